@@ -7,12 +7,17 @@
 extern "C" {
 #	include <memory.h>
 }
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <string>
 #include <limits>
 
 #include "AudioBuffer.h"
+#include "AudioChannelMixer.h"
 #include "AudioError.h"
+#include "AudioRequantizer.h"
+#include "AudioTrace.h"
 
 #include <iostream>
 
@@ -20,10 +25,23 @@ namespace com {
 namespace nealrame {
 namespace audio {
 
+template<typename SOURCE, typename DEST>
+struct Resampler;
+
+template<typename DEST>
+struct Resampler<float, DEST> {
+	static inline DEST value(float v) {
+		// Clip to the destination range and round to nearest.
+		const float lo = std::numeric_limits<DEST>::min();
+		const float hi = std::numeric_limits<DEST>::max();
+		return static_cast<DEST>(std::nearbyint(std::min(std::max(v*hi, lo), hi)));
+	}
+};
+
 template<typename SOURCE, typename DEST>
 struct Resampler {
 	static inline DEST value(SOURCE v) {
-		return Resampler<SOURCE, float>::value(v)*std::numeric_limits<DEST>::max();
+		return Resampler<float, DEST>::value(Resampler<SOURCE, float>::value(v));
 	}
 };
 
@@ -41,13 +59,6 @@ struct Resampler<SOURCE, float> {
 	}
 };
 
-template<typename DEST>
-struct Resampler<float, DEST> {
-	static inline DEST value(float v) {
-		return v*std::numeric_limits<DEST>::max();
-	}
-};
-
 Buffer::Buffer(Format format) :
 	_format(format),
 	_frameCount(0),
@@ -60,8 +71,15 @@ Buffer::Buffer(Format format, size_t size, char *samples) :
 	_samples = samples;
 }
 
+Buffer::Buffer(Format format, size_t size, const char *samples, std::shared_ptr<const void> owner) :
+	_format(format),
+	_frameCount(format.frameCountForSize(size)),
+	_samples(const_cast<char *>(samples)),
+	_owner(owner) {
+}
+
 Buffer::~Buffer() {
-	if (! isNull()) {
+	if (! isNull() && ! _owner) {
 		delete _samples;
 	}
 }
@@ -139,7 +157,7 @@ unsigned int Buffer::read(unsigned int offset, unsigned int frameCount, int8_t *
 		break;
 
 	case 16:
-		_transfer(frameCount, channel_count, (int8_t *)ptr, dst);
+		_transfer(frameCount, channel_count, (int16_t *)ptr, dst);
 		break;
 	}
 	return frameCount;
@@ -157,7 +175,7 @@ unsigned int Buffer::read(unsigned int offset, unsigned int frameCount, int16_t
 		break;
 
 	case 16:
-		_transfer(frameCount, channel_count, (int8_t *)ptr, dst);
+		_transfer(frameCount, channel_count, (int16_t *)ptr, dst);
 		break;
 	}
 	return frameCount;
@@ -355,10 +373,157 @@ void Buffer::write(unsigned int offset, unsigned int frameCount, const float **s
 	}
 }
 
+// Frames are mixed by blocks into a planar float scratch living on the
+// stack, then converted straight into the buffer samples.
+#define MIX_BLOCK_FRAME_COUNT 256
+
+template<typename SOURCE>
+void Buffer::writeMixed(unsigned int offset, unsigned int frameCount, const SOURCE *interleaved, const SOURCE **planar, const ChannelMixer &mixer, Requantizer *requantizer) {
+	unsigned int channel_count = _format.channelCount();
+
+	if (mixer.outputChannelCount() != channel_count) {
+		Error::raise(Error::Status::FormatBadValue, "Channel mixer does not match buffer format.");
+	}
+	if ((offset + frameCount) > _frameCount) {
+		resize(offset + frameCount);
+	}
+
+	float scratch[ChannelMixer::MaxChannelCount*MIX_BLOCK_FRAME_COUNT];
+	float *planes[ChannelMixer::MaxChannelCount];
+	const SOURCE *src_planes[ChannelMixer::MaxChannelCount];
+
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		planes[c] = scratch + c*MIX_BLOCK_FRAME_COUNT;
+	}
+
+	for (unsigned int done = 0; done < frameCount; done += MIX_BLOCK_FRAME_COUNT) {
+		unsigned int count = std::min(frameCount - done, (unsigned int)MIX_BLOCK_FRAME_COUNT);
+		char *ptr = _samples + _format.sizeForFrameCount(offset + done);
+
+		if (planar != nullptr) {
+			for (unsigned int c = 0; c < mixer.inputChannelCount(); ++c) {
+				src_planes[c] = planar[c] + done;
+			}
+			mixer.mix(count, src_planes, planes);
+		} else {
+			mixer.mix(count, interleaved + done*mixer.inputChannelCount(), planes);
+		}
+
+		switch (_format.bitDepth()) {
+		case 8:
+			if (requantizer != nullptr) {
+				requantizer->quantize(count, channel_count, planes, (int8_t *)ptr);
+			} else {
+				_transfer(count, channel_count, (const float **)planes, (int8_t *)ptr);
+			}
+			break;
+
+		case 16:
+			if (requantizer != nullptr) {
+				requantizer->quantize(count, channel_count, planes, (int16_t *)ptr);
+			} else {
+				_transfer(count, channel_count, (const float **)planes, (int16_t *)ptr);
+			}
+			break;
+		}
+	}
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int8_t *src, const ChannelMixer &mixer) {
+	writeMixed<int8_t>(offset, frameCount, src, nullptr, mixer, nullptr);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int16_t *src, const ChannelMixer &mixer) {
+	writeMixed<int16_t>(offset, frameCount, src, nullptr, mixer, nullptr);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const float *src, const ChannelMixer &mixer) {
+	writeMixed<float>(offset, frameCount, src, nullptr, mixer, nullptr);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int8_t **src, const ChannelMixer &mixer) {
+	writeMixed<int8_t>(offset, frameCount, nullptr, src, mixer, nullptr);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int16_t **src, const ChannelMixer &mixer) {
+	writeMixed<int16_t>(offset, frameCount, nullptr, src, mixer, nullptr);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const float **src, const ChannelMixer &mixer) {
+	writeMixed<float>(offset, frameCount, nullptr, src, mixer, nullptr);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int8_t *src, const ChannelMixer &mixer, Requantizer &requantizer) {
+	writeMixed<int8_t>(offset, frameCount, src, nullptr, mixer, &requantizer);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int16_t *src, const ChannelMixer &mixer, Requantizer &requantizer) {
+	writeMixed<int16_t>(offset, frameCount, src, nullptr, mixer, &requantizer);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const float *src, const ChannelMixer &mixer, Requantizer &requantizer) {
+	writeMixed<float>(offset, frameCount, src, nullptr, mixer, &requantizer);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int8_t **src, const ChannelMixer &mixer, Requantizer &requantizer) {
+	writeMixed<int8_t>(offset, frameCount, nullptr, src, mixer, &requantizer);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const int16_t **src, const ChannelMixer &mixer, Requantizer &requantizer) {
+	writeMixed<int16_t>(offset, frameCount, nullptr, src, mixer, &requantizer);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const float **src, const ChannelMixer &mixer, Requantizer &requantizer) {
+	writeMixed<float>(offset, frameCount, nullptr, src, mixer, &requantizer);
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const float *src, Requantizer &requantizer) {
+	if ((offset + frameCount) > _frameCount) {
+		resize(offset + frameCount);
+	}
+	char *ptr = _samples + _format.sizeForFrameCount(offset);
+	unsigned int channel_count = _format.channelCount();
+	switch (_format.bitDepth()) {
+	case 8:
+		requantizer.quantize(frameCount, channel_count, src, (int8_t *)ptr);
+		break;
+
+	case 16:
+		requantizer.quantize(frameCount, channel_count, src, (int16_t *)ptr);
+		break;
+	}
+}
+
+void Buffer::write(unsigned int offset, unsigned int frameCount, const float **src, Requantizer &requantizer) {
+	if ((offset + frameCount) > _frameCount) {
+		resize(offset + frameCount);
+	}
+	char *ptr = _samples + _format.sizeForFrameCount(offset);
+	unsigned int channel_count = _format.channelCount();
+	switch (_format.bitDepth()) {
+	case 8:
+		requantizer.quantize(frameCount, channel_count, src, (int8_t *)ptr);
+		break;
+
+	case 16:
+		requantizer.quantize(frameCount, channel_count, src, (int16_t *)ptr);
+		break;
+	}
+}
+
 void Buffer::resize(unsigned int count) {
+	Trace::Span span("buffer.resize", "memory");
 	size_t size = _format.sizeForFrameCount(count);
+	if (_owner) {
+		// Samples owned by someone else are copied to our own storage.
+		char *samples = static_cast<char *>(malloc(size));
+		memcpy(samples, _samples, std::min(size, _format.sizeForFrameCount(_frameCount)));
+		_samples = samples;
+		_owner.reset();
+	} else {
+		_samples = static_cast<char *>((_samples == NULL) ? malloc(size) : realloc(_samples, size));
+	}
 	_frameCount = count;
-	_samples = static_cast<char *>((_samples == NULL) ? malloc(size) : realloc(_samples, size));
 }
 
 } /* namespace audio */
@@ -8,16 +8,24 @@
 #ifndef BUFFER_H_
 #define BUFFER_H_
 
+#include <memory>
+
 #include "AudioFormat.h"
 
 namespace com {
 namespace nealrame {
 namespace audio {
-
+class ChannelMixer;
+class Requantizer;
 class Buffer {
 public:
 	Buffer(Format);
 	Buffer(Format, size_t size, char *samples);
+	// Wrap samples owned by someone else (a shared memory mapping, a
+	// cache), kept alive by `owner` as long as the buffer. Growing the
+	// buffer copies the samples to its own storage first, writing in place
+	// needs writable samples.
+	Buffer(Format, size_t size, const char *samples, std::shared_ptr<const void> owner);
 	virtual ~Buffer();
 
 public:
@@ -47,16 +55,43 @@ public:
 	void write(unsigned int offset, unsigned int count, const int16_t **);
 	void write(unsigned int offset, unsigned int count, const float **);
 
+	// Mix the source frames through the given mixer while writing them. The
+	// mixer output channel count must match this buffer channel count.
+	void write(unsigned int offset, unsigned int count, const int8_t  *, const ChannelMixer &);
+	void write(unsigned int offset, unsigned int count, const int16_t *, const ChannelMixer &);
+	void write(unsigned int offset, unsigned int count, const float   *, const ChannelMixer &);
+
+	void write(unsigned int offset, unsigned int count, const int8_t  **, const ChannelMixer &);
+	void write(unsigned int offset, unsigned int count, const int16_t **, const ChannelMixer &);
+	void write(unsigned int offset, unsigned int count, const float   **, const ChannelMixer &);
+
+	// Float frames are converted through the given requantizer (dither and
+	// noise shaping) instead of being plainly rounded.
+	void write(unsigned int offset, unsigned int count, const float *, Requantizer &);
+	void write(unsigned int offset, unsigned int count, const float **, Requantizer &);
+
+	void write(unsigned int offset, unsigned int count, const int8_t  *, const ChannelMixer &, Requantizer &);
+	void write(unsigned int offset, unsigned int count, const int16_t *, const ChannelMixer &, Requantizer &);
+	void write(unsigned int offset, unsigned int count, const float   *, const ChannelMixer &, Requantizer &);
+
+	void write(unsigned int offset, unsigned int count, const int8_t  **, const ChannelMixer &, Requantizer &);
+	void write(unsigned int offset, unsigned int count, const int16_t **, const ChannelMixer &, Requantizer &);
+	void write(unsigned int offset, unsigned int count, const float   **, const ChannelMixer &, Requantizer &);
+
 	void resize(unsigned int frameCount);
 
 private:
 	size_t readFrame (const char *src, float  *dst) const;
 	size_t readFrame (const char *src, float **dst, unsigned int frame_index) const;
 
+	template<typename SOURCE>
+	void writeMixed(unsigned int offset, unsigned int count, const SOURCE *interleaved, const SOURCE **planar, const ChannelMixer &, Requantizer *);
+
 private:
 	Format _format;
 	unsigned int _frameCount;
 	char *_samples;
+	std::shared_ptr<const void> _owner;
 };
 
 } /* namespace audio */
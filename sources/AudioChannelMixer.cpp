@@ -0,0 +1,203 @@
+/*
+ * AudioChannelMixer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "AudioChannelMixer.h"
+#include "AudioError.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int ChannelMixer::MaxChannelCount;
+
+ChannelMixer ChannelMixer::identity(unsigned int channelCount) {
+	std::vector<float> gains(channelCount*channelCount, 0.0f);
+	for (unsigned int i = 0; i < channelCount; ++i) {
+		gains[i*channelCount + i] = 1.0f;
+	}
+	return ChannelMixer(channelCount, channelCount, gains);
+}
+
+ChannelMixer ChannelMixer::stereoToMono() {
+	return ChannelMixer(2, 1, { 0.5f, 0.5f });
+}
+
+ChannelMixer ChannelMixer::monoToStereo() {
+	return ChannelMixer(1, 2, { 1.0f, 1.0f });
+}
+
+struct Surround51 {
+	unsigned int left, right, center, lfe, left_surround, right_surround;
+};
+
+static Surround51 surround51_channels(ChannelMixer::ChannelOrder order) {
+	switch (order) {
+	case ChannelMixer::ChannelOrder::Vorbis:
+		return Surround51{ 0, 2, 1, 5, 3, 4 };
+	case ChannelMixer::ChannelOrder::Wave:
+	default:
+		break;
+	}
+	return Surround51{ 0, 1, 2, 3, 4, 5 };
+}
+
+ChannelMixer ChannelMixer::surround51ToStereo(ChannelOrder order) {
+	const float m3db = static_cast<float>(M_SQRT1_2);
+	const float norm = 1.0f/(1.0f + 2*m3db);
+	Surround51 ch = surround51_channels(order);
+	ChannelMixer mixer(6, 2, std::vector<float>(12, 0.0f));
+
+	mixer.setGain(0, ch.left, norm)
+		.setGain(0, ch.center, m3db*norm)
+		.setGain(0, ch.left_surround, m3db*norm)
+		.setGain(1, ch.right, norm)
+		.setGain(1, ch.center, m3db*norm)
+		.setGain(1, ch.right_surround, m3db*norm);
+
+	return mixer;
+}
+
+ChannelMixer ChannelMixer::surround51ToMono(ChannelOrder order) {
+	ChannelMixer stereo = surround51ToStereo(order);
+	ChannelMixer mixer(6, 1, std::vector<float>(6, 0.0f));
+	for (unsigned int i = 0; i < 6; ++i) {
+		mixer.setGain(0, i, 0.5f*(stereo.gain(0, i) + stereo.gain(1, i)));
+	}
+	return mixer;
+}
+
+ChannelMixer ChannelMixer::downmix(unsigned int inputCount, unsigned int outputCount, ChannelOrder order) {
+	if (inputCount == outputCount) {
+		return identity(inputCount);
+	}
+	if (inputCount == 2 && outputCount == 1) {
+		return stereoToMono();
+	}
+	if (inputCount == 1 && outputCount == 2) {
+		return monoToStereo();
+	}
+	if (inputCount == 6 && outputCount == 2) {
+		return surround51ToStereo(order);
+	}
+	if (inputCount == 6 && outputCount == 1) {
+		return surround51ToMono(order);
+	}
+	throw Error(Error::Status::FormatBadValue, "No default channel mixer for this layout.");
+}
+
+ChannelMixer::ChannelMixer(unsigned int inputCount, unsigned int outputCount, const std::vector<float> &gains) :
+	_inputChannelCount(inputCount),
+	_outputChannelCount(outputCount),
+	_gains(gains) {
+	if (inputCount < 1 || outputCount < 1
+		|| inputCount > MaxChannelCount || outputCount > MaxChannelCount) {
+		Error::raise(Error::Status::FormatBadValue, "Bad channel mixer channel count.");
+	}
+	if (gains.size() != inputCount*outputCount) {
+		Error::raise(Error::Status::FormatBadValue, "Bad channel mixer gain matrix size.");
+	}
+}
+
+float ChannelMixer::gain(unsigned int output, unsigned int input) const {
+	return _gains[output*_inputChannelCount + input];
+}
+
+ChannelMixer & ChannelMixer::setGain(unsigned int output, unsigned int input, float gain) {
+	if (output >= _outputChannelCount || input >= _inputChannelCount) {
+		Error::raise(Error::Status::FormatBadValue, "Bad channel mixer channel index.");
+	}
+	_gains[output*_inputChannelCount + input] = gain;
+	return *this;
+}
+
+template<typename SOURCE>
+struct SampleScale {
+	static inline float value() {
+		return 1.0f/std::numeric_limits<SOURCE>::max();
+	}
+};
+
+template<>
+struct SampleScale<float> {
+	static inline float value() {
+		return 1.0f;
+	}
+};
+
+// Both loops below walk one output channel at a time over contiguous
+// frames so that the compiler can vectorise the multiply-add.
+
+template<typename SOURCE>
+void _mix(const std::vector<float> &gains, unsigned int in_count, unsigned int out_count,
+		unsigned int frameCount, const SOURCE * const *src, float **dst) {
+	const float scale = SampleScale<SOURCE>::value();
+	for (unsigned int o = 0; o < out_count; ++o) {
+		float * __restrict__ out = dst[o];
+		for (unsigned int i = 0; i < frameCount; ++i) {
+			out[i] = 0.0f;
+		}
+		for (unsigned int c = 0; c < in_count; ++c) {
+			const float g = gains[o*in_count + c]*scale;
+			if (g == 0.0f) continue;
+			const SOURCE * __restrict__ in = src[c];
+			for (unsigned int i = 0; i < frameCount; ++i) {
+				out[i] += g*static_cast<float>(in[i]);
+			}
+		}
+	}
+}
+
+template<typename SOURCE>
+void _mix(const std::vector<float> &gains, unsigned int in_count, unsigned int out_count,
+		unsigned int frameCount, const SOURCE *src, float **dst) {
+	const float scale = SampleScale<SOURCE>::value();
+	for (unsigned int o = 0; o < out_count; ++o) {
+		float * __restrict__ out = dst[o];
+		for (unsigned int i = 0; i < frameCount; ++i) {
+			out[i] = 0.0f;
+		}
+		for (unsigned int c = 0; c < in_count; ++c) {
+			const float g = gains[o*in_count + c]*scale;
+			if (g == 0.0f) continue;
+			const SOURCE * __restrict__ in = src + c;
+			for (unsigned int i = 0; i < frameCount; ++i) {
+				out[i] += g*static_cast<float>(in[i*in_count]);
+			}
+		}
+	}
+}
+
+void ChannelMixer::mix(unsigned int frameCount, const float * const *src, float **dst) const {
+	_mix(_gains, _inputChannelCount, _outputChannelCount, frameCount, src, dst);
+}
+
+void ChannelMixer::mix(unsigned int frameCount, const int16_t * const *src, float **dst) const {
+	_mix(_gains, _inputChannelCount, _outputChannelCount, frameCount, src, dst);
+}
+
+void ChannelMixer::mix(unsigned int frameCount, const int8_t * const *src, float **dst) const {
+	_mix(_gains, _inputChannelCount, _outputChannelCount, frameCount, src, dst);
+}
+
+void ChannelMixer::mix(unsigned int frameCount, const float *src, float **dst) const {
+	_mix(_gains, _inputChannelCount, _outputChannelCount, frameCount, src, dst);
+}
+
+void ChannelMixer::mix(unsigned int frameCount, const int16_t *src, float **dst) const {
+	_mix(_gains, _inputChannelCount, _outputChannelCount, frameCount, src, dst);
+}
+
+void ChannelMixer::mix(unsigned int frameCount, const int8_t *src, float **dst) const {
+	_mix(_gains, _inputChannelCount, _outputChannelCount, frameCount, src, dst);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,116 @@
+/*
+ * AudioChannelMixer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOCHANNELMIXER_H_
+#define AUDIOCHANNELMIXER_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class ChannelMixer
+ * A `ChannelMixer` maps `inputChannelCount()` channels onto
+ * `outputChannelCount()` channels through a gain matrix:
+ *     out[o] = sum(gain(o, i)*in[i])
+ * Mixing is done block by block on planar float scratch so the inner loops
+ * vectorise. Integer sources are scaled to [-1, 1] on the fly.
+ */
+class ChannelMixer {
+public:
+	/**
+	 * ### Channel order
+	 * 5.1 streams do not store their channels in the same order:
+	 * * `ChannelOrder::Wave`:   L, R, C, LFE, Ls, Rs (WAV, MP3),
+	 * * `ChannelOrder::Vorbis`: L, C, R, Ls, Rs, LFE (Ogg Vorbis).
+	 */
+	enum class ChannelOrder {
+		Wave,
+		Vorbis,
+	};
+
+	/** Maximum number of input or output channels a mixer can handle. */
+	static const unsigned int MaxChannelCount = 32;
+
+public:
+	/**
+	 * * `ChannelMixer identity(unsigned int channelCount)`
+	 *     Pass through mixer.
+	 */
+	static ChannelMixer identity(unsigned int channelCount);
+	/**
+	 * * `ChannelMixer stereoToMono()`
+	 *     Average left and right channels.
+	 */
+	static ChannelMixer stereoToMono();
+	/**
+	 * * `ChannelMixer monoToStereo()`
+	 *     Duplicate the mono channel on left and right.
+	 */
+	static ChannelMixer monoToStereo();
+	/**
+	 * * `ChannelMixer surround51ToStereo(ChannelOrder)`
+	 *     ITU-R BS.775 downmix (center and surrounds at -3dB, LFE dropped),
+	 *     normalized so that a full scale input can not clip.
+	 */
+	static ChannelMixer surround51ToStereo(ChannelOrder order = ChannelOrder::Wave);
+	/**
+	 * * `ChannelMixer surround51ToMono(ChannelOrder)`
+	 */
+	static ChannelMixer surround51ToMono(ChannelOrder order = ChannelOrder::Wave);
+	/**
+	 * * `ChannelMixer downmix(unsigned int inputCount, unsigned int outputCount)`
+	 *     Pick one of the above mixers for the given channel counts. Raise
+	 *     `Error::Status::FormatBadValue` if there is no sensible default.
+	 */
+	static ChannelMixer downmix(unsigned int inputCount, unsigned int outputCount, ChannelOrder order = ChannelOrder::Wave);
+
+public:
+	/**
+	 * * `ChannelMixer(unsigned int inputCount, unsigned int outputCount, const std::vector<float> &gains)`
+	 *     Build a mixer from a row-major `outputCount` x `inputCount` gain
+	 *     matrix.
+	 */
+	ChannelMixer(unsigned int inputCount, unsigned int outputCount, const std::vector<float> &gains);
+
+public:
+	unsigned int inputChannelCount() const { return _inputChannelCount; }
+	unsigned int outputChannelCount() const { return _outputChannelCount; }
+
+	float gain(unsigned int output, unsigned int input) const;
+	ChannelMixer & setGain(unsigned int output, unsigned int input, float gain);
+
+	/**
+	 * * `void mix(unsigned int frameCount, const T * const *src, float **dst) const`
+	 *     Mix `frameCount` planar source frames into `outputChannelCount()`
+	 *     planar float channels.
+	 */
+	void mix(unsigned int frameCount, const float   * const *src, float **dst) const;
+	void mix(unsigned int frameCount, const int16_t * const *src, float **dst) const;
+	void mix(unsigned int frameCount, const int8_t  * const *src, float **dst) const;
+
+	/**
+	 * * `void mix(unsigned int frameCount, const T *src, float **dst) const`
+	 *     Same as above with interleaved source frames.
+	 */
+	void mix(unsigned int frameCount, const float   *src, float **dst) const;
+	void mix(unsigned int frameCount, const int16_t *src, float **dst) const;
+	void mix(unsigned int frameCount, const int8_t  *src, float **dst) const;
+
+private:
+	unsigned int _inputChannelCount;
+	unsigned int _outputChannelCount;
+	std::vector<float> _gains;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOCHANNELMIXER_H_ */
@@ -0,0 +1,369 @@
+/*
+ * AudioCompressedBuffer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "AudioBuffer.h"
+#include "AudioCompressedBuffer.h"
+#include "AudioError.h"
+#include "AudioTrace.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int CompressedBuffer::DefaultBlockFrameCount;
+const unsigned int CompressedBuffer::CacheBlockCount;
+
+namespace {
+
+enum BlockKind : uint8_t {
+	Coded = 0,
+	Verbatim = 1,
+};
+
+const unsigned int MaxOrder = 3;
+const unsigned int MaxRiceParameter = 20;
+// Quotients from this one are escaped: the residual follows on 32 bits.
+const unsigned int EscapeQuotient = 24;
+// The bit reader loads 8 bytes at a time, up to 8 bytes ahead of the bits
+// it returns.
+const size_t Padding = 16;
+
+struct CachedBlock {
+	uint64_t id;
+	unsigned int block;
+	std::shared_ptr<std::vector<char>> samples;
+};
+
+thread_local CachedBlock block_cache[CompressedBuffer::CacheBlockCount];
+thread_local unsigned int block_cache_next;
+
+std::atomic<uint64_t> next_id(1);
+
+inline uint32_t zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t unzigzag(uint32_t value) {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// MSB first bit writer.
+class BitWriter {
+public:
+	BitWriter(std::vector<uint8_t> &output) : _output(output), _bits(0), _count(0) {}
+
+	void put(uint32_t value, unsigned int count) {
+		_bits = (_bits << count) | (value & (uint32_t)((1ull << count) - 1));
+		_count += count;
+		while (_count >= 8) {
+			_count -= 8;
+			_output.push_back((uint8_t)(_bits >> _count));
+		}
+	}
+
+	void rice(uint32_t value, unsigned int k) {
+		uint32_t quotient = value >> k;
+		if (quotient < EscapeQuotient) {
+			put(1, quotient + 1);
+			put(value, k);
+		} else {
+			put(1, EscapeQuotient + 1);
+			put(value, 32);
+		}
+	}
+
+	void flush() {
+		if (_count > 0) {
+			put(0, 8 - _count);
+		}
+	}
+
+private:
+	std::vector<uint8_t> &_output;
+	uint64_t _bits;
+	unsigned int _count;
+};
+
+// MSB first bit reader, refilled by 64 bits loads: the input must be
+// followed by `Padding` readable bytes.
+class BitReader {
+public:
+	explicit BitReader(const uint8_t *input) : _input(input), _bits(0), _count(0) {
+		refill();
+	}
+
+	inline void refill() {
+		uint64_t word;
+		memcpy(&word, _input, sizeof(word));
+		_bits |= __builtin_bswap64(word) >> _count;
+		_input += (63 - _count) >> 3;
+		_count |= 56;
+	}
+
+	// At most 32 bits, refill before.
+	inline uint32_t get(unsigned int count) {
+		if (count == 0) return 0;
+		uint32_t value = (uint32_t)(_bits >> (64 - count));
+		_bits <<= count;
+		_count -= count;
+		return value;
+	}
+
+	inline uint32_t rice(unsigned int k) {
+		refill();
+		unsigned int quotient = __builtin_clzll(_bits | 1);
+		_bits <<= quotient + 1;
+		_count -= quotient + 1;
+		if (__builtin_expect(quotient >= EscapeQuotient, 0)) {
+			refill();
+			return get(32);
+		}
+		// Branchless for k = 0.
+		uint32_t remainder = (uint32_t)((_bits >> 1) >> (63 - k));
+		_bits <<= k;
+		_count -= k;
+		return (quotient << k) | remainder;
+	}
+
+private:
+	const uint8_t *_input;
+	uint64_t _bits;
+	unsigned int _count;
+};
+
+template<typename SAMPLE>
+void encode_channel(BitWriter &writer, const SAMPLE *src, unsigned int stride, unsigned int count, unsigned int bitDepth, std::vector<uint32_t> &residuals) {
+	// Pick the fixed predictor with the smallest residuals.
+	uint64_t sums[MaxOrder + 1] = { 0, 0, 0, 0 };
+	for (unsigned int i = MaxOrder; i < count; ++i) {
+		int32_t x0 = src[i*stride], x1 = src[(i - 1)*stride], x2 = src[(i - 2)*stride], x3 = src[(i - 3)*stride];
+		sums[0] += std::abs(x0);
+		sums[1] += std::abs(x0 - x1);
+		sums[2] += std::abs(x0 - 2*x1 + x2);
+		sums[3] += std::abs(x0 - 3*x1 + 3*x2 - x3);
+	}
+	unsigned int order = 0;
+	if (count > MaxOrder) {
+		order = std::min_element(sums, sums + MaxOrder + 1) - sums;
+	}
+
+	uint64_t sum = 0;
+	residuals.resize(count);
+	for (unsigned int i = order; i < count; ++i) {
+		int32_t prediction = 0;
+		switch (order) {
+		case 1: prediction = src[(i - 1)*stride]; break;
+		case 2: prediction = 2*src[(i - 1)*stride] - src[(i - 2)*stride]; break;
+		case 3: prediction = 3*src[(i - 1)*stride] - 3*src[(i - 2)*stride] + src[(i - 3)*stride]; break;
+		}
+		sum += residuals[i] = zigzag(src[i*stride] - prediction);
+	}
+	unsigned int k = 0;
+	if (count > order) {
+		uint64_t mean = sum/(count - order);
+		while (k < MaxRiceParameter && (2ull << k) <= mean) {
+			++k;
+		}
+	}
+
+	writer.put(order, 2);
+	writer.put(k, 5);
+	for (unsigned int i = 0; i < order; ++i) {
+		writer.put((uint32_t)src[i*stride], bitDepth);
+	}
+	for (unsigned int i = order; i < count; ++i) {
+		writer.rice(residuals[i], k);
+	}
+}
+
+// The reader is copied in a local so that its state stays in registers
+// whatever the sample stores alias.
+template<typename SAMPLE>
+void decode_channel(BitReader &input, SAMPLE *dst, unsigned int stride, unsigned int count, unsigned int bitDepth) {
+	BitReader reader(input);
+	reader.refill();
+	unsigned int order = std::min(reader.get(2), count);
+	unsigned int k = reader.get(5);
+	int32_t x1 = 0, x2 = 0, x3 = 0;
+
+	for (unsigned int i = 0; i < order; ++i) {
+		reader.refill();
+		int32_t x = (int32_t)(reader.get(bitDepth) << (32 - bitDepth)) >> (32 - bitDepth);
+		dst[i*stride] = x;
+		x3 = x2; x2 = x1; x1 = x;
+	}
+	switch (order) {
+	case 0:
+		for (unsigned int i = 0; i < count; ++i) {
+			dst[i*stride] = unzigzag(reader.rice(k));
+		}
+		break;
+	case 1:
+		for (unsigned int i = 1; i < count; ++i) {
+			x1 += unzigzag(reader.rice(k));
+			dst[i*stride] = x1;
+		}
+		break;
+	case 2:
+		for (unsigned int i = 2; i < count; ++i) {
+			int32_t x = unzigzag(reader.rice(k)) + 2*x1 - x2;
+			dst[i*stride] = x;
+			x2 = x1; x1 = x;
+		}
+		break;
+	case 3:
+		for (unsigned int i = 3; i < count; ++i) {
+			int32_t x = unzigzag(reader.rice(k)) + 3*x1 - 3*x2 + x3;
+			dst[i*stride] = x;
+			x3 = x2; x2 = x1; x1 = x;
+		}
+		break;
+	}
+	input = reader;
+}
+
+}
+
+CompressedBuffer::CompressedBuffer(const Buffer &buffer, unsigned int blockFrameCount) :
+	_format(buffer.format()),
+	_frameCount(buffer.frameCount()),
+	_blockFrameCount(std::max(blockFrameCount, 1u)),
+	_id(next_id++) {
+	Trace::Span span("compressed_buffer.compress", "memory");
+	if (_format.bitDepth() != 8 && _format.bitDepth() != 16) {
+		Error::raise(Error::Status::FormatBadValue, "Unsupported bit depth.");
+	}
+
+	for (unsigned int offset = 0; offset < _frameCount; offset += _blockFrameCount) {
+		_offsets.push_back(_data.size());
+		compressBlock(buffer.data() + _format.sizeForFrameCount(offset), std::min(_blockFrameCount, _frameCount - offset));
+	}
+	_offsets.push_back(_data.size());
+	_data.resize(_data.size() + Padding);
+	_data.shrink_to_fit();
+}
+
+size_t CompressedBuffer::compressedSize() const {
+	return _data.size() + _offsets.size()*sizeof(uint64_t);
+}
+
+void CompressedBuffer::compressBlock(const char *samples, unsigned int frameCount) {
+	size_t start = _data.size();
+	size_t size = _format.sizeForFrameCount(frameCount);
+	unsigned int channel_count = _format.channelCount();
+	std::vector<uint32_t> residuals;
+	BitWriter writer(_data);
+
+	_data.push_back(Coded);
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		if (_format.bitDepth() == 8) {
+			encode_channel(writer, (const int8_t *)samples + c, channel_count, frameCount, 8, residuals);
+		} else {
+			encode_channel(writer, (const int16_t *)samples + c, channel_count, frameCount, 16, residuals);
+		}
+	}
+	writer.flush();
+
+	if (_data.size() - start > size) {
+		_data.resize(start);
+		_data.push_back(Verbatim);
+		_data.insert(_data.end(), samples, samples + size);
+	}
+}
+
+void CompressedBuffer::decompressBlock(unsigned int block, char *samples) const {
+	const uint8_t *data = _data.data() + _offsets[block];
+	unsigned int offset = block*_blockFrameCount;
+	unsigned int frame_count = std::min(_blockFrameCount, _frameCount - offset);
+	unsigned int channel_count = _format.channelCount();
+
+	if (*data == Verbatim) {
+		memcpy(samples, data + 1, _format.sizeForFrameCount(frame_count));
+		return;
+	}
+	BitReader reader(data + 1);
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		if (_format.bitDepth() == 8) {
+			decode_channel(reader, (int8_t *)samples + c, channel_count, frame_count, 8);
+		} else {
+			decode_channel(reader, (int16_t *)samples + c, channel_count, frame_count, 16);
+		}
+	}
+}
+
+// Get a decoded block from the calling thread cache.
+std::shared_ptr<std::vector<char>> CompressedBuffer::block(unsigned int block) const {
+	for (CachedBlock &cached : block_cache) {
+		if (cached.id == _id && cached.block == block) {
+			return cached.samples;
+		}
+	}
+
+	CachedBlock &cached = block_cache[block_cache_next];
+	block_cache_next = (block_cache_next + 1) % CacheBlockCount;
+	// A buffer still using the previous samples keeps them.
+	if (! cached.samples || ! cached.samples.unique()) {
+		cached.samples = std::make_shared<std::vector<char>>();
+	}
+	cached.samples->resize(_format.sizeForFrameCount(_blockFrameCount));
+	cached.id = _id;
+	cached.block = block;
+	decompressBlock(block, cached.samples->data());
+	return cached.samples;
+}
+
+template<typename T>
+unsigned int CompressedBuffer::readFrames(unsigned int offset, unsigned int count, T *dst) const {
+	if (offset + count > _frameCount) {
+		count = offset < _frameCount ? _frameCount - offset : 0;
+	}
+	unsigned int done = 0;
+	while (done < count) {
+		unsigned int index = (offset + done)/_blockFrameCount;
+		unsigned int start = (offset + done)%_blockFrameCount;
+		unsigned int n = std::min(count - done, _blockFrameCount - start);
+		std::shared_ptr<std::vector<char>> samples = block(index);
+		// Convert through a buffer over the decoded block, without copy.
+		Buffer view(_format, _format.sizeForFrameCount(start + n), samples->data(), samples);
+		view.read(start, n, dst + (size_t)done*_format.channelCount());
+		done += n;
+	}
+	return count;
+}
+
+unsigned int CompressedBuffer::read(unsigned int offset, unsigned int count, float *dst) const {
+	return readFrames(offset, count, dst);
+}
+
+unsigned int CompressedBuffer::read(unsigned int offset, unsigned int count, int8_t *dst) const {
+	return readFrames(offset, count, dst);
+}
+
+unsigned int CompressedBuffer::read(unsigned int offset, unsigned int count, int16_t *dst) const {
+	return readFrames(offset, count, dst);
+}
+
+Buffer * CompressedBuffer::decompress() const {
+	Trace::Span span("compressed_buffer.decompress", "memory");
+	size_t size = _format.sizeForFrameCount(_frameCount);
+	char *samples = static_cast<char *>(malloc(size));
+
+	for (unsigned int block = 0; block < _offsets.size() - 1; ++block) {
+		decompressBlock(block, samples + _format.sizeForFrameCount(block*_blockFrameCount));
+	}
+	return new Buffer(_format, size, samples);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,93 @@
+/*
+ * AudioCompressedBuffer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOCOMPRESSEDBUFFER_H_
+#define AUDIOCOMPRESSEDBUFFER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AudioFormat.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+/**
+ * ## Class CompressedBuffer
+ * A read-only copy of a `Buffer`, losslessly compressed in memory, for
+ * tracks which stay resident.
+ *
+ * Frames are split in blocks of `blockFrameCount()` frames. In a block,
+ * each channel is predicted by the best of the fixed polynomial predictors
+ * of order 0 to 3, and the residuals are Rice coded with a parameter
+ * chosen for the block. Blocks which do not compress are stored verbatim.
+ *
+ * Blocks are located by frame in O(1) through an offset table. Reads
+ * decode the blocks they need into a small per-thread cache of decoded
+ * blocks, so sequential reads by small counts decode each block once.
+ * Concurrent reads are safe.
+ */
+class CompressedBuffer {
+public:
+	static const unsigned int DefaultBlockFrameCount = 4096;
+	static const unsigned int CacheBlockCount = 4;
+
+public:
+	/**
+	 * * `CompressedBuffer(const Buffer &, unsigned int blockFrameCount)`
+	 *     Compress the frames of the given buffer.
+	 */
+	CompressedBuffer(const Buffer &, unsigned int blockFrameCount = DefaultBlockFrameCount);
+	virtual ~CompressedBuffer() {}
+
+public:
+	Format format() const { return _format; }
+	unsigned int frameCount() const { return _frameCount; }
+	double duration() const { return _format.durationForFrameCount(_frameCount); }
+	unsigned int blockFrameCount() const { return _blockFrameCount; }
+	/**
+	 * * `size_t compressedSize() const`
+	 *     Get the memory used by the compressed blocks and their offsets.
+	 */
+	size_t compressedSize() const;
+
+	/**
+	 * * `unsigned int read(unsigned int offset, unsigned int count, T *dst) const`
+	 *     Read interleaved frames, as `Buffer::read` does. Return the count
+	 *     of frames read.
+	 */
+	unsigned int read(unsigned int offset, unsigned int count, float *dst) const;
+	unsigned int read(unsigned int offset, unsigned int count, int8_t *dst) const;
+	unsigned int read(unsigned int offset, unsigned int count, int16_t *dst) const;
+	/**
+	 * * `Buffer * decompress() const`
+	 *     Decode every block in a new buffer.
+	 */
+	Buffer * decompress() const;
+
+private:
+	void compressBlock(const char *samples, unsigned int frameCount);
+	void decompressBlock(unsigned int block, char *samples) const;
+	std::shared_ptr<std::vector<char>> block(unsigned int block) const;
+	template<typename T>
+	unsigned int readFrames(unsigned int offset, unsigned int count, T *dst) const;
+
+private:
+	Format _format;
+	unsigned int _frameCount;
+	unsigned int _blockFrameCount;
+	uint64_t _id;                           // identifies the buffer in the block caches
+	std::vector<uint8_t> _data;
+	std::vector<uint64_t> _offsets;         // block start in _data, one more for the end
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOCOMPRESSEDBUFFER_H_ */
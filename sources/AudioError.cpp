@@ -38,17 +38,26 @@ std::string Error::statusToString(Error::Status status) {
 	case Status::OggVorbisError:
 		return "audio::OggVorbisError";
 
+	case Status::FLACError:
+		return "audio::FLACError";
+
 	case Status::PCMError:
 		return "audio::PCMError";
 
 	case Status::NoSuitableDecoder:
 		return "audio::NoSuitableDecoder";
 
+	case Status::NoSuitableCoder:
+		return "audio::NoSuitableCoder";
+
 	case Status::NotImplemented:
 		return "audio::NotImplemented";
 
 	case Status::UndefinedFormat:
 		return "audio::UndefinedFormat";
+
+	case Status::Cancelled:
+		return "audio::Cancelled";
 	}
 	return "audio:UnknownError";
 }
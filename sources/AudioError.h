@@ -22,10 +22,13 @@ public:
 		FormatBadValue,
 		MP3CodecError,
 		OggVorbisError,
+		FLACError,
 		PCMError,
 		NoSuitableDecoder,
+		NoSuitableCoder,
 		NotImplemented,
 		UndefinedFormat,
+		Cancelled,
 	};
 
 public:
@@ -0,0 +1,316 @@
+/*
+ * AudioExecutor.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "AudioError.h"
+#include "AudioExecutor.h"
+#include "AudioTrace.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+namespace {
+
+thread_local Executor *current_executor = nullptr;
+thread_local unsigned int current_worker = 0;
+
+std::mutex shared_mutex;
+Executor::Configuration shared_configuration;
+bool shared_started = false;
+
+Executor::Configuration start_shared() {
+	std::lock_guard<std::mutex> lock(shared_mutex);
+	shared_started = true;
+	return shared_configuration;
+}
+
+// The NUMA node of a CPU, -1 if unknown.
+int cpu_node(unsigned int cpu) {
+	char path[64];
+	int node = -1;
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+	if (DIR *dir = opendir(path)) {
+		while (struct dirent *entry = readdir(dir)) {
+			if (strncmp(entry->d_name, "node", 4) == 0 && isdigit((unsigned char)entry->d_name[4])) {
+				node = atoi(entry->d_name + 4);
+				break;
+			}
+		}
+		closedir(dir);
+	}
+	return node;
+}
+
+}
+
+Executor & Executor::shared() {
+	static Executor executor(start_shared());
+	return executor;
+}
+
+bool Executor::configureShared(const Configuration &configuration) {
+	std::lock_guard<std::mutex> lock(shared_mutex);
+	if (shared_started) {
+		return false;
+	}
+	shared_configuration = configuration;
+	return true;
+}
+
+Executor::Executor(const Configuration &configuration) :
+	_queued(0),
+	_localMemory(configuration.localMemory),
+	_stop(false) {
+	unsigned int count = configuration.workerCount;
+	if (count == 0) {
+		count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// Check the CPU sets before starting any worker.
+	const std::vector<std::vector<unsigned int>> &cpu_sets = configuration.cpuSets;
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (! cpu_sets.empty() && sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+		Error::raise(Error::Status::FormatBadValue, std::string("Failed to get the CPU affinity: ") + strerror(errno));
+	}
+	for (const std::vector<unsigned int> &cpus : cpu_sets) {
+		if (cpus.empty()) {
+			Error::raise(Error::Status::FormatBadValue, "Empty CPU set.");
+		}
+		for (unsigned int cpu : cpus) {
+			if (cpu >= CPU_SETSIZE || ! CPU_ISSET(cpu, &allowed)) {
+				Error::raise(Error::Status::FormatBadValue, "CPU " + std::to_string(cpu) + " is not available.");
+			}
+		}
+	}
+
+	std::vector<int> nodes(count, -1);
+	for (unsigned int i = 0; i < count; ++i) {
+		_workers.push_back(std::unique_ptr<Worker>(new Worker));
+		if (! cpu_sets.empty()) {
+			nodes[i] = cpu_node(cpu_sets[i % cpu_sets.size()].front());
+		}
+	}
+	for (unsigned int i = 0; i < count; ++i) {
+		std::vector<unsigned int> &victims = _workers[i]->victims;
+		for (unsigned int j = 1; j < count; ++j) {
+			victims.push_back((i + j) % count);
+		}
+		std::stable_partition(victims.begin(), victims.end(), [&](unsigned int victim) {
+			return nodes[victim] == nodes[i];
+		});
+	}
+	for (unsigned int i = 0; i < count; ++i) {
+		std::vector<unsigned int> cpus;
+		if (! cpu_sets.empty()) {
+			cpus = cpu_sets[i % cpu_sets.size()];
+		}
+		_workers[i]->thread = std::thread(&Executor::run, this, i, cpus);
+	}
+}
+
+Executor::~Executor() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (std::unique_ptr<Worker> &worker : _workers) {
+		worker->thread.join();
+	}
+}
+
+// The count of queued tasks is raised before the task is queued, so a
+// worker going to sleep either sees it or is woken.
+void Executor::submit(Task task) {
+	if (current_executor == this) {
+		Worker &worker = *_workers[current_worker];
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			_queued++;
+			worker.tasks.push_back(std::move(task));
+		}
+		std::lock_guard<std::mutex> lock(_mutex);
+	} else {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queued++;
+		_tasks.push_back(std::move(task));
+	}
+	_wake.notify_one();
+}
+
+bool Executor::pop(unsigned int index, Task &task) {
+	Worker &worker = *_workers[index];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (! worker.tasks.empty()) {
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			_queued--;
+			return true;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (! _tasks.empty()) {
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+			_queued--;
+			return true;
+		}
+	}
+	for (unsigned int victim : worker.victims) {
+		Worker &other = *_workers[victim];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		if (! other.tasks.empty()) {
+			task = std::move(other.tasks.front());
+			other.tasks.pop_front();
+			_queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Executor::run(unsigned int index, std::vector<unsigned int> cpus) {
+	std::ostringstream name;
+	name << "executor-" << index;
+	Trace::setThreadName(name.str());
+
+	if (! cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (unsigned int cpu : cpus) {
+			CPU_SET(cpu, &set);
+		}
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+	if (_localMemory) {
+		// The thread policy, without linking libnuma.
+		syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0);
+	}
+	current_executor = this;
+	current_worker = index;
+
+	for (;;) {
+		Task task;
+		if (pop(index, task)) {
+			Trace::Span span("executor.task", "executor");
+			task();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_wake.wait(lock, [this] { return _stop || _queued > 0; });
+		if (_stop && _queued == 0) {
+			return;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Executor::Group ///////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+Executor::Group::Group(unsigned int concurrency, Executor &executor) :
+	_state(std::make_shared<State>(executor, concurrency ? concurrency : executor.workerCount())) {
+}
+
+Executor::Group::~Group() {
+	wait();
+}
+
+void Executor::Group::submit(Task task) {
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		_state->tasks.push_back(std::move(task));
+		if (_state->dispatched >= _state->concurrency) {
+			return;
+		}
+		_state->dispatched++;
+	}
+	dispatch(_state);
+}
+
+// A dispatched task runs the next queued task of the group, if the waiting
+// thread did not take it, then dispatches itself again while there are.
+void Executor::Group::dispatch(std::shared_ptr<State> state) {
+	state->executor.submit([state]() {
+		std::unique_lock<std::mutex> lock(state->mutex);
+		if (! state->tasks.empty()) {
+			Task task(std::move(state->tasks.front()));
+			state->tasks.pop_front();
+			state->running++;
+			lock.unlock();
+			task();
+			lock.lock();
+			state->running--;
+			if (! state->tasks.empty()) {
+				lock.unlock();
+				dispatch(state);
+				return;
+			}
+		}
+		state->dispatched--;
+		if (state->tasks.empty() && state->running == 0) {
+			state->idle.notify_all();
+		}
+	});
+}
+
+void Executor::Group::wait() {
+	std::unique_lock<std::mutex> lock(_state->mutex);
+	for (;;) {
+		if (! _state->tasks.empty()) {
+			lock.unlock();
+			runPending();
+			lock.lock();
+		} else if (_state->running == 0) {
+			return;
+		} else {
+			_state->idle.wait(lock);
+		}
+	}
+}
+
+bool Executor::Group::runPending() {
+	std::unique_lock<std::mutex> lock(_state->mutex);
+	if (_state->tasks.empty()) {
+		return false;
+	}
+	Task task(std::move(_state->tasks.front()));
+	_state->tasks.pop_front();
+	_state->running++;
+	lock.unlock();
+	{
+		Trace::Span span("executor.task", "executor");
+		task();
+	}
+	lock.lock();
+	if (--_state->running == 0 && _state->tasks.empty()) {
+		_state->idle.notify_all();
+	}
+	return true;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
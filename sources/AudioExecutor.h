@@ -0,0 +1,192 @@
+/*
+ * AudioExecutor.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOEXECUTOR_H_
+#define AUDIOEXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class Executor
+ * The worker threads of the library. Every parallel path (asynchronous
+ * decodes and encodes, FLAC frames, wave writes, batch reads, loudness
+ * segments, page prefetch) submits its tasks to the shared executor
+ * instead of starting threads, so a process never runs more compute
+ * threads than it has workers.
+ *
+ * Each worker has its own deque. A task submitted by a worker goes to the
+ * back of its deque and the worker runs its deque from the back, the most
+ * recent task first, while its data are hot. Tasks submitted from other
+ * threads go to a shared queue, run first in, first out. An idle worker
+ * steals from the front of the other deques, those of the workers on the
+ * same NUMA node first.
+ *
+ * Workers are named `executor-<index>` in the trace timeline (see
+ * [Trace](AudioTrace.h)) and each task is recorded as an `executor.task`
+ * span. Tasks must not throw.
+ */
+class Executor {
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 * ### Struct Executor::Configuration
+	 * * `workerCount`: worker count, one per hardware thread if 0,
+	 * * `cpuSets`:     the CPUs each worker may run on, worker `i` is pinned
+	 *     to `cpuSets[i % cpuSets.size()]`, no pinning if empty,
+	 * * `localMemory`: make the memory allocated by the workers come from
+	 *     their own NUMA node, whatever the policy of the process (as set
+	 *     by `numactl --interleave` for example).
+	 */
+	struct Configuration {
+		unsigned int workerCount;
+		std::vector<std::vector<unsigned int>> cpuSets;
+		bool localMemory;
+
+		Configuration() : workerCount(0), localMemory(false) {}
+	};
+
+public:
+	/**
+	 * * `static Executor & shared()`
+	 *     Get the executor of the library, started on first use with the
+	 *     configuration given to `configureShared`.
+	 */
+	static Executor & shared();
+	/**
+	 * * `static bool configureShared(const Configuration &)`
+	 *     Set the configuration of the shared executor. Return false if it
+	 *     is already started: its configuration does not change.
+	 */
+	static bool configureShared(const Configuration &);
+
+public:
+	/**
+	 * * `Executor(const Configuration &)`
+	 *     Start the workers. Raise `Error::Status::FormatBadValue` if a
+	 *     worker can not be pinned to its CPU set.
+	 */
+	Executor(const Configuration & = Configuration());
+	/**
+	 * * `~Executor()`
+	 *     Run the pending tasks, then stop the workers.
+	 */
+	virtual ~Executor();
+
+public:
+	unsigned int workerCount() const { return _workers.size(); }
+	/**
+	 * * `void submit(Task)`
+	 *     Queue a task.
+	 */
+	void submit(Task);
+
+public:
+	/**
+	 * ### Class Executor::Group
+	 * The tasks of one job. A group runs at most `concurrency` of its
+	 * tasks at once on the executor, as many as the executor has workers if
+	 * 0. Its queued tasks are handed to the executor one at a time, so a
+	 * job with many tasks does not hold the workers.
+	 *
+	 *     Executor::Group group(4);
+	 *     for (auto &part : parts) {
+	 *         group.submit([&part]() { process(part); });
+	 *     }
+	 *     group.wait();
+	 *
+	 * Waiting runs the queued tasks of the group on the waiting thread, so
+	 * a task of the executor can wait for a group without deadlock.
+	 */
+	class Group {
+	public:
+		/**
+		 * * `Group(unsigned int concurrency, Executor &)`
+		 */
+		Group(unsigned int concurrency = 0, Executor & = Executor::shared());
+		/**
+		 * * `~Group()`
+		 *     Wait for the tasks of the group.
+		 */
+		virtual ~Group();
+
+	public:
+		unsigned int concurrency() const { return _state->concurrency; }
+		/**
+		 * * `void submit(Task)`
+		 *     Queue a task of the group.
+		 */
+		void submit(Task);
+		/**
+		 * * `void wait()`
+		 *     Block until every submitted task of the group has run.
+		 */
+		void wait();
+		/**
+		 * * `bool runPending()`
+		 *     Run a queued task of the group on the calling thread. Return
+		 *     false if there is none: every task submitted is running or
+		 *     done.
+		 */
+		bool runPending();
+
+	private:
+		struct State {
+			Executor &executor;
+			unsigned int concurrency;
+			std::mutex mutex;
+			std::condition_variable idle;
+			std::deque<Task> tasks;
+			unsigned int dispatched;        // tasks handed to the executor
+			unsigned int running;
+
+			State(Executor &executor, unsigned int concurrency) :
+				executor(executor), concurrency(concurrency), dispatched(0), running(0) {}
+		};
+
+		static void dispatch(std::shared_ptr<State>);
+
+	private:
+		std::shared_ptr<State> _state;
+	};
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::vector<unsigned int> victims;  // same node first
+		std::thread thread;
+	};
+
+	bool pop(unsigned int index, Task &);
+	void run(unsigned int index, std::vector<unsigned int> cpus);
+
+private:
+	std::vector<std::unique_ptr<Worker>> _workers;
+	std::mutex _mutex;                      // shared queue and sleep
+	std::deque<Task> _tasks;
+	std::condition_variable _wake;
+	std::atomic<unsigned int> _queued;
+	bool _localMemory;
+	bool _stop;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOEXECUTOR_H_ */
@@ -0,0 +1,250 @@
+/*
+ * AudioGenerator.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "AudioBuffer.h"
+#include "AudioError.h"
+#include "AudioGenerator.h"
+#include "codec/AudioOggVorbisCoder.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+#define GENERATOR_BLOCK_FRAME_COUNT 4096
+
+static const struct {
+	Generator::Signal signal;
+	const char *name;
+} signal_names[] = {
+	{ Generator::Signal::Silence,    "silence" },
+	{ Generator::Signal::Sine,       "sine" },
+	{ Generator::Signal::Sweep,      "sweep" },
+	{ Generator::Signal::WhiteNoise, "white" },
+	{ Generator::Signal::PinkNoise,  "pink" },
+	{ Generator::Signal::Impulses,   "impulses" },
+	{ Generator::Signal::Clipped,    "clipped" },
+};
+
+std::string Generator::signalName(Signal signal) {
+	for (auto &entry : signal_names) {
+		if (entry.signal == signal) {
+			return entry.name;
+		}
+	}
+	return "unknown";
+}
+
+Generator::Signal Generator::signalFromName(const std::string &name) {
+	for (auto &entry : signal_names) {
+		if (name == entry.name) {
+			return entry.signal;
+		}
+	}
+	Error::raise(Error::Status::FormatBadValue, "Unknown signal " + name + ".");
+	return Signal::Silence;
+}
+
+Generator::Generator(Signal signal, uint32_t seed) :
+	_signal(signal),
+	_seed(seed),
+	_amplitude(0.5f),
+	_frequency(1000.0),
+	_sweepFrom(20.0),
+	_sweepTo(20000.0),
+	_sweepPeriod(10.0),
+	_impulseInterval(1.0),
+	_position(0) {
+}
+
+Generator & Generator::setAmplitude(float amplitude) {
+	if (amplitude < 0.0f || amplitude > 1.0f) {
+		Error::raise(Error::Status::FormatBadValue, "Generator amplitude must be in [0, 1].");
+	}
+	_amplitude = amplitude;
+	return *this;
+}
+
+Generator & Generator::setFrequency(double frequency) {
+	if (frequency <= 0.0) {
+		Error::raise(Error::Status::FormatBadValue, "Generator frequency must be positive.");
+	}
+	_frequency = frequency;
+	return *this;
+}
+
+Generator & Generator::setSweep(double from, double to, double period) {
+	if (from <= 0.0 || to <= 0.0 || period <= 0.0) {
+		Error::raise(Error::Status::FormatBadValue, "Generator sweep parameters must be positive.");
+	}
+	_sweepFrom = from;
+	_sweepTo = to;
+	_sweepPeriod = period;
+	return *this;
+}
+
+Generator & Generator::setImpulseInterval(double interval) {
+	if (interval <= 0.0) {
+		Error::raise(Error::Status::FormatBadValue, "Generator impulse interval must be positive.");
+	}
+	_impulseInterval = interval;
+	return *this;
+}
+
+void Generator::reset() {
+	_position = 0;
+	_noise.clear();
+	_pink.clear();
+}
+
+void Generator::setup(unsigned int channel_count) {
+	if (_noise.size() == channel_count) {
+		return;
+	}
+	// splitmix32 of seed and channel, so every channel gets an independent
+	// (and never null) xorshift32 state.
+	_noise.resize(channel_count);
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		uint32_t z = _seed + 0x9e3779b9u*(c + 1);
+		z = (z ^ (z >> 16))*0x85ebca6bu;
+		z = (z ^ (z >> 13))*0xc2b2ae35u;
+		z ^= z >> 16;
+		_noise[c] = z ? z : 0x2545f491u;
+	}
+	_pink.assign(7*channel_count, 0.0f);
+}
+
+inline float Generator::noise(unsigned int channel) {
+	uint32_t x = _noise[channel];
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	_noise[channel] = x;
+	return static_cast<int32_t>(x)/2147483648.0f;
+}
+
+void Generator::generate(unsigned int frame_count, unsigned int channel_count, unsigned int sample_rate, float *dst) {
+	setup(channel_count);
+
+	const float amplitude = _amplitude;
+	const uint64_t position = _position;
+
+	switch (_signal) {
+	case Signal::Silence:
+		std::fill(dst, dst + frame_count*channel_count, 0.0f);
+		break;
+
+	case Signal::Sine:
+	case Signal::Clipped:
+		for (unsigned int c = 0; c < channel_count; ++c) {
+			// Phase is reduced modulo one cycle so long signals keep their
+			// precision.
+			const double cycles_per_frame = _frequency*(c + 1)/sample_rate;
+			const float drive = _signal == Signal::Clipped ? 4.0f : 1.0f;
+			for (unsigned int i = 0; i < frame_count; ++i) {
+				double cycles = std::fmod(cycles_per_frame*static_cast<double>(position + i), 1.0);
+				float v = drive*std::sin(2*M_PI*cycles);
+				dst[i*channel_count + c] = amplitude*std::max(-1.0f, std::min(1.0f, v));
+			}
+		}
+		break;
+
+	case Signal::Sweep: {
+			const uint64_t period = std::max<uint64_t>(1, _sweepPeriod*sample_rate);
+			const double ratio = std::log(_sweepTo/_sweepFrom);
+			for (unsigned int c = 0; c < channel_count; ++c) {
+				const uint64_t delay = period*c/channel_count;
+				for (unsigned int i = 0; i < frame_count; ++i) {
+					// phase(t) = 2.pi.f0.T/ln(f1/f0).(exp(t/T.ln(f1/f0)) - 1)
+					double t = static_cast<double>((position + i + period - delay) % period)/period;
+					double cycles = _sweepFrom*_sweepPeriod/ratio*(std::exp(t*ratio) - 1.0);
+					dst[i*channel_count + c] = amplitude*std::sin(2*M_PI*std::fmod(cycles, 1.0));
+				}
+			}
+		}
+		break;
+
+	case Signal::WhiteNoise:
+		for (unsigned int i = 0; i < frame_count; ++i) {
+			for (unsigned int c = 0; c < channel_count; ++c) {
+				dst[i*channel_count + c] = amplitude*noise(c);
+			}
+		}
+		break;
+
+	case Signal::PinkNoise:
+		// Paul Kellet's refined filter, accurate to +/-0.05dB above 9.2Hz at
+		// 44.1kHz.
+		for (unsigned int i = 0; i < frame_count; ++i) {
+			for (unsigned int c = 0; c < channel_count; ++c) {
+				float *b = &_pink[7*c];
+				float white = noise(c);
+				b[0] = 0.99886f*b[0] + white*0.0555179f;
+				b[1] = 0.99332f*b[1] + white*0.0750759f;
+				b[2] = 0.96900f*b[2] + white*0.1538520f;
+				b[3] = 0.86650f*b[3] + white*0.3104856f;
+				b[4] = 0.55000f*b[4] + white*0.5329522f;
+				b[5] = -0.7616f*b[5] - white*0.0168980f;
+				float pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white*0.5362f;
+				b[6] = white*0.115926f;
+				dst[i*channel_count + c] = amplitude*std::max(-1.0f, std::min(1.0f, 0.11f*pink));
+			}
+		}
+		break;
+
+	case Signal::Impulses: {
+			const uint64_t interval = std::max<uint64_t>(1, _impulseInterval*sample_rate);
+			for (unsigned int i = 0; i < frame_count; ++i) {
+				uint64_t phase = (position + i)%interval;
+				for (unsigned int c = 0; c < channel_count; ++c) {
+					dst[i*channel_count + c] = phase == c%interval ? amplitude : 0.0f;
+				}
+			}
+		}
+		break;
+	}
+
+	_position += frame_count;
+}
+
+void Generator::generate(Buffer &buffer, unsigned int frame_count) {
+	Format format = buffer.format();
+	const unsigned int channel_count = format.channelCount();
+	unsigned int offset = buffer.frameCount();
+
+	buffer.resize(offset + frame_count);
+	_scratch.resize(GENERATOR_BLOCK_FRAME_COUNT*channel_count);
+	for (unsigned int done = 0, chunk; done < frame_count; done += chunk) {
+		chunk = std::min(frame_count - done, (unsigned int)GENERATOR_BLOCK_FRAME_COUNT);
+		generate(chunk, channel_count, format.sampleRate(), _scratch.data());
+		buffer.write(offset + done, chunk, (const float *)_scratch.data());
+	}
+}
+
+Buffer * Generator::generate(Format format, double duration) {
+	std::unique_ptr<Buffer> buffer(new Buffer(format));
+	reset();
+	generate(*buffer, format.frameCountForDuration(duration));
+	return buffer.release();
+}
+
+void Generator::generate(Format format, double duration, const std::string &filename, Coder::Quality quality) {
+	std::unique_ptr<Coder> coder(Coder::getCoder(filename));
+	std::unique_ptr<Buffer> buffer(generate(format, duration));
+	coder->setQuality(quality);
+	if (OggVorbisCoder *ogg = dynamic_cast<OggVorbisCoder *>(coder.get())) {
+		ogg->setStreamSerial(_seed);
+	}
+	coder->encode(*buffer, filename);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
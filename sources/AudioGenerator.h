@@ -0,0 +1,142 @@
+/*
+ * AudioGenerator.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOGENERATOR_H_
+#define AUDIOGENERATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "codec/AudioCoder.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+
+/**
+ * ## Class Generator
+ * Deterministic synthetic signals. Two generators built with the same
+ * signal, parameters and seed produce the same frames on any machine, so
+ * tests and benchmarks can build their corpus instead of shipping one.
+ *
+ * Every channel gets its own variant of the signal so channel mix ups are
+ * visible: sine frequency multiplied by `channel + 1`, sweep and impulses
+ * delayed, independent noise.
+ */
+class Generator {
+public:
+	/**
+	 * ### Signals
+	 * * `Generator::Signal::Silence`:    digital silence,
+	 * * `Generator::Signal::Sine`:       sine at `frequency()`,
+	 * * `Generator::Signal::Sweep`:      exponential sweep, repeated every
+	 *     `sweepPeriod()` seconds,
+	 * * `Generator::Signal::WhiteNoise`: uniform white noise,
+	 * * `Generator::Signal::PinkNoise`:  -3dB/octave noise,
+	 * * `Generator::Signal::Impulses`:   one sample impulse every
+	 *     `impulseInterval()` seconds,
+	 * * `Generator::Signal::Clipped`:    sine driven 4 times over full scale
+	 *     then hard clipped.
+	 */
+	enum class Signal {
+		Silence,
+		Sine,
+		Sweep,
+		WhiteNoise,
+		PinkNoise,
+		Impulses,
+		Clipped,
+	};
+
+	/**
+	 * * `static std::string signalName(Signal)`
+	 * * `static Signal signalFromName(const std::string &)`
+	 */
+	static std::string signalName(Signal);
+	static Signal signalFromName(const std::string &);
+
+public:
+	Generator(Signal, uint32_t seed = 1);
+
+public:
+	Signal signal() const { return _signal; }
+	uint32_t seed() const { return _seed; }
+
+	/** Peak amplitude, in [0, 1] (default is 0.5). */
+	float amplitude() const { return _amplitude; }
+	Generator & setAmplitude(float);
+
+	/** Sine and clipped sine frequency in Hz (default is 1000). */
+	double frequency() const { return _frequency; }
+	Generator & setFrequency(double);
+
+	/** Sweep start and end frequencies and period (default 20Hz to 20kHz in 10s). */
+	double sweepFrom() const { return _sweepFrom; }
+	double sweepTo() const { return _sweepTo; }
+	double sweepPeriod() const { return _sweepPeriod; }
+	Generator & setSweep(double from, double to, double period);
+
+	/** Time between two impulses in seconds (default is 1). */
+	double impulseInterval() const { return _impulseInterval; }
+	Generator & setImpulseInterval(double);
+
+	/**
+	 * * `void reset()`
+	 *     Restart the signal from its first frame.
+	 */
+	void reset();
+
+	/**
+	 * * `void generate(unsigned int frameCount, unsigned int channelCount, unsigned int sampleRate, float *dst)`
+	 *     Generate the next `frameCount` interleaved frames.
+	 */
+	void generate(unsigned int frameCount, unsigned int channelCount, unsigned int sampleRate, float *dst);
+
+	/**
+	 * * `void generate(Buffer &, unsigned int frameCount)`
+	 *     Append the next `frameCount` frames to the given buffer.
+	 */
+	void generate(Buffer &, unsigned int frameCount);
+
+	/**
+	 * * `Buffer * generate(Format, double duration)`
+	 *     Build a buffer holding `duration` seconds of the signal, from its
+	 *     first frame.
+	 */
+	Buffer * generate(Format, double duration);
+
+	/**
+	 * * `void generate(Format, double duration, const std::string &filename, Coder::Quality)`
+	 *     Generate `duration` seconds of the signal and encode them with the
+	 *     coder matching the file extension (see `Coder::getCoder`).
+	 */
+	void generate(Format, double duration, const std::string &filename, Coder::Quality quality = Coder::Quality::Good);
+
+private:
+	void setup(unsigned int channelCount);
+	float noise(unsigned int channel);
+
+private:
+	Signal _signal;
+	uint32_t _seed;
+	float _amplitude;
+	double _frequency;
+	double _sweepFrom, _sweepTo, _sweepPeriod;
+	double _impulseInterval;
+	uint64_t _position;
+	std::vector<uint32_t> _noise;       // per channel generator state
+	std::vector<float> _pink;           // 7 filter states per channel
+	std::vector<float> _scratch;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOGENERATOR_H_ */
@@ -0,0 +1,80 @@
+/*
+ * AudioJob.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+
+#include "AudioError.h"
+#include "AudioJob.h"
+#include "io/AudioSource.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+namespace {
+thread_local Job *current_job = nullptr;
+}
+
+Job::Job() :
+	_cancelled(false),
+	_progress(0) {
+}
+
+void Job::cancel() {
+	_cancelled = true;
+}
+
+bool Job::cancelled() const {
+	return _cancelled;
+}
+
+double Job::progress() const {
+	return _progress;
+}
+
+void Job::setProgress(double progress) {
+	_progress = progress;
+}
+
+Job * Job::current() {
+	return current_job;
+}
+
+void Job::checkpoint(double progress) {
+	if (Job *job = current_job) {
+		job->_progress = progress;
+		if (job->_cancelled) {
+			Error::raise(Error::Status::Cancelled, "The job is cancelled.");
+		}
+	}
+}
+
+void Job::checkpoint(const Source &source) {
+	if (Job *job = current_job) {
+		int64_t size = source.size();
+		checkpoint(size > 0 ? std::min(1., (double)source.position()/size) : job->_progress.load());
+	}
+}
+
+void Job::checkpoint(unsigned int offset, unsigned int frameCount) {
+	if (current_job) {
+		checkpoint(frameCount > 0 ? (double)offset/frameCount : 0.);
+	}
+}
+
+Job::Scope::Scope(Job *job) :
+	_previous(current_job) {
+	if (job) current_job = job;
+}
+
+Job::Scope::~Scope() {
+	current_job = _previous;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,101 @@
+/*
+ * AudioJob.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOJOB_H_
+#define AUDIOJOB_H_
+
+#include <atomic>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Source;
+/**
+ * ## Class Job
+ * The handle of an asynchronous decode or encode (see
+ * `Decoder::decodeAsync` and `Coder::encodeAsync`): cooperative
+ * cancellation and coarse progress.
+ *
+ * A job is the current job of the thread running it. Codecs call one of
+ * the `checkpoint` functions between two blocks: it updates the progress
+ * of the current job and raises `Error::Status::Cancelled` once the job is
+ * cancelled, which unwinds the codec as any other error. Without a current
+ * job, a checkpoint only reads a thread local pointer.
+ *
+ *     std::shared_ptr<Job> job(new Job);
+ *     std::future<std::shared_ptr<Buffer>> result = decoder->decodeAsync("song.mp3", job);
+ *     ...
+ *     job->cancel();
+ */
+class Job {
+public:
+	Job();
+	virtual ~Job() {}
+
+public:
+	/**
+	 * * `void cancel()`
+	 *     Ask the job to stop at its next checkpoint. A job cancelled
+	 *     before it starts does not run.
+	 */
+	void cancel();
+	/**
+	 * * `bool cancelled() const`
+	 */
+	bool cancelled() const;
+	/**
+	 * * `double progress() const`
+	 *     Get the part of the job done, from 0 to 1. The progress is
+	 *     estimated from the input bytes consumed when decoding and from
+	 *     the frames encoded when encoding.
+	 */
+	double progress() const;
+	/**
+	 * * `void setProgress(double)`
+	 */
+	void setProgress(double);
+
+public:
+	/**
+	 * * `static Job * current()`
+	 *     Get the job run by the calling thread, `nullptr` if none.
+	 */
+	static Job * current();
+	/**
+	 * * `static void checkpoint(double progress)`
+	 * * `static void checkpoint(const Source &)`
+	 * * `static void checkpoint(unsigned int offset, unsigned int frameCount)`
+	 *     Set the progress of the current job, from a ratio, from the
+	 *     position of the decoded source in its size, or from the frames
+	 *     encoded, then raise `Error::Status::Cancelled` if it is cancelled.
+	 */
+	static void checkpoint(double progress);
+	static void checkpoint(const Source &);
+	static void checkpoint(unsigned int offset, unsigned int frameCount);
+
+	/**
+	 * ### Class Job::Scope
+	 * Make a job the current job of the calling thread during its
+	 * lifetime. Does nothing if built with a null `Job`.
+	 */
+	class Scope {
+	public:
+		Scope(Job *);
+		~Scope();
+	private:
+		Job *_previous;
+	};
+
+private:
+	std::atomic<bool> _cancelled;
+	std::atomic<double> _progress;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOJOB_H_ */
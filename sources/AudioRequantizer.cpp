@@ -0,0 +1,206 @@
+/*
+ * AudioRequantizer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "AudioError.h"
+#include "AudioRequantizer.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int Requantizer::MaxChannelCount;
+const unsigned int Requantizer::NoiseLaneCount;
+const unsigned int Requantizer::NoiseBlockSize;
+
+// Noise shaping error filter, 3 taps E-weighted (Wannamaker), the
+// requantization noise spectrum is shaped by 1 - H(z).
+#define SHAPE_H1  1.623f
+#define SHAPE_H2 -0.982f
+#define SHAPE_H3  0.109f
+
+// Adding then removing 1.5*2^23 rounds a float to the nearest integer
+// (ties to even) without leaving the vector unit, valid for |v| < 2^22.
+static inline float _round(float v) {
+	const float magic = 12582912.0f;
+	return (v + magic) - magic;
+}
+
+static inline float _clamp(float v, float lo, float hi) {
+	return std::min(std::max(v, lo), hi);
+}
+
+struct PlanarSource {
+	const float * const *src;
+	inline float operator()(unsigned int frame, unsigned int channel) const {
+		return src[channel][frame];
+	}
+};
+
+struct InterleavedSource {
+	const float *src;
+	unsigned int channelCount;
+	inline float operator()(unsigned int frame, unsigned int channel) const {
+		return src[frame*channelCount + channel];
+	}
+};
+
+// Add the dither noise to `frameCount` frames from `frame` and requantize
+// them. The noise runs along the interleaved frames: with an interleaved
+// source the loop is flat and vectorised, with a planar one it is run per
+// channel. Rounding before clipping gives the same values (the bounds are
+// integers) and lets the compiler vectorise the loops.
+template<typename DEST>
+static inline void _tpdf(const InterleavedSource &src, unsigned int channelCount, unsigned int frame, unsigned int frameCount, const float *noise, float scale, DEST *dst) {
+	const float lo = std::numeric_limits<DEST>::min();
+	const float hi = std::numeric_limits<DEST>::max();
+	const float *s = src.src + frame*channelCount;
+	DEST *d = dst + frame*channelCount;
+
+	for (unsigned int k = 0; k < frameCount*channelCount; ++k) {
+		d[k] = static_cast<DEST>(_clamp(_round(s[k]*scale + noise[k]), lo, hi));
+	}
+}
+
+template<typename DEST>
+static inline void _tpdf(const PlanarSource &src, unsigned int channelCount, unsigned int frame, unsigned int frameCount, const float *noise, float scale, DEST *dst) {
+	const float lo = std::numeric_limits<DEST>::min();
+	const float hi = std::numeric_limits<DEST>::max();
+
+	for (unsigned int c = 0; c < channelCount; ++c) {
+		const float *s = src.src[c] + frame;
+		DEST *d = dst + frame*channelCount + c;
+		for (unsigned int i = 0; i < frameCount; ++i) {
+			d[i*channelCount] = static_cast<DEST>(_clamp(_round(s[i]*scale + noise[i*channelCount + c]), lo, hi));
+		}
+	}
+}
+
+Requantizer::Requantizer(Dither dither, uint32_t seed) :
+	_dither(dither),
+	_seed(seed) {
+	reset();
+}
+
+void Requantizer::reset() {
+	// splitmix32 spreads the seed over the generator lanes.
+	uint32_t z = _seed;
+	for (unsigned int l = 0; l < NoiseLaneCount; ++l) {
+		z += 0x9e3779b9;
+		uint32_t x = z;
+		x = (x ^ (x >> 16))*0x85ebca6b;
+		x = (x ^ (x >> 13))*0xc2b2ae35;
+		x ^= x >> 16;
+		_lanes[l] = (x == 0) ? 0x2545f491 : x;
+	}
+	_noiseIndex = NoiseBlockSize;
+	std::fill(_error.begin(), _error.end(), 0.0f);
+}
+
+// Fill the noise block with TPDF values in ]-1, 1[. Each lane runs an
+// independent xorshift32 generator, the lane loop is vectorised. The two
+// uniform variables are the high and low halves of each generated word.
+void Requantizer::refill() {
+	uint32_t lanes[NoiseLaneCount];
+	std::copy(_lanes, _lanes + NoiseLaneCount, lanes);
+
+	for (unsigned int i = 0; i < NoiseBlockSize; i += NoiseLaneCount) {
+		for (unsigned int l = 0; l < NoiseLaneCount; ++l) {
+			uint32_t x = lanes[l];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			lanes[l] = x;
+			_noise[i + l] =
+				static_cast<float>(static_cast<int32_t>(x >> 16) - static_cast<int32_t>(x & 0xffff))
+				*(1.0f/65536.0f);
+		}
+	}
+
+	std::copy(lanes, lanes + NoiseLaneCount, _lanes);
+	_noiseIndex = 0;
+}
+
+template<typename DEST, typename SOURCE>
+void Requantizer::run(unsigned int frameCount, unsigned int channelCount, const SOURCE &src, DEST *dst) {
+	const float scale = std::numeric_limits<DEST>::max();
+	const float lo = std::numeric_limits<DEST>::min();
+	const float hi = std::numeric_limits<DEST>::max();
+
+	if (channelCount > MaxChannelCount) {
+		Error::raise(Error::Status::FormatBadValue, "Too many channels to requantize.");
+	}
+
+	switch (_dither) {
+	case Dither::None:
+		for (unsigned int i = 0; i < frameCount; ++i) {
+			for (unsigned int c = 0; c < channelCount; ++c) {
+				dst[i*channelCount + c] = static_cast<DEST>(_round(_clamp(src(i, c)*scale, lo, hi)));
+			}
+		}
+		break;
+
+	case Dither::TPDF:
+		// As many frames at once as the noise block has left.
+		for (unsigned int i = 0; i < frameCount && channelCount > 0;) {
+			if (_noiseIndex + channelCount > NoiseBlockSize) {
+				refill();
+			}
+			unsigned int count = std::min(frameCount - i, (NoiseBlockSize - _noiseIndex)/channelCount);
+			_tpdf(src, channelCount, i, count, _noise + _noiseIndex, scale, dst);
+			_noiseIndex += count*channelCount;
+			i += count;
+		}
+		break;
+
+	case Dither::NoiseShaped:
+		if (_error.size() < 3*channelCount) {
+			_error.resize(3*channelCount, 0.0f);
+		}
+		for (unsigned int i = 0; i < frameCount; ++i) {
+			if (_noiseIndex + channelCount > NoiseBlockSize) {
+				refill();
+			}
+			const float *noise = _noise + _noiseIndex;
+			for (unsigned int c = 0; c < channelCount; ++c) {
+				float *e = &_error[3*c];
+				float w = src(i, c)*scale - (SHAPE_H1*e[0] + SHAPE_H2*e[1] + SHAPE_H3*e[2]);
+				float q = _round(_clamp(w + noise[c], lo, hi));
+				// Clipped samples would feed back a huge error, bound it so
+				// the shaping filter can not run away.
+				e[2] = e[1];
+				e[1] = e[0];
+				e[0] = _clamp(q - w, -2.0f, 2.0f);
+				dst[i*channelCount + c] = static_cast<DEST>(q);
+			}
+			_noiseIndex += channelCount;
+		}
+		break;
+	}
+}
+
+void Requantizer::quantize(unsigned int frameCount, unsigned int channelCount, const float * const *src, int8_t *dst) {
+	run(frameCount, channelCount, PlanarSource{ src }, dst);
+}
+
+void Requantizer::quantize(unsigned int frameCount, unsigned int channelCount, const float * const *src, int16_t *dst) {
+	run(frameCount, channelCount, PlanarSource{ src }, dst);
+}
+
+void Requantizer::quantize(unsigned int frameCount, unsigned int channelCount, const float *src, int8_t *dst) {
+	run(frameCount, channelCount, InterleavedSource{ src, channelCount }, dst);
+}
+
+void Requantizer::quantize(unsigned int frameCount, unsigned int channelCount, const float *src, int16_t *dst) {
+	run(frameCount, channelCount, InterleavedSource{ src, channelCount }, dst);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,93 @@
+/*
+ * AudioRequantizer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOREQUANTIZER_H_
+#define AUDIOREQUANTIZER_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class Requantizer
+ * A `Requantizer` converts float samples in [-1, 1] to 8 or 16 bits
+ * integers. Samples are clipped to the integer range and rounded to the
+ * nearest value; optionally TPDF dither is added and the requantization
+ * error is noise shaped.
+ *
+ * A `Requantizer` holds per channel state, use one instance per stream.
+ */
+class Requantizer {
+public:
+	/**
+	 * ### Dither
+	 * * `Requantizer::Dither::None`:        round to nearest, no dither (the
+	 *     default),
+	 * * `Requantizer::Dither::TPDF`:        add triangular dither of +/-1 LSB,
+	 * * `Requantizer::Dither::NoiseShaped`: TPDF dither and error feedback
+	 *     pushing the noise toward high frequencies.
+	 */
+	enum class Dither {
+		None,
+		TPDF,
+		NoiseShaped,
+	};
+
+	/** Maximum channel count a `Requantizer` can handle. */
+	static const unsigned int MaxChannelCount = 1024;
+
+public:
+	Requantizer(Dither dither = Dither::None, uint32_t seed = 0x2545f491);
+
+public:
+	Dither dither() const { return _dither; }
+
+	/**
+	 * * `void reset()`
+	 *     Reset the noise generator and the noise shaping state.
+	 */
+	void reset();
+
+	/**
+	 * * `void quantize(unsigned int frameCount, unsigned int channelCount, const float * const *src, T *dst)`
+	 *     Requantize planar float frames into interleaved integer frames.
+	 */
+	void quantize(unsigned int frameCount, unsigned int channelCount, const float * const *src, int8_t  *dst);
+	void quantize(unsigned int frameCount, unsigned int channelCount, const float * const *src, int16_t *dst);
+
+	/**
+	 * * `void quantize(unsigned int frameCount, unsigned int channelCount, const float *src, T *dst)`
+	 *     Requantize interleaved float frames into interleaved integer frames.
+	 */
+	void quantize(unsigned int frameCount, unsigned int channelCount, const float *src, int8_t  *dst);
+	void quantize(unsigned int frameCount, unsigned int channelCount, const float *src, int16_t *dst);
+
+private:
+	static const unsigned int NoiseLaneCount = 8;
+	static const unsigned int NoiseBlockSize = 2048;
+
+	void refill();
+
+	template<typename DEST, typename SOURCE>
+	void run(unsigned int frameCount, unsigned int channelCount, const SOURCE &src, DEST *dst);
+
+private:
+	Dither _dither;
+	uint32_t _seed;
+	uint32_t _lanes[NoiseLaneCount];
+	float _noise[NoiseBlockSize];
+	unsigned int _noiseIndex;
+	std::vector<float> _error;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOREQUANTIZER_H_ */
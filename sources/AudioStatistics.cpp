@@ -0,0 +1,78 @@
+/*
+ * AudioStatistics.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include "AudioStatistics.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int Statistics::PhaseCount;
+
+Statistics::Statistics() :
+	_depth(0),
+	_phase(Phase::Other),
+	_phaseStart(0) {
+	reset();
+}
+
+void Statistics::reset() {
+	operationCount = 0;
+	bytesRead = bytesWritten = 0;
+	framesProcessed = 0;
+	wallTime = cpuTime = 0;
+	for (unsigned int i = 0; i < PhaseCount; ++i) {
+		phaseWallTime[i] = 0;
+	}
+	allocationCount = allocatedBytes = 0;
+	bufferGrowthCount = 0;
+}
+
+Statistics & Statistics::operator+=(const Statistics &other) {
+	operationCount += other.operationCount;
+	bytesRead += other.bytesRead;
+	bytesWritten += other.bytesWritten;
+	framesProcessed += other.framesProcessed;
+	wallTime += other.wallTime;
+	cpuTime += other.cpuTime;
+	for (unsigned int i = 0; i < PhaseCount; ++i) {
+		phaseWallTime[i] += other.phaseWallTime[i];
+	}
+	allocationCount += other.allocationCount;
+	allocatedBytes += other.allocatedBytes;
+	bufferGrowthCount += other.bufferGrowthCount;
+	return *this;
+}
+
+Statistics::Operation::Operation(Statistics *statistics) :
+	_statistics(statistics),
+	_outer(false) {
+	if (_statistics && _statistics->_depth++ == 0) {
+		_outer = true;
+		_wallStart = now(CLOCK_MONOTONIC);
+		_cpuStart = now(CLOCK_THREAD_CPUTIME_ID);
+		_statistics->_phase = Phase::Other;
+		_statistics->_phaseStart = _wallStart;
+	}
+}
+
+Statistics::Operation::~Operation() {
+	if (_statistics == nullptr) {
+		return;
+	}
+	if (_outer) {
+		_statistics->enter(Phase::Other);
+		_statistics->wallTime += now(CLOCK_MONOTONIC) - _wallStart;
+		_statistics->cpuTime += now(CLOCK_THREAD_CPUTIME_ID) - _cpuStart;
+		_statistics->operationCount++;
+	}
+	_statistics->_depth--;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
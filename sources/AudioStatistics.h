@@ -0,0 +1,144 @@
+/*
+ * AudioStatistics.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSTATISTICS_H_
+#define AUDIOSTATISTICS_H_
+
+#include <cstdint>
+#include <ctime>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Struct Statistics
+ * Performance counters of decode and encode operations.
+ *
+ * Give a `Statistics` to a `Decoder` or a `Coder` with `setStatistics` and
+ * every following operation adds its counters to it. Without one, the
+ * codecs only test a null pointer. A `Statistics` is not thread safe: use
+ * one per thread and sum them with `+=`.
+ *
+ * Wall time is split in exclusive phases (a phase entered inside another
+ * one pauses it), so the phase times add up to `wallTime`. CPU time is
+ * measured per operation (thread CPU clock), reading it per phase would
+ * cost more than the work measured.
+ */
+struct Statistics {
+	/**
+	 * ### Phases
+	 * * `Statistics::Phase::Other`:      setup, analyzers and bookkeeping,
+	 * * `Statistics::Phase::IO`:         reading and writing the stream,
+	 * * `Statistics::Phase::Codec`:      LAME, Vorbis or PCM packing,
+	 * * `Statistics::Phase::Conversion`: `Buffer` reads and writes (sample
+	 *     format conversion, mixing, dithering).
+	 */
+	enum class Phase {
+		Other,
+		IO,
+		Codec,
+		Conversion,
+	};
+	static const unsigned int PhaseCount = 4;
+
+	uint64_t operationCount;
+	uint64_t bytesRead;
+	uint64_t bytesWritten;
+	uint64_t framesProcessed;
+	uint64_t wallTime;                      // nanoseconds
+	uint64_t cpuTime;                       // nanoseconds
+	uint64_t phaseWallTime[PhaseCount];     // nanoseconds
+	uint64_t allocationCount;               // Buffer storage and codec work buffers
+	uint64_t allocatedBytes;
+	uint64_t bufferGrowthCount;
+
+	Statistics();
+
+	/**
+	 * * `void reset()`
+	 */
+	void reset();
+
+	/**
+	 * * `Statistics & operator+=(const Statistics &)`
+	 *     Add the counters of another instance.
+	 */
+	Statistics & operator+=(const Statistics &);
+
+	uint64_t phaseTime(Phase phase) const { return phaseWallTime[static_cast<unsigned int>(phase)]; }
+
+	/**
+	 * * `void allocation(size_t bytes)`
+	 * * `void growth(size_t bytes)`
+	 *     Count an allocation, or the reallocation of a growing buffer.
+	 */
+	void allocation(size_t bytes) { allocationCount++; allocatedBytes += bytes; }
+	void growth(size_t bytes) { bufferGrowthCount++; allocation(bytes); }
+
+	/**
+	 * ### Class Statistics::Scope
+	 * Account the wall time of its lifetime to a phase. Does nothing if
+	 * built with a null `Statistics`.
+	 */
+	class Scope {
+	public:
+		Scope(Statistics *statistics, Phase phase) : _statistics(statistics), _previous(Phase::Other) {
+			if (_statistics) _previous = _statistics->enter(phase);
+		}
+		~Scope() {
+			if (_statistics) _statistics->enter(_previous);
+		}
+	private:
+		Statistics *_statistics;
+		Phase _previous;
+	};
+
+	/**
+	 * ### Class Statistics::Operation
+	 * Account a whole decode or encode operation: wall and CPU time and
+	 * operation count.
+	 */
+	class Operation {
+	public:
+		Operation(Statistics *statistics);
+		~Operation();
+	private:
+		Statistics *_statistics;
+		bool _outer;
+		uint64_t _wallStart;
+		uint64_t _cpuStart;
+	};
+
+private:
+	static uint64_t now(clockid_t clock) {
+		struct timespec ts;
+		clock_gettime(clock, &ts);
+		return static_cast<uint64_t>(ts.tv_sec)*1000000000ull + ts.tv_nsec;
+	}
+
+	Phase enter(Phase phase) {
+		uint64_t t = now(CLOCK_MONOTONIC);
+		Phase previous = _phase;
+		if (_depth > 0) {
+			phaseWallTime[static_cast<unsigned int>(_phase)] += t - _phaseStart;
+		}
+		_phase = phase;
+		_phaseStart = t;
+		return previous;
+	}
+
+private:
+	unsigned int _depth;                    // running operations
+	Phase _phase;
+	uint64_t _phaseStart;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSTATISTICS_H_ */
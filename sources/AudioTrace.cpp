@@ -0,0 +1,215 @@
+/*
+ * AudioTrace.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "AudioError.h"
+#include "AudioTrace.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int Trace::BufferCapacity;
+std::atomic<bool> Trace::_enabled(false);
+
+namespace {
+
+// Fields are relaxed atomics so the export can read a ring while its
+// thread writes in it; the head index, published with release semantic,
+// tells which slots are complete.
+struct TraceEvent {
+	std::atomic<const char *> name;
+	std::atomic<const char *> category;
+	std::atomic<uint64_t> start;
+	std::atomic<uint64_t> end;
+};
+
+struct TraceBuffer {
+	std::atomic<uint64_t> head;
+	std::atomic<uint64_t> tail;
+	std::atomic<bool> exited;
+	long tid;
+	std::string name;               // guarded by registry_mutex
+	TraceEvent events[Trace::BufferCapacity];
+
+	TraceBuffer() : head(0), tail(0), exited(false), tid(syscall(SYS_gettid)) {}
+};
+
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<TraceBuffer>> registry;
+
+// The registry keeps the buffer of a thread alive after it exits, until
+// its spans are exported or cleared.
+struct ThreadBuffer {
+	std::shared_ptr<TraceBuffer> buffer;
+	~ThreadBuffer() {
+		if (buffer) buffer->exited.store(true, std::memory_order_release);
+	}
+};
+
+TraceBuffer & thread_buffer() {
+	thread_local ThreadBuffer thread;
+	if (! thread.buffer) {
+		thread.buffer = std::make_shared<TraceBuffer>();
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		registry.push_back(thread.buffer);
+	}
+	return *thread.buffer;
+}
+
+
+void write_json_string(std::ostream &out, const char *s) {
+	out << '"';
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') out << '\\';
+		out << *s;
+	}
+	out << '"';
+}
+
+// Trace Event timestamps are in microseconds, keep the nanoseconds as
+// decimals.
+void write_microseconds(std::ostream &out, uint64_t ns) {
+	char decimals[4] = {
+		static_cast<char>('0' + (ns%1000)/100),
+		static_cast<char>('0' + (ns%100)/10),
+		static_cast<char>('0' + ns%10),
+		0 };
+	out << ns/1000 << '.' << decimals;
+}
+
+}
+
+void Trace::enable(bool enable) {
+	_enabled.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t Trace::now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec)*1000000000ull + ts.tv_nsec;
+}
+
+void Trace::record(const char *name, const char *category, uint64_t start, uint64_t end) {
+	TraceBuffer &buffer = thread_buffer();
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	TraceEvent &event = buffer.events[head%BufferCapacity];
+
+	event.name.store(name, std::memory_order_relaxed);
+	event.category.store(category, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const std::string &name) {
+	TraceBuffer &buffer = thread_buffer();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	buffer.name = name;
+}
+
+void Trace::clear() {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (auto &buffer : registry) {
+		buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+	registry.erase(std::remove_if(registry.begin(), registry.end(), [](const std::shared_ptr<TraceBuffer> &buffer) {
+		return buffer->exited.load(std::memory_order_acquire);
+	}), registry.end());
+}
+
+void Trace::write(std::ostream &out) {
+	struct Span {
+		const char *name;
+		const char *category;
+		uint64_t start;
+		uint64_t end;
+	};
+	const long pid = getpid();
+	std::vector<Span> spans;
+	std::vector<std::shared_ptr<TraceBuffer>> exited;
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	// The threads which exited before the export have recorded all their
+	// spans: they are released after it.
+	for (auto &buffer : registry) {
+		if (buffer->exited.load(std::memory_order_acquire)) {
+			exited.push_back(buffer);
+		}
+	}
+
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	for (auto &buffer : registry) {
+		if (! buffer->name.empty()) {
+			out << (first ? "\n" : ",\n")
+				<< "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+				<< ",\"args\":{\"name\":";
+			write_json_string(out, buffer->name.c_str());
+			out << "}}";
+			first = false;
+		}
+
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t begin = std::max(buffer->tail.load(std::memory_order_relaxed), head > BufferCapacity ? head - BufferCapacity : 0);
+
+		spans.clear();
+		for (uint64_t i = begin; i < head; ++i) {
+			const TraceEvent &event = buffer->events[i%BufferCapacity];
+			spans.push_back(Span{
+				event.name.load(std::memory_order_relaxed),
+				event.category.load(std::memory_order_relaxed),
+				event.start.load(std::memory_order_relaxed),
+				event.end.load(std::memory_order_relaxed) });
+		}
+
+		// Drop the slots the thread may have overwritten while they were
+		// copied, including the one it may be writing.
+		uint64_t after = buffer->head.load(std::memory_order_acquire) + 1;
+		size_t skip = after > begin + BufferCapacity ? std::min<uint64_t>(after - begin - BufferCapacity, spans.size()) : 0;
+
+		for (size_t i = skip; i < spans.size(); ++i) {
+			const Span &span = spans[i];
+			out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"name\":";
+			write_json_string(out, span.name);
+			out << ",\"cat\":";
+			write_json_string(out, span.category);
+			out << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+				<< ",\"ts\":";
+			write_microseconds(out, span.start);
+			out << ",\"dur\":";
+			write_microseconds(out, span.end - span.start);
+			out << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+	registry.erase(std::remove_if(registry.begin(), registry.end(), [&exited](const std::shared_ptr<TraceBuffer> &buffer) {
+		return std::find(exited.begin(), exited.end(), buffer) != exited.end();
+	}), registry.end());
+}
+
+void Trace::write(const std::string &filename) {
+	std::ofstream ofs(filename.data());
+	write(ofs);
+	if (ofs.fail()) {
+		Error::raise(Error::Status::IOError, "Failed to write trace file.");
+	}
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,98 @@
+/*
+ * AudioTrace.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOTRACE_H_
+#define AUDIOTRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class Trace
+ * Timeline instrumentation of the library. When enabled, `Trace::Span`
+ * objects record their name, thread, start and duration in a per thread
+ * ring buffer (the last `BufferCapacity` spans of each thread are kept),
+ * and `write` exports all of them as Trace Event JSON which can be loaded
+ * in Perfetto or `chrome://tracing`.
+ *
+ * Recording takes no lock: each thread only writes in its own ring, the
+ * export reads the rings concurrently and drops the spans overwritten
+ * while it was reading them. Disabled, a span costs a relaxed atomic load.
+ * The ring of a thread is kept after it exits until the next `write` or
+ * `clear`, which release it.
+ */
+class Trace {
+public:
+	static const unsigned int BufferCapacity = 1 << 16;
+
+	/**
+	 * * `static void enable(bool)`
+	 * * `static bool enabled()`
+	 */
+	static void enable(bool);
+	static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * * `static void setThreadName(const std::string &)`
+	 *     Name the calling thread in the exported timeline.
+	 */
+	static void setThreadName(const std::string &);
+
+	/**
+	 * * `static void clear()`
+	 *     Drop the recorded spans of every thread.
+	 */
+	static void clear();
+
+	/**
+	 * * `static void write(std::ostream &)`
+	 * * `static void write(const std::string &filename)`
+	 *     Export the recorded spans as Trace Event JSON. The spans of the
+	 *     exited threads are exported once, then released.
+	 */
+	static void write(std::ostream &);
+	static void write(const std::string &filename);
+
+	/**
+	 * ### Class Trace::Span
+	 * Record the lifetime of the object as a span. `name` and `category`
+	 * must be string literals (only the pointers are stored).
+	 */
+	class Span {
+	public:
+		Span(const char *name, const char *category = "audio") :
+			_name(name),
+			_category(category),
+			_start(enabled() ? now() : 0) {
+		}
+		~Span() {
+			if (_start != 0) record(_name, _category, _start, now());
+		}
+	private:
+		const char *_name;
+		const char *_category;
+		uint64_t _start;
+	};
+
+private:
+	static uint64_t now();
+	static void record(const char *name, const char *category, uint64_t start, uint64_t end);
+
+private:
+	static std::atomic<bool> _enabled;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOTRACE_H_ */
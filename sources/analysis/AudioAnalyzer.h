@@ -0,0 +1,38 @@
+/*
+ * AudioAnalyzer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOANALYZER_H_
+#define AUDIOANALYZER_H_
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+/**
+ * ## Class Analyzer
+ * An `Analyzer` consumes a stream of `Buffer` blocks. Analyzers can be
+ * attached to a `Decoder` or a `Coder` (see `addAnalyzer`), they are then
+ * fed each block as it is decoded or encoded, while it is still hot in
+ * cache, without a second read of the data.
+ */
+class Analyzer {
+public:
+	virtual ~Analyzer() {}
+
+public:
+	/**
+	 * * `void process(const Buffer &, unsigned int offset, unsigned int count)`
+	 *     Analyze the `count` frames of the given buffer starting at
+	 *     `offset`. Successive calls must cover successive frames.
+	 */
+	virtual void process(const Buffer &, unsigned int offset, unsigned int count) = 0;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOANALYZER_H_ */
@@ -0,0 +1,175 @@
+/*
+ * AudioFFT.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include "../AudioError.h"
+#include "AudioFFT.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+#if defined(__x86_64__) && defined(__GNUC__) && ! defined(__clang__)
+# define FFT_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+# define FFT_KERNEL
+#endif
+
+namespace {
+
+// First pass when the complex size is an odd power of two: butterflies of
+// adjacent points, all twiddles are 1.
+FFT_KERNEL
+void radix2_pass(unsigned int size, float * __restrict__ re, float * __restrict__ im) {
+	for (unsigned int k = 0; k < size; k += 2) {
+		float ar = re[k], ai = im[k], br = re[k + 1], bi = im[k + 1];
+		re[k] = ar + br; im[k] = ai + bi;
+		re[k + 1] = ar - br; im[k + 1] = ai - bi;
+	}
+}
+
+// Combine four consecutive sub transforms of `h` points in one of `4h`
+// points: two radix-2 stages fused so each point is loaded and stored once.
+//  - w1 = W(2h)^j, used by the (a, b) and (c, d) butterflies,
+//  - w2 = W(4h)^j, used by (a', c'), and -i.w2 by (b', d').
+FFT_KERNEL
+void radix4_pass(unsigned int size, unsigned int h,
+		float * __restrict__ re, float * __restrict__ im,
+		const float * __restrict__ w1r, const float * __restrict__ w1i,
+		const float * __restrict__ w2r, const float * __restrict__ w2i) {
+	for (unsigned int base = 0; base < size; base += 4*h) {
+		float * __restrict__ ar = re + base, * __restrict__ ai = im + base;
+		float * __restrict__ br = ar + h, * __restrict__ bi = ai + h;
+		float * __restrict__ cr = br + h, * __restrict__ ci = bi + h;
+		float * __restrict__ dr = cr + h, * __restrict__ di = ci + h;
+
+		for (unsigned int j = 0; j < h; ++j) {
+			// w1.b and w1.d
+			float tbr = w1r[j]*br[j] - w1i[j]*bi[j], tbi = w1r[j]*bi[j] + w1i[j]*br[j];
+			float tdr = w1r[j]*dr[j] - w1i[j]*di[j], tdi = w1r[j]*di[j] + w1i[j]*dr[j];
+
+			float a1r = ar[j] + tbr, a1i = ai[j] + tbi;
+			float b1r = ar[j] - tbr, b1i = ai[j] - tbi;
+			float c1r = cr[j] + tdr, c1i = ci[j] + tdi;
+			float d1r = cr[j] - tdr, d1i = ci[j] - tdi;
+
+			// w2.c' and w3.d' with w3 = -i.w2
+			float tcr = w2r[j]*c1r - w2i[j]*c1i, tci = w2r[j]*c1i + w2i[j]*c1r;
+			float udr = w2r[j]*d1r - w2i[j]*d1i, udi = w2r[j]*d1i + w2i[j]*d1r;
+			float tdr3 = udi, tdi3 = -udr;
+
+			ar[j] = a1r + tcr; ai[j] = a1i + tci;
+			cr[j] = a1r - tcr; ci[j] = a1i - tci;
+			br[j] = b1r + tdr3; bi[j] = b1i + tdi3;
+			dr[j] = b1r - tdr3; di[j] = b1i - tdi3;
+		}
+	}
+}
+
+std::mutex plans_mutex;
+std::map<unsigned int, std::shared_ptr<const FFT>> plans;
+
+}
+
+std::shared_ptr<const FFT> FFT::plan(unsigned int size) {
+	std::lock_guard<std::mutex> lock(plans_mutex);
+	std::shared_ptr<const FFT> &plan = plans[size];
+	if (! plan) {
+		plan = std::make_shared<FFT>(size);
+	}
+	return plan;
+}
+
+FFT::FFT(unsigned int size) :
+	_size(size),
+	_half(size/2) {
+	if (size < 4 || (size & (size - 1)) != 0) {
+		Error::raise(Error::Status::FormatBadValue, "FFT size must be a power of two greater or equal to 4.");
+	}
+
+	unsigned int bits = 0;
+	while ((1u << bits) < _half) bits++;
+
+	_bitReverse.resize(_half);
+	for (unsigned int k = 0; k < _half; ++k) {
+		unsigned int r = 0;
+		for (unsigned int b = 0; b < bits; ++b) {
+			r |= ((k >> b) & 1) << (bits - 1 - b);
+		}
+		_bitReverse[k] = r;
+	}
+
+	for (unsigned int h = (bits % 2) ? 2 : 1; h < _half; h *= 4) {
+		size_t offset = _twiddles.size();
+		_twiddles.resize(offset + 4*h);
+		for (unsigned int j = 0; j < h; ++j) {
+			double a1 = -M_PI*j/h, a2 = -M_PI*j/(2*h);
+			_twiddles[offset + j] = std::cos(a1);
+			_twiddles[offset + h + j] = std::sin(a1);
+			_twiddles[offset + 2*h + j] = std::cos(a2);
+			_twiddles[offset + 3*h + j] = std::sin(a2);
+		}
+	}
+
+	_realTwiddles.resize(2*(_half/2 + 1));
+	for (unsigned int k = 0; k <= _half/2; ++k) {
+		double a = 2*M_PI*k/size;
+		_realTwiddles[2*k] = std::cos(a);
+		_realTwiddles[2*k + 1] = std::sin(a);
+	}
+}
+
+void FFT::forward(const float *input, float *re, float *im) const {
+	const unsigned int half = _half;
+
+	// Pack the even/odd samples as the real/imaginary parts of a half size
+	// complex signal, in bit reversed order.
+	for (unsigned int k = 0; k < half; ++k) {
+		unsigned int r = _bitReverse[k];
+		re[r] = input[2*k];
+		im[r] = input[2*k + 1];
+	}
+
+	unsigned int h = 1;
+	if (__builtin_ctz(half) % 2) {
+		radix2_pass(half, re, im);
+		h = 2;
+	}
+	for (const float *w = _twiddles.data(); h < half; w += 4*h, h *= 4) {
+		radix4_pass(half, h, re, im, w, w + h, w + 2*h, w + 3*h);
+	}
+
+	// Split the half size transform Z in the transform X of the real
+	// signal, two mirrored bins (k, half - k) per iteration:
+	//  Fe = (Z[k] + conj(Z[half - k]))/2, Fo = -i.(Z[k] - conj(Z[half - k]))/2
+	//  X[k] = Fe + W^k.Fo, X[half - k] = conj(Fe - W^k.Fo)
+	float z0r = re[0], z0i = im[0];
+	re[0] = z0r + z0i; im[0] = 0;
+	re[half] = z0r - z0i; im[half] = 0;
+
+	for (unsigned int k = 1; k <= half/2; ++k) {
+		unsigned int m = half - k;
+		float zkr = re[k], zki = im[k], zmr = re[m], zmi = im[m];
+
+		float fer = 0.5f*(zkr + zmr), fei = 0.5f*(zki - zmi);
+		float for_ = 0.5f*(zki + zmi), foi = -0.5f*(zkr - zmr);
+
+		// W^k = cos - i.sin
+		float c = _realTwiddles[2*k], s = _realTwiddles[2*k + 1];
+		float tr = c*for_ + s*foi, ti = c*foi - s*for_;
+
+		re[k] = fer + tr; im[k] = fei + ti;
+		re[m] = fer - tr; im[m] = -(fei - ti);
+	}
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,65 @@
+/*
+ * AudioFFT.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOFFT_H_
+#define AUDIOFFT_H_
+
+#include <memory>
+#include <vector>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class FFT
+ * Real input forward FFT of a power of two size `N`.
+ *
+ * The real signal is packed in a `N/2` points complex FFT computed in
+ * split (separate real and imaginary arrays) format: bit reversal, an
+ * optional radix-2 pass, then fused radix-2/4 passes with precomputed
+ * twiddles. The butterfly loops are compiled for AVX2 and generic x86_64,
+ * the best version is selected at load time.
+ *
+ * Plans are immutable and cached by size, a plan can be shared between
+ * threads.
+ */
+class FFT {
+public:
+	/**
+	 * * `std::shared_ptr<const FFT> plan(unsigned int size)`
+	 *     Get the (cached) plan for the given size, which must be a power of
+	 *     two greater or equal to 4.
+	 */
+	static std::shared_ptr<const FFT> plan(unsigned int size);
+
+public:
+	FFT(unsigned int size);
+
+public:
+	unsigned int size() const { return _size; }
+	unsigned int binCount() const { return _size/2 + 1; }
+
+	/**
+	 * * `void forward(const float *input, float *re, float *im) const`
+	 *     Compute the `binCount()` complex bins of `size()` real samples.
+	 *     `re` and `im` must hold `binCount()` values.
+	 */
+	void forward(const float *input, float *re, float *im) const;
+
+private:
+	unsigned int _size;
+	unsigned int _half;
+	std::vector<unsigned int> _bitReverse;
+	std::vector<float> _twiddles;       // per pass: w1 re, w1 im, w2 re, w2 im
+	std::vector<float> _realTwiddles;   // real split: cos, sin of 2.pi.k/size
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOFFT_H_ */
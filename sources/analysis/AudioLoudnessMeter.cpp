@@ -0,0 +1,442 @@
+/*
+ * AudioLoudnessMeter.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+#include "../AudioBuffer.h"
+#include "../AudioError.h"
+#include "../AudioExecutor.h"
+#include "../AudioTrace.h"
+#include "AudioLoudnessMeter.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+#define LOUDNESS_BLOCK_FRAME_COUNT 1024
+
+// Sub-blocks are 100ms long, gating blocks span 4 sub-blocks (400ms, 75%
+// overlap) and short-term windows 30 sub-blocks (3s).
+#define GATING_BLOCK_LENGTH     4
+#define SHORT_TERM_LENGTH      30
+
+#define ABSOLUTE_GATE       -70.0
+#define RELATIVE_GATE       -10.0
+#define LRA_RELATIVE_GATE   -20.0
+#define REPLAY_GAIN_REFERENCE -18.0
+
+// 4x oversampling interpolator, 12 taps per phase.
+#define TRUE_PEAK_PHASES         4
+#define TRUE_PEAK_TAPS          12
+#define TRUE_PEAK_HISTORY       (TRUE_PEAK_TAPS - 1)
+
+static double _loudness(double energy) {
+	return energy > 0 ? -0.691 + 10.0*std::log10(energy) : -HUGE_VAL;
+}
+
+static double _energy(double loudness) {
+	return std::pow(10.0, (loudness + 0.691)/10.0);
+}
+
+struct TruePeakInterpolator {
+	float coefficients[TRUE_PEAK_PHASES][TRUE_PEAK_TAPS];
+
+	TruePeakInterpolator() {
+		const int length = TRUE_PEAK_PHASES*TRUE_PEAK_TAPS;
+		const double center = (length - 1)/2.0;
+		double h[length], sum = 0;
+
+		// Windowed sinc low-pass at the original Nyquist frequency.
+		for (int n = 0; n < length; ++n) {
+			double x = (n - center)/TRUE_PEAK_PHASES;
+			double sinc = (x == 0) ? 1.0 : std::sin(M_PI*x)/(M_PI*x);
+			double window = 0.42 - 0.5*std::cos(2*M_PI*(n + 0.5)/length) + 0.08*std::cos(4*M_PI*(n + 0.5)/length);
+			h[n] = sinc*window;
+			sum += h[n];
+		}
+		for (int n = 0; n < length; ++n) {
+			coefficients[n % TRUE_PEAK_PHASES][n/TRUE_PEAK_PHASES] = static_cast<float>(h[n]*TRUE_PEAK_PHASES/sum);
+		}
+	}
+};
+
+static const TruePeakInterpolator true_peak_interpolator;
+
+LoudnessMeter::LoudnessMeter() :
+	_ready(false),
+	_format(1, 44100, 16) {
+	reset();
+}
+
+LoudnessMeter::LoudnessMeter(Format format) :
+	_ready(false),
+	_format(format) {
+	setup(format);
+}
+
+void LoudnessMeter::setup(Format format) {
+	const double rate = format.sampleRate();
+	unsigned int channel_count = format.channelCount();
+	double f0, G, Q, K, Vh, Vb, a0;
+
+	_format = format;
+	_subBlockSize = format.sampleRate()/10;
+
+	// BS.1770 K-weighting filters, computed for the stream sample rate.
+	f0 = 1681.974450955533;
+	G  = 3.999843853973347;
+	Q  = 0.7071752369554196;
+	K  = std::tan(M_PI*f0/rate);
+	Vh = std::pow(10.0, G/20.0);
+	Vb = std::pow(Vh, 0.4996667741545416);
+	a0 = 1.0 + K/Q + K*K;
+	_shelf.b0 = (Vh + Vb*K/Q + K*K)/a0;
+	_shelf.b1 = 2.0*(K*K - Vh)/a0;
+	_shelf.b2 = (Vh - Vb*K/Q + K*K)/a0;
+	_shelf.a1 = 2.0*(K*K - 1.0)/a0;
+	_shelf.a2 = (1.0 - K/Q + K*K)/a0;
+
+	f0 = 38.13547087602444;
+	Q  = 0.5003270373238773;
+	K  = std::tan(M_PI*f0/rate);
+	a0 = 1.0 + K/Q + K*K;
+	_highpass.b0 = 1.0;
+	_highpass.b1 = -2.0;
+	_highpass.b2 = 1.0;
+	_highpass.a1 = 2.0*(K*K - 1.0)/a0;
+	_highpass.a2 = (1.0 - K/Q + K*K)/a0;
+
+	_weights.assign(channel_count, 1.0);
+	if (channel_count == 6) {
+		_weights[3] = 0.0;
+		_weights[4] = _weights[5] = 1.41;
+	}
+
+	_scratch.assign(channel_count*LOUDNESS_BLOCK_FRAME_COUNT, 0.0f);
+	_planes.assign(channel_count, nullptr);
+	_ready = true;
+
+	reset();
+}
+
+unsigned int LoudnessMeter::segmentAlignment() const {
+	return _subBlockSize;
+}
+
+void LoudnessMeter::setChannelWeights(const std::vector<double> &weights) {
+	if (! _ready || weights.size() != _format.channelCount()) {
+		Error::raise(Error::Status::FormatBadValue, "Channel weights do not match the meter format.");
+	}
+	_weights = weights;
+}
+
+void LoudnessMeter::reset() {
+	unsigned int channel_count = _ready ? _format.channelCount() : 0;
+	_filterState.assign(4*channel_count, 0.0);
+	_history.assign(TRUE_PEAK_HISTORY*channel_count, 0.0f);
+	_subBlocks.clear();
+	_pendingEnergy = 0;
+	_pendingFrames = 0;
+	_samplePeak = 0;
+	_truePeak = 0;
+}
+
+void LoudnessMeter::filter(unsigned int offset, unsigned int count, const float * const *planar, bool measure) {
+	unsigned int channel_count = _format.channelCount();
+	const Biquad s = _shelf, h = _highpass;
+
+	// True peak, the interpolator runs on the history followed by the block.
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		float window[TRUE_PEAK_HISTORY + LOUDNESS_BLOCK_FRAME_COUNT];
+		float *history = &_history[c*TRUE_PEAK_HISTORY];
+		const float *src = planar[c] + offset;
+
+		std::copy(history, history + TRUE_PEAK_HISTORY, window);
+		std::copy(src, src + count, window + TRUE_PEAK_HISTORY);
+
+		if (measure) {
+			float sample_peak = 0, true_peak = 0;
+			for (unsigned int i = 0; i < count; ++i) {
+				sample_peak = std::max(sample_peak, std::fabs(src[i]));
+				for (unsigned int p = 0; p < TRUE_PEAK_PHASES; ++p) {
+					const float *coef = true_peak_interpolator.coefficients[p];
+					float acc = 0;
+					for (unsigned int k = 0; k < TRUE_PEAK_TAPS; ++k) {
+						acc += coef[k]*window[i + TRUE_PEAK_HISTORY - k];
+					}
+					true_peak = std::max(true_peak, std::fabs(acc));
+				}
+			}
+			_samplePeak = std::max(_samplePeak, (double)sample_peak);
+			_truePeak = std::max(_truePeak, (double)std::max(true_peak, sample_peak));
+		}
+
+		std::copy(window + count, window + count + TRUE_PEAK_HISTORY, history);
+	}
+
+	// K-weighting and mean square, split on sub-block boundaries.
+	for (unsigned int done = 0, chunk; done < count; done += chunk) {
+		chunk = std::min(count - done, _subBlockSize - _pendingFrames);
+
+		for (unsigned int c = 0; c < channel_count; ++c) {
+			double *z = &_filterState[4*c];
+			const float *src = planar[c] + offset + done;
+			double sum = 0;
+
+			for (unsigned int i = 0; i < chunk; ++i) {
+				double x = src[i];
+				double y = s.b0*x + z[0];
+				z[0] = s.b1*x - s.a1*y + z[1];
+				z[1] = s.b2*x - s.a2*y;
+				x = y;
+				y = h.b0*x + z[2];
+				z[2] = h.b1*x - h.a1*y + z[3];
+				z[3] = h.b2*x - h.a2*y;
+				sum += y*y;
+			}
+			_pendingEnergy += _weights[c]*sum;
+		}
+
+		if (measure) {
+			_pendingFrames += chunk;
+			if (_pendingFrames == _subBlockSize) {
+				_subBlocks.push_back(_pendingEnergy/_subBlockSize);
+				_pendingEnergy = 0;
+				_pendingFrames = 0;
+			}
+		} else {
+			_pendingEnergy = 0;
+		}
+	}
+}
+
+void LoudnessMeter::process(unsigned int count, const float * const *planar) {
+	if (! _ready) {
+		Error::raise(Error::Status::UndefinedFormat, "Loudness meter format is not set.");
+	}
+	for (unsigned int done = 0, chunk; done < count; done += chunk) {
+		chunk = std::min(count - done, (unsigned int)LOUDNESS_BLOCK_FRAME_COUNT);
+		filter(done, chunk, planar, true);
+	}
+}
+
+void LoudnessMeter::process(const Buffer &buffer, unsigned int offset, unsigned int count) {
+	if (! _ready) {
+		setup(buffer.format());
+	} else if (buffer.format().channelCount() != _format.channelCount()
+			|| buffer.format().sampleRate() != _format.sampleRate()) {
+		Error::raise(Error::Status::FormatBadValue, "Buffer format does not match the loudness meter format.");
+	}
+
+	for (unsigned int c = 0; c < _format.channelCount(); ++c) {
+		_planes[c] = &_scratch[c*LOUDNESS_BLOCK_FRAME_COUNT];
+	}
+
+	for (unsigned int done = 0, chunk; done < count; done += chunk) {
+		chunk = buffer.read(offset + done, std::min(count - done, (unsigned int)LOUDNESS_BLOCK_FRAME_COUNT), _planes.data());
+		if (chunk == 0) break;
+		filter(0, chunk, _planes.data(), true);
+	}
+}
+
+void LoudnessMeter::prime(const Buffer &buffer, unsigned int offset, unsigned int count) {
+	if (! _ready) {
+		setup(buffer.format());
+	}
+
+	for (unsigned int c = 0; c < _format.channelCount(); ++c) {
+		_planes[c] = &_scratch[c*LOUDNESS_BLOCK_FRAME_COUNT];
+	}
+
+	for (unsigned int done = 0, chunk; done < count; done += chunk) {
+		chunk = buffer.read(offset + done, std::min(count - done, (unsigned int)LOUDNESS_BLOCK_FRAME_COUNT), _planes.data());
+		if (chunk == 0) break;
+		filter(0, chunk, _planes.data(), false);
+	}
+}
+
+void LoudnessMeter::merge(const LoudnessMeter &other) {
+	if (! other._ready) {
+		return;
+	}
+	if (! _ready) {
+		*this = other;
+		return;
+	}
+	if (other._format.channelCount() != _format.channelCount()
+			|| other._format.sampleRate() != _format.sampleRate()) {
+		Error::raise(Error::Status::FormatBadValue, "Can not merge loudness meters of different formats.");
+	}
+	if (_pendingFrames != 0) {
+		Error::raise(Error::Status::FormatBadValue, "Merged segment does not start on a sub-block boundary.");
+	}
+
+	_subBlocks.insert(_subBlocks.end(), other._subBlocks.begin(), other._subBlocks.end());
+	_pendingEnergy = other._pendingEnergy;
+	_pendingFrames = other._pendingFrames;
+	_filterState = other._filterState;
+	_history = other._history;
+	_samplePeak = std::max(_samplePeak, other._samplePeak);
+	_truePeak = std::max(_truePeak, other._truePeak);
+}
+
+// Every segment but the last one covers whole sub-blocks, and none is
+// empty: a segment starting at the end of the buffer would not start on a
+// sub-block boundary once the previous one is merged.
+LoudnessMeter LoudnessMeter::analyze(const Buffer &buffer, unsigned int threadCount) {
+	unsigned int alignment = LoudnessMeter(buffer.format()).segmentAlignment();
+	unsigned int block_count = (buffer.frameCount() + alignment - 1)/alignment;
+	unsigned int segment_count = std::max(std::min(threadCount, block_count), 1u);
+	unsigned int segment = (block_count + segment_count - 1)/segment_count*alignment;
+	if (segment > 0) {
+		segment_count = (buffer.frameCount() + segment - 1)/segment;
+	}
+
+	std::vector<LoudnessMeter> meters(segment_count, LoudnessMeter(buffer.format()));
+	std::vector<std::exception_ptr> errors(meters.size());
+	Executor::Group group(meters.size());
+
+	for (unsigned int i = 0; i < meters.size(); ++i) {
+		group.submit([&, i]() {
+			Trace::Span span("loudness.segment", "analysis");
+			try {
+				unsigned int start = std::min(i*segment, buffer.frameCount());
+				unsigned int count = std::min(segment, buffer.frameCount() - start);
+				unsigned int preroll = std::min(start, alignment);
+
+				meters[i].prime(buffer, start - preroll, preroll);
+				meters[i].process(buffer, start, count);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		});
+	}
+
+	{
+		Trace::Span span("loudness.join", "analysis");
+		group.wait();
+	}
+	for (unsigned int i = 0; i < errors.size(); ++i) {
+		if (errors[i]) std::rethrow_exception(errors[i]);
+	}
+
+	LoudnessMeter meter = meters[0];
+	for (unsigned int i = 1; i < meters.size(); ++i) {
+		if (i*segment < buffer.frameCount()) {
+			meter.merge(meters[i]);
+		}
+	}
+	return meter;
+}
+
+double LoudnessMeter::windowEnergy(unsigned int last, unsigned int length) const {
+	double sum = 0;
+	for (unsigned int i = last + 1 - length; i <= last; ++i) {
+		sum += _subBlocks[i];
+	}
+	return sum/length;
+}
+
+double LoudnessMeter::integratedLoudness() const {
+	const double absolute_gate = _energy(ABSOLUTE_GATE);
+	std::vector<double> blocks;
+
+	for (unsigned int i = GATING_BLOCK_LENGTH - 1; i < _subBlocks.size(); ++i) {
+		double energy = windowEnergy(i, GATING_BLOCK_LENGTH);
+		if (energy > absolute_gate) {
+			blocks.push_back(energy);
+		}
+	}
+	if (blocks.empty()) {
+		return -HUGE_VAL;
+	}
+
+	double sum = 0;
+	for (double energy : blocks) sum += energy;
+	const double relative_gate = sum/blocks.size()*std::pow(10.0, RELATIVE_GATE/10.0);
+
+	unsigned int count = 0;
+	sum = 0;
+	for (double energy : blocks) {
+		if (energy > relative_gate) {
+			sum += energy;
+			count++;
+		}
+	}
+	return count > 0 ? _loudness(sum/count) : -HUGE_VAL;
+}
+
+double LoudnessMeter::loudnessRange() const {
+	const double absolute_gate = _energy(ABSOLUTE_GATE);
+	std::vector<double> windows;
+
+	for (unsigned int i = SHORT_TERM_LENGTH - 1; i < _subBlocks.size(); ++i) {
+		double energy = windowEnergy(i, SHORT_TERM_LENGTH);
+		if (energy > absolute_gate) {
+			windows.push_back(energy);
+		}
+	}
+	if (windows.empty()) {
+		return 0;
+	}
+
+	double sum = 0;
+	for (double energy : windows) sum += energy;
+	const double relative_gate = sum/windows.size()*std::pow(10.0, LRA_RELATIVE_GATE/10.0);
+
+	std::vector<double> gated;
+	for (double energy : windows) {
+		if (energy > relative_gate) {
+			gated.push_back(energy);
+		}
+	}
+	if (gated.empty()) {
+		return 0;
+	}
+
+	std::sort(gated.begin(), gated.end());
+	double low  = gated[static_cast<size_t>(std::round((gated.size() - 1)*0.10))];
+	double high = gated[static_cast<size_t>(std::round((gated.size() - 1)*0.95))];
+	return _loudness(high) - _loudness(low);
+}
+
+double LoudnessMeter::momentaryLoudness() const {
+	if (_subBlocks.size() < GATING_BLOCK_LENGTH) {
+		return -HUGE_VAL;
+	}
+	return _loudness(windowEnergy(_subBlocks.size() - 1, GATING_BLOCK_LENGTH));
+}
+
+double LoudnessMeter::shortTermLoudness() const {
+	if (_subBlocks.size() < SHORT_TERM_LENGTH) {
+		return -HUGE_VAL;
+	}
+	return _loudness(windowEnergy(_subBlocks.size() - 1, SHORT_TERM_LENGTH));
+}
+
+double LoudnessMeter::truePeak() const {
+	return _truePeak > 0 ? 20.0*std::log10(_truePeak) : -HUGE_VAL;
+}
+
+double LoudnessMeter::samplePeak() const {
+	return _samplePeak;
+}
+
+double LoudnessMeter::replayGain() const {
+	double loudness = integratedLoudness();
+	return std::isfinite(loudness) ? REPLAY_GAIN_REFERENCE - loudness : 0;
+}
+
+double LoudnessMeter::replayGainPeak() const {
+	return _truePeak;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
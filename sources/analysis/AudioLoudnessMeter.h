@@ -0,0 +1,140 @@
+/*
+ * AudioLoudnessMeter.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOLOUDNESSMETER_H_
+#define AUDIOLOUDNESSMETER_H_
+
+#include <vector>
+
+#include "../AudioFormat.h"
+#include "AudioAnalyzer.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class LoudnessMeter
+ * Streaming EBU R128 / ITU-R BS.1770-4 loudness meter.
+ *
+ * Frames are K-weighted (pre-filter and RLB high-pass biquads) and their
+ * mean square is accumulated per 100ms sub-block. 400ms gating blocks and
+ * 3s short-term windows are built from the sub-blocks when results are
+ * requested, so the state of a meter is the sub-block energy sequence plus
+ * the peaks, and two meters covering consecutive parts of a stream can be
+ * merged (see `merge`).
+ *
+ * True peak is measured on a 4x oversampled signal (48 taps polyphase
+ * interpolator).
+ */
+class LoudnessMeter : public Analyzer {
+public:
+	/**
+	 * * `LoudnessMeter()`
+	 *     Build a meter which takes its format from the first processed
+	 *     buffer.
+	 */
+	LoudnessMeter();
+	/**
+	 * * `LoudnessMeter(Format)`
+	 */
+	LoudnessMeter(Format);
+	virtual ~LoudnessMeter() {}
+
+public:
+	/**
+	 * * `static LoudnessMeter analyze(const Buffer &, unsigned int threadCount)`
+	 *     Analyze a whole buffer splitting it in `threadCount` segments
+	 *     measured concurrently on the shared executor, then merged.
+	 */
+	static LoudnessMeter analyze(const Buffer &, unsigned int threadCount);
+
+	/**
+	 * * `unsigned int segmentAlignment() const`
+	 *     Frame count of a sub-block. Segments measured by separate meters
+	 *     then merged must start on a multiple of this value.
+	 */
+	unsigned int segmentAlignment() const;
+
+	/**
+	 * * `void setChannelWeights(const std::vector<double> &)`
+	 *     Override the BS.1770 channel weights (default is 1.0 for every
+	 *     channel, 5.1 streams get 0.0 for LFE and 1.41 for surrounds,
+	 *     WAV channel order).
+	 */
+	void setChannelWeights(const std::vector<double> &);
+
+	/**
+	 * * `void reset()`
+	 */
+	void reset();
+
+	virtual void process(const Buffer &, unsigned int offset, unsigned int count);
+	void process(unsigned int count, const float * const *planar);
+
+	/**
+	 * * `void prime(const Buffer &, unsigned int offset, unsigned int count)`
+	 *     Run the filters on the given frames without measuring them. Used
+	 *     to warm up a meter on the frames preceding its segment.
+	 */
+	void prime(const Buffer &, unsigned int offset, unsigned int count);
+
+	/**
+	 * * `void merge(const LoudnessMeter &)`
+	 *     Append the measure of a meter which analyzed the frames following
+	 *     the ones analyzed by this meter.
+	 */
+	void merge(const LoudnessMeter &);
+
+public:
+	/** Gated integrated loudness in LUFS, -HUGE_VAL if silent. */
+	double integratedLoudness() const;
+	/** Loudness range in LU. */
+	double loudnessRange() const;
+	/** Loudness of the last 400ms in LUFS. */
+	double momentaryLoudness() const;
+	/** Loudness of the last 3s in LUFS. */
+	double shortTermLoudness() const;
+	/** Maximum true peak over all channels, in dBTP. */
+	double truePeak() const;
+	/** Maximum sample peak over all channels, linear. */
+	double samplePeak() const;
+	/** ReplayGain 2.0 track gain (reference -18 LUFS), in dB. */
+	double replayGain() const;
+	/** ReplayGain 2.0 track peak, linear true peak. */
+	double replayGainPeak() const;
+
+private:
+	struct Biquad {
+		double b0, b1, b2, a1, a2;
+	};
+
+	void setup(Format);
+	void filter(unsigned int offset, unsigned int count, const float * const *planar, bool measure);
+	double windowEnergy(unsigned int last, unsigned int length) const;
+
+private:
+	bool _ready;
+	Format _format;
+	unsigned int _subBlockSize;
+	Biquad _shelf, _highpass;
+	std::vector<double> _weights;
+	std::vector<double> _filterState;   // 2 values per channel and biquad
+	std::vector<float> _history;        // interpolator history, per channel
+	std::vector<float> _scratch;        // planar float frames read from buffers
+	std::vector<float *> _planes;
+	std::vector<double> _subBlocks;     // weighted mean square per sub-block
+	double _pendingEnergy;
+	unsigned int _pendingFrames;
+	double _samplePeak;
+	double _truePeak;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOLOUDNESSMETER_H_ */
@@ -0,0 +1,343 @@
+/*
+ * AudioPeakPyramid.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "../AudioBuffer.h"
+#include "../AudioError.h"
+#include "AudioPeakPyramid.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int PeakPyramid::DefaultBaseShift;
+
+#define PEAK_FILE_VERSION 1
+
+struct PeakFileHeader {
+	char magic[4];
+	uint16_t version;
+	uint16_t channelCount;
+	uint32_t sampleRate;
+	uint32_t frameCount;
+	uint8_t baseShift;
+	uint8_t levelCount;
+	uint16_t reserved;
+} __attribute__((packed));
+
+struct PeakFileBin {
+	int16_t min;
+	int16_t max;
+	uint16_t rms;
+} __attribute__((packed));
+
+template<typename SAMPLE>
+struct PeakScale {
+	static inline int value(SAMPLE v) { return v; }
+};
+
+template<>
+struct PeakScale<int8_t> {
+	static inline int value(int8_t v) { return v*256; }
+};
+
+PeakPyramid::PeakPyramid(unsigned int baseShift) :
+	_baseShift(baseShift),
+	_channelCount(0),
+	_sampleRate(0),
+	_frameCount(0),
+	_finished(false),
+	_pendingFrames(0) {
+	if (baseShift > 24) {
+		Error::raise(Error::Status::FormatBadValue, "Peak pyramid base bin is too large.");
+	}
+}
+
+void PeakPyramid::process(const Buffer &buffer, unsigned int offset, unsigned int count) {
+	Format format = buffer.format();
+
+	if (_finished) {
+		Error::raise(Error::Status::FormatBadValue, "Peak pyramid is finished.");
+	}
+	if (_channelCount == 0) {
+		_channelCount = format.channelCount();
+		_sampleRate = format.sampleRate();
+		_pending.assign(_channelCount, Bin{ std::numeric_limits<int16_t>::max(), std::numeric_limits<int16_t>::min(), 0 });
+		_pendingSquares.assign(_channelCount, 0.0);
+		_merged.resize(_channelCount);
+	} else if (format.channelCount() != _channelCount) {
+		Error::raise(Error::Status::FormatBadValue, "Buffer format does not match the peak pyramid.");
+	}
+
+	if (offset >= buffer.frameCount()) {
+		return;
+	}
+	count = std::min(count, buffer.frameCount() - offset);
+
+	const char *data = buffer.data() + format.sizeForFrameCount(offset);
+	switch (format.bitDepth()) {
+	case 8:
+		accumulate((const int8_t *)data, count);
+		break;
+
+	case 16:
+		accumulate((const int16_t *)data, count);
+		break;
+	}
+}
+
+// The per channel loops run over the interleaved samples with a constant
+// stride, min/max and the sum of squares are kept in locals so the
+// compiler vectorises them.
+template<typename SAMPLE>
+void PeakPyramid::accumulate(const SAMPLE *src, unsigned int count) {
+	const unsigned int bin_size = baseBinSize();
+	const unsigned int channel_count = _channelCount;
+	const float norm = 1.0f/(32767.0f*32767.0f);
+
+	_frameCount += count;
+
+	while (count > 0) {
+		unsigned int n = std::min(count, bin_size - _pendingFrames);
+
+		for (unsigned int c = 0; c < channel_count; ++c) {
+			int mn = _pending[c].min, mx = _pending[c].max;
+			float squares = 0;
+			for (unsigned int i = 0; i < n; ++i) {
+				int v = PeakScale<SAMPLE>::value(src[i*channel_count + c]);
+				mn = std::min(mn, v);
+				mx = std::max(mx, v);
+				squares += static_cast<float>(v)*static_cast<float>(v);
+			}
+			_pending[c].min = mn;
+			_pending[c].max = mx;
+			_pendingSquares[c] += squares*norm;
+		}
+
+		src += n*channel_count;
+		count -= n;
+		_pendingFrames += n;
+
+		if (_pendingFrames == bin_size) {
+			for (unsigned int c = 0; c < channel_count; ++c) {
+				_pending[c].meanSquare = _pendingSquares[c]/bin_size;
+			}
+			push(0, _pending.data());
+			for (unsigned int c = 0; c < channel_count; ++c) {
+				_pending[c] = Bin{ std::numeric_limits<int16_t>::max(), std::numeric_limits<int16_t>::min(), 0 };
+				_pendingSquares[c] = 0;
+			}
+			_pendingFrames = 0;
+		}
+	}
+}
+
+// Bins hold `baseBinSize() << level` frames, but the last one of a level
+// which may be cut by the end of the stream.
+unsigned int PeakPyramid::binFrameCount(unsigned int level, size_t index) const {
+	size_t bin_size = (size_t)baseBinSize() << level;
+	size_t start = index*bin_size;
+	return start < _frameCount ? std::min<size_t>(bin_size, _frameCount - start) : 0;
+}
+
+void PeakPyramid::push(unsigned int level, const Bin *bins) {
+	for (;; ++level) {
+		if (_levels.size() <= level) {
+			_levels.resize(level + 1);
+		}
+
+		std::vector<Bin> &bins_at_level = _levels[level];
+		bins_at_level.insert(bins_at_level.end(), bins, bins + _channelCount);
+
+		size_t bin_count = bins_at_level.size()/_channelCount;
+		if (bin_count % 2 != 0) {
+			break;
+		}
+
+		// A pair is complete, merge it in the level above. The mean squares
+		// are weighted by frame counts, the second bin may be the last one.
+		const Bin *a = &bins_at_level[(bin_count - 2)*_channelCount];
+		const Bin *b = &bins_at_level[(bin_count - 1)*_channelCount];
+		float weight_a = binFrameCount(level, bin_count - 2), weight_b = binFrameCount(level, bin_count - 1);
+		float norm = weight_a + weight_b > 0 ? 1.0f/(weight_a + weight_b) : 0.0f;
+		for (unsigned int c = 0; c < _channelCount; ++c) {
+			_merged[c].min = std::min(a[c].min, b[c].min);
+			_merged[c].max = std::max(a[c].max, b[c].max);
+			_merged[c].meanSquare = (weight_a*a[c].meanSquare + weight_b*b[c].meanSquare)*norm;
+		}
+		bins = _merged.data();
+	}
+}
+
+void PeakPyramid::finish() {
+	if (_finished || _channelCount == 0) {
+		_finished = true;
+		return;
+	}
+
+	if (_pendingFrames > 0) {
+		for (unsigned int c = 0; c < _channelCount; ++c) {
+			_pending[c].meanSquare = _pendingSquares[c]/_pendingFrames;
+		}
+		push(0, _pending.data());
+		_pendingFrames = 0;
+	}
+
+	// Carry the unpaired last bin of each level up to the level above, until
+	// the top level holds a single bin.
+	for (unsigned int level = 0; level < _levels.size() && _levels[level].size()/_channelCount > 1; ++level) {
+		size_t bin_count = _levels[level].size()/_channelCount;
+		if (bin_count % 2 == 1) {
+			std::vector<Bin> last(_levels[level].end() - _channelCount, _levels[level].end());
+			push(level + 1, last.data());
+		}
+	}
+
+	_finished = true;
+}
+
+std::vector<PeakPyramid::Peak> PeakPyramid::query(unsigned int start, unsigned int end, unsigned int pixelWidth) const {
+	std::vector<Peak> peaks(pixelWidth*_channelCount, Peak{ 0, 0, 0 });
+
+	end = std::min(end, _frameCount);
+	if (pixelWidth == 0 || start >= end || _levels.empty()) {
+		return peaks;
+	}
+
+	const double frames_per_pixel = static_cast<double>(end - start)/pixelWidth;
+	unsigned int level = 0;
+	while (level + 1 < _levels.size() && (static_cast<double>(baseBinSize() << (level + 1))) <= frames_per_pixel) {
+		level++;
+	}
+
+	const std::vector<Bin> &bins = _levels[level];
+	const unsigned int bin_size = baseBinSize() << level;
+	const size_t bin_count = bins.size()/_channelCount;
+	const float scale = 1.0f/32767.0f;
+
+	if (bin_count == 0) {
+		return peaks;
+	}
+
+	for (unsigned int p = 0; p < pixelWidth; ++p) {
+		size_t a = start + static_cast<size_t>(p*frames_per_pixel);
+		size_t b = start + static_cast<size_t>(std::ceil((p + 1)*frames_per_pixel));
+		size_t first = std::min(a/bin_size, bin_count - 1);
+		size_t last = std::min(std::max(a, b - 1)/bin_size, bin_count - 1);
+
+		for (unsigned int c = 0; c < _channelCount; ++c) {
+			int mn = std::numeric_limits<int>::max(), mx = std::numeric_limits<int>::min();
+			float squares = 0, frames = 0;
+			for (size_t i = first; i <= last; ++i) {
+				const Bin &bin = bins[i*_channelCount + c];
+				float weight = binFrameCount(level, i);
+				mn = std::min(mn, (int)bin.min);
+				mx = std::max(mx, (int)bin.max);
+				squares += weight*bin.meanSquare;
+				frames += weight;
+			}
+			Peak &peak = peaks[p*_channelCount + c];
+			peak.min = mn*scale;
+			peak.max = mx*scale;
+			peak.rms = frames > 0 ? std::sqrt(squares/frames) : 0;
+		}
+	}
+
+	return peaks;
+}
+
+void PeakPyramid::save(std::ostream &out) const {
+	PeakFileHeader header;
+
+	memcpy(header.magic, "NRPK", 4);
+	header.version = PEAK_FILE_VERSION;
+	header.channelCount = _channelCount;
+	header.sampleRate = _sampleRate;
+	header.frameCount = _frameCount;
+	header.baseShift = _baseShift;
+	header.levelCount = _levels.size();
+	header.reserved = 0;
+
+	out.write((const char *)&header, sizeof(header));
+
+	std::vector<PeakFileBin> records;
+	for (const std::vector<Bin> &bins : _levels) {
+		uint32_t bin_count = _channelCount > 0 ? bins.size()/_channelCount : 0;
+		out.write((const char *)&bin_count, sizeof(bin_count));
+
+		records.resize(bins.size());
+		for (size_t i = 0; i < bins.size(); ++i) {
+			records[i].min = bins[i].min;
+			records[i].max = bins[i].max;
+			records[i].rms = static_cast<uint16_t>(std::min(1.0f, std::sqrt(bins[i].meanSquare))*65535.0f + 0.5f);
+		}
+		out.write((const char *)records.data(), records.size()*sizeof(PeakFileBin));
+	}
+
+	if (out.fail()) {
+		Error::raise(Error::Status::IOError, "Failed to write peak file.");
+	}
+}
+
+void PeakPyramid::save(const std::string &filename) const {
+	std::ofstream ofs(filename.data(), std::ofstream::binary);
+	save(ofs);
+}
+
+PeakPyramid PeakPyramid::load(std::istream &in) {
+	PeakFileHeader header;
+
+	in.read((char *)&header, sizeof(header));
+	if (in.fail() || memcmp(header.magic, "NRPK", 4) != 0 || header.version != PEAK_FILE_VERSION) {
+		Error::raise(Error::Status::IOError, "Bad peak file.");
+	}
+
+	PeakPyramid pyramid(header.baseShift);
+	pyramid._channelCount = header.channelCount;
+	pyramid._sampleRate = header.sampleRate;
+	pyramid._frameCount = header.frameCount;
+	pyramid._finished = true;
+	pyramid._levels.resize(header.levelCount);
+	pyramid._merged.resize(header.channelCount);
+
+	std::vector<PeakFileBin> records;
+	for (std::vector<Bin> &bins : pyramid._levels) {
+		uint32_t bin_count;
+		in.read((char *)&bin_count, sizeof(bin_count));
+		if (in.fail()) {
+			Error::raise(Error::Status::IOError, "Truncated peak file.");
+		}
+
+		records.resize(bin_count*header.channelCount);
+		in.read((char *)records.data(), records.size()*sizeof(PeakFileBin));
+		if (in.fail()) {
+			Error::raise(Error::Status::IOError, "Truncated peak file.");
+		}
+
+		bins.resize(records.size());
+		for (size_t i = 0; i < records.size(); ++i) {
+			float rms = records[i].rms/65535.0f;
+			bins[i] = Bin{ records[i].min, records[i].max, rms*rms };
+		}
+	}
+
+	return pyramid;
+}
+
+PeakPyramid PeakPyramid::load(const std::string &filename) {
+	std::ifstream ifs(filename.data(), std::ifstream::binary);
+	return load(ifs);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
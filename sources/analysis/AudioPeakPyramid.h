@@ -0,0 +1,124 @@
+/*
+ * AudioPeakPyramid.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOPEAKPYRAMID_H_
+#define AUDIOPEAKPYRAMID_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../AudioFormat.h"
+#include "AudioAnalyzer.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class PeakPyramid
+ * Multi-resolution waveform overview. Level `k` stores, for each channel,
+ * the minimum, maximum and RMS of consecutive bins of
+ * `baseBinSize() << k` frames.
+ *
+ * The pyramid is built in one pass as an `Analyzer` (typically attached to
+ * a `Decoder`): level 0 bins are computed straight from the buffer
+ * samples, upper levels are merged from the level below as soon as two
+ * bins are complete. Once built, `query` renders any range at any width in
+ * O(pixels), whatever the track length.
+ */
+class PeakPyramid : public Analyzer {
+public:
+	struct Peak {
+		float min;
+		float max;
+		float rms;
+	};
+
+	static const unsigned int DefaultBaseShift = 8;
+
+public:
+	/**
+	 * * `PeakPyramid(unsigned int baseShift)`
+	 *     Build an empty pyramid with level 0 bins of `1 << baseShift`
+	 *     frames. The format is taken from the first processed buffer.
+	 */
+	PeakPyramid(unsigned int baseShift = DefaultBaseShift);
+	virtual ~PeakPyramid() {}
+
+public:
+	/**
+	 * * `static PeakPyramid load(std::istream &)`
+	 * * `static PeakPyramid load(const std::string &)`
+	 *     Load a pyramid previously saved with `save`.
+	 */
+	static PeakPyramid load(std::istream &);
+	static PeakPyramid load(const std::string &);
+
+	/**
+	 * * `void save(std::ostream &) const`
+	 * * `void save(const std::string &) const`
+	 *     Write the pyramid as a compact sidecar (6 bytes per channel and
+	 *     bin).
+	 */
+	void save(std::ostream &) const;
+	void save(const std::string &) const;
+
+public:
+	virtual void process(const Buffer &, unsigned int offset, unsigned int count);
+
+	/**
+	 * * `void finish()`
+	 *     Flush the last, incomplete, bins. Must be called once the whole
+	 *     stream has been processed.
+	 */
+	void finish();
+
+	unsigned int channelCount() const { return _channelCount; }
+	unsigned int sampleRate() const { return _sampleRate; }
+	unsigned int frameCount() const { return _frameCount; }
+	unsigned int baseBinSize() const { return 1u << _baseShift; }
+	unsigned int levelCount() const { return _levels.size(); }
+
+	/**
+	 * * `std::vector<Peak> query(unsigned int start, unsigned int end, unsigned int pixelWidth) const`
+	 *     Get the peaks of the frames [start, end) rendered on `pixelWidth`
+	 *     pixels. The result holds `pixelWidth` peaks per channel,
+	 *     interleaved (pixel major).
+	 */
+	std::vector<Peak> query(unsigned int start, unsigned int end, unsigned int pixelWidth) const;
+
+private:
+	struct Bin {
+		int16_t min;
+		int16_t max;
+		float meanSquare;
+	};
+
+	template<typename SAMPLE>
+	void accumulate(const SAMPLE *src, unsigned int count);
+	void push(unsigned int level, const Bin *bins);
+	unsigned int binFrameCount(unsigned int level, size_t index) const;
+
+private:
+	unsigned int _baseShift;
+	unsigned int _channelCount;
+	unsigned int _sampleRate;
+	unsigned int _frameCount;
+	bool _finished;
+	std::vector<std::vector<Bin>> _levels;
+	std::vector<Bin> _pending;
+	std::vector<Bin> _merged;
+	std::vector<double> _pendingSquares;
+	unsigned int _pendingFrames;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOPEAKPYRAMID_H_ */
@@ -0,0 +1,138 @@
+/*
+ * AudioSpectrogram.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "../AudioBuffer.h"
+#include "../AudioError.h"
+#include "AudioSpectrogram.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+#define SPECTROGRAM_BLOCK_FRAME_COUNT 1024
+
+Spectrogram::Spectrogram(unsigned int frameSize, unsigned int hopSize, Window window, Callback callback) :
+	_fft(FFT::plan(frameSize)),
+	_hopSize(hopSize),
+	_callback(callback),
+	_window(frameSize),
+	_fifo(frameSize, 0.0f),
+	_fifoFill(0),
+	_windowed(frameSize),
+	_re(frameSize/2 + 1),
+	_im(frameSize/2 + 1),
+	_magnitudes(frameSize/2 + 1),
+	_mono(SPECTROGRAM_BLOCK_FRAME_COUNT),
+	_frameIndex(0) {
+	if (hopSize == 0 || hopSize > frameSize) {
+		Error::raise(Error::Status::FormatBadValue, "Spectrogram hop size must be in [1, frameSize].");
+	}
+
+	double sum = 0;
+	for (unsigned int i = 0; i < frameSize; ++i) {
+		double x = 2*M_PI*i/frameSize, w = 1.0;
+		switch (window) {
+		case Window::Rectangular:
+			break;
+
+		case Window::Hann:
+			w = 0.5 - 0.5*std::cos(x);
+			break;
+
+		case Window::Hamming:
+			w = 0.54 - 0.46*std::cos(x);
+			break;
+
+		case Window::Blackman:
+			w = 0.42 - 0.5*std::cos(x) + 0.08*std::cos(2*x);
+			break;
+		}
+		_window[i] = w;
+		sum += w;
+	}
+	_scale = 2.0/sum;
+}
+
+void Spectrogram::reset() {
+	_fifoFill = 0;
+	_frameIndex = 0;
+}
+
+void Spectrogram::process(unsigned int count, const float *mono) {
+	const unsigned int frame_size = frameSize();
+
+	while (count > 0) {
+		unsigned int n = std::min(count, frame_size - _fifoFill);
+		memcpy(&_fifo[_fifoFill], mono, n*sizeof(float));
+		_fifoFill += n;
+		mono += n;
+		count -= n;
+
+		if (_fifoFill == frame_size) {
+			emit();
+			memmove(&_fifo[0], &_fifo[_hopSize], (frame_size - _hopSize)*sizeof(float));
+			_fifoFill = frame_size - _hopSize;
+		}
+	}
+}
+
+void Spectrogram::process(const Buffer &buffer, unsigned int offset, unsigned int count) {
+	const unsigned int channel_count = buffer.format().channelCount();
+
+	// Only reallocated when the channel count changes.
+	if (_planes.size() != channel_count) {
+		_scratch.assign(channel_count*SPECTROGRAM_BLOCK_FRAME_COUNT, 0.0f);
+		_planes.resize(channel_count);
+	}
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		_planes[c] = &_scratch[c*SPECTROGRAM_BLOCK_FRAME_COUNT];
+	}
+
+	const float gain = 1.0f/channel_count;
+	for (unsigned int done = 0, chunk; done < count; done += chunk) {
+		chunk = buffer.read(offset + done, std::min(count - done, (unsigned int)SPECTROGRAM_BLOCK_FRAME_COUNT), _planes.data());
+		if (chunk == 0) break;
+
+		float *mono = _mono.data();
+		std::fill(mono, mono + chunk, 0.0f);
+		for (unsigned int c = 0; c < channel_count; ++c) {
+			const float *src = _planes[c];
+			for (unsigned int i = 0; i < chunk; ++i) {
+				mono[i] += src[i]*gain;
+			}
+		}
+		process(chunk, mono);
+	}
+}
+
+void Spectrogram::emit() {
+	const unsigned int frame_size = frameSize();
+	const unsigned int bin_count = binCount();
+
+	for (unsigned int i = 0; i < frame_size; ++i) {
+		_windowed[i] = _fifo[i]*_window[i];
+	}
+
+	_fft->forward(_windowed.data(), _re.data(), _im.data());
+
+	for (unsigned int k = 0; k < bin_count; ++k) {
+		_magnitudes[k] = _scale*std::sqrt(_re[k]*_re[k] + _im[k]*_im[k]);
+	}
+	// DC and Nyquist have no mirrored bin.
+	_magnitudes[0] *= 0.5f;
+	_magnitudes[bin_count - 1] *= 0.5f;
+
+	_callback(_magnitudes.data(), bin_count, _frameIndex++);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
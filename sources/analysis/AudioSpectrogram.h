@@ -0,0 +1,93 @@
+/*
+ * AudioSpectrogram.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSPECTROGRAM_H_
+#define AUDIOSPECTROGRAM_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "AudioAnalyzer.h"
+#include "AudioFFT.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class Spectrogram
+ * Streaming short-time Fourier transform. The processed frames are mixed
+ * down to mono, windowed every `hopSize` frames over `frameSize` frames and
+ * the magnitude spectrum of each window is passed to a callback.
+ *
+ * All buffers are allocated at construction, processing does not allocate.
+ */
+class Spectrogram : public Analyzer {
+public:
+	enum class Window {
+		Rectangular,
+		Hann,
+		Hamming,
+		Blackman,
+	};
+
+	/**
+	 * Called for each STFT frame with `binCount` (`frameSize/2 + 1`)
+	 * magnitudes, scaled so a full scale sine reads 1.0. The array is only
+	 * valid during the call.
+	 */
+	typedef std::function<void (const float *magnitudes, unsigned int binCount, unsigned int frameIndex)> Callback;
+
+public:
+	/**
+	 * * `Spectrogram(unsigned int frameSize, unsigned int hopSize, Window, Callback)`
+	 *     `frameSize` must be a power of two, `hopSize` must be in
+	 *     [1, frameSize].
+	 */
+	Spectrogram(unsigned int frameSize, unsigned int hopSize, Window, Callback);
+	virtual ~Spectrogram() {}
+
+public:
+	virtual void process(const Buffer &, unsigned int offset, unsigned int count);
+	void process(unsigned int count, const float *mono);
+
+	/**
+	 * * `void reset()`
+	 *     Drop the pending frames and restart the frame index at 0.
+	 */
+	void reset();
+
+	unsigned int frameSize() const { return _fft->size(); }
+	unsigned int hopSize() const { return _hopSize; }
+	unsigned int binCount() const { return _fft->binCount(); }
+	unsigned int frameIndex() const { return _frameIndex; }
+
+private:
+	void emit();
+
+private:
+	std::shared_ptr<const FFT> _fft;
+	unsigned int _hopSize;
+	Callback _callback;
+	std::vector<float> _window;
+	std::vector<float> _fifo;           // last frameSize mono frames
+	unsigned int _fifoFill;
+	std::vector<float> _windowed;
+	std::vector<float> _re, _im;
+	std::vector<float> _magnitudes;
+	std::vector<float> _scratch;        // planar float frames read from buffers
+	std::vector<float *> _planes;
+	std::vector<float> _mono;
+	float _scale;
+	unsigned int _frameIndex;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSPECTROGRAM_H_ */
@@ -5,32 +5,121 @@
  *      Author: jux
  */
 
+#include <algorithm>
+
+#include "boost/algorithm/string.hpp"
+#include "boost/filesystem.hpp"
+
 #include "../AudioError.h"
+#include "../AudioExecutor.h"
+#include "../AudioJob.h"
+#include "../AudioTrace.h"
+#include "../analysis/AudioAnalyzer.h"
+#include "../io/AudioVectoredSink.h"
 #include "AudioCoder.h"
+#include "AudioFLACCoder.h"
+#include "AudioMP3Coder.h"
+#include "AudioOggVorbisCoder.h"
+#include "AudioPCMCoder.h"
+#include "AudioSessionPool.h"
 
 namespace com {
 namespace nealrame {
 namespace audio {
 
+Coder * Coder::getCoder(const std::string filename) {
+	std::string ext = boost::to_lower_copy(boost::filesystem::path(filename).extension().string());
+
+	if (ext == ".mp3") {
+		return new MP3Coder;
+	}
+
+	if (ext == ".ogg") {
+		return new OggVorbisCoder;
+	}
+
+	if (ext == ".flac") {
+		return new FLACCoder;
+	}
+
+	if (ext == ".wav") {
+		return new PCMCoder;
+	}
+
+	throw Error(Error::Status::NoSuitableCoder);
+}
+
 Coder::Coder() : 
 	Coder(Quality::Good) {
 }
 
 Coder::Coder(Quality quality) :
-	_quality(quality) {
+	_quality(quality),
+	_statistics(nullptr) {
 }
 
 void Coder::encode(const Buffer &buffer, const std::string &filename) const {
-	std::ofstream ofs(filename.data(), std::ofstream::binary);
-	try {
-		encode(buffer, ofs);
-		ofs.close();
-	} catch (Error &e) {
-		ofs.close();
-		throw e;
+	VectoredSink sink(filename);
+	encode(buffer, sink);
+}
+
+void Coder::encode(const Buffer &buffer, std::ostream &output) const {
+	StreamSink sink(output);
+	encode(buffer, sink);
+}
+
+std::future<void> Coder::encodeAsync(std::shared_ptr<const Buffer> buffer, const std::string &filename, std::shared_ptr<Job> job) const {
+	std::shared_ptr<std::promise<void>> promise(new std::promise<void>);
+	encodeAsync(buffer, filename, [promise](std::exception_ptr error) {
+		if (error) {
+			promise->set_exception(error);
+		} else {
+			promise->set_value();
+		}
+	}, job);
+	return promise->get_future();
+}
+
+void Coder::encodeAsync(std::shared_ptr<const Buffer> buffer, const std::string &filename, EncodeCallback callback, std::shared_ptr<Job> job) const {
+	Executor::shared().submit([this, buffer, filename, callback, job]() {
+		std::exception_ptr error;
+		try {
+			Trace::Span span("coder.async", "job");
+			Job::Scope scope(job.get());
+			Job::checkpoint(0.);
+			encode(*buffer, filename);
+			if (job) job->setProgress(1);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		// Executor tasks must not throw, there is nobody to report to.
+		try {
+			callback(error);
+		} catch (...) {
+		}
+	});
+}
+
+Coder::Session * Coder::session() const {
+	return new Session;
+}
+
+void Coder::encode(const Buffer &buffer, Sink &output, Session &) const {
+	encode(buffer, output);
+}
+
+Coder::PooledSession::PooledSession(const Coder &coder) :
+	_type(typeid(coder)),
+	_session(SessionPool<Session>::take(_type)) {
+	if (! _session) {
+		_session.reset(coder.session());
 	}
 }
 
+Coder::PooledSession::~PooledSession() {
+	SessionPool<Session>::give(_type, std::move(_session));
+}
+
 Coder::Quality Coder::quality() const {
 	return _quality;
 }
@@ -39,6 +128,28 @@ void Coder::setQuality(Quality quality) {
 	_quality = quality;
 }
 
+Statistics * Coder::statistics() const {
+	return _statistics;
+}
+
+void Coder::setStatistics(Statistics *statistics) {
+	_statistics = statistics;
+}
+
+void Coder::addAnalyzer(Analyzer *analyzer) {
+	_analyzers.push_back(analyzer);
+}
+
+void Coder::removeAnalyzer(Analyzer *analyzer) {
+	_analyzers.erase(std::remove(_analyzers.begin(), _analyzers.end(), analyzer), _analyzers.end());
+}
+
+void Coder::analyze(const Buffer &buffer, unsigned int offset, unsigned int count) const {
+	for (Analyzer *analyzer : _analyzers) {
+		analyzer->process(buffer, offset, count);
+	}
+}
+
 } /* namespace audio */
 } /* namespace nealrame */
 } /* namespace com */
@@ -8,17 +8,40 @@
 #ifndef AUDIOCODER_H_
 #define AUDIOCODER_H_
 
-#include <fstream>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "../AudioStatistics.h"
+#include "../io/AudioSink.h"
 
 namespace com {
 namespace nealrame {
 namespace audio {
+class Analyzer;
 class Buffer;
+class Job;
 /**
  * ## Class coder
+ * A coder may be used by several threads at once: encoding changes
+ * nothing in it, and each thread encodes with its own session. It must not
+ * be configured meanwhile, and its statistics and analyzers are updated
+ * by all of them: give each thread its own coder to collect them.
  */
 class Coder {
+public:
+	/**
+	 * * `static Coder * getCoder(const std::string filename)`
+	 *     Build the coder matching the extension of the given filename
+	 *     (`.flac`, `.mp3`, `.ogg` or `.wav`).
+	 */
+	static Coder * getCoder(const std::string filename);
+
 public:
 	/**
 	 * ### Encoding quality
@@ -78,13 +101,112 @@ public:
 	virtual void encode(const Buffer &, const std::string &) const;
 
 	/**
-	 * * `void encode(const Buffer &, const std::string &) const`
+	 * * `void encode(const Buffer &, std::ostream &) const`
 	 *     Encode the given buffer to the given output stream (see [Buffer.md](doc/Buffer.md)for more details about `Buffer`).
 	 */
-	virtual void encode(const Buffer &, std::ofstream &) const = 0;
+	virtual void encode(const Buffer &, std::ostream &) const;
+
+	/**
+	 * * `void encode(const Buffer &, Sink &) const`
+	 *     Encode the given buffer to the given sink (see [Sink](../io/AudioSink.h)).
+	 *     The sink is flushed at the end of the encode.
+	 */
+	virtual void encode(const Buffer &, Sink &) const = 0;
+
+	/**
+	 * ### Class Coder::Session
+	 * The codec state and scratch buffers of a coder type, kept from one
+	 * stream to the next so a batch of short files does not pay the setup
+	 * of each one. A session is used by one encode at a time, with any coder
+	 * of the type which built it, and is reinitialised at the start of each
+	 * encode: a failed encode does not spoil it.
+	 *
+	 * `encode(const Buffer &, Sink &)` takes its session from a pool of the
+	 * calling thread (see [SessionPool](AudioSessionPool.h)).
+	 */
+	class Session {
+	public:
+		virtual ~Session() {}
+	};
+
+	/**
+	 * * `Session * session() const`
+	 *     Build a session for the coders of this type. The default one holds
+	 *     nothing, for the formats with no setup to keep.
+	 */
+	virtual Session * session() const;
+	/**
+	 * * `void encode(const Buffer &, Sink &, Session &) const`
+	 *     Encode the given buffer to the given sink with the given session.
+	 *     Raise `Error::Status::FormatBadValue` if the session was not built
+	 *     by a coder of this type.
+	 */
+	virtual void encode(const Buffer &, Sink &, Session &) const;
+
+	/**
+	 * * `std::future<void> encodeAsync(std::shared_ptr<const Buffer>, const std::string &, std::shared_ptr<Job>) const`
+	 *     Encode the given buffer to the given filename on the shared
+	 *     executor of the library (see [Executor](../AudioExecutor.h)).
+	 *     Errors are raised by the future. The coder must outlive the
+	 *     encode and must not be configured meanwhile. Give a
+	 *     [Job](../AudioJob.h) to follow the progress of the encode or to
+	 *     cancel it: a cancelled encode fails with
+	 *     `Error::Status::Cancelled` and leaves a truncated file.
+	 */
+	std::future<void> encodeAsync(std::shared_ptr<const Buffer>, const std::string &, std::shared_ptr<Job> = std::shared_ptr<Job>()) const;
+	/**
+	 * * `void encodeAsync(std::shared_ptr<const Buffer>, const std::string &, EncodeCallback, std::shared_ptr<Job>) const`
+	 *     Same as above, then call the callback from the executor with the
+	 *     error raised, null on success. The callback should not throw: an
+	 *     exception it raises is dropped.
+	 */
+	typedef std::function<void(std::exception_ptr)> EncodeCallback;
+	void encodeAsync(std::shared_ptr<const Buffer>, const std::string &, EncodeCallback, std::shared_ptr<Job> = std::shared_ptr<Job>()) const;
+
+	/**
+	 * * `void addAnalyzer(Analyzer *)`
+	 *     Feed the given analyzer with the frames as they are encoded. The
+	 *     analyzer is not owned.
+	 */
+	void addAnalyzer(Analyzer *);
+	/**
+	 * * `void removeAnalyzer(Analyzer *)`
+	 */
+	void removeAnalyzer(Analyzer *);
+	/**
+	 * * `Statistics * statistics() const`
+	 * * `void setStatistics(Statistics *)`
+	 *     Add the counters of the following encode operations to the given
+	 *     statistics. The statistics are not owned, `nullptr` (the default)
+	 *     disables the collection.
+	 */
+	Statistics * statistics() const;
+	void setStatistics(Statistics *);
+
+protected:
+	/**
+	 * ### Class Coder::PooledSession
+	 * A session of this coder type taken from the pool of the calling
+	 * thread, built if the pool has none, and given back at the end of the
+	 * scope.
+	 */
+	class PooledSession {
+	public:
+		PooledSession(const Coder &);
+		~PooledSession();
+		Session & operator*() const { return *_session; }
+	private:
+		const std::type_info &_type;
+		std::unique_ptr<Session> _session;
+	};
+
+protected:
+	void analyze(const Buffer &, unsigned int offset, unsigned int count) const;
 
 private:
 	Quality _quality;
+	std::vector<Analyzer *> _analyzers;
+	Statistics *_statistics;
 };
 
 } /* namespace audio */
@@ -0,0 +1,196 @@
+/*
+ * AudioDecodeCache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <functional>
+#include <typeinfo>
+
+#include <sys/stat.h>
+
+#include "../AudioBuffer.h"
+#include "../AudioChannelMixer.h"
+#include "../AudioTrace.h"
+#include "AudioDecodeCache.h"
+#include "AudioDecoder.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int DecodeCache::DefaultShardCount;
+
+namespace {
+
+size_t buffer_size(const Buffer &buffer) {
+	return buffer.format().sizeForFrameCount(buffer.frameCount());
+}
+
+// The mixer by value: decoders built per request with equal mixers share
+// their entries.
+std::vector<float> mixer_key(const std::shared_ptr<const ChannelMixer> &mixer) {
+	std::vector<float> key;
+	if (mixer) {
+		key.push_back(mixer->inputChannelCount());
+		key.push_back(mixer->outputChannelCount());
+		for (unsigned int o = 0; o < mixer->outputChannelCount(); ++o) {
+			for (unsigned int i = 0; i < mixer->inputChannelCount(); ++i) {
+				key.push_back(mixer->gain(o, i));
+			}
+		}
+	}
+	return key;
+}
+
+}
+
+bool DecodeCache::Key::operator==(const Key &other) const {
+	return size == other.size
+		&& mtime == other.mtime
+		&& decoder == other.decoder
+		&& mixer == other.mixer
+		&& dither == other.dither
+		&& path == other.path;
+}
+
+size_t DecodeCache::KeyHash::operator()(const Key &key) const {
+	size_t hash = std::hash<std::string>()(key.path);
+	hash ^= std::hash<uint64_t>()(key.size ^ (uint64_t)key.mtime) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= key.decoder.hash_code() + (size_t)key.dither;
+	for (float gain : key.mixer) {
+		hash ^= std::hash<float>()(gain) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+DecodeCache::DecodeCache(size_t budget, unsigned int shardCount) :
+	_budget(budget) {
+	shardCount = std::max(shardCount, 1u);
+	_shardBudget = budget/shardCount;
+	for (unsigned int i = 0; i < shardCount; ++i) {
+		std::unique_ptr<Shard> shard(new Shard);
+		shard->bytes = 0;
+		shard->hits = shard->misses = shard->coalesced = shard->evictions = 0;
+		_shards.push_back(std::move(shard));
+	}
+}
+
+DecodeCache::~DecodeCache() {
+}
+
+std::shared_ptr<const Buffer> DecodeCache::decode(const std::string &path) {
+	std::unique_ptr<Decoder> decoder(Decoder::getDecoder(path));
+	return decode(path, *decoder);
+}
+
+std::shared_ptr<const Buffer> DecodeCache::decode(const std::string &path, const Decoder &decoder) {
+	struct stat st;
+	if (stat(path.data(), &st) != 0 || ! S_ISREG(st.st_mode)) {
+		return std::shared_ptr<const Buffer>(decoder.decode(path));
+	}
+
+	Key key = {
+		path,
+		(uint64_t)st.st_size,
+		(int64_t)st.st_mtim.tv_sec*1000000000 + st.st_mtim.tv_nsec,
+		std::type_index(typeid(decoder)),
+		mixer_key(decoder.channelMixer()),
+		decoder.dither(),
+	};
+	Shard &shard = *_shards[KeyHash()(key) % _shards.size()];
+	std::promise<std::shared_ptr<const Buffer>> promise;
+	{
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		auto entry = shard.index.find(key);
+		if (entry != shard.index.end()) {
+			shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+			shard.hits++;
+			std::shared_ptr<const Buffer> buffer = entry->second->second;
+			lock.unlock();
+			decoder.analyze(*buffer, 0, buffer->frameCount());
+			return buffer;
+		}
+		auto pending = shard.pending.find(key);
+		if (pending != shard.pending.end()) {
+			Pending result = pending->second;
+			shard.coalesced++;
+			lock.unlock();
+			std::shared_ptr<const Buffer> buffer;
+			{
+				Trace::Span span("cache.wait", "cache");
+				buffer = result.get();
+			}
+			decoder.analyze(*buffer, 0, buffer->frameCount());
+			return buffer;
+		}
+		shard.pending.insert(std::make_pair(key, promise.get_future().share()));
+		shard.misses++;
+	}
+
+	std::shared_ptr<const Buffer> buffer;
+	try {
+		Trace::Span span("cache.decode", "cache");
+		buffer.reset(decoder.decode(path));
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.pending.erase(key);
+		}
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.pending.erase(key);
+		insert(shard, key, buffer);
+	}
+	promise.set_value(buffer);
+	return buffer;
+}
+
+// Called with the shard locked.
+void DecodeCache::insert(Shard &shard, const Key &key, const std::shared_ptr<const Buffer> &buffer) {
+	size_t size = buffer_size(*buffer);
+	if (size > _shardBudget) {
+		return;
+	}
+	while (shard.bytes + size > _shardBudget) {
+		shard.bytes -= buffer_size(*shard.entries.back().second);
+		shard.index.erase(shard.entries.back().first);
+		shard.entries.pop_back();
+		shard.evictions++;
+	}
+	shard.entries.push_front(std::make_pair(key, buffer));
+	shard.index[key] = shard.entries.begin();
+	shard.bytes += size;
+}
+
+void DecodeCache::clear() {
+	for (auto &shard : _shards) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		shard->index.clear();
+		shard->entries.clear();
+		shard->bytes = 0;
+	}
+}
+
+DecodeCache::Counters DecodeCache::counters() const {
+	Counters counters = { 0, 0, 0, 0, 0, 0 };
+	for (auto &shard : _shards) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		counters.hits += shard->hits;
+		counters.misses += shard->misses;
+		counters.coalesced += shard->coalesced;
+		counters.evictions += shard->evictions;
+		counters.bytes += shard->bytes;
+		counters.entries += shard->entries.size();
+	}
+	return counters;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
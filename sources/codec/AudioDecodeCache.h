@@ -0,0 +1,140 @@
+/*
+ * AudioDecodeCache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIODECODECACHE_H_
+#define AUDIODECODECACHE_H_
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include "../AudioRequantizer.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+class ChannelMixer;
+class Decoder;
+/**
+ * ## Class DecodeCache
+ * Keep decoded files in memory, shared read-only, under a byte budget.
+ *
+ * Entries are keyed by path, size and modification time of the file, and
+ * by the output the decoder is configured for (its type, the channel
+ * counts and gains of its mixer, and its dither): a file rewritten in
+ * place or decoded to another channel layout is a different entry, while
+ * decoders built per request with equal mixers share theirs.
+ *
+ * A request served by the cache feeds the analyzers of its decoder with
+ * the whole buffer, as a decode does, but does not update its statistics:
+ * no decode operation runs.
+ *
+ * The keys are spread on `shardCount` shards, each one with its own lock,
+ * LRU list and `budget/shardCount` bytes. Concurrent requests for a file
+ * not in the cache wait for a single decode. A buffer evicted from the
+ * cache stays valid as long as someone holds it.
+ *
+ *     DecodeCache cache(256 << 20);
+ *     std::shared_ptr<const Buffer> buffer = cache.decode("song.mp3");
+ */
+class DecodeCache {
+public:
+	static const unsigned int DefaultShardCount = 16;
+
+	/**
+	 * ### Counters
+	 * * `hits`:      requests served from the cache,
+	 * * `misses`:    requests which decoded the file,
+	 * * `coalesced`: requests which waited for the decode of another one,
+	 * * `evictions`: entries dropped to fit the budget,
+	 * * `bytes`, `entries`: current content of the cache.
+	 */
+	struct Counters {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t coalesced;
+		uint64_t evictions;
+		uint64_t bytes;
+		uint64_t entries;
+	};
+
+public:
+	/**
+	 * * `DecodeCache(size_t budget, unsigned int shardCount)`
+	 *     Create a cache holding up to `budget` bytes of samples. A buffer
+	 *     bigger than a shard budget is returned but not kept.
+	 */
+	DecodeCache(size_t budget, unsigned int shardCount = DefaultShardCount);
+	virtual ~DecodeCache();
+
+public:
+	/**
+	 * * `std::shared_ptr<const Buffer> decode(const std::string &path)`
+	 *     Get the given file, decoded with the decoder matching its
+	 *     extension.
+	 */
+	std::shared_ptr<const Buffer> decode(const std::string &path);
+	/**
+	 * * `std::shared_ptr<const Buffer> decode(const std::string &path, const Decoder &)`
+	 *     Get the given file, decoded with the given decoder. Files which are
+	 *     not regular (pipes, devices) are decoded and never kept. Decode
+	 *     errors are raised to every waiting request and not cached.
+	 */
+	std::shared_ptr<const Buffer> decode(const std::string &path, const Decoder &);
+	/**
+	 * * `void clear()`
+	 *     Drop every entry. Decodes in progress are not affected.
+	 */
+	void clear();
+	size_t budget() const { return _budget; }
+	Counters counters() const;
+
+private:
+	struct Key {
+		std::string path;
+		uint64_t size;
+		int64_t mtime;                      // in nanoseconds
+		std::type_index decoder;
+		std::vector<float> mixer;           // channel counts then gains, empty if none
+		Requantizer::Dither dither;
+
+		bool operator==(const Key &) const;
+	};
+	struct KeyHash {
+		size_t operator()(const Key &) const;
+	};
+	typedef std::shared_future<std::shared_ptr<const Buffer>> Pending;
+	typedef std::list<std::pair<Key, std::shared_ptr<const Buffer>>> Entries;
+
+	struct Shard {
+		std::mutex mutex;
+		Entries entries;                    // most recently used first
+		std::unordered_map<Key, Entries::iterator, KeyHash> index;
+		std::unordered_map<Key, Pending, KeyHash> pending;
+		size_t bytes;
+		uint64_t hits, misses, coalesced, evictions;
+	};
+
+	void insert(Shard &, const Key &, const std::shared_ptr<const Buffer> &);
+
+private:
+	size_t _budget;
+	size_t _shardBudget;
+	std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIODECODECACHE_H_ */
@@ -5,21 +5,38 @@
  *      Author: jux
  */
 
+#include <algorithm>
 #include <iostream>
 
+#include <sys/stat.h>
+
 #include "boost/algorithm/string.hpp"
 #include "boost/filesystem.hpp"
 
+#include "../AudioBuffer.h"
+#include "../AudioChannelMixer.h"
 #include "../AudioError.h"
+#include "../AudioExecutor.h"
+#include "../AudioJob.h"
+#include "../AudioTrace.h"
+#include "../analysis/AudioAnalyzer.h"
 #include "AudioDecoder.h"
+#include "AudioFLACDecoder.h"
 #include "AudioMP3Decoder.h"
 #include "AudioPCMDecoder.h"
 #include "AudioOggVorbisDecoder.h"
+#include "AudioSessionPool.h"
+#include "AudioSidecarCache.h"
 
 namespace com {
 namespace nealrame {
 namespace audio {
 
+Decoder::Decoder() :
+	_dither(Requantizer::Dither::None),
+	_statistics(nullptr) {
+}
+
 Decoder * Decoder::getDecoder(const std::string filename) {
 	std::string ext = boost::to_lower_copy(boost::filesystem::path(filename).extension().string());
 
@@ -31,6 +48,10 @@ Decoder * Decoder::getDecoder(const std::string filename) {
 		return new OggVorbisDecoder;
 	}
 
+	if (ext == ".flac") {
+		return new FLACDecoder;
+	}
+
 	if (ext == ".wav") {
 		return new PCMDecoder;
 	}
@@ -39,16 +60,225 @@ Decoder * Decoder::getDecoder(const std::string filename) {
 }
 
 Buffer * Decoder::decode(const std::string &filename) const {
-	std::ifstream ifs(filename.data(), std::ifstream::binary);
-	Buffer *buffer = nullptr;
-	try {
-		buffer = decode(ifs);
-		ifs.close();
-	} catch (Error &e) {
-		ifs.close();
-		throw e;
-	}
-	return buffer;
+	std::unique_ptr<Buffer> buffer;
+	struct stat st;
+
+	if (_sidecarCache && (buffer.reset(_sidecarCache->load(filename, *this)), buffer)) {
+		analyze(*buffer, 0, buffer->frameCount());
+		return buffer.release();
+	}
+	if (stat(filename.data(), &st) == 0 && S_ISREG(st.st_mode)) {
+		MappedFileSource source(filename);
+		buffer.reset(decode(source));
+	} else {
+		FileDescriptorSource source(filename);
+		buffer.reset(decode(source));
+	}
+	if (_sidecarCache) {
+		// The cache is an optimization, failing to store does not fail the
+		// decode.
+		try {
+			_sidecarCache->store(filename, *this, *buffer);
+		} catch (Error &) {
+		}
+	}
+	return buffer.release();
+}
+
+Buffer * Decoder::decode(std::istream &input) const {
+	StreamSource source(input);
+	return decode(source);
+}
+
+std::future<std::shared_ptr<Buffer>> Decoder::decodeAsync(const std::string &filename, std::shared_ptr<Job> job) const {
+	typedef std::promise<std::shared_ptr<Buffer>> Promise;
+	std::shared_ptr<Promise> promise(new Promise);
+	decodeAsync(filename, [promise](std::shared_ptr<Buffer> buffer, std::exception_ptr error) {
+		if (error) {
+			promise->set_exception(error);
+		} else {
+			promise->set_value(buffer);
+		}
+	}, job);
+	return promise->get_future();
+}
+
+void Decoder::decodeAsync(const std::string &filename, DecodeCallback callback, std::shared_ptr<Job> job) const {
+	Executor::shared().submit([this, filename, callback, job]() {
+		std::shared_ptr<Buffer> buffer;
+		std::exception_ptr error;
+		try {
+			Trace::Span span("decoder.async", "job");
+			Job::Scope scope(job.get());
+			Job::checkpoint(0.);
+			buffer.reset(decode(filename));
+			if (job) job->setProgress(1);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		// Executor tasks must not throw, there is nobody to report to.
+		try {
+			callback(buffer, error);
+		} catch (...) {
+		}
+	});
+}
+
+Decoder::Index * Decoder::index(const char *, size_t) const {
+	return nullptr;
+}
+
+Buffer * Decoder::decode(const Index &, unsigned int, unsigned int) const {
+	Error::raise(Error::Status::NotImplemented, "No random access for this format.");
+	return nullptr;
+}
+
+Decoder::Session * Decoder::session() const {
+	return new Session;
+}
+
+Buffer * Decoder::decode(Source &input, Session &) const {
+	return decode(input);
+}
+
+Decoder::PooledSession::PooledSession(const Decoder &decoder) :
+	_type(typeid(decoder)),
+	_session(SessionPool<Session>::take(_type)) {
+	if (! _session) {
+		_session.reset(decoder.session());
+	}
+}
+
+Decoder::PooledSession::~PooledSession() {
+	SessionPool<Session>::give(_type, std::move(_session));
+}
+
+std::shared_ptr<const ChannelMixer> Decoder::channelMixer() const {
+	return _channelMixer;
+}
+
+void Decoder::setChannelMixer(std::shared_ptr<const ChannelMixer> mixer) {
+	_channelMixer = mixer;
+}
+
+Requantizer::Dither Decoder::dither() const {
+	return _dither;
+}
+
+void Decoder::setDither(Requantizer::Dither dither) {
+	_dither = dither;
+}
+
+void Decoder::addAnalyzer(Analyzer *analyzer) {
+	_analyzers.push_back(analyzer);
+}
+
+void Decoder::removeAnalyzer(Analyzer *analyzer) {
+	_analyzers.erase(std::remove(_analyzers.begin(), _analyzers.end(), analyzer), _analyzers.end());
+}
+
+Statistics * Decoder::statistics() const {
+	return _statistics;
+}
+
+void Decoder::setStatistics(Statistics *statistics) {
+	_statistics = statistics;
+}
+
+std::shared_ptr<SidecarCache> Decoder::sidecarCache() const {
+	return _sidecarCache;
+}
+
+void Decoder::setSidecarCache(std::shared_ptr<SidecarCache> cache) {
+	_sidecarCache = cache;
+}
+
+void Decoder::analyze(const Buffer &buffer, unsigned int offset, unsigned int count) const {
+	for (Analyzer *analyzer : _analyzers) {
+		analyzer->process(buffer, offset, count);
+	}
+}
+
+Format Decoder::outputFormat(const Format &streamFormat) const {
+	Format format(streamFormat);
+	if (_channelMixer) {
+		if (_channelMixer->inputChannelCount() != streamFormat.channelCount()) {
+			Error::raise(Error::Status::FormatBadValue, "Channel mixer does not match the stream channel count.");
+		}
+		format.setChannelCount(_channelMixer->outputChannelCount());
+	}
+	return format;
+}
+
+// Buffer::write reallocates the buffer storage each time it grows.
+void Decoder::accountWrite(const Buffer &buffer, unsigned int previousFrameCount, unsigned int count) const {
+	if (_statistics) {
+		_statistics->framesProcessed += count;
+		if (buffer.frameCount() > previousFrameCount) {
+			size_t size = buffer.format().sizeForFrameCount(buffer.frameCount());
+			if (previousFrameCount == 0) {
+				_statistics->allocation(size);
+			} else {
+				_statistics->growth(size);
+			}
+		}
+	}
+}
+
+void Decoder::write(Buffer &buffer, unsigned int offset, unsigned int count, const int16_t **src, Requantizer &requantizer) const {
+	unsigned int frame_count = buffer.frameCount();
+	{
+		Statistics::Scope scope(_statistics, Statistics::Phase::Conversion);
+		if (_channelMixer) {
+			buffer.write(offset, count, src, *_channelMixer, requantizer);
+		} else {
+			buffer.write(offset, count, src);
+		}
+	}
+	accountWrite(buffer, frame_count, count);
+	analyze(buffer, offset, count);
+}
+
+void Decoder::write(Buffer &buffer, unsigned int offset, unsigned int count, const int16_t *src, Requantizer &requantizer) const {
+	unsigned int frame_count = buffer.frameCount();
+	{
+		Statistics::Scope scope(_statistics, Statistics::Phase::Conversion);
+		if (_channelMixer) {
+			buffer.write(offset, count, src, *_channelMixer, requantizer);
+		} else {
+			buffer.write(offset, count, src);
+		}
+	}
+	accountWrite(buffer, frame_count, count);
+	analyze(buffer, offset, count);
+}
+
+void Decoder::write(Buffer &buffer, unsigned int offset, unsigned int count, const int8_t *src, Requantizer &requantizer) const {
+	unsigned int frame_count = buffer.frameCount();
+	{
+		Statistics::Scope scope(_statistics, Statistics::Phase::Conversion);
+		if (_channelMixer) {
+			buffer.write(offset, count, src, *_channelMixer, requantizer);
+		} else {
+			buffer.write(offset, count, src);
+		}
+	}
+	accountWrite(buffer, frame_count, count);
+	analyze(buffer, offset, count);
+}
+
+void Decoder::write(Buffer &buffer, unsigned int offset, unsigned int count, const float **src, Requantizer &requantizer) const {
+	unsigned int frame_count = buffer.frameCount();
+	{
+		Statistics::Scope scope(_statistics, Statistics::Phase::Conversion);
+		if (_channelMixer) {
+			buffer.write(offset, count, src, *_channelMixer, requantizer);
+		} else {
+			buffer.write(offset, count, src, requantizer);
+		}
+	}
+	accountWrite(buffer, frame_count, count);
+	analyze(buffer, offset, count);
 }
 
 } /* namespace audio */
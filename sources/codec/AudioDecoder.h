@@ -8,23 +8,255 @@
 #ifndef AUDIODECODER_H_
 #define AUDIODECODER_H_
 
-#include <fstream>
+#include <exception>
+#include <functional>
+#include <future>
+#include <istream>
 #include <memory>
 #include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "../AudioFormat.h"
+#include "../AudioRequantizer.h"
+#include "../AudioStatistics.h"
+#include "../io/AudioSource.h"
 
 namespace com {
 namespace nealrame {
 namespace audio {
+class Analyzer;
 class Buffer;
+class ChannelMixer;
+class DecodeCache;
+class Job;
+class SidecarCache;
 class Decoder {
 public:
 	static Decoder * getDecoder(const std::string file_extension);
 	
 public:
+	Decoder();
 	virtual ~Decoder() {}
 public:
+	/**
+	 * ### Threads
+	 * A decoder may be used by several threads at once: decoding changes
+	 * nothing in it, and each thread decodes with its own session. It must
+	 * not be configured meanwhile, and its statistics and analyzers are
+	 * updated by all of them: give each thread its own decoder to collect
+	 * them.
+	 */
+
+	/**
+	 * * `Buffer * decode(const std::string &filename) const`
+	 *     Decode the given file. Regular files are mapped in memory and
+	 *     decoded without copy, other ones (pipes, devices) are read by
+	 *     large blocks. With a sidecar cache, the file is mapped from its
+	 *     sidecar if there is one, stored in it otherwise.
+	 */
 	virtual Buffer * decode(const std::string &) const;
-	virtual Buffer * decode(std::ifstream &) const = 0;
+	/**
+	 * * `Buffer * decode(std::istream &) const`
+	 *     Decode the given input stream.
+	 */
+	virtual Buffer * decode(std::istream &) const;
+	/**
+	 * * `Buffer * decode(Source &) const`
+	 *     Decode the given source (see [Source](../io/AudioSource.h)), from
+	 *     its current position.
+	 */
+	virtual Buffer * decode(Source &) const = 0;
+
+public:
+	/**
+	 * ### Asynchronous decode
+	 * The decode runs on the shared executor of the library (see
+	 * [Executor](../AudioExecutor.h)), so many decodes are served by a few
+	 * threads. The decoder must outlive it and must not be configured
+	 * meanwhile; its statistics and analyzers are updated from the
+	 * executor.
+	 * Give a [Job](../AudioJob.h) to follow the progress of the decode or
+	 * to cancel it: a cancelled decode fails with
+	 * `Error::Status::Cancelled`.
+	 *
+	 * * `std::future<std::shared_ptr<Buffer>> decodeAsync(const std::string &filename, std::shared_ptr<Job>) const`
+	 *     Decode the given file, as `decode(const std::string &)` does.
+	 *     Errors are raised by the future.
+	 */
+	std::future<std::shared_ptr<Buffer>> decodeAsync(const std::string &, std::shared_ptr<Job> = std::shared_ptr<Job>()) const;
+	/**
+	 * * `void decodeAsync(const std::string &filename, DecodeCallback, std::shared_ptr<Job>) const`
+	 *     Decode the given file, then call the callback from the executor
+	 *     with the decoded buffer, or with the error raised. The callback
+	 *     should not throw: an exception it raises is dropped.
+	 */
+	typedef std::function<void(std::shared_ptr<Buffer>, std::exception_ptr)> DecodeCallback;
+	void decodeAsync(const std::string &, DecodeCallback, std::shared_ptr<Job> = std::shared_ptr<Job>()) const;
+
+public:
+	/**
+	 * ### Class Decoder::Index
+	 * The seek index of a stream held in memory, built by `index()`. It
+	 * knows the output format and frame count of the stream and where its
+	 * frames are. An index is used by one decode at a time.
+	 */
+	class Index {
+	public:
+		Index(const char *data, size_t size, Format format, unsigned int frameCount) :
+			_data(data), _size(size), _format(format), _frameCount(frameCount) {}
+		virtual ~Index() {}
+
+	public:
+		const char * data() const { return _data; }
+		size_t size() const { return _size; }
+		Format format() const { return _format; }
+		unsigned int frameCount() const { return _frameCount; }
+
+	private:
+		const char *_data;
+		size_t _size;
+		Format _format;
+		unsigned int _frameCount;
+	};
+
+	/**
+	 * * `Index * index(const char *data, size_t size) const`
+	 *     Index the given stream for random access. The stream must outlive
+	 *     the index. Return `nullptr` if the format has no random access
+	 *     (the default).
+	 */
+	virtual Index * index(const char *data, size_t size) const;
+	/**
+	 * * `Buffer * decode(const Index &, unsigned int offset, unsigned int count) const`
+	 *     Decode `count` frames of an indexed stream from frame `offset`,
+	 *     without decoding the frames before. The result does not depend on
+	 *     what was decoded before, dither included. Analyzers are fed the
+	 *     decoded range.
+	 */
+	virtual Buffer * decode(const Index &, unsigned int offset, unsigned int count) const;
+
+public:
+	/**
+	 * ### Class Decoder::Session
+	 * The codec state and scratch buffers of a decoder type, kept from one
+	 * stream to the next so a batch of short files does not pay the setup
+	 * of each one. A session is used by one decode at a time, with any
+	 * decoder of the type which built it, and is reinitialised at the start
+	 * of each decode: a failed decode does not spoil it.
+	 *
+	 * `decode(Source &)` takes its session from a pool of the calling
+	 * thread (see [SessionPool](AudioSessionPool.h)), so the threads of a
+	 * batch keep theirs without asking.
+	 */
+	class Session {
+	public:
+		virtual ~Session() {}
+	};
+
+	/**
+	 * * `Session * session() const`
+	 *     Build a session for the decoders of this type. The default one
+	 *     holds nothing, for the formats with no setup to keep.
+	 */
+	virtual Session * session() const;
+	/**
+	 * * `Buffer * decode(Source &, Session &) const`
+	 *     Decode the given source with the given session. Raise
+	 *     `Error::Status::FormatBadValue` if the session was not built by a
+	 *     decoder of this type.
+	 */
+	virtual Buffer * decode(Source &, Session &) const;
+
+public:
+	/**
+	 * * `std::shared_ptr<const ChannelMixer> channelMixer() const`
+	 *     Get the mixer applied to decoded frames, `nullptr` if none.
+	 */
+	std::shared_ptr<const ChannelMixer> channelMixer() const;
+	/**
+	 * * `void setChannelMixer(std::shared_ptr<const ChannelMixer>)`
+	 *     Mix the decoded frames while they are written in the output
+	 *     `Buffer`. The output buffer has the mixer output channel count, the
+	 *     dropped channels are never stored.
+	 */
+	void setChannelMixer(std::shared_ptr<const ChannelMixer>);
+	/**
+	 * * `Requantizer::Dither dither() const`
+	 *     Get the dither used when float or mixed frames are stored as
+	 *     integers (default is `Requantizer::Dither::None`, decodes are
+	 *     then reproducible; set `TPDF` to decorrelate the rounding error).
+	 */
+	Requantizer::Dither dither() const;
+	/**
+	 * * `void setDither(Requantizer::Dither)`
+	 */
+	void setDither(Requantizer::Dither);
+	/**
+	 * * `void addAnalyzer(Analyzer *)`
+	 *     Feed the given analyzer with the decoded frames as they are
+	 *     written in the output `Buffer`. The analyzer is not owned.
+	 */
+	void addAnalyzer(Analyzer *);
+	/**
+	 * * `void removeAnalyzer(Analyzer *)`
+	 */
+	void removeAnalyzer(Analyzer *);
+	/**
+	 * * `Statistics * statistics() const`
+	 * * `void setStatistics(Statistics *)`
+	 *     Add the counters of the following decode operations to the given
+	 *     statistics (see [Statistics](../AudioStatistics.h)). The
+	 *     statistics are not owned, `nullptr` (the default) disables the
+	 *     collection.
+	 */
+	Statistics * statistics() const;
+	void setStatistics(Statistics *);
+	/**
+	 * * `std::shared_ptr<SidecarCache> sidecarCache() const`
+	 * * `void setSidecarCache(std::shared_ptr<SidecarCache>)`
+	 *     Keep the files decoded by name in the given cache (see
+	 *     [SidecarCache](AudioSidecarCache.h)), `nullptr` (the default)
+	 *     disables it. Analyzers are fed the mapped frames on a hit.
+	 */
+	std::shared_ptr<SidecarCache> sidecarCache() const;
+	void setSidecarCache(std::shared_ptr<SidecarCache>);
+
+protected:
+	/**
+	 * ### Class Decoder::PooledSession
+	 * A session of this decoder type taken from the pool of the calling
+	 * thread, built if the pool has none, and given back at the end of the
+	 * scope.
+	 */
+	class PooledSession {
+	public:
+		PooledSession(const Decoder &);
+		~PooledSession();
+		Session & operator*() const { return *_session; }
+	private:
+		const std::type_info &_type;
+		std::unique_ptr<Session> _session;
+	};
+
+protected:
+	void analyze(const Buffer &, unsigned int offset, unsigned int count) const;
+	Format outputFormat(const Format &streamFormat) const;
+	void write(Buffer &, unsigned int offset, unsigned int count, const int16_t **, Requantizer &) const;
+	void write(Buffer &, unsigned int offset, unsigned int count, const int16_t *, Requantizer &) const;
+	void write(Buffer &, unsigned int offset, unsigned int count, const int8_t *, Requantizer &) const;
+	void write(Buffer &, unsigned int offset, unsigned int count, const float **, Requantizer &) const;
+
+private:
+	friend class DecodeCache;               // feeds the analyzers on a hit
+	void accountWrite(const Buffer &, unsigned int previousFrameCount, unsigned int count) const;
+
+private:
+	std::shared_ptr<const ChannelMixer> _channelMixer;
+	Requantizer::Dither _dither;
+	std::vector<Analyzer *> _analyzers;
+	Statistics *_statistics;
+	std::shared_ptr<SidecarCache> _sidecarCache;
 };
 
 } /* namespace audio */
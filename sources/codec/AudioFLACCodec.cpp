@@ -0,0 +1,1422 @@
+/*
+ * AudioFLACCodec.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "../AudioBuffer.h"
+#include "../AudioError.h"
+#include "../AudioExecutor.h"
+#include "../AudioFormat.h"
+#include "../AudioJob.h"
+#include "../AudioRequantizer.h"
+#include "../AudioTrace.h"
+#include "../io/AudioSource.h"
+#include "AudioFLACCoder.h"
+#include "AudioFLACDecoder.h"
+
+#define FLAC_DECODE_INPUT_BUFFER_SIZE 65536
+#define FLAC_MAX_LPC_ORDER 32
+#define FLAC_MAX_BIT_DEPTH 24
+// Seeks closer than this many blocks decode their way to the target.
+#define FLAC_SEEK_BLOCK_COUNT 8
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+namespace {
+
+enum BlockType {
+	StreamInfo = 0,
+};
+
+enum ChannelAssignment {
+	Independent = 0,
+	LeftSide = 8,
+	SideRight = 9,
+	MidSide = 10,
+};
+
+enum SubframeType {
+	Constant = 0,
+	Verbatim = 1,
+	Fixed = 8,
+	LPC = 32,
+};
+
+struct CRCTables {
+	uint8_t crc8[256];
+	uint16_t crc16[256];
+
+	CRCTables() {
+		for (unsigned int i = 0; i < 256; ++i) {
+			uint8_t c8 = i;
+			uint16_t c16 = i << 8;
+			for (unsigned int bit = 0; bit < 8; ++bit) {
+				c8 = (c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1;
+				c16 = (c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1;
+			}
+			crc8[i] = c8;
+			crc16[i] = c16;
+		}
+	}
+};
+
+const CRCTables & crc_tables() {
+	static const CRCTables tables;
+	return tables;
+}
+
+uint8_t crc8(const uint8_t *data, size_t size) {
+	const CRCTables &tables = crc_tables();
+	uint8_t crc = 0;
+	for (size_t i = 0; i < size; ++i) {
+		crc = tables.crc8[crc ^ data[i]];
+	}
+	return crc;
+}
+
+uint16_t crc16(const uint8_t *data, size_t size) {
+	const CRCTables &tables = crc_tables();
+	uint16_t crc = 0;
+	for (size_t i = 0; i < size; ++i) {
+		crc = (crc << 8) ^ tables.crc16[(crc >> 8) ^ data[i]];
+	}
+	return crc;
+}
+
+inline uint32_t zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+const unsigned int block_sizes[16] = {
+	0, 192, 576, 1152, 2304, 4608, 0, 0,
+	256, 512, 1024, 2048, 4096, 8192, 16384, 32768,
+};
+
+const unsigned int sample_rates[12] = {
+	0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000,
+};
+
+const unsigned int sample_sizes[8] = {
+	0, 8, 12, 0, 16, 20, 24, 0,
+};
+
+} /* namespace */
+
+//////////////////////////////////////////////////////////////////////////////
+// Decoder ///////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct FLACStreamInfo {
+	unsigned int minBlockSize;
+	unsigned int maxBlockSize;
+	unsigned int sampleRate;
+	unsigned int channelCount;
+	unsigned int bitDepth;
+	uint64_t frameCount;
+};
+
+// The input is copied in a window, so that the frames are parsed in place
+// whatever the source.
+struct RAII_FLACDecodeData {
+	Source &input;
+	Statistics *statistics;
+	std::vector<uint8_t> window;
+	size_t begin, end;
+	bool eof;
+	Buffer *buffer;
+
+	RAII_FLACDecodeData(Source &in, Statistics *stats) :
+		input(in),
+		statistics(stats),
+		begin(0),
+		end(0),
+		eof(false),
+		buffer(nullptr) {
+	}
+
+	~RAII_FLACDecodeData() {
+		if (buffer) delete buffer;
+	}
+
+	const uint8_t * data() const { return window.data() + begin; }
+	size_t available() const { return end - begin; }
+
+	// Make `size` bytes available, less only at the end of the input.
+	void fill(size_t size) {
+		if (available() >= size || eof) return;
+		if (begin > 0) {
+			memmove(window.data(), window.data() + begin, available());
+			end -= begin;
+			begin = 0;
+		}
+		size = std::max(size, (size_t)FLAC_DECODE_INPUT_BUFFER_SIZE);
+		if (window.size() < size) {
+			window.resize(size);
+			if (statistics) statistics->growth(window.size());
+		}
+		Statistics::Scope scope(statistics, Statistics::Phase::IO);
+		while (end < size && ! eof) {
+			size_t count = input.read((char *)window.data() + end, size - end);
+			if (statistics) statistics->bytesRead += count;
+			eof = count == 0;
+			end += count;
+		}
+	}
+
+	void consume(size_t size) {
+		begin += size;
+	}
+
+	void skip(uint64_t size) {
+		size_t count = std::min<uint64_t>(size, available());
+		consume(count);
+		if (count < size) {
+			Statistics::Scope scope(statistics, Statistics::Phase::IO);
+			uint64_t skipped = input.skip(size - count);
+			if (statistics) statistics->bytesRead += skipped;
+			if (skipped < size - count) {
+				Error::raise(Error::Status::IOError, "The file is truncated.");
+			}
+		}
+	}
+};
+
+// MSB first bit reader. Reads past the end of the data return zeros and
+// are reported by `overflowed()`.
+class FLACBitReader {
+public:
+	FLACBitReader(const uint8_t *data, size_t size) : _data(data), _size(size), _position(0) {}
+
+	inline uint32_t read(unsigned int count) {
+		if (count == 0) return 0;
+		uint64_t word = load() << (_position & 7);
+		_position += count;
+		return (uint32_t)(word >> (64 - count));
+	}
+
+	inline int32_t readSigned(unsigned int count) {
+		if (count == 0) return 0;
+		return (int32_t)(read(count) << (32 - count)) >> (32 - count);
+	}
+
+	inline uint32_t readUnary() {
+		uint32_t count = 0;
+		while (! overflowed()) {
+			unsigned int available = 64 - (_position & 7);
+			uint64_t word = load() << (_position & 7);
+			if (word != 0) {
+				unsigned int zeros = __builtin_clzll(word);
+				_position += zeros + 1;
+				return count + zeros;
+			}
+			_position += available;
+			count += available;
+		}
+		return count;
+	}
+
+	inline int32_t readRice(unsigned int k) {
+		uint32_t value = (readUnary() << k) | read(k);
+		return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+	}
+
+	void align() { _position = (_position + 7) & ~(uint64_t)7; }
+	size_t bytePosition() const { return _position >> 3; }
+	bool overflowed() const { return _position > (uint64_t)_size*8; }
+
+private:
+	inline uint64_t load() const {
+		size_t index = _position >> 3;
+		uint64_t word = 0;
+		if (index + sizeof(word) <= _size) {
+			memcpy(&word, _data + index, sizeof(word));
+		} else if (index < _size) {
+			memcpy(&word, _data + index, _size - index);
+		}
+		return __builtin_bswap64(word);
+	}
+
+private:
+	const uint8_t *_data;
+	size_t _size;
+	uint64_t _position;
+};
+
+void read_stream_info(const uint8_t *data, FLACStreamInfo &info) {
+	FLACBitReader bits(data, 34);
+	info.minBlockSize = bits.read(16);
+	info.maxBlockSize = bits.read(16);
+	bits.read(24);                              // minimum frame size
+	bits.read(24);                              // maximum frame size
+	info.sampleRate = bits.read(20);
+	info.channelCount = bits.read(3) + 1;
+	info.bitDepth = bits.read(5) + 1;
+	info.frameCount = (uint64_t)bits.read(4) << 32;
+	info.frameCount |= bits.read(32);
+
+	if (info.bitDepth > FLAC_MAX_BIT_DEPTH || info.bitDepth < 4) {
+		Error::raise(Error::Status::FormatBadValue, "Unsupported FLAC sample size.");
+	}
+}
+
+void skip_id3_section(RAII_FLACDecodeData &decode_data) {
+	decode_data.fill(10);
+	const uint8_t *data = decode_data.data();
+	if (decode_data.available() >= 10 && memcmp(data, "ID3", 3) == 0) {
+		uint64_t size = 10
+			+ ((data[6] & 0x7f) << 21) + ((data[7] & 0x7f) << 14)
+			+ ((data[8] & 0x7f) << 7) + (data[9] & 0x7f)
+			+ ((data[5] & 0x10) ? 10 : 0);
+		decode_data.skip(size);
+	}
+}
+
+void read_metadata(RAII_FLACDecodeData &decode_data, FLACStreamInfo &info) {
+	bool has_stream_info = false, last = false;
+
+	decode_data.fill(4);
+	if (decode_data.available() < 4 || memcmp(decode_data.data(), "fLaC", 4) != 0) {
+		Error::raise(Error::Status::FLACError, "Bad file format.");
+	}
+	decode_data.consume(4);
+
+	while (! last) {
+		decode_data.fill(4);
+		if (decode_data.available() < 4) {
+			Error::raise(Error::Status::IOError, "The file is truncated.");
+		}
+		const uint8_t *header = decode_data.data();
+		unsigned int type = header[0] & 0x7f;
+		uint32_t size = (header[1] << 16) | (header[2] << 8) | header[3];
+		last = (header[0] & 0x80) != 0;
+		decode_data.consume(4);
+
+		if (type == StreamInfo) {
+			decode_data.fill(size);
+			if (size < 34 || decode_data.available() < size) {
+				Error::raise(Error::Status::FLACError, "Bad stream info.");
+			}
+			read_stream_info(decode_data.data(), info);
+			has_stream_info = true;
+		}
+		decode_data.skip(size);
+	}
+
+	if (! has_stream_info) {
+		Error::raise(Error::Status::FLACError, "Missing stream info.");
+	}
+}
+
+void read_residual(FLACBitReader &bits, int32_t *dst, unsigned int block_size, unsigned int order) {
+	unsigned int method = bits.read(2);
+	if (method > 1) {
+		Error::raise(Error::Status::FLACError, "Reserved residual coding method.");
+	}
+	unsigned int parameter_bits = method == 0 ? 4 : 5;
+	unsigned int escape = (1u << parameter_bits) - 1;
+	unsigned int partition_order = bits.read(4);
+	unsigned int partition_size = block_size >> partition_order;
+
+	if ((partition_size << partition_order) != block_size || partition_size < order) {
+		Error::raise(Error::Status::FLACError, "Bad residual partition order.");
+	}
+
+	int32_t *residual = dst + order;
+	for (unsigned int partition = 0; partition < (1u << partition_order); ++partition) {
+		unsigned int count = partition_size - (partition == 0 ? order : 0);
+		unsigned int k = bits.read(parameter_bits);
+		if (k == escape) {
+			unsigned int size = bits.read(5);
+			for (unsigned int i = 0; i < count; ++i) {
+				*residual++ = bits.readSigned(size);
+			}
+		} else {
+			for (unsigned int i = 0; i < count; ++i) {
+				*residual++ = bits.readRice(k);
+			}
+		}
+		if (bits.overflowed()) return;
+	}
+}
+
+void read_subframe(FLACBitReader &bits, int32_t *dst, unsigned int block_size, unsigned int bit_depth) {
+	if (bits.read(1) != 0) {
+		Error::raise(Error::Status::FLACError, "Bad subframe header.");
+	}
+	unsigned int type = bits.read(6);
+	unsigned int wasted = 0;
+	if (bits.read(1)) {
+		wasted = bits.readUnary() + 1;
+		if (wasted >= bit_depth) {
+			Error::raise(Error::Status::FLACError, "Bad subframe header.");
+		}
+		bit_depth -= wasted;
+	}
+
+	if (type == Constant) {
+		std::fill(dst, dst + block_size, bits.readSigned(bit_depth));
+	} else if (type == Verbatim) {
+		for (unsigned int i = 0; i < block_size; ++i) {
+			dst[i] = bits.readSigned(bit_depth);
+		}
+	} else if (type >= Fixed && type <= Fixed + 4) {
+		unsigned int order = type - Fixed;
+		if (order > block_size) {
+			Error::raise(Error::Status::FLACError, "Bad predictor order.");
+		}
+		for (unsigned int i = 0; i < order; ++i) {
+			dst[i] = bits.readSigned(bit_depth);
+		}
+		read_residual(bits, dst, block_size, order);
+		switch (order) {
+		case 1:
+			for (unsigned int i = 1; i < block_size; ++i) dst[i] += dst[i - 1];
+			break;
+		case 2:
+			for (unsigned int i = 2; i < block_size; ++i) dst[i] += 2*dst[i - 1] - dst[i - 2];
+			break;
+		case 3:
+			for (unsigned int i = 3; i < block_size; ++i) dst[i] += 3*dst[i - 1] - 3*dst[i - 2] + dst[i - 3];
+			break;
+		case 4:
+			for (unsigned int i = 4; i < block_size; ++i) dst[i] += 4*dst[i - 1] - 6*dst[i - 2] + 4*dst[i - 3] - dst[i - 4];
+			break;
+		}
+	} else if (type >= LPC) {
+		unsigned int order = type - LPC + 1;
+		int32_t coefficients[FLAC_MAX_LPC_ORDER];
+		if (order > block_size) {
+			Error::raise(Error::Status::FLACError, "Bad predictor order.");
+		}
+		for (unsigned int i = 0; i < order; ++i) {
+			dst[i] = bits.readSigned(bit_depth);
+		}
+		unsigned int precision = bits.read(4) + 1;
+		int shift = bits.readSigned(5);
+		if (precision == 16 || shift < 0) {
+			Error::raise(Error::Status::FLACError, "Bad LPC coefficients.");
+		}
+		for (unsigned int i = 0; i < order; ++i) {
+			coefficients[i] = bits.readSigned(precision);
+		}
+		read_residual(bits, dst, block_size, order);
+		for (unsigned int i = order; i < block_size; ++i) {
+			int64_t sum = 0;
+			for (unsigned int j = 0; j < order; ++j) {
+				sum += (int64_t)coefficients[j]*dst[i - 1 - j];
+			}
+			dst[i] += (int32_t)(sum >> shift);
+		}
+	} else {
+		Error::raise(Error::Status::FLACError, "Reserved subframe type.");
+	}
+
+	if (wasted > 0) {
+		for (unsigned int i = 0; i < block_size; ++i) {
+			dst[i] <<= wasted;
+		}
+	}
+}
+
+// Decode the frame at the start of the given data in the channels. Return
+// its size, 0 if the data ends before the frame does and -1 if the data
+// does not start with a valid frame header.
+long read_frame(const uint8_t *data, size_t size, const FLACStreamInfo &info, std::vector<std::vector<int32_t>> &channels, unsigned int &block_size, uint64_t &first_frame) {
+	FLACBitReader bits(data, size);
+
+	if (size < 2 || data[0] != 0xff || (data[1] & 0xfe) != 0xf8) {
+		return -1;
+	}
+	bits.read(16);
+	unsigned int block_size_code = bits.read(4);
+	unsigned int sample_rate_code = bits.read(4);
+	unsigned int assignment = bits.read(4);
+	unsigned int sample_size_code = bits.read(3);
+	if (bits.read(1) != 0 || block_size_code == 0 || sample_rate_code == 15
+			|| assignment > MidSide || sample_size_code == 3 || sample_size_code == 7) {
+		return -1;
+	}
+
+	// Frame number, or sample number of variable block size streams, UTF-8
+	// like coded.
+	bool variable = (data[1] & 1) != 0;
+	uint32_t lead = bits.read(8);
+	if ((lead & 0xc0) == 0x80 || lead == 0xff) {
+		return -1;
+	}
+	uint64_t number = lead;
+	if (lead & 0x80) {
+		unsigned int count = __builtin_clz(~lead << 24) - 1;
+		number = lead & (0x3f >> count);
+		while (count-- > 0) {
+			uint32_t next = bits.read(8);
+			if (next >> 6 != 2) return -1;
+			number = (number << 6) | (next & 0x3f);
+		}
+	}
+	first_frame = variable ? number : number*info.maxBlockSize;
+
+	block_size = block_sizes[block_size_code];
+	if (block_size_code == 6) block_size = bits.read(8) + 1;
+	if (block_size_code == 7) block_size = bits.read(16) + 1;
+	if (sample_rate_code == 12) bits.read(8);
+	if (sample_rate_code == 13 || sample_rate_code == 14) bits.read(16);
+
+	size_t header_size = bits.bytePosition();
+	if (bits.overflowed() || header_size >= size) {
+		return 0;
+	}
+	if (bits.read(8) != crc8(data, header_size)) {
+		return -1;
+	}
+
+	unsigned int channel_count = assignment < LeftSide ? assignment + 1 : 2;
+	unsigned int bit_depth = sample_size_code == 0 ? info.bitDepth : sample_sizes[sample_size_code];
+	if (channel_count != info.channelCount || bit_depth != info.bitDepth) {
+		Error::raise(Error::Status::FLACError, "Stream format changes are not supported.");
+	}
+
+	for (unsigned int channel = 0; channel < channel_count; ++channel) {
+		if (channels[channel].size() < block_size) {
+			channels[channel].resize(block_size);
+		}
+		bool side = (assignment == LeftSide && channel == 1)
+			|| (assignment == SideRight && channel == 0)
+			|| (assignment == MidSide && channel == 1);
+		read_subframe(bits, channels[channel].data(), block_size, bit_depth + (side ? 1 : 0));
+		if (bits.overflowed()) {
+			return 0;
+		}
+	}
+
+	bits.align();
+	size_t frame_size = bits.bytePosition();
+	uint16_t crc = bits.read(16);
+	if (bits.overflowed()) {
+		return 0;
+	}
+	if (crc != crc16(data, frame_size)) {
+		Error::raise(Error::Status::FLACError, "Frame CRC mismatch.");
+	}
+
+	int32_t *left = channels[0].data(), *right = channel_count > 1 ? channels[1].data() : nullptr;
+	switch (assignment) {
+	case LeftSide:
+		for (unsigned int i = 0; i < block_size; ++i) right[i] = left[i] - right[i];
+		break;
+	case SideRight:
+		for (unsigned int i = 0; i < block_size; ++i) left[i] += right[i];
+		break;
+	case MidSide:
+		for (unsigned int i = 0; i < block_size; ++i) {
+			int32_t mid = (left[i] << 1) | (right[i] & 1), side = right[i];
+			left[i] = (mid + side) >> 1;
+			right[i] = (mid - side) >> 1;
+		}
+		break;
+	}
+
+	return frame_size + 2;
+}
+
+} /* namespace */
+
+// Decoded channels, converted to what `Decoder::write` takes.
+struct FLACDecoder::Output {
+	Output(unsigned int channelCount, unsigned int bitDepth) :
+		channelCount(channelCount),
+		bitDepth(bitDepth),
+		channels(channelCount),
+		samples16(channelCount),
+		samples32(channelCount),
+		pointers16(channelCount),
+		pointers32(channelCount) {
+	}
+
+	unsigned int channelCount;
+	unsigned int bitDepth;
+	std::vector<std::vector<int32_t>> channels;
+	std::vector<int8_t> samples8;
+	std::vector<std::vector<int16_t>> samples16;
+	std::vector<std::vector<float>> samples32;
+	std::vector<const int16_t *> pointers16;
+	std::vector<const float *> pointers32;
+};
+
+void FLACDecoder::writeOutput(Buffer &buffer, unsigned int offset, Output &output, unsigned int first, unsigned int count, Requantizer &requantizer) const {
+	unsigned int channel_count = output.channelCount, bit_depth = output.bitDepth;
+
+	if (bit_depth <= 8) {
+		output.samples8.resize(count*channel_count);
+		for (unsigned int channel = 0; channel < channel_count; ++channel) {
+			const int32_t *src = output.channels[channel].data() + first;
+			for (unsigned int i = 0; i < count; ++i) {
+				output.samples8[i*channel_count + channel] = src[i] << (8 - bit_depth);
+			}
+		}
+		write(buffer, offset, count, output.samples8.data(), requantizer);
+	} else if (bit_depth <= 16) {
+		for (unsigned int channel = 0; channel < channel_count; ++channel) {
+			const int32_t *src = output.channels[channel].data() + first;
+			output.samples16[channel].resize(count);
+			for (unsigned int i = 0; i < count; ++i) {
+				output.samples16[channel][i] = src[i] << (16 - bit_depth);
+			}
+			output.pointers16[channel] = output.samples16[channel].data();
+		}
+		write(buffer, offset, count, output.pointers16.data(), requantizer);
+	} else {
+		float scale = 1.0f/(1u << (bit_depth - 1));
+		for (unsigned int channel = 0; channel < channel_count; ++channel) {
+			const int32_t *src = output.channels[channel].data() + first;
+			output.samples32[channel].resize(count);
+			for (unsigned int i = 0; i < count; ++i) {
+				output.samples32[channel][i] = src[i]*scale;
+			}
+			output.pointers32[channel] = output.samples32[channel].data();
+		}
+		write(buffer, offset, count, output.pointers32.data(), requantizer);
+	}
+}
+
+Buffer * FLACDecoder::decode(Source &input) const {
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	RAII_FLACDecodeData decode_data(input, stats);
+	FLACStreamInfo info = FLACStreamInfo();
+
+	skip_id3_section(decode_data);
+	read_metadata(decode_data, info);
+
+	Format format(info.channelCount, info.sampleRate, info.bitDepth <= 8 ? 8 : 16);
+	decode_data.buffer = new Buffer(outputFormat(format));
+	if (info.frameCount > 0 && info.frameCount < UINT32_MAX) {
+		decode_data.buffer->resize(info.frameCount);
+		if (stats) {
+			stats->allocation(decode_data.buffer->format().sizeForFrameCount(info.frameCount));
+		}
+	}
+
+	Requantizer requantizer(dither());
+	Output output(info.channelCount, info.bitDepth);
+	size_t needed = std::max<size_t>(FLAC_DECODE_INPUT_BUFFER_SIZE,
+		(size_t)info.maxBlockSize*info.channelCount*(info.bitDepth + 1)/8 + 64);
+	unsigned int offset = 0;
+
+	for (;;) {
+		decode_data.fill(needed);
+		if (decode_data.available() == 0) {
+			break;
+		}
+
+		unsigned int block_size;
+		uint64_t first_frame;
+		long frame_size;
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Codec);
+			Trace::Span span("flac.decode", "codec");
+			try {
+				frame_size = read_frame(decode_data.data(), decode_data.available(), info, output.channels, block_size, first_frame);
+			} catch (Error &) {
+				// A false frame header, which passed its CRC-8.
+				frame_size = -1;
+			}
+		}
+		if (frame_size == 0 && decode_data.eof) {
+			if (offset == 0) {
+				Error::raise(Error::Status::IOError, "The file is truncated.");
+			}
+			// A false frame header running past the end of the input.
+			frame_size = -1;
+		}
+		if (frame_size < 0) {
+			// Not a frame: resynchronize on the next frame header, what
+			// trails the last frame (tags) is ignored.
+			decode_data.consume(1);
+			continue;
+		}
+		if (frame_size == 0) {
+			needed = decode_data.available()*2;
+			continue;
+		}
+		decode_data.consume(frame_size);
+
+		writeOutput(*decode_data.buffer, offset, output, 0, block_size, requantizer);
+		offset += block_size;
+		Job::checkpoint(input);
+	}
+
+	if (offset < decode_data.buffer->frameCount()) {
+		decode_data.buffer->resize(offset);
+	}
+
+	Buffer *buffer = decode_data.buffer;
+	decode_data.buffer = nullptr;
+
+	return buffer;
+}
+
+namespace {
+
+struct FLACIndex : public Decoder::Index {
+	FLACIndex(const char *data, size_t size, Format format, unsigned int frameCount, const FLACStreamInfo &info) :
+		Decoder::Index(data, size, format, frameCount),
+		info(info) {
+	}
+
+	FLACStreamInfo info;
+	// Byte offsets of the frames found so far, by first frame.
+	mutable std::map<uint64_t, size_t> frames;
+};
+
+// Find the first valid frame in [position, end). Return its offset, `end`
+// if there is none.
+size_t find_frame(const FLACIndex &index, size_t position, size_t end, std::vector<std::vector<int32_t>> &channels, unsigned int &block_size, uint64_t &first_frame) {
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(index.data());
+	for (; position < end; ++position) {
+		if (data[position] != 0xff) continue;
+		try {
+			if (read_frame(data + position, index.size() - position, index.info, channels, block_size, first_frame) > 0) {
+				return position;
+			}
+		} catch (Error &) {
+			// A false frame header, which passed its CRC-8.
+		}
+	}
+	return end;
+}
+
+// Get the offset of a frame starting at most a few blocks before the given
+// frame, by interpolation between the frames found so far.
+size_t seek_frame(const FLACIndex &index, uint64_t target, std::vector<std::vector<int32_t>> &channels) {
+	uint64_t distance = (uint64_t)FLAC_SEEK_BLOCK_COUNT*index.info.maxBlockSize;
+	auto next = index.frames.upper_bound(target);
+	auto previous = std::prev(next);
+	uint64_t low_frame = previous->first, high_frame = index.frameCount();
+	size_t low = previous->second, high = index.size();
+	if (next != index.frames.end()) {
+		high_frame = next->first;
+		high = next->second;
+	}
+
+	while (target - low_frame > distance && high - low > 1) {
+		double ratio = high_frame > low_frame ? (double)(target - low_frame)/(high_frame - low_frame) : 0.5;
+		size_t probe = low + (size_t)((high - low)*ratio);
+		probe = std::max(low + 1, std::min(high - 1, probe));
+
+		unsigned int block_size;
+		uint64_t first_frame;
+		size_t position = find_frame(index, probe, high, channels, block_size, first_frame);
+		if (position == high) {
+			high = probe;
+			continue;
+		}
+		index.frames[first_frame] = position;
+		if (first_frame <= target) {
+			low = position;
+			low_frame = first_frame;
+		} else {
+			high = position;
+			high_frame = first_frame;
+		}
+	}
+	return low;
+}
+
+} /* namespace */
+
+Decoder::Index * FLACDecoder::index(const char *data, size_t size) const {
+	MemorySource input(data, size);
+	RAII_FLACDecodeData decode_data(input, nullptr);
+	FLACStreamInfo info = FLACStreamInfo();
+
+	skip_id3_section(decode_data);
+	read_metadata(decode_data, info);
+	size_t first = input.position() - decode_data.available();
+
+	if (info.frameCount > UINT32_MAX) {
+		Error::raise(Error::Status::FormatBadValue, "The stream is too long.");
+	}
+	Format format(info.channelCount, info.sampleRate, info.bitDepth <= 8 ? 8 : 16);
+	std::unique_ptr<FLACIndex> index(new FLACIndex(data, size, outputFormat(format), info.frameCount, info));
+	index->frames[0] = first;
+
+	if (info.frameCount == 0) {
+		// Unknown length: find the last frame, from the end of the stream.
+		std::vector<std::vector<int32_t>> channels(info.channelCount);
+		uint64_t frame_count = 0;
+		for (size_t window = FLAC_DECODE_INPUT_BUFFER_SIZE; frame_count == 0; window *= 4) {
+			size_t position = size - first > window ? size - window : first;
+			unsigned int block_size;
+			uint64_t first_frame;
+			while ((position = find_frame(*index, position, size, channels, block_size, first_frame)) < size) {
+				frame_count = first_frame + block_size;
+				position++;
+			}
+			if (size - first <= window) break;
+		}
+		if (frame_count > UINT32_MAX) {
+			Error::raise(Error::Status::FormatBadValue, "The stream is too long.");
+		}
+		index.reset(new FLACIndex(data, size, outputFormat(format), frame_count, info));
+		index->frames[0] = first;
+	}
+	return index.release();
+}
+
+Buffer * FLACDecoder::decode(const Index &index, unsigned int offset, unsigned int count) const {
+	const FLACIndex *flac_index = dynamic_cast<const FLACIndex *>(&index);
+	if (flac_index == nullptr) {
+		Error::raise(Error::Status::FLACError, "Not a FLAC stream index.");
+	}
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	const FLACStreamInfo &info = flac_index->info;
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(index.data());
+	std::unique_ptr<Buffer> buffer(new Buffer(index.format()));
+	Output output(info.channelCount, info.bitDepth);
+
+	offset = std::min(offset, index.frameCount());
+	count = std::min(count, index.frameCount() - offset);
+
+	// Seeded by offset, so that a range is dithered the same way whatever
+	// was decoded before.
+	Requantizer requantizer(dither(), 0x2545f491u ^ offset*0x9e3779b9u);
+	size_t position;
+	{
+		Statistics::Scope scope(stats, Statistics::Phase::Codec);
+		Trace::Span span("flac.seek", "codec");
+		position = seek_frame(*flac_index, offset, output.channels);
+	}
+
+	unsigned int done = 0;
+	while (done < count && position < index.size()) {
+		unsigned int block_size;
+		uint64_t first_frame;
+		long frame_size;
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Codec);
+			Trace::Span span("flac.decode", "codec");
+			frame_size = read_frame(data + position, index.size() - position, info, output.channels, block_size, first_frame);
+		}
+		if (frame_size < 0) {
+			position++;
+			continue;
+		}
+		if (frame_size == 0) {
+			Error::raise(Error::Status::IOError, "The file is truncated.");
+		}
+		position += frame_size;
+		if (stats) stats->bytesRead += frame_size;
+
+		uint64_t next = offset + done;
+		if (first_frame + block_size > next) {
+			unsigned int first = first_frame < next ? next - first_frame : 0;
+			unsigned int n = std::min(block_size - first, count - done);
+			writeOutput(*buffer, done, output, first, n, requantizer);
+			done += n;
+		}
+		// The next range likely starts where this one ends.
+		if (done == count) {
+			flac_index->frames[first_frame + block_size] = position;
+		}
+	}
+
+	return buffer.release();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Coder /////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct FLACEncodeParameters {
+	unsigned int blockSize;
+	unsigned int maxFixedOrder;
+	unsigned int maxLPCOrder;
+	bool exhaustiveLPC;
+	unsigned int maxPartitionOrder;
+	bool stereoDecorrelation;
+};
+
+// The compression levels 8, 5, 2 and 0 of the reference encoder.
+FLACEncodeParameters flac_parameters(Coder::Quality quality) {
+	switch (quality) {
+	case Coder::Quality::Best:
+		return FLACEncodeParameters { 4096, 4, 12, true, 6, true };
+	case Coder::Quality::Good:
+		return FLACEncodeParameters { 4096, 4, 8, false, 5, true };
+	case Coder::Quality::Acceptable:
+		return FLACEncodeParameters { 4096, 4, 0, false, 4, true };
+	case Coder::Quality::Fastest:
+		break;
+	}
+	return FLACEncodeParameters { 1152, 2, 0, false, 3, false };
+}
+
+// MSB first bit writer.
+class FLACBitWriter {
+public:
+	FLACBitWriter(std::vector<uint8_t> &output) : _output(output), _bits(0), _count(0) {}
+
+	// At most 32 bits.
+	inline void write(uint32_t value, unsigned int count) {
+		if (count == 0) return;
+		_bits = (_bits << count) | (value & (uint32_t)((1ull << count) - 1));
+		_count += count;
+		while (_count >= 8) {
+			_count -= 8;
+			_output.push_back((uint8_t)(_bits >> _count));
+		}
+	}
+
+	inline void writeRice(int32_t value, unsigned int k) {
+		uint32_t u = zigzag(value);
+		uint32_t quotient = u >> k;
+		if (quotient + 1 + k <= 32) {
+			write((1u << k) | (u & ((1u << k) - 1)), quotient + 1 + k);
+			return;
+		}
+		for (; quotient >= 32; quotient -= 32) {
+			write(0, 32);
+		}
+		write(1, quotient + 1);
+		write(u, k);
+	}
+
+	void align() {
+		if (_count > 0) {
+			write(0, 8 - _count);
+		}
+	}
+
+	size_t size() const { return _output.size(); }
+
+private:
+	std::vector<uint8_t> &_output;
+	uint64_t _bits;
+	unsigned int _count;
+};
+
+// A channel coding candidate: the subframe type, predictor and residual
+// partitions, with its size in bits.
+struct Subframe {
+	unsigned int type;
+	unsigned int order;
+	unsigned int precision;
+	int shift;
+	int32_t coefficients[FLAC_MAX_LPC_ORDER];
+	unsigned int partitionOrder;
+	unsigned int parameters[1 << 8];
+	uint64_t bits;
+	std::vector<int32_t> residual;
+};
+
+// Find the partition order and Rice parameters of the residual with the
+// fewest bits, as estimated from the partition sums.
+uint64_t choose_partitions(const int32_t *residual, unsigned int block_size, unsigned int order, unsigned int max_partition_order, Subframe &subframe) {
+	unsigned int partition_order = max_partition_order;
+	while (partition_order > 0
+			&& ((block_size & ((1u << partition_order) - 1)) != 0 || (block_size >> partition_order) <= order)) {
+		partition_order--;
+	}
+
+	uint64_t sums[1 << 8];
+	unsigned int partition_count = 1u << partition_order, partition_size = block_size >> partition_order;
+	for (unsigned int partition = 0, i = order; partition < partition_count; ++partition) {
+		uint64_t sum = 0;
+		for (unsigned int end = (partition + 1)*partition_size; i < end; ++i) {
+			sum += zigzag(residual[i]);
+		}
+		sums[partition] = sum;
+	}
+
+	uint64_t best = UINT64_MAX;
+	for (;;) {
+		unsigned int parameters[1 << 8], max_parameter = 0;
+		uint64_t bits = 0;
+		for (unsigned int partition = 0; partition < partition_count; ++partition) {
+			uint64_t count = partition_size - (partition == 0 ? order : 0);
+			unsigned int k = 0;
+			while (k < 30 && (count << (k + 1)) < sums[partition]) {
+				++k;
+			}
+			parameters[partition] = k;
+			max_parameter = std::max(max_parameter, k);
+			bits += count*(k + 1) + (sums[partition] >> k);
+		}
+		bits += 2 + 4 + partition_count*(max_parameter < 15 ? 4 : 5);
+		if (bits < best) {
+			best = bits;
+			subframe.partitionOrder = partition_order;
+			std::copy(parameters, parameters + partition_count, subframe.parameters);
+		}
+		if (partition_order == 0) break;
+		partition_order--;
+		partition_count >>= 1;
+		partition_size <<= 1;
+		for (unsigned int partition = 0; partition < partition_count; ++partition) {
+			sums[partition] = sums[2*partition] + sums[2*partition + 1];
+		}
+	}
+	return best;
+}
+
+void fixed_residual(const int32_t *src, unsigned int block_size, unsigned int order, int32_t *dst) {
+	std::copy(src, src + order, dst);
+	for (unsigned int i = order; i < block_size; ++i) {
+		switch (order) {
+		case 0: dst[i] = src[i]; break;
+		case 1: dst[i] = src[i] - src[i - 1]; break;
+		case 2: dst[i] = src[i] - 2*src[i - 1] + src[i - 2]; break;
+		case 3: dst[i] = src[i] - 3*src[i - 1] + 3*src[i - 2] - src[i - 3]; break;
+		case 4: dst[i] = src[i] - 4*src[i - 1] + 6*src[i - 2] - 4*src[i - 3] + src[i - 4]; break;
+		}
+	}
+}
+
+// Return false if the residual does not fit the Rice coding.
+bool lpc_residual(const int32_t *src, unsigned int block_size, const Subframe &subframe, int32_t *dst) {
+	std::copy(src, src + subframe.order, dst);
+	for (unsigned int i = subframe.order; i < block_size; ++i) {
+		int64_t sum = 0;
+		for (unsigned int j = 0; j < subframe.order; ++j) {
+			sum += (int64_t)subframe.coefficients[j]*src[i - 1 - j];
+		}
+		int64_t residual = src[i] - (sum >> subframe.shift);
+		if (residual > (1 << 30) || residual < -(1 << 30)) {
+			return false;
+		}
+		dst[i] = (int32_t)residual;
+	}
+	return true;
+}
+
+// Quantize the coefficients of the given order, as the reference encoder:
+// the largest one uses all the precision bits, rounding errors are carried
+// to the next coefficient.
+bool quantize_coefficients(const double *lpc, unsigned int order, unsigned int precision, Subframe &subframe) {
+	double max = 0;
+	for (unsigned int i = 0; i < order; ++i) {
+		max = std::max(max, std::fabs(lpc[i]));
+	}
+	if (max <= 0) {
+		return false;
+	}
+	int log2max;
+	std::frexp(max, &log2max);
+	int shift = std::min((int)precision - 1 - log2max, 15);
+	if (shift < 0) {
+		return false;
+	}
+	int32_t limit = (1 << (precision - 1)) - 1;
+	double error = 0;
+	for (unsigned int i = 0; i < order; ++i) {
+		error += lpc[i]*(1 << shift);
+		int32_t q = std::max(-limit - 1, std::min(limit, (int32_t)std::lround(error)));
+		error -= q;
+		subframe.coefficients[i] = q;
+	}
+	subframe.order = order;
+	subframe.precision = precision;
+	subframe.shift = shift;
+	return true;
+}
+
+// Linear prediction coefficients of every order up to `max_order` from the
+// windowed autocorrelation, by the Levinson-Durbin recursion. Return the
+// highest order computed.
+unsigned int compute_lpc(const int32_t *src, unsigned int block_size, unsigned int max_order, std::vector<double> &windowed, double lpc[][FLAC_MAX_LPC_ORDER]) {
+	windowed.resize(block_size);
+	for (unsigned int i = 0; i < block_size; ++i) {
+		// Welch window.
+		double x = (2.0*i - (block_size - 1))/(block_size + 1);
+		windowed[i] = src[i]*(1 - x*x);
+	}
+	double autocorrelation[FLAC_MAX_LPC_ORDER + 1];
+	for (unsigned int lag = 0; lag <= max_order; ++lag) {
+		double sum = 0;
+		for (unsigned int i = lag; i < block_size; ++i) {
+			sum += windowed[i]*windowed[i - lag];
+		}
+		autocorrelation[lag] = sum;
+	}
+	if (autocorrelation[0] <= 0) {
+		return 0;
+	}
+
+	double coefficients[FLAC_MAX_LPC_ORDER], error = autocorrelation[0];
+	for (unsigned int order = 0; order < max_order; ++order) {
+		double reflection = -autocorrelation[order + 1];
+		for (unsigned int i = 0; i < order; ++i) {
+			reflection -= coefficients[i]*autocorrelation[order - i];
+		}
+		reflection /= error;
+		coefficients[order] = reflection;
+		for (unsigned int i = 0; i < order/2; ++i) {
+			double c = coefficients[i];
+			coefficients[i] += reflection*coefficients[order - 1 - i];
+			coefficients[order - 1 - i] += reflection*c;
+		}
+		if (order & 1) {
+			coefficients[order/2] += coefficients[order/2]*reflection;
+		}
+		error *= 1 - reflection*reflection;
+		for (unsigned int i = 0; i <= order; ++i) {
+			lpc[order][i] = -coefficients[i];
+		}
+		if (error <= 0) {
+			return order + 1;
+		}
+	}
+	return max_order;
+}
+
+// Choose the smallest coding of a channel.
+void encode_channel(const int32_t *src, unsigned int block_size, unsigned int bit_depth, const FLACEncodeParameters &parameters, Subframe &best, Subframe &candidate, std::vector<double> &windowed) {
+	if (std::all_of(src + 1, src + block_size, [src](int32_t x) { return x == src[0]; })) {
+		best.type = Constant;
+		best.bits = 8 + bit_depth;
+		return;
+	}
+
+	best.type = Verbatim;
+	best.bits = 8 + (uint64_t)bit_depth*block_size;
+	best.residual.resize(block_size);
+	candidate.residual.resize(block_size);
+
+	for (unsigned int order = 0; order <= parameters.maxFixedOrder && order < block_size; ++order) {
+		fixed_residual(src, block_size, order, candidate.residual.data());
+		candidate.type = Fixed;
+		candidate.order = order;
+		candidate.bits = 8 + order*bit_depth
+			+ choose_partitions(candidate.residual.data(), block_size, order, parameters.maxPartitionOrder, candidate);
+		if (candidate.bits < best.bits) {
+			std::swap(best, candidate);
+		}
+	}
+
+	unsigned int max_order = std::min(parameters.maxLPCOrder, block_size - 1);
+	if (max_order == 0) {
+		return;
+	}
+	double lpc[FLAC_MAX_LPC_ORDER][FLAC_MAX_LPC_ORDER];
+	max_order = compute_lpc(src, block_size, max_order, windowed, lpc);
+	unsigned int precision = std::min(15u, bit_depth <= 8 ? 8u : 12u);
+	for (unsigned int order = parameters.exhaustiveLPC ? 1 : max_order; order > 0 && order <= max_order; ++order) {
+		if (! quantize_coefficients(lpc[order - 1], order, precision, candidate)
+				|| ! lpc_residual(src, block_size, candidate, candidate.residual.data())) {
+			continue;
+		}
+		candidate.type = LPC;
+		candidate.bits = 8 + order*bit_depth + 4 + 5 + order*precision
+			+ choose_partitions(candidate.residual.data(), block_size, order, parameters.maxPartitionOrder, candidate);
+		if (candidate.bits < best.bits) {
+			std::swap(best, candidate);
+		}
+	}
+}
+
+void write_subframe(FLACBitWriter &writer, const int32_t *src, unsigned int block_size, unsigned int bit_depth, const Subframe &subframe) {
+	switch (subframe.type) {
+	case Constant:
+		writer.write(Constant << 1, 8);
+		writer.write(src[0], bit_depth);
+		return;
+
+	case Verbatim:
+		writer.write(Verbatim << 1, 8);
+		for (unsigned int i = 0; i < block_size; ++i) {
+			writer.write(src[i], bit_depth);
+		}
+		return;
+
+	case Fixed:
+		writer.write((Fixed + subframe.order) << 1, 8);
+		for (unsigned int i = 0; i < subframe.order; ++i) {
+			writer.write(src[i], bit_depth);
+		}
+		break;
+
+	case LPC:
+		writer.write((LPC + subframe.order - 1) << 1, 8);
+		for (unsigned int i = 0; i < subframe.order; ++i) {
+			writer.write(src[i], bit_depth);
+		}
+		writer.write(subframe.precision - 1, 4);
+		writer.write(subframe.shift, 5);
+		for (unsigned int i = 0; i < subframe.order; ++i) {
+			writer.write(subframe.coefficients[i], subframe.precision);
+		}
+		break;
+	}
+
+	unsigned int partition_count = 1u << subframe.partitionOrder;
+	unsigned int partition_size = block_size >> subframe.partitionOrder;
+	unsigned int max_parameter = *std::max_element(subframe.parameters, subframe.parameters + partition_count);
+	unsigned int parameter_bits = max_parameter < 15 ? 4 : 5;
+	writer.write(parameter_bits - 4, 2);
+	writer.write(subframe.partitionOrder, 4);
+	const int32_t *residual = subframe.residual.data();
+	for (unsigned int partition = 0, i = subframe.order; partition < partition_count; ++partition) {
+		unsigned int k = subframe.parameters[partition];
+		writer.write(k, parameter_bits);
+		for (unsigned int end = (partition + 1)*partition_size; i < end; ++i) {
+			writer.writeRice(residual[i], k);
+		}
+	}
+}
+
+// The state of a worker, reused from frame to frame.
+struct FrameEncoder {
+	std::vector<std::vector<int32_t>> channels;     // left, right, mid and side for stereo
+	std::vector<Subframe> subframes;
+	Subframe candidate;
+	std::vector<double> windowed;
+	std::vector<int16_t> samples;
+};
+
+void write_frame_header(FLACBitWriter &writer, std::vector<uint8_t> &output, uint32_t frame_number, unsigned int block_size, const Format &format, unsigned int assignment) {
+	unsigned int block_size_code = block_size <= 256 ? 6 : 7;
+	for (unsigned int code = 1; code < 16; ++code) {
+		if (block_sizes[code] == block_size) block_size_code = code;
+	}
+	unsigned int sample_rate_code = 0;
+	for (unsigned int code = 1; code < 12; ++code) {
+		if (sample_rates[code] == format.sampleRate()) sample_rate_code = code;
+	}
+
+	writer.write(0xfff8, 16);
+	writer.write(block_size_code, 4);
+	writer.write(sample_rate_code, 4);
+	writer.write(assignment, 4);
+	writer.write(format.bitDepth() == 8 ? 1 : 4, 3);
+	writer.write(0, 1);
+	if (frame_number < 0x80) {
+		writer.write(frame_number, 8);
+	} else {
+		unsigned int count = 1;
+		while (count < 6 && frame_number >= (1u << (5*count + 6))) {
+			++count;
+		}
+		writer.write((0xff << (7 - count)) | (frame_number >> (6*count)), 8);
+		while (count-- > 0) {
+			writer.write(0x80 | ((frame_number >> (6*count)) & 0x3f), 8);
+		}
+	}
+	if (block_size_code == 6) writer.write(block_size - 1, 8);
+	if (block_size_code == 7) writer.write(block_size - 1, 16);
+	writer.write(crc8(output.data(), output.size()), 8);
+}
+
+void encode_frame(const Buffer &buffer, unsigned int frame, const FLACEncodeParameters &parameters, FrameEncoder &encoder, std::vector<uint8_t> &output) {
+	Format format = buffer.format();
+	unsigned int channel_count = format.channelCount(), bit_depth = format.bitDepth();
+	unsigned int offset = frame*parameters.blockSize;
+	unsigned int block_size = std::min(parameters.blockSize, buffer.frameCount() - offset);
+	bool stereo = channel_count == 2 && parameters.stereoDecorrelation;
+
+	encoder.channels.resize(stereo ? 4 : channel_count);
+	encoder.subframes.resize(encoder.channels.size());
+	encoder.samples.resize(block_size*channel_count);
+	if (bit_depth == 8) {
+		buffer.read(offset, block_size, reinterpret_cast<int8_t *>(encoder.samples.data()));
+		const int8_t *samples = reinterpret_cast<const int8_t *>(encoder.samples.data());
+		for (unsigned int channel = 0; channel < channel_count; ++channel) {
+			encoder.channels[channel].resize(block_size);
+			for (unsigned int i = 0; i < block_size; ++i) {
+				encoder.channels[channel][i] = samples[i*channel_count + channel];
+			}
+		}
+	} else {
+		buffer.read(offset, block_size, encoder.samples.data());
+		for (unsigned int channel = 0; channel < channel_count; ++channel) {
+			encoder.channels[channel].resize(block_size);
+			for (unsigned int i = 0; i < block_size; ++i) {
+				encoder.channels[channel][i] = encoder.samples[i*channel_count + channel];
+			}
+		}
+	}
+	if (stereo) {
+		encoder.channels[2].resize(block_size);
+		encoder.channels[3].resize(block_size);
+		for (unsigned int i = 0; i < block_size; ++i) {
+			int32_t left = encoder.channels[0][i], right = encoder.channels[1][i];
+			encoder.channels[2][i] = (left + right) >> 1;
+			encoder.channels[3][i] = left - right;
+		}
+	}
+
+	for (unsigned int channel = 0; channel < encoder.channels.size(); ++channel) {
+		encode_channel(encoder.channels[channel].data(), block_size, bit_depth + (stereo && channel == 3 ? 1 : 0),
+			parameters, encoder.subframes[channel], encoder.candidate, encoder.windowed);
+	}
+
+	// Pick the channel pair with the fewest bits.
+	unsigned int assignment = channel_count - 1, pair[2] = { 0, 1 };
+	if (stereo) {
+		uint64_t left = encoder.subframes[0].bits, right = encoder.subframes[1].bits;
+		uint64_t mid = encoder.subframes[2].bits, side = encoder.subframes[3].bits;
+		uint64_t best = left + right;
+		if (left + side < best) { best = left + side; assignment = LeftSide; pair[0] = 0; pair[1] = 3; }
+		if (side + right < best) { best = side + right; assignment = SideRight; pair[0] = 3; pair[1] = 1; }
+		if (mid + side < best) { best = mid + side; assignment = MidSide; pair[0] = 2; pair[1] = 3; }
+	}
+
+	output.clear();
+	FLACBitWriter writer(output);
+	write_frame_header(writer, output, frame, block_size, format, assignment);
+	for (unsigned int channel = 0; channel < channel_count; ++channel) {
+		unsigned int index = stereo ? pair[channel] : channel;
+		write_subframe(writer, encoder.channels[index].data(), block_size,
+			bit_depth + (stereo && index == 3 ? 1 : 0), encoder.subframes[index]);
+	}
+	writer.align();
+	writer.write(crc16(output.data(), output.size()), 16);
+}
+
+void write_stream_info(std::vector<uint8_t> &output, const Format &format, unsigned int block_size, uint64_t frame_count) {
+	FLACBitWriter writer(output);
+	writer.write('f', 8);
+	writer.write('L', 8);
+	writer.write('a', 8);
+	writer.write('C', 8);
+	writer.write(0x80 | StreamInfo, 8);         // last metadata block
+	writer.write(34, 24);
+	writer.write(block_size, 16);
+	writer.write(block_size, 16);
+	writer.write(0, 24);                        // frame sizes are unknown
+	writer.write(0, 24);
+	writer.write(format.sampleRate(), 20);
+	writer.write(format.channelCount() - 1, 3);
+	writer.write(format.bitDepth() - 1, 5);
+	writer.write((uint32_t)(frame_count >> 32), 4);
+	writer.write((uint32_t)frame_count, 32);
+	for (unsigned int i = 0; i < 4; ++i) {
+		writer.write(0, 32);                    // MD5 signature is unset
+	}
+}
+
+} /* namespace */
+
+FLACCoder::FLACCoder() :
+	_threadCount(0) {
+}
+
+FLACCoder::FLACCoder(Quality quality) :
+	Coder(quality),
+	_threadCount(0) {
+}
+
+void FLACCoder::encode(const Buffer &buffer, Sink &out) const {
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	Format format = buffer.format();
+	FLACEncodeParameters parameters = flac_parameters(quality());
+
+	if (format.channelCount() > 8) {
+		Error::raise(Error::Status::FLACError, "FLAC streams have at most 8 channels.");
+	}
+
+	std::vector<uint8_t> stream_info;
+	write_stream_info(stream_info, format, parameters.blockSize, buffer.frameCount());
+	{
+		Statistics::Scope scope(stats, Statistics::Phase::IO);
+		out.write((const char *)stream_info.data(), stream_info.size());
+	}
+	if (stats) stats->bytesWritten += stream_info.size();
+
+	// Frames are encoded by batches, a few per worker. A batch is written
+	// in order while the next one is encoded. The group is declared last:
+	// if a write fails, it waits for the running batch before the frames
+	// are freed.
+	unsigned int concurrency = _threadCount ? _threadCount : Executor::shared().workerCount();
+	unsigned int frame_count = (buffer.frameCount() + parameters.blockSize - 1)/parameters.blockSize;
+	unsigned int batch_size = 4*concurrency;
+	std::vector<FrameEncoder> encoders(concurrency);
+	std::vector<std::exception_ptr> errors(concurrency);
+	std::vector<std::vector<uint8_t>> frames[2] = {
+		std::vector<std::vector<uint8_t>>(batch_size),
+		std::vector<std::vector<uint8_t>>(batch_size),
+	};
+	std::vector<struct iovec> chunks(batch_size);
+	Executor::Group pool(concurrency);
+
+	auto submit = [&](unsigned int first, std::vector<std::vector<uint8_t>> &batch) {
+		unsigned int count = std::min(batch_size, frame_count - first);
+		for (unsigned int worker = 0; worker < encoders.size(); ++worker) {
+			pool.submit([&, worker, first, count]() {
+				Trace::Span span("flac.encode", "codec");
+				try {
+					for (unsigned int i = worker; i < count; i += encoders.size()) {
+						encode_frame(buffer, first + i, parameters, encoders[worker], batch[i]);
+					}
+				} catch (...) {
+					errors[worker] = std::current_exception();
+				}
+			});
+		}
+	};
+
+	if (frame_count > 0) {
+		submit(0, frames[0]);
+	}
+	for (unsigned int first = 0, index = 0; first < frame_count; first += batch_size, index ^= 1) {
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Codec);
+			pool.wait();
+		}
+		for (std::exception_ptr &error : errors) {
+			if (error) std::rethrow_exception(error);
+		}
+		// No batch is running: a cancelled job unwinds from here.
+		Job::checkpoint(first, frame_count);
+		if (first + batch_size < frame_count) {
+			submit(first + batch_size, frames[index ^ 1]);
+		}
+
+		unsigned int count = std::min(batch_size, frame_count - first);
+		unsigned int offset = first*parameters.blockSize;
+		unsigned int batch_frame_count = std::min(buffer.frameCount() - offset, count*parameters.blockSize);
+		analyze(buffer, offset, batch_frame_count);
+
+		size_t size = 0;
+		for (unsigned int i = 0; i < count; ++i) {
+			chunks[i].iov_base = frames[index][i].data();
+			chunks[i].iov_len = frames[index][i].size();
+			size += frames[index][i].size();
+		}
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::IO);
+			out.write(chunks.data(), count);
+		}
+		if (stats) {
+			stats->bytesWritten += size;
+			stats->framesProcessed += batch_frame_count;
+		}
+	}
+
+	Statistics::Scope scope(stats, Statistics::Phase::IO);
+	out.flush();
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,61 @@
+/*
+ * AudioFLACCoder.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOFLACCODER_H_
+#define AUDIOFLACCODER_H_
+
+#include "AudioCoder.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+/**
+ * ## Class FLACCoder
+ * Encode buffers losslessly to FLAC streams.
+ *
+ * The frames of a stream are independent: they are encoded by batches on
+ * the shared executor, then written in order. The quality selects the
+ * compression level, as the `flac` tool does:
+ * * `Coder::Quality::Best`:       level 8, LPC up to order 12, every order tried,
+ * * `Coder::Quality::Good`:       level 5, LPC of order 8,
+ * * `Coder::Quality::Acceptable`: level 2, fixed predictors only,
+ * * `Coder::Quality::Fastest`:    level 0, small frames, no stereo decorrelation.
+ *
+ * The MD5 signature of the stream info is left unset (all zeros), as the
+ * format allows.
+ */
+class FLACCoder : public Coder {
+public:
+	/**
+	 * * `FLACCoder()`
+	 * * `FLACCoder(Quality)`
+	 */
+	FLACCoder();
+	FLACCoder(Quality);
+
+public:
+	/**
+	 * * `unsigned int threadCount() const`
+	 * * `void setThreadCount(unsigned int)`
+	 *     Encode frames in the given count of concurrent tasks, as many as
+	 *     the executor has workers if 0 (the default).
+	 */
+	unsigned int threadCount() const { return _threadCount; }
+	void setThreadCount(unsigned int threadCount) { _threadCount = threadCount; }
+
+	using Coder::encode;
+	virtual void encode(const Buffer &, Sink &) const;
+
+private:
+	unsigned int _threadCount;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOFLACCODER_H_ */
@@ -0,0 +1,44 @@
+/*
+ * AudioFLACDecoder.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOFLACDECODER_H_
+#define AUDIOFLACDECODER_H_
+
+#include "AudioDecoder.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+/**
+ * ## Class FLACDecoder
+ * Decode FLAC streams, up to 24 bits per sample. Streams of 8 bits are
+ * decoded to 8 bits buffers, others to 16 bits: deeper samples are
+ * requantized with the decoder dither.
+ *
+ * Frames are checked against their CRC, a mismatch raises
+ * `Error::Status::FLACError`.
+ *
+ * Indexed streams (see `Decoder::index`) are sought by interpolation on
+ * the frame headers, refined by the frames found by previous seeks.
+ */
+class FLACDecoder: public Decoder {
+public:
+	using Decoder::decode;
+	virtual Buffer * decode(Source &) const;
+	virtual Index * index(const char *data, size_t size) const;
+	virtual Buffer * decode(const Index &, unsigned int offset, unsigned int count) const;
+
+private:
+	struct Output;
+	void writeOutput(Buffer &, unsigned int offset, Output &, unsigned int first, unsigned int count, Requantizer &) const;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOFLACDECODER_H_ */
@@ -10,10 +10,15 @@ extern "C" {
 #	include <lame/lame.h>
 }
 
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
 #include <cstring>
 #include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 #include <boost/format.hpp>
 #include <boost/detail/endian.hpp>
@@ -21,6 +26,11 @@ extern "C" {
 #include "../AudioError.h"
 #include "../AudioBuffer.h"
 #include "../AudioFormat.h"
+#include "../AudioJob.h"
+#include "../AudioStatistics.h"
+#include "../AudioTrace.h"
+#include "../io/AudioSink.h"
+#include "../io/AudioSource.h"
 
 #include "AudioMP3Coder.h"
 #include "AudioMP3Decoder.h"
@@ -29,6 +39,57 @@ namespace com {
 namespace nealrame {
 namespace audio {
 
+//////////////////////////////////////////////////////////////////////////////
+// LAME //////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+#define LAME_ERROR_MESSAGE_SIZE 256
+
+namespace {
+
+// LAME builds its global tables the first time a decoder or an encoder is
+// set up, without locking.
+std::mutex lame_setup_mutex;
+
+// LAME reports errors through callbacks without user data, and no
+// exception may unwind its C frames: the message is kept by the calling
+// thread and raised once the LAME call has returned.
+thread_local char lame_error[LAME_ERROR_MESSAGE_SIZE];
+
+void error_handler(const char *fmt, va_list ap) {
+	vsnprintf(lame_error, sizeof(lame_error), fmt, ap);
+}
+
+#if defined(DEBUG)
+void debug_handler(const char *fmt, va_list ap) {
+	vfprintf(stderr, fmt, ap);
+}
+
+void message_handler(const char *fmt, va_list ap) {
+	vfprintf(stderr, fmt, ap);
+}
+#else
+void debug_handler(const char *, va_list) {}
+void message_handler(const char *, va_list) {}
+#endif
+
+void clear_lame_error() {
+	lame_error[0] = '\0';
+}
+
+// Raise the last error reported by LAME on this thread, the given message
+// if none.
+void raise_lame_error(const std::string &message) {
+	std::string reported(lame_error);
+	clear_lame_error();
+	while (! reported.empty() && isspace((unsigned char)reported.back())) {
+		reported.pop_back();
+	}
+	Error::raise(Error::Status::MP3CodecError, reported.empty() ? message : reported);
+}
+
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Decoder ///////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -73,29 +134,28 @@ bool check_id3_tag_word(u_int32_t word) {
 	return memcmp((void *)&word, "ID3", 3) == 0;
 }
 
-void skip_id3_sections(std::ifstream &input) {
-	u_int32_t dword;
+void skip_id3_sections(Source &input) {
 	bool stop = false;
 
 	do {
-		std::streampos pos = input.tellg();
-
-		input.read((char *)&dword, sizeof(dword));
+		size_t len = sizeof(ID3V2Header);
+		const char *data = input.peek(len);
 
-		if (input.fail() || (uint)input.gcount() < sizeof(dword)) {
+		if (len < sizeof(u_int32_t)) {
 			Error::raise(Error::Status::IOError);
 		}
 
-		input.seekg(pos);
+		u_int32_t dword;
+		memcpy(&dword, data, sizeof(dword));
 
 		if (check_id3_tag_word(dword)) {
 			ID3V2Header id3v2_header;
-			input.read((char *)&id3v2_header, sizeof(id3v2_header));
-			if (input.fail() || (uint)input.gcount() < sizeof(id3v2_header)) {
+			if (len < sizeof(id3v2_header)) {
 				Error::raise(Error::Status::IOError);
 			}
-			id3v2_header.size = unsynchsafe(id3v2_header.size);
-			input.seekg(id3v2_header.size, std::ifstream::cur);
+			memcpy(&id3v2_header, data, sizeof(id3v2_header));
+			input.consume(sizeof(id3v2_header));
+			input.skip(unsynchsafe(id3v2_header.size));
 		} else {
 			stop = true;
 		}
@@ -106,38 +166,76 @@ bool check_album_id_word(u_int32_t word) {
 	return memcmp((void *)&word, "AiD\1", sizeof(word)) == 0;
 }
 
-void skip_album_id_section(std::ifstream &input) {
-	u_int32_t dword;
+void skip_album_id_section(Source &input) {
 	bool stop = false;
 
 	do {
-		std::streampos pos = input.tellg();
+		size_t len = sizeof(u_int32_t) + sizeof(u_int16_t);
+		const char *data = input.peek(len);
 
-		input.read((char *)&dword, sizeof(dword));
-		if (input.fail() || (uint)input.gcount() < sizeof(dword)) {
+		if (len < sizeof(u_int32_t)) {
 			Error::raise(Error::Status::IOError);
 		}
 
+		u_int32_t dword;
+		memcpy(&dword, data, sizeof(dword));
+
 		if (check_album_id_word(dword)) {
 			u_int16_t section_size;
-			input.read((char *)&section_size, sizeof(section_size));
-			if (input.fail() || (uint) input.gcount() < sizeof(section_size)) {
+			if (len < sizeof(dword) + sizeof(section_size)) {
 				Error::raise(Error::Status::IOError);
 			}
+			memcpy(&section_size, data + sizeof(dword), sizeof(section_size));
 #if ! defined (BOOST_LITTLE_ENDIAN)
 			section_size = bswap_16(section_size);
 #endif
-			input.seekg(section_size - 6, std::ifstream::cur);
+			if (section_size < len) {
+				Error::raise(Error::Status::MP3CodecError, "Bad album id section.");
+			}
+			input.skip(section_size);
 		} else {
-			input.seekg(pos);
 			stop = true;
 		}
 	} while (! stop);
 }
 
+#define MP3_DECODE_INPUT_BUFFER_SIZE 4096
+#define MP3_DECODE_FRAME_SIZE        1152
+
+// LAME can not reset a decoder: hip_decode1_headers keeps the tags and the
+// bit reservoir of the previous stream. The session keeps the pcm buffers,
+// a decoder is initialised for each stream.
+struct MP3DecoderSession : public Decoder::Session {
+	hip_global_flags *hip;
+	int16_t pcm[2][MP3_DECODE_FRAME_SIZE];
+
+	MP3DecoderSession() :
+		hip(nullptr) {
+	}
+
+	virtual ~MP3DecoderSession() {
+		if (hip != nullptr) hip_decode_exit(hip);
+	}
+
+	void reset() {
+		if (hip != nullptr) {
+			hip_decode_exit(hip);
+		}
+		{
+			std::lock_guard<std::mutex> lock(lame_setup_mutex);
+			hip = hip_decode_init();
+		}
+		if (hip == nullptr) {
+			Error::raise(Error::Status::MP3CodecError, "Failed to init lame decoder.");
+		}
+		hip_set_errorf(hip, error_handler);
+		hip_set_debugf(hip, debug_handler);
+		hip_set_msgf  (hip, message_handler);
+	}
+};
+
 struct RAII_MP3DecoderData {
-	std::ifstream &input;
-	std::ifstream::iostate input_state;
+	Source &input;
 	hip_global_flags *hip;
 	mp3data_struct format;
 	int16_t *pcm_buffer[2];
@@ -145,31 +243,23 @@ struct RAII_MP3DecoderData {
 	int enc_padding;
 	Buffer *audio_buffer;
 
-	RAII_MP3DecoderData(std::ifstream &in) :
+	RAII_MP3DecoderData(Source &in, MP3DecoderSession &session) :
 		input(in) {
 
-		input_state = input.exceptions();
-		input.exceptions(std::ifstream::badbit);
-
-		if ((hip = hip_decode_init()) == nullptr) {
-			Error::raise(Error::Status::MP3CodecError, "Failed to init lame encoder.");
-		}
+		session.reset();
+		hip = session.hip;
 
 		memset(&format, 0, sizeof(format));
 
-		pcm_buffer[0] = new int16_t[1152];
-		pcm_buffer[1] = new int16_t[1152];
+		pcm_buffer[0] = session.pcm[0];
+		pcm_buffer[1] = session.pcm[1];
 		enc_delay = enc_padding = 0;
 
 		audio_buffer = nullptr;
 	}
 
 	virtual ~RAII_MP3DecoderData() {
-		input.exceptions(input_state);
 		if (audio_buffer != nullptr) delete audio_buffer;
-		if (hip != nullptr) hip_decode_exit(hip);
-		delete pcm_buffer[0];
-		delete pcm_buffer[1];
 	}
 };
 
@@ -185,23 +275,53 @@ do { \
 #	define DEBUG_MP3_FORMAT_HEADER(...)
 #endif
 
-Buffer * MP3Decoder::decode(std::ifstream &input) const {
-	RAII_MP3DecoderData decode_data(input);
+// The input is peeked, not copied: memory and mapped sources hand their
+// own storage to LAME. Consume it once LAME has taken it.
+unsigned char * peek_input(Source &input, size_t &size, Statistics *statistics) {
+	Statistics::Scope scope(statistics, Statistics::Phase::IO);
+	Trace::Span span("mp3.read", "io");
+	unsigned char *data = (unsigned char *)input.peek(size);
+	if (statistics) statistics->bytesRead += size;
+	return data;
+}
+
+Decoder::Session * MP3Decoder::session() const {
+	return new MP3DecoderSession;
+}
+
+Buffer * MP3Decoder::decode(Source &input) const {
+	PooledSession session(*this);
+	return decode(input, *session);
+}
+
+Buffer * MP3Decoder::decode(Source &input, Session &session) const {
+	MP3DecoderSession *mp3_session = dynamic_cast<MP3DecoderSession *>(&session);
+	if (mp3_session == nullptr) {
+		Error::raise(Error::Status::FormatBadValue, "Not an MP3 decoder session.");
+	}
+
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	clear_lame_error();
+	RAII_MP3DecoderData decode_data(input, *mp3_session);
 
 	skip_id3_sections(input);
 	skip_album_id_section(input);
 
-	uint8_t buffer[512];
-	int len, offset = 0, ret = 0;
+	Requantizer requantizer(dither());
+	unsigned char *buffer;
+	size_t len;
+	int offset = 0, ret = 0;
 
 	while (decode_data.format.header_parsed == 0) {
-		input.read((char *)buffer, sizeof(buffer));
-		len = input.gcount();
+		len = MP3_DECODE_INPUT_BUFFER_SIZE;
+		buffer = peek_input(input, len, stats);
 
 		if (len == 0) {
 			Error::raise(Error::Status::IOError, "The file is truncated.");
 		}
 
+		Statistics::Scope scope(stats, Statistics::Phase::Codec);
 		if ((ret = hip_decode1_headersB(
 				decode_data.hip, buffer, len,
 				decode_data.pcm_buffer[0], 
@@ -209,8 +329,9 @@ Buffer * MP3Decoder::decode(std::ifstream &input) const {
 				&decode_data.format, 
 				&decode_data.enc_delay, 
 				&decode_data.enc_padding)) < 0) {
-			Error::raise(Error::Status::MP3CodecError);
+			raise_lame_error("Failed to decode an MP3 header.");
 		}
+		input.consume(len);
 	}
 
 	if (decode_data.format.bitrate == 0) {
@@ -220,35 +341,44 @@ Buffer * MP3Decoder::decode(std::ifstream &input) const {
 	DEBUG_MP3_FORMAT_HEADER(decode_data.format);
 
 	decode_data.audio_buffer =
-		new Buffer(
+		new Buffer(outputFormat(
 			Format((unsigned int)decode_data.format.stereo, 
 				(unsigned int)decode_data.format.samplerate, 
-				16));
+				16)));
 
-	len = 0;
-	if ((ret = hip_decode1_headers(
-			decode_data.hip, buffer, len,
-			decode_data.pcm_buffer[0], decode_data.pcm_buffer[1],
-			&decode_data.format)) < 0) {
-		Error::raise(Error::Status::MP3CodecError);
+	if (ret > 0) {
+		write(*decode_data.audio_buffer, offset, ret, (const int16_t **)decode_data.pcm_buffer, requantizer);
+		offset += ret;
 	}
 
-	decode_data.audio_buffer->write(offset, ret, (const int16_t **)decode_data.pcm_buffer);
-	offset += ret;
-
+	// LAME outputs at most one frame per call: after each read, call it
+	// again without input until it has no complete frame left.
 	do {
-		input.read((char *)buffer, sizeof(buffer));
-		len = input.gcount();
+		len = MP3_DECODE_INPUT_BUFFER_SIZE;
+		buffer = peek_input(input, len, stats);
+
+		size_t input_len = len;
+		do {
+			{
+				Statistics::Scope scope(stats, Statistics::Phase::Codec);
+				Trace::Span span("mp3.decode", "codec");
+				if ((ret = hip_decode1_headers(
+						decode_data.hip, buffer, input_len,
+						decode_data.pcm_buffer[0], decode_data.pcm_buffer[1],
+						&decode_data.format)) < 0) {
+					raise_lame_error("Failed to decode an MP3 frame.");
+				}
+			}
+			input_len = 0;
 
-		if ((ret = hip_decode1_headers(
-				decode_data.hip, buffer, len,
-				decode_data.pcm_buffer[0], decode_data.pcm_buffer[1],
-				&decode_data.format)) < 0) {
-			Error::raise(Error::Status::MP3CodecError);
-		}
+			if (ret > 0) {
+				write(*decode_data.audio_buffer, offset, ret, (const int16_t **)decode_data.pcm_buffer, requantizer);
+				offset += ret;
+			}
+		} while (ret > 0);
 
-		decode_data.audio_buffer->write(offset, ret, (const int16_t **)decode_data.pcm_buffer);
-		offset += ret;
+		input.consume(len);
+		Job::checkpoint(input);
 	} while (len > 0);
 
 	Buffer *audio_buffer = decode_data.audio_buffer;
@@ -271,55 +401,46 @@ int lame_quality(Coder::Quality quality) {
 	return 0;
 }
 
-#define ERR_HANDLER_DEFAULT_BUFFER_SIZE 128
 #define MP3_ENCODE_INPUT_BUFFER_SIZE   1024
+#define MP3_ENCODE_OUTPUT_BUFFER_SIZE  (5*MP3_ENCODE_INPUT_BUFFER_SIZE/4 + 7200)
 
-void error_handler(const char *fmt, va_list ap) {
-	char **buffer = nullptr;
-	size_t buffer_size = ERR_HANDLER_DEFAULT_BUFFER_SIZE;
-	bool again;
-	do {
-		size_t written;
-		*buffer = (char *)realloc(*buffer, buffer_size);
-
-		written = vsnprintf(*buffer, buffer_size, fmt, ap);
+// LAME can not reset an encoder nor set its parameters twice. The session
+// keeps the input and output buffers, an encoder is initialised for each
+// stream.
+struct MP3CoderSession : public Coder::Session {
+	std::vector<float> input;
+	std::vector<unsigned char> output;
 
-		if (written >= buffer_size) {
-			again = true;
-			buffer_size = written;
-		} else {
-			again = false;
-		}
-	} while (again);
-	Error::raise(Error::Status::MP3CodecError, std::string(*buffer));
-}
-
-#if defined(DEBUG)
-void debug_handler(const char *, va_list ap) {
-	fvprintf(stderr, "%s\n", ap);
-}
-
-void message_handler(const char *, va_list) {
-	fvprintf(stderr, "%s\n", ap);
-}
-#else
-void debug_handler(const char *, va_list) {}
-void message_handler(const char *, va_list) {}
-#endif
+	MP3CoderSession() :
+		output(MP3_ENCODE_OUTPUT_BUFFER_SIZE) {
+	}
+};
 
 struct RAII_MP3CoderData {
-	std::ofstream &output;
-	std::ofstream::iostate output_state;
+	Sink &output;
 	lame_t gfp;
-	int mp3_output_buffer_size, mp3_input_buffer_size;
-	char *mp3_output_buffer;
+	int mp3_output_buffer_size;
+	unsigned char *mp3_output_buffer;
 	float *mp3_input_buffer;
 
-	RAII_MP3CoderData(const MP3Coder &coder, const Buffer &buffer, std::ofstream &out) :
+	RAII_MP3CoderData(const MP3Coder &coder, const Buffer &buffer, Sink &out, MP3CoderSession &session, Statistics *statistics) :
 		output(out) {
 
-		output_state = output.exceptions();
-		output.exceptions(std::ofstream::failbit | std::ofstream::badbit );
+		Format format = buffer.format();
+		size_t input_size = format.channelCount()*MP3_ENCODE_INPUT_BUFFER_SIZE;
+
+		if (session.input.capacity() < input_size && statistics) {
+			statistics->allocation(input_size*sizeof(float));
+		}
+		session.input.resize(input_size);
+		mp3_input_buffer = session.input.data();
+
+		// lame_encode_buffer needs 1.25*sample count + 7200 bytes per
+		// call, whatever the length of the stream.
+		mp3_output_buffer = session.output.data();
+		mp3_output_buffer_size = session.output.size();
+
+		std::lock_guard<std::mutex> lock(lame_setup_mutex);
 
 		if ((gfp = lame_init()) == nullptr) {
 			Error::raise(Error::Status::MP3CodecError, "Failed to init lame encoder.");
@@ -329,67 +450,97 @@ struct RAII_MP3CoderData {
 		lame_set_debugf(gfp, debug_handler);
 		lame_set_msgf  (gfp, message_handler);
 
-		Format format = buffer.format();
-
-		mp3_output_buffer_size = 1.25*buffer.frameCount() + 7200;
-		mp3_output_buffer = 
-			new char[mp3_output_buffer_size];
-
-		mp3_input_buffer_size = format.channelCount()*MP3_ENCODE_INPUT_BUFFER_SIZE;
-		mp3_input_buffer = 
-			new float[mp3_input_buffer_size];
-
 		lame_set_num_channels(gfp, format.channelCount());
 		lame_set_in_samplerate(gfp, format.sampleRate());
 		lame_set_quality(gfp, lame_quality(coder.quality()));
 		lame_set_bWriteVbrTag(gfp, 0);
 
-		lame_init_params(gfp);
+		if (lame_init_params(gfp) < 0) {
+			lame_close(gfp);
+			raise_lame_error("Failed to init lame encoder.");
+		}
 	}
 
 	virtual ~RAII_MP3CoderData( ) {
-		if (gfp != nullptr) {
-			lame_close(gfp);
-			delete[] mp3_output_buffer;
-			delete[] mp3_input_buffer;
-		}
-		output.exceptions(output_state);
+		if (gfp != nullptr) lame_close(gfp);
 	}
 };
 
-void MP3Coder::encode(const Buffer &buffer, std::ofstream &out) const {
-	RAII_MP3CoderData encode_data(*this, buffer, out);
+Coder::Session * MP3Coder::session() const {
+	return new MP3CoderSession;
+}
+
+void MP3Coder::encode(const Buffer &buffer, Sink &out) const {
+	PooledSession session(*this);
+	encode(buffer, out, *session);
+}
+
+void MP3Coder::encode(const Buffer &buffer, Sink &out, Session &session) const {
+	MP3CoderSession *mp3_session = dynamic_cast<MP3CoderSession *>(&session);
+	if (mp3_session == nullptr) {
+		Error::raise(Error::Status::FormatBadValue, "Not an MP3 coder session.");
+	}
+
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	clear_lame_error();
+	RAII_MP3CoderData encode_data(*this, buffer, out, *mp3_session, stats);
 
 	unsigned int offset = 0;
 	int nbytes;
 
 	do {
-		unsigned int count = buffer.read(offset, MP3_ENCODE_INPUT_BUFFER_SIZE, encode_data.mp3_input_buffer);
-
-		nbytes = lame_encode_buffer_interleaved_ieee_float(
-				encode_data.gfp, 
-				encode_data.mp3_input_buffer, 
-				count,
-				(unsigned char *)encode_data.mp3_output_buffer,
-				encode_data.mp3_output_buffer_size);
+		unsigned int count;
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Conversion);
+			count = buffer.read(offset, MP3_ENCODE_INPUT_BUFFER_SIZE, encode_data.mp3_input_buffer);
+		}
+		analyze(buffer, offset, count);
+
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Codec);
+			Trace::Span span("mp3.encode", "codec");
+			nbytes = lame_encode_buffer_interleaved_ieee_float(
+					encode_data.gfp, 
+					encode_data.mp3_input_buffer, 
+					count,
+					encode_data.mp3_output_buffer,
+					encode_data.mp3_output_buffer_size);
+		}
 
 		if (nbytes >= 0) {
+			Statistics::Scope scope(stats, Statistics::Phase::IO);
 			out.write((char *)encode_data.mp3_output_buffer, nbytes);
 		} else {
-			Error::raise(Error::Status::MP3CodecError,
-				(boost::format("Lame encode error code: %1%") % nbytes).str());
+			raise_lame_error((boost::format("Lame encode error code: %1%") % nbytes).str());
+		}
+
+		if (stats) {
+			stats->framesProcessed += count;
+			stats->bytesWritten += nbytes;
 		}
 
 		offset += count;
+		Job::checkpoint(offset, buffer.frameCount());
 	} while (offset < buffer.frameCount());
 
-	nbytes = lame_encode_flush(encode_data.gfp,
-				(unsigned char *)encode_data.mp3_output_buffer,
-				encode_data.mp3_output_buffer_size);
+	{
+		Statistics::Scope scope(stats, Statistics::Phase::Codec);
+		nbytes = lame_encode_flush(encode_data.gfp,
+					encode_data.mp3_output_buffer,
+					encode_data.mp3_output_buffer_size);
+	}
 
 	if (nbytes >= 0) {
+		Statistics::Scope scope(stats, Statistics::Phase::IO);
 		out.write((char *)encode_data.mp3_output_buffer, nbytes);
+		if (stats) stats->bytesWritten += nbytes;
+	} else {
+		raise_lame_error((boost::format("Lame flush error code: %1%") % nbytes).str());
 	}
+
+	Statistics::Scope scope(stats, Statistics::Phase::IO);
+	out.flush();
 }
 
 } /* namespace audio */
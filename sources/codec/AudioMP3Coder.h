@@ -17,7 +17,9 @@ class Buffer;
 class MP3Coder : public Coder {
 public:
 	using Coder::encode;
-	virtual void encode(const Buffer &, std::ofstream &) const;
+	virtual void encode(const Buffer &, Sink &) const;
+	virtual Session * session() const;
+	virtual void encode(const Buffer &, Sink &, Session &) const;
 };
 } /* namespace audio */
 } /* namespace nealrame */
@@ -12,11 +12,13 @@ extern "C" {
 #	include <vorbis/vorbisenc.h>
 }
 
+#include <atomic>
 #include <cstring>
 #include <cstdint>
-#include <ctime>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <vector>
 
 #include <boost/format.hpp>
 #include <boost/detail/endian.hpp>
@@ -24,6 +26,11 @@ extern "C" {
 #include "../AudioError.h"
 #include "../AudioBuffer.h"
 #include "../AudioFormat.h"
+#include "../AudioJob.h"
+#include "../AudioStatistics.h"
+#include "../AudioTrace.h"
+#include "../io/AudioSink.h"
+#include "../io/AudioSource.h"
 
 #include "AudioOggVorbisCoder.h"
 #include "AudioOggVorbisDecoder.h"
@@ -105,30 +112,79 @@ float vorbis_quality(Coder::Quality quality) {
 // Decoder ///////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-struct RAII_OggDecodeData;
-void decode_ogg_page_out(RAII_OggDecodeData &, ogg_page &);
-void decode_ogg_packet_out(RAII_OggDecodeData &, ogg_packet &);
-
-struct RAII_OggDecodeData {
-	std::ifstream &input;
-	std::ifstream::iostate input_state;
+#define OGG_DECODE_INPUT_BUFFER_SIZE 8192
 
+struct RAII_OggDecodeData;
+bool decode_ogg_page_out(RAII_OggDecodeData &, ogg_page &);
+bool decode_ogg_packet_out(RAII_OggDecodeData &, ogg_packet &);
+
+// The session keeps the ogg buffers and, while the streams decoded share
+// their identification and setup headers (same encoder, channel count,
+// sample rate and quality), the vorbis decoder with its codebooks: it is
+// only restarted.
+struct OggVorbisDecoderSession : public Decoder::Session {
 	ogg_sync_state o_sync;
 	ogg_stream_state o_state;
 
-	RAII_OggDecodeData(std::ifstream &in) :
-		input(in) {
-		input_state = input.exceptions();
-		input.exceptions(std::ifstream::badbit);
+	vorbis_info v_info;
+	vorbis_comment v_comment;
+	vorbis_dsp_state v_dsp;
+	vorbis_block v_block;
+	bool synthesis;                         // v_dsp and v_block are initialised
+	std::vector<unsigned char> headers[3];  // the headers v_info is built from
 
+	OggVorbisDecoderSession() :
+		synthesis(false) {
 		ogg_sync_init(&o_sync);
+		if (ogg_stream_init(&o_state, 0) < 0) {
+			ogg_sync_clear(&o_sync);
+			Error::raise(Error::Status::OggVorbisError, "Ogg internal error.");
+		}
+		vorbis_info_init(&v_info);
+		vorbis_comment_init(&v_comment);
+	}
 
-		ogg_page page;
-		decode_ogg_page_out(*this, page);
+	virtual ~OggVorbisDecoderSession() {
+		clearSynthesis();
+		vorbis_comment_clear(&v_comment);
+		vorbis_info_clear(&v_info);
+		ogg_stream_clear(&o_state);
+		ogg_sync_clear(&o_sync);
+	}
 
-		int stream_serial = ogg_page_serialno(&page);
+	void clearSynthesis() {
+		if (synthesis) {
+			vorbis_block_clear(&v_block);
+			vorbis_dsp_clear(&v_dsp);
+			synthesis = false;
+		}
+	}
+};
+
+struct RAII_OggDecodeData {
+	Source &input;
+	Statistics *statistics;
+	bool direct;                            // pages parsed in place
+	size_t page_size;                       // last in place page, consumed on the next read
+
+	ogg_sync_state &o_sync;
+	ogg_stream_state &o_state;
+
+	RAII_OggDecodeData(Source &in, OggVorbisDecoderSession &session, Statistics *stats) :
+		input(in),
+		statistics(stats),
+		direct(true),
+		page_size(0),
+		o_sync(session.o_sync),
+		o_state(session.o_state) {
+		ogg_sync_reset(&o_sync);
 
-		if (ogg_stream_init(&o_state, stream_serial) < 0) {
+		ogg_page page;
+		if (! decode_ogg_page_out(*this, page)) {
+			Error::raise(Error::Status::OggVorbisError, "Failed to read an Ogg page.");
+		}
+
+		if (ogg_stream_reset_serialno(&o_state, ogg_page_serialno(&page)) < 0) {
 			Error::raise(Error::Status::OggVorbisError, "Ogg internal error.");
 		}
 
@@ -136,44 +192,60 @@ struct RAII_OggDecodeData {
 			Error::raise(Error::Status::OggVorbisError, "Ogg internal error.");
 		}
 	}
-
-	virtual ~RAII_OggDecodeData( ) {
-		input.exceptions(input_state);
-		ogg_sync_clear(&o_sync);
-		ogg_stream_clear(&o_state);
-	}
 };
 
 struct RAII_VorbisDecodeData {
-	vorbis_info v_state;
-	vorbis_comment v_comment;
-	vorbis_dsp_state v_dsp;
-	vorbis_block v_block;
+	vorbis_info &v_state;
+	vorbis_dsp_state &v_dsp;
+	vorbis_block &v_block;
 	Buffer *buffer;
 
-	RAII_VorbisDecodeData(RAII_OggDecodeData &ogg_decode_data) {
-		int status;
-
-		buffer = nullptr;
-
-		vorbis_info_init(&v_state);
-		vorbis_comment_init(&v_comment);
-
-		ogg_packet packet;
+	RAII_VorbisDecodeData(RAII_OggDecodeData &ogg_decode_data, OggVorbisDecoderSession &session) :
+		v_state(session.v_info),
+		v_dsp(session.v_dsp),
+		v_block(session.v_block),
+		buffer(nullptr) {
+		// The packets point in the ogg buffers, or in the input: keep a
+		// copy of the headers to compare them with the next stream ones.
+		std::vector<unsigned char> headers[3];
+		for (std::vector<unsigned char> &header : headers) {
+			ogg_packet packet;
+			if (! decode_ogg_packet_out(ogg_decode_data, packet)) {
+				Error::raise(Error::Status::OggVorbisError, "Failed to read Ogg packet.");
+			}
+			header.assign(packet.packet, packet.packet + packet.bytes);
+		}
 
-		decode_ogg_packet_out(ogg_decode_data, packet);
-		if ((status = vorbis_synthesis_headerin(&v_state, &v_comment, &packet)) < 0) {
-			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+		// The comment header does not change the decoder.
+		if (session.synthesis && headers[0] == session.headers[0] && headers[2] == session.headers[2]) {
+			if (vorbis_synthesis_restart(&v_dsp) != 0) {
+				session.clearSynthesis();
+				Error::raise(Error::Status::OggVorbisError, "Vorbis internal error.");
+			}
+			return;
 		}
 
-		decode_ogg_packet_out(ogg_decode_data, packet);
-		if ((status = vorbis_synthesis_headerin(&v_state, &v_comment, &packet)) < 0) {
-			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+		session.clearSynthesis();
+		vorbis_comment_clear(&session.v_comment);
+		vorbis_info_clear(&v_state);
+		vorbis_info_init(&v_state);
+		vorbis_comment_init(&session.v_comment);
+		for (std::vector<unsigned char> &header : session.headers) {
+			header.clear();
 		}
 
-		decode_ogg_packet_out(ogg_decode_data, packet);
-		if ((status = vorbis_synthesis_headerin(&v_state, &v_comment, &packet)) < 0) {
-			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+		for (int i = 0; i < 3; ++i) {
+			ogg_packet packet;
+			int status;
+
+			memset(&packet, 0, sizeof(packet));
+			packet.packet = headers[i].data();
+			packet.bytes = headers[i].size();
+			packet.b_o_s = i == 0;
+			packet.packetno = i;
+			if ((status = vorbis_synthesis_headerin(&v_state, &session.v_comment, &packet)) < 0) {
+				Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+			}
 		}
 
 		if (vorbis_synthesis_init(&v_dsp, &v_state) != 0) {
@@ -181,47 +253,149 @@ struct RAII_VorbisDecodeData {
 		}
 
 		if (vorbis_block_init(&v_dsp, &v_block) != 0) {
+			vorbis_dsp_clear(&v_dsp);
 			Error::raise(Error::Status::OggVorbisError, "Vorbis internal error.");
 		}
 
-		buffer = new Buffer(Format(v_state.channels, v_state.rate, 16));
+		session.synthesis = true;
+		for (int i = 0; i < 3; ++i) {
+			session.headers[i].swap(headers[i]);
+		}
 	}
 
 	virtual ~RAII_VorbisDecodeData() {
 		if (buffer != nullptr) delete buffer;
-		vorbis_block_clear(&v_block);
-		vorbis_dsp_clear(&v_dsp);
-		vorbis_info_clear(&v_state);
-		vorbis_comment_clear(&v_comment);
 	}
 };
 
-void decode_ogg_page_out(RAII_OggDecodeData &decode_data, ogg_page &page) {
-	std::ifstream &input = decode_data.input;
+#define OGG_PAGE_HEADER_SIZE 27
+
+uint32_t ogg_crc(uint32_t crc, const unsigned char *data, size_t size) {
+	static const struct Table {
+		uint32_t values[256];
+		Table() {
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t r = i << 24;
+				for (int j = 0; j < 8; ++j) {
+					r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : r << 1;
+				}
+				values[i] = r;
+			}
+		}
+	} table;
+
+	for (size_t i = 0; i < size; ++i) {
+		crc = (crc << 8) ^ table.values[(crc >> 24) ^ data[i]];
+	}
+	return crc;
+}
+
+// Parse the page at the current position of the input in place: the page
+// points in the peeked bytes (in the mapping for mapped and memory sources)
+// instead of being copied in the ogg_sync buffer. Return false if the
+// bytes are not a valid page, the caller then resyncs with ogg_sync.
+bool decode_ogg_page_in_place(RAII_OggDecodeData &decode_data, ogg_page &page, bool &end) {
+	Source &input = decode_data.input;
+	const unsigned char *data;
+	size_t size = OGG_PAGE_HEADER_SIZE;
+
+	Statistics::Scope scope(decode_data.statistics, Statistics::Phase::IO);
+	Trace::Span span("ogg.read", "io");
+
+	data = (const unsigned char *)input.peek(size);
+	if ((end = size == 0)) {
+		return false;
+	}
+	if (size < OGG_PAGE_HEADER_SIZE || memcmp(data, "OggS", 4) != 0 || data[4] != 0) {
+		return false;
+	}
+
+	size_t header_size = OGG_PAGE_HEADER_SIZE + data[26];
+	size = header_size;
+	data = (const unsigned char *)input.peek(size);
+	if (size < header_size) {
+		return false;
+	}
+
+	size_t body_size = 0;
+	for (size_t i = OGG_PAGE_HEADER_SIZE; i < header_size; ++i) {
+		body_size += data[i];
+	}
+	size = header_size + body_size;
+	data = (const unsigned char *)input.peek(size);
+	if (size < header_size + body_size) {
+		return false;
+	}
+
+	static const unsigned char zero[4] = { 0, 0, 0, 0 };
+	uint32_t crc = ogg_crc(0, data, 22);
+	crc = ogg_crc(crc, zero, 4);
+	crc = ogg_crc(crc, data + 26, size - 26);
+	if (crc != (data[22] | (data[23] << 8) | (data[24] << 16) | ((uint32_t)data[25] << 24))) {
+		return false;
+	}
+
+	page.header = (unsigned char *)data;
+	page.header_len = header_size;
+	page.body = (unsigned char *)data + header_size;
+	page.body_len = body_size;
+	decode_data.page_size = size;
+	if (decode_data.statistics) decode_data.statistics->bytesRead += size;
+	return true;
+}
+
+// Return false at the end of the input.
+bool decode_ogg_page_out(RAII_OggDecodeData &decode_data, ogg_page &page) {
 	ogg_sync_state *o_sync =  &decode_data.o_sync;
 
+	// The previous in place page has been submitted to the stream.
+	decode_data.input.consume(decode_data.page_size);
+	decode_data.page_size = 0;
+
+	if (decode_data.direct) {
+		bool end;
+		if (decode_ogg_page_in_place(decode_data, page, end)) {
+			return true;
+		}
+		if (end) {
+			return false;
+		}
+		decode_data.direct = false;
+	}
+
 	char *buffer;
-	std::streamsize bytes;
+	size_t bytes;
 	int status;
 
-	while ((status = ogg_sync_pageout(&decode_data.o_sync, &page)) == 0) { // need more data
-		buffer = ogg_sync_buffer(&decode_data.o_sync, 8192);
-		input.read(buffer, 8192);
+	// A negative status means that ogg_sync skipped bytes to resync on the
+	// next page, keep looking for it.
+	while ((status = ogg_sync_pageout(o_sync, &page)) != 1) {
+		if (status < 0) {
+			continue;
+		}
+		buffer = ogg_sync_buffer(o_sync, OGG_DECODE_INPUT_BUFFER_SIZE);
+		{
+			Statistics::Scope scope(decode_data.statistics, Statistics::Phase::IO);
+			Trace::Span span("ogg.read", "io");
+			bytes = decode_data.input.read(buffer, OGG_DECODE_INPUT_BUFFER_SIZE);
+		}
+
+		if (decode_data.statistics) decode_data.statistics->bytesRead += bytes;
 
-		bytes = input.gcount();
+		if (bytes == 0) {
+			return false;
+		}
 
-		if (! (bytes > 0 && ogg_sync_wrote(o_sync, bytes) == 0)) {
-			status = -1;
-			break;
+		if (ogg_sync_wrote(o_sync, bytes) != 0) {
+			Error::raise(Error::Status::OggVorbisError, "Failed to read an Ogg page.");
 		}
 	}
 
-	if (status < 0) {
-		Error::raise(Error::Status::OggVorbisError, "Failed to read an Ogg page.");
-	}
+	return true;
 }
 
-void decode_ogg_packet_out(RAII_OggDecodeData &decode_data, ogg_packet &packet) {
+// Return false at the end of the input.
+bool decode_ogg_packet_out(RAII_OggDecodeData &decode_data, ogg_packet &packet) {
 	ogg_sync_state *o_sync =  &decode_data.o_sync;
 
 	if (ogg_sync_check(o_sync) != 0) {
@@ -230,44 +404,77 @@ void decode_ogg_packet_out(RAII_OggDecodeData &decode_data, ogg_packet &packet)
 
 	ogg_stream_state *o_state = &decode_data.o_state;
 
-	if (ogg_stream_packetout(o_state, &packet) != 1) {
+	while (ogg_stream_packetout(o_state, &packet) != 1) {
 		ogg_page page;
-		decode_ogg_page_out(decode_data, page);
-		if (ogg_stream_pagein(&decode_data.o_state, &page) < 0) {
+		if (! decode_ogg_page_out(decode_data, page)) {
+			return false;
+		}
+		if (ogg_stream_pagein(o_state, &page) < 0) {
 			Error::raise(Error::Status::OggVorbisError, "Failed to read Ogg packet.");
 		}
-		decode_ogg_packet_out(decode_data, packet);
 	}
+
+	return true;
 }
 
-Buffer * OggVorbisDecoder::decode(std::ifstream &in) const {
-	RAII_OggDecodeData ogg_decode_data(in);
-	RAII_VorbisDecodeData vorbis_decode_data(ogg_decode_data);
+Decoder::Session * OggVorbisDecoder::session() const {
+	return new OggVorbisDecoderSession;
+}
+
+Buffer * OggVorbisDecoder::decode(Source &in) const {
+	PooledSession session(*this);
+	return decode(in, *session);
+}
 
+Buffer * OggVorbisDecoder::decode(Source &in, Session &session) const {
+	OggVorbisDecoderSession *ogg_session = dynamic_cast<OggVorbisDecoderSession *>(&session);
+	if (ogg_session == nullptr) {
+		Error::raise(Error::Status::FormatBadValue, "Not an Ogg Vorbis decoder session.");
+	}
+
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	RAII_OggDecodeData ogg_decode_data(in, *ogg_session, stats);
+	RAII_VorbisDecodeData vorbis_decode_data(ogg_decode_data, *ogg_session);
+
+	vorbis_decode_data.buffer =
+		new Buffer(outputFormat(
+			Format(vorbis_decode_data.v_state.channels, vorbis_decode_data.v_state.rate, 16)));
+
+	Requantizer requantizer(dither());
 	int offset = 0;
+	bool end_of_stream = false;
 
-	while (! in.eof()) {
+	while (! end_of_stream) {
 		int status;
 		ogg_packet packet;
+		float **pcm;
+		int count;
 
-		decode_ogg_packet_out(ogg_decode_data, packet);
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Codec);
+			Trace::Span span("ogg.decode", "codec");
 
-		if ((status = vorbis_synthesis(&vorbis_decode_data.v_block, &packet)) < 0) {
-			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
-		}
+			if (! decode_ogg_packet_out(ogg_decode_data, packet)) {
+				break;
+			}
+			end_of_stream = packet.e_o_s != 0;
 
-		if ((status = vorbis_synthesis_blockin(&vorbis_decode_data.v_dsp, &vorbis_decode_data.v_block)) < 0) {
-			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+			if ((status = vorbis_synthesis(&vorbis_decode_data.v_block, &packet)) < 0) {
+				Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+			}
+
+			if ((status = vorbis_synthesis_blockin(&vorbis_decode_data.v_dsp, &vorbis_decode_data.v_block)) < 0) {
+				Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+			}
 		}
 
-		float **pcm;
-		int count;
-		
 		while ((count = vorbis_synthesis_pcmout(&vorbis_decode_data.v_dsp, &pcm)) > 0) {
-			vorbis_decode_data.buffer->write((unsigned int)offset, (unsigned int)count, (const float **)pcm);
+			write(*vorbis_decode_data.buffer, (unsigned int)offset, (unsigned int)count, (const float **)pcm, requantizer);
 			vorbis_synthesis_read(&vorbis_decode_data.v_dsp, count);
 			offset += count;
 		}
+		Job::checkpoint(in);
 	}
 
 	Buffer *buffer = vorbis_decode_data.buffer;
@@ -280,41 +487,87 @@ Buffer * OggVorbisDecoder::decode(std::ifstream &in) const {
 // Coder /////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-struct RAII_OggVorbisCoderData {
-	std::ofstream &output;
-	std::ofstream::iostate output_state;
-
+// The session keeps the ogg stream buffers and the vorbis setup of the
+// last channel count, sample rate and quality encoded, with the codebooks
+// vorbis_analysis_init builds in it on first use. The analysis state is
+// initialised for each stream.
+struct OggVorbisCoderSession : public Coder::Session {
 	ogg_stream_state o_state;
 
 	vorbis_info v_info;
+	bool configured;                        // v_info is set up for:
+	int channels;
+	int rate;
+	float quality;
+
+	OggVorbisCoderSession() :
+		configured(false),
+		channels(0),
+		rate(0),
+		quality(0) {
+		if (ogg_stream_init(&o_state, 0) < 0) {
+			Error::raise(Error::Status::OggVorbisError, "Ogg internal error.");
+		}
+		vorbis_info_init(&v_info);
+	}
+
+	virtual ~OggVorbisCoderSession() {
+		vorbis_info_clear(&v_info);
+		ogg_stream_clear(&o_state);
+	}
+
+	void configure(int channels, int rate, float quality) {
+		if (configured
+				&& this->channels == channels
+				&& this->rate == rate
+				&& this->quality == quality) {
+			return;
+		}
+
+		int status;
+
+		configured = false;
+		vorbis_info_clear(&v_info);
+		vorbis_info_init(&v_info);
+		if ((status = vorbis_encode_init_vbr(&v_info, channels, rate, quality)) < 0) {
+			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
+		}
+		configured = true;
+		this->channels = channels;
+		this->rate = rate;
+		this->quality = quality;
+	}
+};
+
+struct RAII_OggVorbisCoderData {
+	Sink &output;
+	Statistics *statistics;
+
+	ogg_stream_state &o_state;
+
 	vorbis_dsp_state v_dsp;
 	vorbis_comment v_comment;
 	vorbis_block v_block;
 
-	RAII_OggVorbisCoderData(const OggVorbisCoder &ov_coder, const Buffer &buffer, std::ofstream &out) :
-		output(out) {
-
-		output_state = output.exceptions();
-		output.exceptions(std::ofstream::failbit | std::ofstream::badbit );
+	RAII_OggVorbisCoderData(const OggVorbisCoder &ov_coder, const Buffer &buffer, Sink &out, OggVorbisCoderSession &session) :
+		output(out),
+		statistics(ov_coder.statistics()),
+		o_state(session.o_state) {
 
-		if (ogg_stream_init(&o_state, (int)time(nullptr)) < 0) {
+		if (ogg_stream_reset_serialno(&o_state, ov_coder.streamSerial()) < 0) {
 			Error::raise(Error::Status::OggVorbisError, "Ogg internal error.");
 		}
 
 		Format format = buffer.format();
-		int status;
 
-		vorbis_info_init(&v_info);
+		session.configure(format.channelCount(), format.sampleRate(), vorbis_quality(ov_coder.quality()));
 
-		if ((status = vorbis_encode_init_vbr(&v_info, format.channelCount(), format.sampleRate(), vorbis_quality(ov_coder.quality()))) < 0) {
-			Error::raise(Error::Status::OggVorbisError, vorbis_error_string(status));
-		}
-		
-		if (vorbis_analysis_init(&v_dsp, &v_info) != 0) {
+		if (vorbis_analysis_init(&v_dsp, &session.v_info) != 0) {
 			Error::raise(Error::Status::OggVorbisError, "Vorbis internal error.");
 		}
-		
+
 		if (vorbis_block_init(&v_dsp, &v_block) != 0) {
+			vorbis_dsp_clear(&v_dsp);
 			Error::raise(Error::Status::OggVorbisError, "Vorbis internal error.");
 		}
 
@@ -325,19 +578,20 @@ struct RAII_OggVorbisCoderData {
 
 	virtual ~RAII_OggVorbisCoderData( ) {
 		vorbis_comment_clear(&v_comment);
+		vorbis_block_clear(&v_block);
 		vorbis_dsp_clear(&v_dsp);
-		vorbis_info_clear(&v_info);
-		ogg_stream_clear(&o_state);
-		output.exceptions(output_state);
 	}
 };
 
-void encode_write_ogg_page(ogg_page &page, std::ostream &out) {
-	try {
-		out.write((const char *)page.header, page.header_len);
-		out.write((const char *)page.body,   page.body_len);
-	} catch (std::ofstream::failure ioerr) {
-		Error::raise(Error::Status::IOError, ioerr.what());
+void encode_write_ogg_page(RAII_OggVorbisCoderData &encode_data, ogg_page &page) {
+	Statistics::Scope scope(encode_data.statistics, Statistics::Phase::IO);
+	struct iovec chunks[2] = {
+		{ page.header, (size_t)page.header_len },
+		{ page.body,   (size_t)page.body_len },
+	};
+	encode_data.output.write(chunks, 2);
+	if (encode_data.statistics) {
+		encode_data.statistics->bytesWritten += page.header_len + page.body_len;
 	}
 }
 
@@ -357,7 +611,7 @@ void encode_header(RAII_OggVorbisCoderData &encode_data) {
 	}
 
 	while (ogg_stream_flush(&encode_data.o_state, &page)) {
-		encode_write_ogg_page(page, encode_data.output);
+		encode_write_ogg_page(encode_data, page);
 	}
 }
 
@@ -365,7 +619,7 @@ void encode_flush(RAII_OggVorbisCoderData &encode_data) {
 	ogg_page page;
 
 	while (ogg_stream_flush(&encode_data.o_state, &page)) {
-		encode_write_ogg_page(page, encode_data.output);
+		encode_write_ogg_page(encode_data, page);
 	}
 }
 
@@ -383,11 +637,12 @@ void encode_samples(RAII_OggVorbisCoderData &encode_data) {
 	}
 
 	while (ogg_stream_pageout(&encode_data.o_state, &page)) {
-		encode_write_ogg_page(page, encode_data.output);
+		encode_write_ogg_page(encode_data, page);
 	}
 }
 
 void encode_samples(RAII_OggVorbisCoderData &encode_data, unsigned int count) {
+	Trace::Span span("ogg.encode_samples", "codec");
 	int status;
 
 	if ((status = vorbis_analysis_wrote(&encode_data.v_dsp, count)) < 0) {
@@ -403,22 +658,83 @@ void encode_samples(RAII_OggVorbisCoderData &encode_data, unsigned int count) {
 	}
 }
 
-void OggVorbisCoder::encode(const Buffer &buffer, std::ofstream &out) const {
-	RAII_OggVorbisCoderData encode_data(*this, buffer, out);
+OggVorbisCoder::OggVorbisCoder() :
+	_fixedSerial(false),
+	_serial(0) {
+}
+
+// A random start, then a counter spread over the 32 bits by the murmur3
+// finalizer: it is a bijection, so two encodes of the process never share
+// a serial, and consecutive ones look unrelated.
+int OggVorbisCoder::streamSerial() const {
+	static std::atomic<uint32_t> counter(std::random_device{}());
+
+	if (_fixedSerial) {
+		return _serial;
+	}
+
+	uint32_t serial = counter.fetch_add(1, std::memory_order_relaxed);
+	serial ^= serial >> 16;
+	serial *= 0x85ebca6b;
+	serial ^= serial >> 13;
+	serial *= 0xc2b2ae35;
+	serial ^= serial >> 16;
+	return (int)serial;
+}
+
+void OggVorbisCoder::setStreamSerial(int serial) {
+	_fixedSerial = true;
+	_serial = serial;
+}
+
+Coder::Session * OggVorbisCoder::session() const {
+	return new OggVorbisCoderSession;
+}
+
+void OggVorbisCoder::encode(const Buffer &buffer, Sink &out) const {
+	PooledSession session(*this);
+	encode(buffer, out, *session);
+}
+
+void OggVorbisCoder::encode(const Buffer &buffer, Sink &out, Session &session) const {
+	OggVorbisCoderSession *ogg_session = dynamic_cast<OggVorbisCoderSession *>(&session);
+	if (ogg_session == nullptr) {
+		Error::raise(Error::Status::FormatBadValue, "Not an Ogg Vorbis coder session.");
+	}
+
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	RAII_OggVorbisCoderData encode_data(*this, buffer, out, *ogg_session);
 	unsigned int offset = 0;
 
 	encode_header(encode_data);
 	do {
 		float **samples = vorbis_analysis_buffer(&encode_data.v_dsp, 1024);
-		unsigned int count = buffer.read(offset, 1024, samples);
+		unsigned int count;
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Conversion);
+			count = buffer.read(offset, 1024, samples);
+		}
+		analyze(buffer, offset, count);
 
-		encode_samples(encode_data, count);
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::Codec);
+			encode_samples(encode_data, count);
+		}
+		if (stats) stats->framesProcessed += count;
 
 		offset += count;
+		Job::checkpoint(offset, buffer.frameCount());
 	} while (offset < buffer.frameCount());
 
-	encode_samples(encode_data, 0);
-	encode_flush(encode_data);
+	{
+		Statistics::Scope scope(stats, Statistics::Phase::Codec);
+		encode_samples(encode_data, 0);
+		encode_flush(encode_data);
+	}
+
+	Statistics::Scope scope(stats, Statistics::Phase::IO);
+	out.flush();
 }
 
 } /* namespace audio */
@@ -16,8 +16,33 @@ namespace audio {
 class Buffer;
 class OggVorbisCoder : public Coder {
 public:
+	OggVorbisCoder();
+
+public:
+	/**
+	 * * `int streamSerial() const`
+	 *     Get a logical stream serial number for an encode: the one set,
+	 *     or a new one on each call, never the same twice in a process
+	 *     and random across processes, so files encoded in parallel can be
+	 *     chained.
+	 */
+	int streamSerial() const;
+	/**
+	 * * `void setStreamSerial(int)`
+	 *     Use the given logical stream serial number instead of a new one
+	 *     for each encode, so encoding the same buffer twice gives the same
+	 *     file.
+	 */
+	void setStreamSerial(int);
+
 	using Coder::encode;
-	virtual void encode(const Buffer &, std::ofstream &) const;
+	virtual void encode(const Buffer &, Sink &) const;
+	virtual Session * session() const;
+	virtual void encode(const Buffer &, Sink &, Session &) const;
+
+private:
+	bool _fixedSerial;
+	int _serial;
 };
 } /* namespace audio */
 } /* namespace nealrame */
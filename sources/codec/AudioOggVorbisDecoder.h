@@ -17,7 +17,9 @@ class Buffer;
 class OggVorbisDecoder : public Decoder {
 public:
 	using Decoder::decode;
-	virtual Buffer * decode(std::ifstream &) const;
+	virtual Buffer * decode(Source &) const;
+	virtual Session * session() const;
+	virtual Buffer * decode(Source &, Session &) const;
 };
 } /* namespace audio */
 } /* namespace nealrame */
@@ -5,15 +5,31 @@
  *      Author: jux
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstdint>
 #include <cstring>
+#include <exception>
 #include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "../AudioBuffer.h"
 #include "../AudioError.h"
+#include "../AudioExecutor.h"
+#include "../AudioJob.h"
+#include "../AudioStatistics.h"
+#include "../AudioTrace.h"
+#include "../io/AudioSink.h"
+#include "../io/AudioSource.h"
 
 #include "AudioPCMCoder.h"
 #include "AudioPCMDecoder.h"
+#include "AudioWaveWriter.h"
 
 namespace com {
 namespace nealrame {
@@ -73,62 +89,183 @@ struct WaveDataChunk {
 // Decoder ///////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
+#define PCM_DECODE_BLOCK_FRAME_COUNT 4096
+
 struct RAII_PCMDecoderData {
-	std::ifstream &input;
-	std::ifstream::iostate input_state;
 	char *samples;
+	Buffer *buffer;
 
-	RAII_PCMDecoderData(std::ifstream &in) :
-		input(in) {
+	RAII_PCMDecoderData() {
 		samples = nullptr;
-		input_state = input.exceptions();
-		input.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		buffer = nullptr;
 	}
 
 	virtual ~RAII_PCMDecoderData() {
-		input.exceptions(input_state);
 		if (samples != nullptr) free(samples);
+		if (buffer != nullptr) delete buffer;
 	}
 };
 
-Buffer * PCMDecoder::decode(std::ifstream &in) const {
-	RAII_PCMDecoderData decode_data(in);
+void read_chunk(Source &input, void *chunk, size_t size) {
+	if (input.read((char *)chunk, size) < size) {
+		Error::raise(Error::Status::IOError, "The file is truncated.");
+	}
+}
+
+// Read the chunk headers up to the samples, return the stream format.
+Format read_wave_headers(Source &in, uint32_t &data_size) {
+	RIFFHeaderChunk header_chunk;
+	read_chunk(in, &header_chunk, sizeof(RIFFHeaderChunk));
+	if (strncmp(header_chunk.id, "RIFF", 4) != 0
+		|| strncmp(header_chunk.format, "WAVE", 4) != 0) {
+		Error::raise(Error::Status::PCMError, "Bad file format.");
+	}
+	debug_riff_header_chunk(header_chunk);
+
+	WaveFormatChunk format_chunk;
+	read_chunk(in, &format_chunk, sizeof(WaveFormatChunk));
+	if (strncmp(format_chunk.id, "fmt ", 4) != 0) {
+		Error::raise(Error::Status::PCMError, "Bad file format.");
+	}
+	debug_wave_format_chunk(format_chunk);
+
+	WaveDataChunk data_chunk;
+	read_chunk(in, &data_chunk, sizeof(WaveDataChunk));
+	if (strncmp(data_chunk.id, "data", 4) != 0) {
+		Error::raise(Error::Status::PCMError, "Bad file format.");
+	}
+	debug_wave_data_chunk(data_chunk);
+
+	data_size = data_chunk.size;
+	return Format(format_chunk.channelCount, format_chunk.sampleRate, format_chunk.bitPerSample);
+}
+
+struct PCMIndex : public Decoder::Index {
+	PCMIndex(const char *data, size_t size, Format output, Format stream, unsigned int frameCount, size_t dataOffset) :
+		Decoder::Index(data, size, output, frameCount),
+		streamFormat(stream),
+		dataOffset(dataOffset) {
+	}
+
+	Format streamFormat;
+	size_t dataOffset;
+};
+
+Buffer * PCMDecoder::decode(Source &in) const {
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	RAII_PCMDecoderData decode_data;
 	Buffer *buffer = nullptr;
 
-	try {
-		RIFFHeaderChunk header_chunk;
-		in.readsome((char *)&header_chunk, sizeof(RIFFHeaderChunk));
-		if (strncmp(header_chunk.id, "RIFF", 4) != 0
-			&& strncpy(header_chunk.format, "WAVE", 4) != 0) {
-			Error::raise(Error::Status::PCMError, "Bad file format.");
+	if (stats) stats->bytesRead += sizeof(RIFFHeaderChunk) + sizeof(WaveFormatChunk) + sizeof(WaveDataChunk);
+
+	uint32_t data_size;
+	Format format = read_wave_headers(in, data_size);
+
+	if (channelMixer()) {
+		// Stream the data chunk through the mixer by blocks, only the
+		// mixed channels are ever stored. The blocks are peeked: memory
+		// and mapped sources are mixed without copy.
+		unsigned int frame_count = format.frameCountForSize(data_size);
+
+		Requantizer requantizer(dither());
+
+		decode_data.buffer = new Buffer(outputFormat(format));
+		decode_data.buffer->resize(frame_count);
+		if (stats) {
+			stats->allocation(decode_data.buffer->format().sizeForFrameCount(frame_count));
 		}
-		debug_riff_header_chunk(header_chunk);
 
-		WaveFormatChunk format_chunk;
-		in.readsome((char *)&format_chunk, sizeof(WaveFormatChunk));
-		if (strncmp(format_chunk.id, "fmt ", 4) != 0) {
-			Error::raise(Error::Status::PCMError, "Bad file format.");
+		for (unsigned int offset = 0, count; offset < frame_count; offset += count) {
+			count = std::min(frame_count - offset, (unsigned int)PCM_DECODE_BLOCK_FRAME_COUNT);
+
+			size_t size = format.sizeForFrameCount(count);
+			const char *samples;
+			{
+				Statistics::Scope scope(stats, Statistics::Phase::IO);
+				samples = in.peek(size);
+			}
+			if (size < format.sizeForFrameCount(count)) {
+				Error::raise(Error::Status::IOError, "The file is truncated.");
+			}
+			if (stats) stats->bytesRead += size;
+			switch (format.bitDepth()) {
+			case 8:
+				write(*decode_data.buffer, offset, count, (const int8_t *)samples, requantizer);
+				break;
+
+			case 16:
+				write(*decode_data.buffer, offset, count, (const int16_t *)samples, requantizer);
+				break;
+			}
+			in.consume(size);
+			Job::checkpoint(in);
+		}
+	} else {
+		decode_data.samples = (char *) malloc(data_size);
+		{
+			Statistics::Scope scope(stats, Statistics::Phase::IO);
+			read_chunk(in, decode_data.samples, data_size);
 		}
-		debug_wave_format_chunk(format_chunk);
+		decode_data.buffer = new Buffer(format, data_size, decode_data.samples);
+		decode_data.samples = nullptr;
 
-		WaveDataChunk data_chunk;
-		in.readsome((char *)&data_chunk, sizeof(WaveDataChunk));
-		if (strncmp(data_chunk.id, "data", 4) != 0) {
-			Error::raise(Error::Status::PCMError, "Bad file format.");
+		if (stats) {
+			stats->allocation(data_size);
+			stats->bytesRead += data_size;
+			stats->framesProcessed += decode_data.buffer->frameCount();
 		}
-		debug_wave_data_chunk(data_chunk);
 
-		Format format(format_chunk.channelCount, format_chunk.sampleRate, format_chunk.bitPerSample);
+		analyze(*decode_data.buffer, 0, decode_data.buffer->frameCount());
+	}
 
-		decode_data.samples = (char *) malloc(data_chunk.size);
+	buffer = decode_data.buffer;
+	decode_data.buffer = nullptr;
 
-		in.read(decode_data.samples, data_chunk.size);
-		buffer = new Buffer(format, data_chunk.size, decode_data.samples);
-		decode_data.samples = nullptr;
+	return buffer;
+}
+
+Decoder::Index * PCMDecoder::index(const char *data, size_t size) const {
+	MemorySource in(data, size);
+	uint32_t data_size;
+	Format format = read_wave_headers(in, data_size);
+	unsigned int frame_count = format.frameCountForSize(std::min<uint64_t>(data_size, size - in.position()));
+
+	return new PCMIndex(data, size, outputFormat(format), format, frame_count, in.position());
+}
 
-	} catch (std::ifstream::failure ioerr) {
-		Error::raise(Error::Status::IOError, ioerr.what());
+Buffer * PCMDecoder::decode(const Index &index, unsigned int offset, unsigned int count) const {
+	const PCMIndex *pcm_index = dynamic_cast<const PCMIndex *>(&index);
+	if (pcm_index == nullptr) {
+		Error::raise(Error::Status::PCMError, "Not a PCM stream index.");
 	}
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	Format format = pcm_index->streamFormat;
+	RAII_PCMDecoderData decode_data;
+
+	offset = std::min(offset, index.frameCount());
+	count = std::min(count, index.frameCount() - offset);
+
+	// Seeded by offset, so that a range is dithered the same way whatever
+	// was decoded before.
+	Requantizer requantizer(dither(), 0x2545f491u ^ offset*0x9e3779b9u);
+	const char *samples = index.data() + pcm_index->dataOffset + format.sizeForFrameCount(offset);
+	if (stats) stats->bytesRead += format.sizeForFrameCount(count);
+
+	decode_data.buffer = new Buffer(index.format());
+	switch (format.bitDepth()) {
+	case 8:
+		write(*decode_data.buffer, 0, count, (const int8_t *)samples, requantizer);
+		break;
+
+	case 16:
+		write(*decode_data.buffer, 0, count, (const int16_t *)samples, requantizer);
+		break;
+	}
+
+	Buffer *buffer = decode_data.buffer;
+	decode_data.buffer = nullptr;
 
 	return buffer;
 }
@@ -137,53 +274,269 @@ Buffer * PCMDecoder::decode(std::ifstream &in) const {
 // Coder /////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-struct RAII_PCMCoderData {
-	std::ofstream &output;
-	std::ofstream::iostate output_state;
+struct WaveHeaders {
+	RIFFHeaderChunk riff;
+	WaveFormatChunk format;
+	WaveDataChunk data;
+} __attribute__((packed));
 
-	RAII_PCMCoderData(std::ofstream &out) :
-		output(out) {
-		output_state = output.exceptions();
-		output.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+void fill_wave_headers(const Format &fmt, uint32_t data_size, WaveHeaders &headers) {
+	memcpy(headers.riff.id,     "RIFF", 4);
+	memcpy(headers.riff.format, "WAVE", 4);
+	headers.riff.size = 4 + sizeof(WaveFormatChunk) + sizeof(WaveDataChunk) + data_size;
+	debug_riff_header_chunk(headers.riff);
+
+	memcpy(headers.format.id, "fmt ", 4);
+	headers.format.size = sizeof(WaveFormatChunk) - sizeof(headers.format.id) - sizeof(headers.format.size);
+	headers.format.audioFormat = 1;
+	headers.format.channelCount = fmt.channelCount();
+	headers.format.sampleRate = fmt.sampleRate();
+	headers.format.byteRate = fmt.sizeForFrameCount(fmt.sampleRate());
+	headers.format.bytePerFrame = fmt.sizeForFrameCount(1);
+	headers.format.bitPerSample = fmt.bitDepth();
+	debug_wave_format_chunk(headers.format);
+
+	memcpy(headers.data.id, "data", 4);
+	headers.data.size = data_size;
+	debug_wave_data_chunk(headers.data);
+}
+
+void PCMCoder::encode(const Buffer &buffer, Sink &out) const {
+	Statistics *stats = statistics();
+	Statistics::Operation operation(stats);
+	Format fmt = buffer.format();
+	WaveHeaders headers;
+
+	fill_wave_headers(fmt, fmt.sizeForFrameCount(buffer.frameCount()), headers);
+	{
+		// Headers and samples in one call, gathered by vectored sinks.
+		Statistics::Scope scope(stats, Statistics::Phase::IO);
+		struct iovec chunks[2] = {
+			{ &headers, sizeof(WaveHeaders) },
+			{ const_cast<char *>(buffer.data()), fmt.sizeForFrameCount(buffer.frameCount()) },
+		};
+		out.write(chunks, 2);
+	}
+	if (stats) {
+		stats->bytesWritten += headers.riff.size + 8;
+		stats->framesProcessed += buffer.frameCount();
 	}
 
-	virtual ~RAII_PCMCoderData() {
-		output.exceptions(output_state);
+	analyze(buffer, 0, buffer.frameCount());
+
+	Statistics::Scope scope(stats, Statistics::Phase::IO);
+	out.flush();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// WaveWriter ////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+const unsigned int WaveWriter::ChunkFrameCount;
+
+#define WAVE_MAX_DATA_SIZE (0xffffffffull - sizeof(WaveHeaders))
+
+WaveWriter::WaveWriter(const std::string &path, Format format, unsigned int threadCount, Requantizer::Dither dither) :
+	_format(format),
+	_dither(dither),
+	_fd(open(path.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)),
+	_frameCount(0),
+	_chunkIndex(0) {
+	if (_fd < 0) {
+		Error::raise(Error::Status::IOError, "Failed to open " + path + ": " + strerror(errno));
 	}
-};
+	if (_format.bitDepth() != 8 && _format.bitDepth() != 16) {
+		close(_fd);
+		Error::raise(Error::Status::FormatBadValue, "Unsupported bit depth.");
+	}
+	try {
+		patchHeaders(_fd);
+	} catch (Error &) {
+		close(_fd);
+		throw;
+	}
+	_pool.reset(new Executor::Group(threadCount));
+}
 
-void PCMCoder::encode(const Buffer &buffer, std::ofstream &out) const {
-	RIFFHeaderChunk header_chunk;
+WaveWriter::~WaveWriter() {
+	try {
+		finish();
+	} catch (Error &) {
+	}
+	if (_fd >= 0) {
+		close(_fd);
+	}
+}
+
+void WaveWriter::patchHeaders(int fd) {
+	WaveHeaders headers;
+	const char *data = (const char *)&headers;
+	size_t written = 0;
+
+	fill_wave_headers(_format, _format.sizeForFrameCount(1)*_frameCount, headers);
+	while (written < sizeof(headers)) {
+		ssize_t count = pwrite(fd, data + written, sizeof(headers) - written, written);
+		if (count < 0 && errno != EINTR) {
+			Error::raise(Error::Status::IOError, std::string("Failed to write: ") + strerror(errno));
+		}
+		if (count > 0) written += count;
+	}
+}
+
+// The file size is set by the writes, `finish` truncates the part reserved
+// but never written.
+void WaveWriter::reserve(uint64_t frameCount) {
+	if (_fd < 0) {
+		Error::raise(Error::Status::IOError, "The wave writer is finished.");
+	}
+	off_t size = sizeof(WaveHeaders) + _format.sizeForFrameCount(1)*frameCount;
+	if (fallocate(_fd, 0, 0, size) < 0 && errno != EOPNOTSUPP) {
+		Error::raise(Error::Status::IOError, std::string("Failed to allocate: ") + strerror(errno));
+	}
+}
+
+// `convert` returns the given frames in the file format, in its own
+// storage or in the given one.
+template<typename CONVERT>
+void WaveWriter::writeRanges(unsigned int frameCount, CONVERT convert) {
+	const size_t frame_size = _format.sizeForFrameCount(1);
+
+	if (_fd < 0) {
+		Error::raise(Error::Status::IOError, "The wave writer is finished.");
+	}
+	if (frame_size*(_frameCount + frameCount) > WAVE_MAX_DATA_SIZE) {
+		Error::raise(Error::Status::FormatBadValue, "WAV data size exceeds 4GiB.");
+	}
+
+	reserve(_frameCount + frameCount);
+
+	std::atomic<int> error(0);
+	std::mutex failure_mutex;
+	std::exception_ptr failure;
+	for (unsigned int offset = 0; offset < frameCount; offset += ChunkFrameCount) {
+		unsigned int count = std::min(frameCount - offset, ChunkFrameCount);
+		off_t position = sizeof(WaveHeaders) + frame_size*(_frameCount + offset);
+		uint64_t chunk = _chunkIndex++;
+
+		_pool->submit([=, &convert, &error, &failure_mutex, &failure]() {
+			std::vector<char> storage;
+			const char *data;
+			try {
+				data = convert(offset, count, chunk, storage);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(failure_mutex);
+				failure = std::current_exception();
+				return;
+			}
+			size_t size = frame_size*count, written = 0;
 
+			Trace::Span span("wave.pwrite", "io");
+			while (written < size) {
+				ssize_t n = pwrite(_fd, data + written, size - written, position + written);
+				if (n < 0) {
+					if (errno == EINTR) continue;
+					int expected = 0;
+					error.compare_exchange_strong(expected, errno);
+					return;
+				}
+				written += n;
+			}
+		});
+	}
+	_pool->wait();
+
+	if (failure) {
+		std::rethrow_exception(failure);
+	}
+	if (error != 0) {
+		Error::raise(Error::Status::IOError, std::string("Failed to write: ") + strerror(error));
+	}
+	_frameCount += frameCount;
+}
+
+void WaveWriter::write(const Buffer &buffer) {
+	const Format &format = _format;
+
+	if (buffer.format().channelCount() != format.channelCount()) {
+		Error::raise(Error::Status::FormatBadValue, "Buffer does not match the file channel count.");
+	}
+	if (buffer.format().bitDepth() == format.bitDepth()) {
+		writeRanges(buffer.frameCount(), [&](unsigned int offset, unsigned int, uint64_t, std::vector<char> &) {
+			return buffer.data() + format.sizeForFrameCount(offset);
+		});
+		return;
+	}
+	writeRanges(buffer.frameCount(), [&](unsigned int offset, unsigned int count, uint64_t, std::vector<char> &storage) {
+		storage.resize(format.sizeForFrameCount(count));
+		if (format.bitDepth() == 8) {
+			buffer.read(offset, count, (int8_t *)storage.data());
+		} else {
+			buffer.read(offset, count, (int16_t *)storage.data());
+		}
+		return (const char *)storage.data();
+	});
+}
+
+// Each range gets its own requantizer, seeded by the range index so the
+// output does not depend on the thread scheduling.
+void WaveWriter::write(unsigned int frameCount, const float * const *channels) {
+	const Format &format = _format;
+	const Requantizer::Dither dither = _dither;
+
+	writeRanges(frameCount, [&](unsigned int offset, unsigned int count, uint64_t chunk, std::vector<char> &storage) {
+		Requantizer requantizer(dither, 0x2545f491u ^ (uint32_t)(chunk*0x9e3779b9u));
+		std::vector<const float *> src(format.channelCount());
+		for (unsigned int c = 0; c < src.size(); ++c) {
+			src[c] = channels[c] + offset;
+		}
+		storage.resize(format.sizeForFrameCount(count));
+		if (format.bitDepth() == 8) {
+			requantizer.quantize(count, src.size(), src.data(), (int8_t *)storage.data());
+		} else {
+			requantizer.quantize(count, src.size(), src.data(), (int16_t *)storage.data());
+		}
+		return (const char *)storage.data();
+	});
+}
+
+void WaveWriter::write(unsigned int frameCount, const float *interleaved) {
+	const Format &format = _format;
+	const Requantizer::Dither dither = _dither;
+
+	writeRanges(frameCount, [&](unsigned int offset, unsigned int count, uint64_t chunk, std::vector<char> &storage) {
+		Requantizer requantizer(dither, 0x2545f491u ^ (uint32_t)(chunk*0x9e3779b9u));
+		const float *src = interleaved + (size_t)offset*format.channelCount();
+		storage.resize(format.sizeForFrameCount(count));
+		if (format.bitDepth() == 8) {
+			requantizer.quantize(count, format.channelCount(), src, (int8_t *)storage.data());
+		} else {
+			requantizer.quantize(count, format.channelCount(), src, (int16_t *)storage.data());
+		}
+		return (const char *)storage.data();
+	});
+}
+
+void WaveWriter::finish() {
+	if (_fd < 0) {
+		return;
+	}
+
+	int fd = _fd, error = 0;
+	_fd = -1;
 	try {
-		Format fmt = buffer.format();
-
-		memcpy(header_chunk.id,     "RIFF", 4);
-		memcpy(header_chunk.format, "WAVE", 4);
-		header_chunk.size = 4 + sizeof(WaveFormatChunk) + sizeof(WaveDataChunk) + fmt.sizeForFrameCount(buffer.frameCount());
-		debug_riff_header_chunk(header_chunk);
-		out.write((const char *)&header_chunk, sizeof(RIFFHeaderChunk));
-
-		WaveFormatChunk wave_format;
-		memcpy(wave_format.id, "fmt ", 4);
-		wave_format.size = sizeof(WaveFormatChunk) - sizeof(wave_format.id) - sizeof(wave_format.size);
-		wave_format.audioFormat = 1;
-		wave_format.channelCount = fmt.channelCount();
-		wave_format.sampleRate = fmt.sampleRate();
-		wave_format.byteRate = fmt.sizeForFrameCount(fmt.sampleRate());
-		wave_format.bytePerFrame = fmt.sizeForFrameCount(1);
-		wave_format.bitPerSample = fmt.bitDepth();
-		debug_wave_format_chunk(wave_format);
-		out.write((const char *)&wave_format, sizeof(WaveFormatChunk));
-
-		WaveDataChunk wave_data;
-		memcpy(wave_data.id, "data", 4);
-		wave_data.size = fmt.sizeForFrameCount(buffer.frameCount());
-		debug_wave_data_chunk(wave_data);
-		out.write((const char *)&wave_data, sizeof(WaveDataChunk));
-		out.write((const char *)buffer.data(), fmt.sizeForFrameCount(buffer.frameCount()));
-	} catch (std::ofstream::failure ioerr) {
-		Error::raise(Error::Status::IOError, ioerr.what());
+		patchHeaders(fd);
+	} catch (Error &) {
+		close(fd);
+		throw;
+	}
+	if (ftruncate(fd, sizeof(WaveHeaders) + _format.sizeForFrameCount(1)*_frameCount) < 0) {
+		error = errno;
+	}
+	if (close(fd) < 0 && error == 0) {
+		error = errno;
+	}
+	if (error != 0) {
+		Error::raise(Error::Status::IOError, std::string("Failed to finish the file: ") + strerror(error));
 	}
 }
 
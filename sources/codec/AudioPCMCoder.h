@@ -16,7 +16,7 @@ namespace audio {
 class PCMCoder : public Coder {
 public:
 	using Coder::encode;
-	virtual void encode(const Buffer &, std::ofstream &) const;
+	virtual void encode(const Buffer &, Sink &) const;
 };
 
 } /* namespace audio */
@@ -17,7 +17,9 @@ class Buffer;
 class PCMDecoder: public Decoder {
 public:
 	using Decoder::decode;
-	virtual Buffer * decode(std::ifstream &) const;
+	virtual Buffer * decode(Source &) const;
+	virtual Index * index(const char *data, size_t size) const;
+	virtual Buffer * decode(const Index &, unsigned int offset, unsigned int count) const;
 };
 
 } /* namespace audio */
@@ -0,0 +1,69 @@
+/*
+ * AudioSessionPool.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSESSIONPOOL_H_
+#define AUDIOSESSIONPOOL_H_
+
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class SessionPool
+ * The sessions (see `Decoder::Session` and `Coder::Session`) kept by the
+ * calling thread, a few per codec type. A session is out of the pool while
+ * it is used, so a decode nested in another one on the same thread gets
+ * its own.
+ */
+template<typename SESSION>
+class SessionPool {
+public:
+	static const unsigned int SessionsPerType = 2;
+
+	/**
+	 * * `static std::unique_ptr<SESSION> take(const std::type_info &codecType)`
+	 *     Take a session of the given codec type, `nullptr` if the pool of
+	 *     the calling thread has none.
+	 */
+	static std::unique_ptr<SESSION> take(const std::type_info &type) {
+		std::vector<std::unique_ptr<SESSION>> &sessions = pool()[std::type_index(type)];
+		std::unique_ptr<SESSION> session;
+		if (! sessions.empty()) {
+			session = std::move(sessions.back());
+			sessions.pop_back();
+		}
+		return session;
+	}
+	/**
+	 * * `static void give(const std::type_info &codecType, std::unique_ptr<SESSION>)`
+	 *     Give a session back to the pool of the calling thread. It is
+	 *     dropped if the pool is full.
+	 */
+	static void give(const std::type_info &type, std::unique_ptr<SESSION> session) {
+		std::vector<std::unique_ptr<SESSION>> &sessions = pool()[std::type_index(type)];
+		if (session && sessions.size() < SessionsPerType) {
+			sessions.push_back(std::move(session));
+		}
+	}
+
+private:
+	static std::unordered_map<std::type_index, std::vector<std::unique_ptr<SESSION>>> & pool() {
+		static thread_local std::unordered_map<std::type_index, std::vector<std::unique_ptr<SESSION>>> sessions;
+		return sessions;
+	}
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSESSIONPOOL_H_ */
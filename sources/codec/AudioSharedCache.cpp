@@ -0,0 +1,640 @@
+/*
+ * AudioSharedCache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <typeinfo>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../AudioBuffer.h"
+#include "../AudioError.h"
+#include "../AudioTrace.h"
+#include "AudioDecoder.h"
+#include "AudioSharedCache.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int SharedCache::DefaultSlotCount;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Shared atomics must be lock-free.");
+
+// The bytes and entries counts are only changed with the mutex held, they
+// are atomics to be read without it. Tombstones are also counted by fills
+// abandoned without the mutex.
+struct SharedCache::Header {
+	std::atomic<uint32_t> magic;
+	uint32_t slotCount;
+	uint64_t budget;
+	pthread_mutex_t mutex;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> entries;
+	std::atomic<uint64_t> evictions;
+	std::atomic<uint32_t> tombstones;
+	uint32_t purgeAt;                       // tombstone count starting a purge, with the mutex held
+	uint32_t hand;                          // CLOCK hand, with the mutex held
+};
+
+// The key is written with the mutex held, before the slot is published as
+// filling: lock-free readers check it with the state word as a sequence
+// lock. The sizes and format are written by the filling process once it
+// has reserved the slot (one reference while filling), before the slot is
+// published as ready. The fill mutex is held by the filling thread for the
+// whole fill: it is robust, so waiters learn that the filling process died
+// from the kernel, whatever its pid namespace.
+struct SharedCache::Slot {
+	std::atomic<uint64_t> word;             // state:2 | generation:30 | references:32
+	std::atomic<uint32_t> sequence;         // futex, bumped when a fill ends
+	std::atomic<uint32_t> used;             // CLOCK reference bit
+	pthread_mutex_t fill;                   // held while filling
+	std::atomic<uint64_t> key[5];
+	uint64_t size;
+	uint32_t channelCount;
+	uint32_t sampleRate;
+	uint32_t bitDepth;
+};
+
+namespace {
+
+const uint32_t Magic = 0x6e724333;
+
+enum State : uint64_t {
+	Empty = 0,
+	Filling = 1,
+	Ready = 2,
+	Tombstone = 3,
+};
+
+uint64_t make_word(uint64_t state, uint32_t generation, uint32_t references) {
+	return (state << 62) | ((uint64_t)(generation & 0x3fffffff) << 32) | references;
+}
+
+uint64_t word_state(uint64_t word) {
+	return word >> 62;
+}
+
+uint32_t word_generation(uint64_t word) {
+	return (word >> 32) & 0x3fffffff;
+}
+
+uint32_t word_references(uint64_t word) {
+	return (uint32_t)word;
+}
+
+uint64_t fnv(uint64_t hash, const void *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ static_cast<const unsigned char *>(data)[i])*0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::string segment_name(const std::string &name, unsigned int index, uint32_t generation) {
+	return name + "." + std::to_string(index) + "." + std::to_string(generation);
+}
+
+void raise_errno(const std::string &message) {
+	Error::raise(Error::Status::IOError, message + ": " + strerror(errno));
+}
+
+void init_mutex(pthread_mutex_t &mutex) {
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&mutex, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+}
+
+void wake(std::atomic<uint32_t> &sequence) {
+	sequence.fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&sequence), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+}
+
+uint64_t SharedCache::Key::hash() const {
+	return fnv(0xcbf29ce484222325ull, values, sizeof(values));
+}
+
+SharedCache::SharedCache(const std::string &name, uint64_t budget, unsigned int slotCount) :
+	_name("/" + name),
+	_indexSize(0),
+	_hits(0),
+	_misses(0),
+	_coalesced(0),
+	_probes(0) {
+	struct stat st;
+	bool created = true;
+	size_t size = sizeof(Header) + std::max(slotCount, 1u)*sizeof(Slot);
+	int fd = shm_open(_name.data(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+	if (fd < 0 && errno == EEXIST) {
+		created = false;
+		fd = shm_open(_name.data(), O_RDWR | O_CLOEXEC, 0600);
+	}
+	if (fd < 0) {
+		raise_errno("Failed to open the shared cache " + name);
+	}
+	if (created && ftruncate(fd, size) < 0) {
+		close(fd);
+		shm_unlink(_name.data());
+		raise_errno("Failed to create the shared cache " + name);
+	}
+	// The creator sizes the index at once, then initializes it.
+	for (int i = 0; ! created; ++i) {
+		if (fstat(fd, &st) < 0) {
+			close(fd);
+			raise_errno("Failed to open the shared cache " + name);
+		}
+		if ((size_t)st.st_size >= sizeof(Header)) {
+			size = st.st_size;
+			break;
+		}
+		if (i == 1000) {
+			close(fd);
+			Error::raise(Error::Status::IOError, "The shared cache " + name + " is not initialized.");
+		}
+		usleep(1000);
+	}
+
+	void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		raise_errno("Failed to map the shared cache " + name);
+	}
+	_index.reset(static_cast<char *>(data), [size](char *data) { munmap(data, size); });
+	_indexSize = size;
+
+	Header *header = this->header();
+	if (created) {
+		init_mutex(header->mutex);
+		header->slotCount = std::max(slotCount, 1u);
+		for (unsigned int i = 0; i < header->slotCount; ++i) {
+			init_mutex(slot(i)->fill);
+		}
+		header->budget = budget;
+		header->purgeAt = std::max(header->slotCount/8, 1u);
+		header->magic.store(Magic, std::memory_order_release);
+	}
+	for (int i = 0; header->magic.load(std::memory_order_acquire) != Magic; ++i) {
+		if (i == 1000) {
+			Error::raise(Error::Status::IOError, "The shared cache " + name + " is not initialized.");
+		}
+		usleep(1000);
+	}
+	if (sizeof(Header) + header->slotCount*sizeof(Slot) > _indexSize) {
+		Error::raise(Error::Status::FormatBadValue, "The shared cache " + name + " is corrupted.");
+	}
+}
+
+SharedCache::~SharedCache() {
+}
+
+void SharedCache::remove(const std::string &name) {
+	std::string index_name = "/" + name;
+	int fd = shm_open(index_name.data(), O_RDONLY | O_CLOEXEC, 0);
+	struct stat st;
+
+	if (fd < 0) {
+		if (errno == ENOENT) return;
+		raise_errno("Failed to open the shared cache " + name);
+	}
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Header)) {
+		void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (data != MAP_FAILED) {
+			const Header *header = static_cast<const Header *>(data);
+			const Slot *slots = reinterpret_cast<const Slot *>(header + 1);
+			for (unsigned int i = 0; sizeof(Header) + (i + 1)*sizeof(Slot) <= (size_t)st.st_size && i < header->slotCount; ++i) {
+				uint64_t word = slots[i].word.load(std::memory_order_acquire);
+				if (word_state(word) == Filling || word_state(word) == Ready) {
+					shm_unlink(segment_name(index_name, i, word_generation(word)).data());
+				}
+			}
+			munmap(data, st.st_size);
+		}
+	}
+	close(fd);
+	shm_unlink(index_name.data());
+}
+
+SharedCache::Header * SharedCache::header() const {
+	return reinterpret_cast<Header *>(_index.get());
+}
+
+SharedCache::Slot * SharedCache::slot(unsigned int index) const {
+	return reinterpret_cast<Slot *>(_index.get() + sizeof(Header)) + index;
+}
+
+uint64_t SharedCache::budget() const {
+	return header()->budget;
+}
+
+void SharedCache::lock() const {
+	int status = pthread_mutex_lock(&header()->mutex);
+	if (status == EOWNERDEAD) {
+		// The owner died with the lock: the slots are consistent by their
+		// state word, only the byte count may be off.
+		pthread_mutex_consistent(&header()->mutex);
+	} else if (status != 0) {
+		Error::raise(Error::Status::IOError, std::string("Failed to lock the shared cache: ") + strerror(status));
+	}
+}
+
+void SharedCache::unlock() const {
+	pthread_mutex_unlock(&header()->mutex);
+}
+
+// Compare the key of a slot seen with the given word. The slot may be
+// reclaimed meanwhile, the key is valid if the word has not changed.
+bool SharedCache::matches(const Slot &slot, uint64_t word, const Key &key) const {
+	uint64_t values[5];
+	// Acquire loads keep the word check below after them.
+	for (unsigned int i = 0; i < 5; ++i) {
+		values[i] = slot.key[i].load(std::memory_order_acquire);
+	}
+	uint64_t mask = ~(uint64_t)0xffffffff;
+	return ((slot.word.load(std::memory_order_relaxed) ^ word) & mask) == 0
+		&& memcmp(values, key.values, sizeof(values)) == 0;
+}
+
+// Look the key up without lock. On a hit, a reference is taken and the
+// segment mapped; a slot being filled is returned with its word.
+SharedCache::Lookup SharedCache::lookup(const Key &key, std::shared_ptr<const Buffer> &buffer, unsigned int &index, uint64_t &word) {
+	unsigned int count = header()->slotCount;
+	unsigned int start = key.hash() % count;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		Slot *slot = this->slot(index = (start + i) % count);
+		word = slot->word.load(std::memory_order_acquire);
+		_probes++;
+		if (word_state(word) == Empty) {
+			break;
+		}
+		if (word_state(word) == Tombstone || ! matches(*slot, word, key)) {
+			continue;
+		}
+		if (word_state(word) == Filling) {
+			return Lookup::Filling;
+		}
+		uint32_t generation = word_generation(word);
+		while (word_state(word) == Ready && word_generation(word) == generation) {
+			if (slot->word.compare_exchange_weak(word, word + 1, std::memory_order_acquire)) {
+				slot->used.store(1, std::memory_order_relaxed);
+				buffer = map(index, generation);
+				return buffer ? Lookup::Hit : Lookup::Unavailable;
+			}
+		}
+	}
+	return Lookup::Miss;
+}
+
+// Map the segment of a slot the caller holds a reference on. The returned
+// buffer releases the reference, `nullptr` if the segment is gone.
+std::shared_ptr<const Buffer> SharedCache::map(unsigned int index, uint32_t generation) {
+	Slot *slot = this->slot(index);
+	std::shared_ptr<char> mapping = _index;
+	size_t size = slot->size;
+	int fd = shm_open(segment_name(_name, index, generation).data(), O_RDONLY | O_CLOEXEC, 0);
+	void *data = fd < 0 ? MAP_FAILED : mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (data == MAP_FAILED) {
+		slot->word.fetch_sub(1, std::memory_order_release);
+		return nullptr;
+	}
+	std::shared_ptr<const void> owner(data, [slot, size, mapping](const void *data) {
+		munmap(const_cast<void *>(data), size);
+		slot->word.fetch_sub(1, std::memory_order_release);
+	});
+	return std::shared_ptr<const Buffer>(
+		new Buffer(Format(slot->channelCount, slot->sampleRate, slot->bitDepth), size, static_cast<const char *>(data), owner));
+}
+
+// Claim a free slot of the key probe sequence to fill it, unless the key
+// is already there (ready or being filled) or the index is full.
+SharedCache::Claim SharedCache::claim(const Key &key, unsigned int &index, uint32_t &generation) {
+	unsigned int count = header()->slotCount;
+	unsigned int start = key.hash() % count;
+	Slot *free = nullptr;
+
+	lock();
+	if (header()->tombstones.load(std::memory_order_relaxed) >= header()->purgeAt) {
+		purge();
+	}
+	for (unsigned int i = 0; i < count; ++i) {
+		Slot *slot = this->slot((start + i) % count);
+		uint64_t word = slot->word.load(std::memory_order_acquire);
+		_probes++;
+		if (word_state(word) == Empty || word_state(word) == Tombstone) {
+			if (! free) {
+				free = slot;
+				index = (start + i) % count;
+			}
+			if (word_state(word) == Empty) break;
+		} else if (matches(*slot, word, key)) {
+			unlock();
+			return Claim::Exists;
+		}
+	}
+	if (! free) {
+		unlock();
+		return Claim::Full;
+	}
+	uint64_t word = free->word.load(std::memory_order_relaxed);
+	if (word_state(word) == Tombstone) {
+		header()->tombstones.fetch_sub(1, std::memory_order_relaxed);
+	}
+	generation = word_generation(word) + 1;
+	for (unsigned int i = 0; i < 5; ++i) {
+		free->key[i].store(key.values[i], std::memory_order_relaxed);
+	}
+	// Only a waiter checking a previous fill may hold it, shortly.
+	if (pthread_mutex_lock(&free->fill) == EOWNERDEAD) {
+		pthread_mutex_consistent(&free->fill);
+	}
+	free->word.store(make_word(Filling, generation, 0), std::memory_order_release);
+	unlock();
+	generation &= 0x3fffffff;
+	return Claim::Done;
+}
+
+// End the fill of a claimed slot, published or abandoned.
+void SharedCache::release(unsigned int index) {
+	pthread_mutex_unlock(&slot(index)->fill);
+}
+
+// Copy a decoded buffer to a new segment and publish it, holding one
+// reference for the returned buffer. `nullptr` if it can not be shared,
+// the slot is then abandoned.
+std::shared_ptr<const Buffer> SharedCache::publish(unsigned int index, uint32_t generation, const Buffer &buffer) {
+	Trace::Span span("shared_cache.publish", "cache");
+	Slot *slot = this->slot(index);
+	std::string name = segment_name(_name, index, generation);
+	size_t size = buffer.format().sizeForFrameCount(buffer.frameCount());
+	void *data = MAP_FAILED;
+
+	// A segment left by a process which died while publishing is replaced.
+	int fd = shm_open(name.data(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0 && errno == EEXIST && shm_unlink(name.data()) == 0) {
+		fd = shm_open(name.data(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	}
+	if (fd >= 0) {
+		if (size > 0 && ftruncate(fd, size) == 0) {
+			data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+	}
+	// Reserve the slot before writing its metadata: a waiter may have
+	// abandoned it, and another process claimed it since.
+	uint64_t word = make_word(Filling, generation, 0);
+	if (data != MAP_FAILED && ! slot->word.compare_exchange_strong(word, make_word(Filling, generation, 1), std::memory_order_acq_rel)) {
+		munmap(data, size);
+		shm_unlink(name.data());
+		return nullptr;
+	}
+	if (data != MAP_FAILED) {
+		memcpy(data, buffer.data(), size);
+		mprotect(data, size, PROT_READ);
+		slot->size = size;
+		slot->channelCount = buffer.format().channelCount();
+		slot->sampleRate = buffer.format().sampleRate();
+		slot->bitDepth = buffer.format().bitDepth();
+
+		lock();
+		bool fits = evict(size);
+		if (fits) {
+			header()->bytes.fetch_add(size, std::memory_order_relaxed);
+			header()->entries.fetch_add(1, std::memory_order_relaxed);
+			slot->used.store(1, std::memory_order_relaxed);
+			slot->word.store(make_word(Ready, generation, 1), std::memory_order_release);
+		} else {
+			slot->word.store(make_word(Filling, generation, 0), std::memory_order_release);
+		}
+		unlock();
+		if (fits) {
+			wake(slot->sequence);
+			std::shared_ptr<char> mapping = _index;
+			std::shared_ptr<const void> owner(data, [slot, size, mapping](const void *data) {
+				munmap(const_cast<void *>(data), size);
+				slot->word.fetch_sub(1, std::memory_order_release);
+			});
+			return std::shared_ptr<const Buffer>(new Buffer(buffer.format(), size, static_cast<const char *>(data), owner));
+		}
+		munmap(data, size);
+	}
+	abandon(index, make_word(Filling, generation, 0));
+	return nullptr;
+}
+
+// Give up filling a slot seen with the given word: it becomes free and its
+// waiters retry.
+void SharedCache::abandon(unsigned int index, uint64_t word) {
+	Slot *slot = this->slot(index);
+	uint32_t generation = word_generation(word);
+
+	if (slot->word.compare_exchange_strong(word, make_word(Tombstone, generation, 0), std::memory_order_acq_rel)) {
+		header()->tombstones.fetch_add(1, std::memory_order_relaxed);
+		shm_unlink(segment_name(_name, index, generation).data());
+		wake(slot->sequence);
+	}
+}
+
+// Turn the tombstones which are not on the probe sequence of an entry back
+// into empty slots, so that misses stop early again. Entries are not
+// moved: their segments are named by slot. Called with the mutex held.
+void SharedCache::purge() {
+	Trace::Span span("shared_cache.purge", "cache");
+	Header *header = this->header();
+	unsigned int count = header->slotCount;
+	std::vector<bool> probed(count, false);
+
+	for (unsigned int index = 0; index < count; ++index) {
+		Slot *slot = this->slot(index);
+		uint64_t state = word_state(slot->word.load(std::memory_order_acquire));
+		if (state != Ready && state != Filling) {
+			continue;
+		}
+		Key key;
+		for (unsigned int i = 0; i < 5; ++i) {
+			key.values[i] = slot->key[i].load(std::memory_order_relaxed);
+		}
+		for (unsigned int i = key.hash() % count; i != index; i = (i + 1) % count) {
+			probed[i] = true;
+		}
+	}
+
+	uint32_t tombstones = 0;
+	for (unsigned int index = 0; index < count; ++index) {
+		Slot *slot = this->slot(index);
+		uint64_t word = slot->word.load(std::memory_order_acquire);
+		if (word_state(word) != Tombstone) {
+			continue;
+		}
+		// A slot abandoned meanwhile is counted by its abandon.
+		if (probed[index] || ! slot->word.compare_exchange_strong(word, make_word(Empty, word_generation(word), 0), std::memory_order_acq_rel)) {
+			tombstones++;
+		}
+	}
+	header->tombstones.store(tombstones, std::memory_order_relaxed);
+	header->purgeAt = std::max(std::max(count/8, 1u), 2*tombstones);
+}
+
+// Wait for a slot to be filled. A filling process which died is detected
+// after a timeout, by the fill mutex it left, and its slot abandoned.
+void SharedCache::wait(unsigned int index, uint64_t word) {
+	Trace::Span span("shared_cache.wait", "cache");
+	Slot *slot = this->slot(index);
+	uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+	struct timespec timeout = { 0, 100000000 };
+
+	if (slot->word.load(std::memory_order_acquire) != word) {
+		return;
+	}
+	if (syscall(SYS_futex, reinterpret_cast<uint32_t *>(&slot->sequence), FUTEX_WAIT, sequence, &timeout, nullptr, 0) < 0
+			&& errno == ETIMEDOUT) {
+		int status = pthread_mutex_trylock(&slot->fill);
+		if (status == EOWNERDEAD) {
+			pthread_mutex_consistent(&slot->fill);
+			uint64_t current = slot->word.load(std::memory_order_acquire);
+			if (word_state(current) == Filling && word_generation(current) == word_generation(word)) {
+				abandon(index, current);
+			}
+		}
+		if (status == 0 || status == EOWNERDEAD) {
+			pthread_mutex_unlock(&slot->fill);
+		}
+	}
+}
+
+// Evict unreferenced entries until `size` more bytes fit in the budget,
+// CLOCK order. Called with the mutex held.
+bool SharedCache::evict(uint64_t size) {
+	Header *header = this->header();
+
+	if (size > header->budget) {
+		return false;
+	}
+	for (unsigned int step = 0; step < 2*header->slotCount; ++step) {
+		if (header->bytes.load(std::memory_order_relaxed) + size <= header->budget) {
+			return true;
+		}
+		unsigned int index = header->hand;
+		Slot *slot = this->slot(index);
+		header->hand = (index + 1) % header->slotCount;
+
+		uint64_t word = slot->word.load(std::memory_order_acquire);
+		if (word_state(word) != Ready || word_references(word) != 0) {
+			continue;
+		}
+		if (slot->used.exchange(0, std::memory_order_relaxed) != 0) {
+			continue;
+		}
+		if (slot->word.compare_exchange_strong(word, make_word(Tombstone, word_generation(word), 0), std::memory_order_acq_rel)) {
+			header->tombstones.fetch_add(1, std::memory_order_relaxed);
+			shm_unlink(segment_name(_name, index, word_generation(word)).data());
+			header->bytes.fetch_sub(slot->size, std::memory_order_relaxed);
+			header->entries.fetch_sub(1, std::memory_order_relaxed);
+			header->evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	return header->bytes.load(std::memory_order_relaxed) + size <= header->budget;
+}
+
+std::shared_ptr<const Buffer> SharedCache::decode(const std::string &path) {
+	std::unique_ptr<Decoder> decoder(Decoder::getDecoder(path));
+	return decode(path, *decoder);
+}
+
+std::shared_ptr<const Buffer> SharedCache::decode(const std::string &path, const Decoder &decoder) {
+	struct stat st;
+	if (decoder.channelMixer() || stat(path.data(), &st) != 0 || ! S_ISREG(st.st_mode) || st.st_size == 0) {
+		return std::shared_ptr<const Buffer>(decoder.decode(path));
+	}
+
+	const char *type = typeid(decoder).name();
+	Key key = {{
+		(uint64_t)st.st_dev,
+		(uint64_t)st.st_ino,
+		(uint64_t)st.st_size,
+		(uint64_t)st.st_mtim.tv_sec*1000000000 + st.st_mtim.tv_nsec,
+		fnv(0xcbf29ce484222325ull, type, strlen(type)) ^ (uint64_t)decoder.dither(),
+	}};
+	bool waited = false;
+
+	for (;;) {
+		std::shared_ptr<const Buffer> buffer;
+		unsigned int index;
+		uint32_t generation;
+		uint64_t word;
+
+		switch (lookup(key, buffer, index, word)) {
+		case Lookup::Hit:
+			(waited ? _coalesced : _hits)++;
+			return buffer;
+		case Lookup::Filling:
+			waited = true;
+			wait(index, word);
+			continue;
+		case Lookup::Unavailable:
+			return std::shared_ptr<const Buffer>(decoder.decode(path));
+		case Lookup::Miss:
+			break;
+		}
+
+		Claim claim = this->claim(key, index, generation);
+		if (claim == Claim::Exists) {
+			continue;
+		}
+		_misses++;
+
+		std::unique_ptr<Buffer> decoded;
+		try {
+			decoded.reset(decoder.decode(path));
+		} catch (...) {
+			if (claim == Claim::Done) {
+				abandon(index, make_word(Filling, generation, 0));
+				release(index);
+			}
+			throw;
+		}
+		if (claim == Claim::Done) {
+			buffer = publish(index, generation, *decoded);
+			release(index);
+			if (buffer) return buffer;
+		}
+		return std::shared_ptr<const Buffer>(decoded.release());
+	}
+}
+
+SharedCache::Counters SharedCache::counters() const {
+	Counters counters = {
+		_hits,
+		_misses,
+		_coalesced,
+		header()->evictions.load(std::memory_order_relaxed),
+		header()->bytes.load(std::memory_order_relaxed),
+		header()->entries.load(std::memory_order_relaxed),
+		_probes,
+	};
+	return counters;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,148 @@
+/*
+ * AudioSharedCache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSHAREDCACHE_H_
+#define AUDIOSHAREDCACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+class Decoder;
+/**
+ * ## Class SharedCache
+ * Share decoded files between the processes of a host, in POSIX shared
+ * memory.
+ *
+ * The cache is made of an index segment, `/<name>`, and of one segment
+ * per decoded file. The index is a fixed size hash table keyed by the file
+ * identity (device, inode, size, modification time) and the decoder type
+ * and dither. Lookups are lock-free: a slot state, generation and
+ * reference count share one atomic word, so taking a reference on a
+ * ready entry is a single compare and swap. Claiming a slot and evicting
+ * entries is serialized by a robust process-shared mutex, recovered when
+ * its owner dies.
+ *
+ * A buffer returned by the cache maps the file segment read-only, without
+ * copy, and holds a reference on its entry until it is destroyed: entries
+ * in use are never evicted. A process decoding a file publishes it when
+ * done; the ones asking for the same file meanwhile sleep on a futex until
+ * it is ready, or decode it themselves if the decoding process died.
+ *
+ *     SharedCache cache("nraudio", 1ull << 30);
+ *     std::shared_ptr<const Buffer> buffer = cache.decode("song.mp3");
+ *
+ * The references held by a process killed before it releases its buffers
+ * are not recovered, pinning their entries until `remove` is called.
+ */
+class SharedCache {
+public:
+	static const unsigned int DefaultSlotCount = 4096;
+
+	/**
+	 * ### Counters
+	 * * `hits`, `misses`, `coalesced`: requests of this process served from
+	 *     the cache, decoded, or which waited for another decode,
+	 * * `evictions`, `bytes`, `entries`: shared by every process,
+	 * * `probes`: index slots visited by the lookups and claims of this
+	 *     process.
+	 */
+	struct Counters {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t coalesced;
+		uint64_t evictions;
+		uint64_t bytes;
+		uint64_t entries;
+		uint64_t probes;
+	};
+
+public:
+	/**
+	 * * `SharedCache(const std::string &name, uint64_t budget, unsigned int slotCount)`
+	 *     Open the named cache, creating it with the given budget (bytes of
+	 *     samples) and slot count if it does not exist yet. The settings of
+	 *     an existing cache are kept.
+	 */
+	SharedCache(const std::string &name, uint64_t budget, unsigned int slotCount = DefaultSlotCount);
+	virtual ~SharedCache();
+
+public:
+	/**
+	 * * `static void remove(const std::string &name)`
+	 *     Unlink the named cache and its segments. Processes which have
+	 *     it open keep their mappings.
+	 */
+	static void remove(const std::string &name);
+
+public:
+	/**
+	 * * `std::shared_ptr<const Buffer> decode(const std::string &path)`
+	 * * `std::shared_ptr<const Buffer> decode(const std::string &path, const Decoder &)`
+	 *     Get the given file, decoded with the decoder matching its
+	 *     extension or with the given one. Decoders with a channel mixer,
+	 *     which cannot be identified across processes, empty files and
+	 *     files which are not regular bypass the cache.
+	 */
+	std::shared_ptr<const Buffer> decode(const std::string &path);
+	std::shared_ptr<const Buffer> decode(const std::string &path, const Decoder &);
+	uint64_t budget() const;
+	Counters counters() const;
+
+private:
+	struct Header;
+	struct Slot;
+	struct Key {
+		uint64_t values[5];                 // device, inode, size, mtime, decoder
+		uint64_t hash() const;
+	};
+	enum class Lookup {
+		Hit,
+		Filling,
+		Miss,
+		Unavailable,
+	};
+	enum class Claim {
+		Done,
+		Exists,
+		Full,
+	};
+
+	Header * header() const;
+	Slot * slot(unsigned int index) const;
+	bool matches(const Slot &, uint64_t word, const Key &) const;
+	void lock() const;
+	void unlock() const;
+	Lookup lookup(const Key &, std::shared_ptr<const Buffer> &, unsigned int &index, uint64_t &word);
+	std::shared_ptr<const Buffer> map(unsigned int index, uint32_t generation);
+	Claim claim(const Key &, unsigned int &index, uint32_t &generation);
+	std::shared_ptr<const Buffer> publish(unsigned int index, uint32_t generation, const Buffer &);
+	void release(unsigned int index);
+	void abandon(unsigned int index, uint64_t word);
+	void wait(unsigned int index, uint64_t word);
+	bool evict(uint64_t size);
+	void purge();
+
+private:
+	std::string _name;
+	std::shared_ptr<char> _index;
+	size_t _indexSize;
+	std::atomic<uint64_t> _hits;
+	std::atomic<uint64_t> _misses;
+	std::atomic<uint64_t> _coalesced;
+	std::atomic<uint64_t> _probes;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSHAREDCACHE_H_ */
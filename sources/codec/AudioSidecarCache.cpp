@@ -0,0 +1,340 @@
+/*
+ * AudioSidecarCache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <sstream>
+#include <typeinfo>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../AudioBuffer.h"
+#include "../AudioChannelMixer.h"
+#include "../AudioError.h"
+#include "../AudioTrace.h"
+#include "../analysis/AudioPeakPyramid.h"
+#include "../io/AudioVectoredSink.h"
+#include "AudioDecoder.h"
+#include "AudioSidecarCache.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const size_t SidecarCache::Alignment;
+
+namespace {
+
+const char Magic[8] = { 'N', 'R', 'P', 'C', 'M', '\r', '\n', '\x1a' };
+const uint32_t Version = 1;
+const char Extension[] = ".pcm";
+const time_t TouchDelay = 60;           // seconds between two last use updates
+const time_t TemporaryLifetime = 3600;  // temporary files older are left by dead writers
+
+struct SidecarHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t dataOffset;
+	uint64_t identity;
+	uint32_t channelCount;
+	uint32_t sampleRate;
+	uint32_t bitDepth;
+	uint32_t frameCount;
+	uint64_t dataSize;
+	uint64_t peaksOffset;
+	uint64_t peaksSize;
+};
+
+static_assert(sizeof(SidecarHeader) == 64, "Unexpected sidecar header layout.");
+
+uint64_t fnv(uint64_t hash, const void *data, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ static_cast<const unsigned char *>(data)[i])*0x100000001b3ull;
+	}
+	return hash;
+}
+
+template<typename T>
+uint64_t fnv(uint64_t hash, const T &value) {
+	return fnv(hash, &value, sizeof(value));
+}
+
+bool ends_with(const std::string &s, const std::string &suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+SidecarCache::SidecarCache(const std::string &directory, uint64_t budget) :
+	_directory(directory),
+	_budget(budget),
+	_storesPeaks(false),
+	_hits(0),
+	_misses(0),
+	_stores(0),
+	_evictions(0),
+	_bytes(0),
+	_entries(0),
+	_scanned(false) {
+	if (mkdir(_directory.data(), 0777) < 0 && errno != EEXIST) {
+		Error::raise(Error::Status::IOError, "Failed to create " + _directory + ": " + strerror(errno));
+	}
+}
+
+SidecarCache::Counters SidecarCache::counters() const {
+	Counters counters = { _hits, _misses, _stores, _evictions, _bytes, _entries };
+	return counters;
+}
+
+// The identity covers everything the decoded samples depend on. Files
+// which are not regular have none.
+bool SidecarCache::identify(const std::string &path, const Decoder &decoder, uint64_t &identity, std::string &name) const {
+	struct stat st;
+	if (stat(path.data(), &st) != 0 || ! S_ISREG(st.st_mode)) {
+		return false;
+	}
+
+	const char *type = typeid(decoder).name();
+	uint32_t dither = (uint32_t)decoder.dither();
+	identity = 0xcbf29ce484222325ull;
+	identity = fnv(identity, st.st_dev);
+	identity = fnv(identity, st.st_ino);
+	identity = fnv(identity, st.st_size);
+	identity = fnv(identity, st.st_mtim.tv_sec);
+	identity = fnv(identity, st.st_mtim.tv_nsec);
+	identity = fnv(identity, type, strlen(type));
+	identity = fnv(identity, dither);
+	if (std::shared_ptr<const ChannelMixer> mixer = decoder.channelMixer()) {
+		uint32_t counts[2] = { mixer->inputChannelCount(), mixer->outputChannelCount() };
+		identity = fnv(identity, counts);
+		for (unsigned int o = 0; o < counts[1]; ++o) {
+			for (unsigned int i = 0; i < counts[0]; ++i) {
+				identity = fnv(identity, mixer->gain(o, i));
+			}
+		}
+	}
+
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)identity);
+	name = _directory + "/" + hex + Extension;
+	return true;
+}
+
+// Map a valid sidecar of the given file, privately. The caller unmaps it.
+const char * SidecarCache::map(const std::string &path, const Decoder &decoder, size_t &size, uint64_t &identity) const {
+	std::string name;
+	struct stat st;
+
+	if (! identify(path, decoder, identity, name)) {
+		return nullptr;
+	}
+	int fd = open(name.data(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return nullptr;
+	}
+	void *data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SidecarHeader)) {
+		size = st.st_size;
+		data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+
+	const SidecarHeader *header = static_cast<const SidecarHeader *>(data);
+	if (memcmp(header->magic, Magic, sizeof(Magic)) != 0
+			|| header->version != Version
+			|| header->identity != identity
+			|| header->dataOffset < sizeof(SidecarHeader)
+			|| header->dataOffset + header->dataSize > size
+			|| header->peaksOffset + header->peaksSize > size
+			|| (header->bitDepth != 8 && header->bitDepth != 16)
+			|| header->channelCount == 0
+			|| (uint64_t)header->frameCount*header->channelCount*(header->bitDepth/8) != header->dataSize) {
+		munmap(data, size);
+		return nullptr;
+	}
+
+	// The modification time of the sidecar is its last use, for eviction.
+	if (st.st_mtime + TouchDelay < time(nullptr)) {
+		utimensat(AT_FDCWD, name.data(), nullptr, 0);
+	}
+	return static_cast<const char *>(data);
+}
+
+Buffer * SidecarCache::load(const std::string &path, const Decoder &decoder) {
+	Trace::Span span("sidecar.load", "cache");
+	uint64_t identity;
+	size_t size;
+	const char *data = map(path, decoder, size, identity);
+
+	if (! data) {
+		_misses++;
+		return nullptr;
+	}
+	_hits++;
+
+	const SidecarHeader *header = reinterpret_cast<const SidecarHeader *>(data);
+	std::shared_ptr<const void> owner(data, [size](const void *data) {
+		munmap(const_cast<void *>(data), size);
+	});
+	return new Buffer(Format(header->channelCount, header->sampleRate, header->bitDepth),
+		header->dataSize, data + header->dataOffset, owner);
+}
+
+PeakPyramid * SidecarCache::loadPeaks(const std::string &path, const Decoder &decoder) {
+	uint64_t identity;
+	size_t size;
+	const char *data = map(path, decoder, size, identity);
+	PeakPyramid *peaks = nullptr;
+
+	if (! data) {
+		return nullptr;
+	}
+
+	const SidecarHeader *header = reinterpret_cast<const SidecarHeader *>(data);
+	if (header->peaksSize > 0) {
+		std::istringstream input(std::string(data + header->peaksOffset, header->peaksSize));
+		try {
+			peaks = new PeakPyramid(PeakPyramid::load(input));
+		} catch (Error &) {
+		}
+	}
+	munmap(const_cast<char *>(data), size);
+	return peaks;
+}
+
+void SidecarCache::store(const std::string &path, const Decoder &decoder, const Buffer &buffer) {
+	Trace::Span span("sidecar.store", "cache");
+	static std::atomic<unsigned int> counter(0);
+	uint64_t identity;
+	std::string name;
+
+	if (! identify(path, decoder, identity, name)) {
+		return;
+	}
+
+	std::string peaks;
+	if (_storesPeaks) {
+		PeakPyramid pyramid;
+		std::ostringstream output;
+		pyramid.process(buffer, 0, buffer.frameCount());
+		pyramid.finish();
+		pyramid.save(output);
+		peaks = output.str();
+	}
+
+	Format format = buffer.format();
+	SidecarHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.dataOffset = Alignment;
+	header.identity = identity;
+	header.channelCount = format.channelCount();
+	header.sampleRate = format.sampleRate();
+	header.bitDepth = format.bitDepth();
+	header.frameCount = buffer.frameCount();
+	header.dataSize = format.sizeForFrameCount(buffer.frameCount());
+	if (! peaks.empty()) {
+		header.peaksOffset = (header.dataOffset + header.dataSize + 7) & ~(uint64_t)7;
+		header.peaksSize = peaks.size();
+	}
+
+	std::string temporary = name + ".tmp" + std::to_string(getpid()) + "." + std::to_string(counter++);
+	try {
+		VectoredSink sink(temporary);
+		std::vector<char> padding(Alignment);
+		struct iovec chunks[5] = {
+			{ &header, sizeof(header) },
+			{ padding.data(), Alignment - sizeof(header) },
+			{ const_cast<char *>(buffer.data()), header.dataSize },
+			{ padding.data(), header.peaksSize > 0 ? header.peaksOffset - header.dataOffset - header.dataSize : 0 },
+			{ const_cast<char *>(peaks.data()), peaks.size() },
+		};
+		sink.write(chunks, 5);
+		sink.flush();
+		// The samples must be on disk before the rename is: map() checks
+		// the header only, a crash would leave a sidecar of silence.
+		if (fsync(sink.fd()) < 0) {
+			Error::raise(Error::Status::IOError, "Failed to sync " + temporary + ": " + strerror(errno));
+		}
+	} catch (Error &) {
+		unlink(temporary.data());
+		throw;
+	}
+	if (rename(temporary.data(), name.data()) < 0) {
+		int error = errno;
+		unlink(temporary.data());
+		Error::raise(Error::Status::IOError, "Failed to store " + name + ": " + strerror(error));
+	}
+	_stores++;
+	// A replaced sidecar is counted twice until the next scan, which only
+	// brings it sooner.
+	_bytes += header.peaksSize > 0 ? header.peaksOffset + header.peaksSize : header.dataOffset + header.dataSize;
+	_entries++;
+	if (! _scanned || _bytes > _budget) {
+		evict();
+	}
+}
+
+void SidecarCache::evict() {
+	Trace::Span span("sidecar.evict", "cache");
+	std::lock_guard<std::mutex> lock(_evictMutex);
+	std::vector<std::pair<time_t, std::string>> sidecars;
+	uint64_t bytes = 0;
+	time_t now = time(nullptr);
+	DIR *dir = opendir(_directory.data());
+
+	if (! dir) {
+		Error::raise(Error::Status::IOError, "Failed to read " + _directory + ": " + strerror(errno));
+	}
+	while (struct dirent *entry = readdir(dir)) {
+		std::string name = _directory + "/" + entry->d_name;
+		struct stat st;
+		if (entry->d_name[0] == '.' || stat(name.data(), &st) != 0 || ! S_ISREG(st.st_mode)) {
+			continue;
+		}
+		if (ends_with(name, Extension)) {
+			sidecars.push_back(std::make_pair(st.st_mtime, name));
+			bytes += st.st_size;
+		} else if (name.find(Extension + std::string(".tmp")) != std::string::npos && st.st_mtime + TemporaryLifetime < now) {
+			unlink(name.data());
+		}
+	}
+	closedir(dir);
+
+	// Oldest first. Sizes are read again, the sidecars may be replaced.
+	std::sort(sidecars.begin(), sidecars.end());
+	uint64_t entries = sidecars.size();
+	for (auto &sidecar : sidecars) {
+		if (bytes <= _budget) break;
+		struct stat st;
+		if (stat(sidecar.second.data(), &st) == 0 && unlink(sidecar.second.data()) == 0) {
+			bytes -= std::min<uint64_t>(bytes, st.st_size);
+			entries--;
+			_evictions++;
+		}
+	}
+	_bytes = bytes;
+	_entries = entries;
+	_scanned = true;
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
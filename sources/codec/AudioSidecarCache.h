@@ -0,0 +1,138 @@
+/*
+ * AudioSidecarCache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSIDECARCACHE_H_
+#define AUDIOSIDECARCACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+class Decoder;
+class PeakPyramid;
+/**
+ * ## Class SidecarCache
+ * Keep decoded files on disk, in a directory, as raw samples which are
+ * mapped in memory when the file is decoded again.
+ *
+ * A sidecar is named after the identity of its source: device, inode,
+ * size and modification time of the file, decoder type, dither and
+ * channel mixer gains. It holds a header (format, frame count, identity),
+ * the samples aligned on a page, then optionally the peak pyramid of the
+ * file (see [PeakPyramid](../analysis/AudioPeakPyramid.h)). Sidecars are
+ * written to a temporary file, synced then renamed in place, so readers
+ * never see a partial one, even after a crash, and are in the host byte
+ * order.
+ *
+ * Attached to a decoder (see `Decoder::setSidecarCache`), the cache is
+ * used transparently by `Decoder::decode(const std::string &)`:
+ *
+ *     std::shared_ptr<SidecarCache> cache(new SidecarCache("/var/cache/nraudio", 10ull << 30));
+ *     decoder->setSidecarCache(cache);
+ *     Buffer *buffer = decoder->decode("song.mp3");   // decoded, then stored
+ *     Buffer *again = decoder->decode("song.mp3");    // mapped, no copy
+ *
+ * Mapped buffers are private copy-on-write mappings: writing them does
+ * not change the sidecar. The cache counts the bytes it stores; the
+ * directory is scanned at the first store and when the count exceeds the
+ * budget, then the oldest sidecars (by last use) are removed until it
+ * fits. Sidecars stored by other processes are seen at the next scan.
+ */
+class SidecarCache {
+public:
+	static const size_t Alignment = 4096;
+
+	/**
+	 * ### Counters
+	 * * `hits`, `misses`: sidecars mapped, or not found,
+	 * * `stores`, `evictions`: sidecars written, or removed for the budget,
+	 * * `bytes`, `entries`: directory content at the last eviction pass,
+ *     plus the sidecars stored since.
+	 */
+	struct Counters {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t stores;
+		uint64_t evictions;
+		uint64_t bytes;
+		uint64_t entries;
+	};
+
+public:
+	/**
+	 * * `SidecarCache(const std::string &directory, uint64_t budget)`
+	 *     Use the given directory, created if needed, holding up to
+	 *     `budget` bytes of sidecars.
+	 */
+	SidecarCache(const std::string &directory, uint64_t budget);
+	virtual ~SidecarCache() {}
+
+public:
+	const std::string & directory() const { return _directory; }
+	uint64_t budget() const { return _budget; }
+	/**
+	 * * `bool storesPeaks() const`
+	 * * `void setStoresPeaks(bool)`
+	 *     Store the peak pyramid of the decoded files with their samples
+	 *     (disabled by default).
+	 */
+	bool storesPeaks() const { return _storesPeaks; }
+	void setStoresPeaks(bool storesPeaks) { _storesPeaks = storesPeaks; }
+	Counters counters() const;
+
+	/**
+	 * * `Buffer * load(const std::string &path, const Decoder &)`
+	 *     Map the sidecar of the given file decoded by the given decoder,
+	 *     `nullptr` if there is none or if it is not valid.
+	 */
+	Buffer * load(const std::string &path, const Decoder &);
+	/**
+	 * * `PeakPyramid * loadPeaks(const std::string &path, const Decoder &)`
+	 *     Load the peak pyramid stored with the sidecar, `nullptr` if there
+	 *     is none.
+	 */
+	PeakPyramid * loadPeaks(const std::string &path, const Decoder &);
+	/**
+	 * * `void store(const std::string &path, const Decoder &, const Buffer &)`
+	 *     Write the sidecar of the given file, then evict sidecars if the
+	 *     budget is exceeded. Raise `Error::Status::IOError` on failure.
+	 */
+	void store(const std::string &path, const Decoder &, const Buffer &);
+	/**
+	 * * `void evict()`
+	 *     Scan the directory and remove the least recently used sidecars
+	 *     until it fits in the budget.
+	 */
+	void evict();
+
+private:
+	bool identify(const std::string &path, const Decoder &, uint64_t &identity, std::string &name) const;
+	const char * map(const std::string &path, const Decoder &, size_t &size, uint64_t &identity) const;
+
+private:
+	std::string _directory;
+	uint64_t _budget;
+	bool _storesPeaks;
+	std::mutex _evictMutex;
+	std::atomic<uint64_t> _hits;
+	std::atomic<uint64_t> _misses;
+	std::atomic<uint64_t> _stores;
+	std::atomic<uint64_t> _evictions;
+	std::atomic<uint64_t> _bytes;
+	std::atomic<uint64_t> _entries;
+	std::atomic<bool> _scanned;             // the directory was scanned once
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSIDECARCACHE_H_ */
@@ -0,0 +1,217 @@
+/*
+ * AudioVirtualBuffer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <climits>
+
+#include "../AudioBuffer.h"
+#include "../AudioError.h"
+#include "../AudioTrace.h"
+#include "../io/AudioSource.h"
+#include "AudioVirtualBuffer.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int VirtualBuffer::DefaultPageFrameCount;
+const size_t VirtualBuffer::DefaultBudget;
+
+VirtualBuffer::VirtualBuffer(const std::string &path, size_t budget, unsigned int pageFrameCount) :
+	VirtualBuffer(path, std::shared_ptr<const Decoder>(Decoder::getDecoder(path)), budget, pageFrameCount) {
+}
+
+VirtualBuffer::VirtualBuffer(const std::string &path, std::shared_ptr<const Decoder> decoder, size_t budget, unsigned int pageFrameCount) :
+	_file(new MappedFileSource(path)),
+	_decoder(decoder),
+	_pageFrameCount(std::max(pageFrameCount, 1u)),
+	_budget(budget),
+	_lastPage(UINT_MAX),
+	_counters() {
+	Trace::Span span("virtual_buffer.open", "codec");
+	_index.reset(_decoder->index(_file->data(), _file->size()));
+	if (! _index) {
+		Error::raise(Error::Status::NotImplemented, "No random access for " + path + ".");
+	}
+	_pageCount = (frameCount() + _pageFrameCount - 1)/_pageFrameCount;
+	_capacity = std::max<size_t>(2, _budget/format().sizeForFrameCount(_pageFrameCount));
+	_prefetcher.reset(new Executor::Group(1));
+}
+
+VirtualBuffer::~VirtualBuffer() {
+}
+
+VirtualBuffer::Counters VirtualBuffer::counters() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _counters;
+}
+
+std::shared_ptr<const Buffer> VirtualBuffer::decodePage(unsigned int index) const {
+	std::lock_guard<std::mutex> lock(_decodeMutex);
+	Trace::Span span("virtual_buffer.page", "codec");
+	return std::shared_ptr<const Buffer>(_decoder->decode(*_index, index*_pageFrameCount, _pageFrameCount));
+}
+
+void VirtualBuffer::insert(unsigned int index, const std::shared_ptr<const Buffer> &page) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pending.erase(index);
+	_pages.push_front(std::make_pair(index, page));
+	_pageIndex[index] = _pages.begin();
+	_counters.pages++;
+	_counters.bytes += page->format().sizeForFrameCount(page->frameCount());
+	while (_pages.size() > _capacity) {
+		const std::shared_ptr<const Buffer> &last = _pages.back().second;
+		_counters.evictions++;
+		_counters.pages--;
+		_counters.bytes -= last->format().sizeForFrameCount(last->frameCount());
+		_pageIndex.erase(_pages.back().first);
+		_pages.pop_back();
+	}
+}
+
+void VirtualBuffer::prefetch(unsigned int index) const {
+	std::shared_ptr<std::promise<std::shared_ptr<const Buffer>>> promise(new std::promise<std::shared_ptr<const Buffer>>);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_pageIndex.count(index) > 0 || _pending.count(index) > 0) {
+			return;
+		}
+		_pending.insert(std::make_pair(index, promise->get_future().share()));
+		_counters.prefetches++;
+	}
+	_prefetcher->submit([this, index, promise]() {
+		std::shared_ptr<const Buffer> page;
+		try {
+			page = decodePage(index);
+		} catch (...) {
+			// Raised again to the read waiting for it, if any.
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending.erase(index);
+			}
+			promise->set_exception(std::current_exception());
+			return;
+		}
+		insert(index, page);
+		promise->set_value(page);
+	});
+}
+
+std::shared_ptr<const Buffer> VirtualBuffer::page(unsigned int index) const {
+	std::promise<std::shared_ptr<const Buffer>> promise;
+	std::shared_ptr<const Buffer> page;
+	Pending pending;
+	bool sequential = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (index != _lastPage) {
+			sequential = index == _lastPage + 1;
+			_lastPage = index;
+		}
+		auto entry = _pageIndex.find(index);
+		auto waiting = _pending.find(index);
+		if (entry != _pageIndex.end()) {
+			_pages.splice(_pages.begin(), _pages, entry->second);
+			page = entry->second->second;
+			_counters.hits++;
+		} else if (waiting != _pending.end()) {
+			pending = waiting->second;
+			_counters.hits++;
+		} else {
+			_pending.insert(std::make_pair(index, promise.get_future().share()));
+			_counters.misses++;
+		}
+	}
+
+	if (sequential && index + 1 < _pageCount) {
+		prefetch(index + 1);
+	}
+	if (page) {
+		return page;
+	}
+	if (pending.valid()) {
+		Trace::Span span("virtual_buffer.wait", "codec");
+		return pending.get();
+	}
+
+	try {
+		page = decodePage(index);
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pending.erase(index);
+		}
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+	insert(index, page);
+	promise.set_value(page);
+	return page;
+}
+
+// The destination of the frames from `frame`, interleaved or planar.
+template<typename T>
+static T * _at(T *dst, unsigned int frame, unsigned int channelCount, std::vector<T *> &) {
+	return dst + (size_t)frame*channelCount;
+}
+
+template<typename T>
+static T ** _at(T **dst, unsigned int frame, unsigned int channelCount, std::vector<T *> &planes) {
+	for (unsigned int c = 0; c < channelCount; ++c) {
+		planes[c] = dst[c] + frame;
+	}
+	return planes.data();
+}
+
+template<typename T, typename DEST>
+unsigned int VirtualBuffer::readFrames(unsigned int offset, unsigned int count, DEST dst) const {
+	if (offset + count > frameCount()) {
+		count = offset < frameCount() ? frameCount() - offset : 0;
+	}
+	unsigned int done = 0, channel_count = format().channelCount();
+	std::vector<T *> planes(channel_count);
+	while (done < count) {
+		unsigned int index = (offset + done)/_pageFrameCount;
+		unsigned int start = (offset + done)%_pageFrameCount;
+		std::shared_ptr<const Buffer> samples = page(index);
+		unsigned int n = samples->read(start, std::min(count - done, _pageFrameCount - start), _at(dst, done, channel_count, planes));
+		if (n == 0) {
+			// The stream holds fewer frames than its index announced.
+			break;
+		}
+		done += n;
+	}
+	return done;
+}
+
+unsigned int VirtualBuffer::read(unsigned int offset, unsigned int count, float *dst) const {
+	return readFrames<float>(offset, count, dst);
+}
+
+unsigned int VirtualBuffer::read(unsigned int offset, unsigned int count, int8_t *dst) const {
+	return readFrames<int8_t>(offset, count, dst);
+}
+
+unsigned int VirtualBuffer::read(unsigned int offset, unsigned int count, int16_t *dst) const {
+	return readFrames<int16_t>(offset, count, dst);
+}
+
+unsigned int VirtualBuffer::read(unsigned int offset, unsigned int count, float **dst) const {
+	return readFrames<float>(offset, count, dst);
+}
+
+unsigned int VirtualBuffer::read(unsigned int offset, unsigned int count, int8_t **dst) const {
+	return readFrames<int8_t>(offset, count, dst);
+}
+
+unsigned int VirtualBuffer::read(unsigned int offset, unsigned int count, int16_t **dst) const {
+	return readFrames<int16_t>(offset, count, dst);
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
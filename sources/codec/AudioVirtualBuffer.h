@@ -0,0 +1,143 @@
+/*
+ * AudioVirtualBuffer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOVIRTUALBUFFER_H_
+#define AUDIOVIRTUALBUFFER_H_
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../AudioExecutor.h"
+#include "../AudioFormat.h"
+#include "AudioDecoder.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+class MappedFileSource;
+/**
+ * ## Class VirtualBuffer
+ * A read-only view of a whole file, decoded lazily by pages of
+ * `pageFrameCount()` frames.
+ *
+ * The file is mapped in memory and indexed by its decoder (see
+ * `Decoder::index`), then pages are decoded on first access and kept in
+ * an LRU cache of `budget()` bytes (two pages at least). When reads go
+ * from a page to the next one, the page after is decoded ahead on the
+ * shared executor. Opening the file and reading its first frames cost
+ * the same whatever its length.
+ *
+ *     VirtualBuffer track("concert.flac");
+ *     track.read(track.format().sampleRate()*3600, 4096, samples);
+ *
+ * A `VirtualBuffer` is not a `Buffer`: it has no samples in memory to
+ * expose with `data()`, it offers the same `read` methods instead.
+ *
+ * Only formats with random access can be opened: WAV and FLAC. Others
+ * raise `Error::Status::NotImplemented`. Concurrent reads are safe; page
+ * decodes are serialized, so the decoder statistics and analyzers are fed
+ * one page at a time.
+ */
+class VirtualBuffer {
+public:
+	static const unsigned int DefaultPageFrameCount = 1 << 16;
+	static const size_t DefaultBudget = 32 << 20;
+
+	/**
+	 * ### Counters
+	 * * `hits`, `misses`: page accesses served by the cache, or decoded,
+	 * * `prefetches`: pages decoded ahead,
+	 * * `evictions`: pages dropped to fit the budget,
+	 * * `pages`, `bytes`: current content of the cache.
+	 */
+	struct Counters {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t prefetches;
+		uint64_t evictions;
+		uint64_t pages;
+		uint64_t bytes;
+	};
+
+public:
+	/**
+	 * * `VirtualBuffer(const std::string &path, size_t budget, unsigned int pageFrameCount)`
+	 *     Open the given file with the decoder matching its extension.
+	 */
+	VirtualBuffer(const std::string &path, size_t budget = DefaultBudget, unsigned int pageFrameCount = DefaultPageFrameCount);
+	/**
+	 * * `VirtualBuffer(const std::string &path, std::shared_ptr<const Decoder>, size_t budget, unsigned int pageFrameCount)`
+	 *     Open the given file with the given decoder, its channel mixer and
+	 *     dither included.
+	 */
+	VirtualBuffer(const std::string &path, std::shared_ptr<const Decoder>, size_t budget = DefaultBudget, unsigned int pageFrameCount = DefaultPageFrameCount);
+	virtual ~VirtualBuffer();
+
+public:
+	Format format() const { return _index->format(); }
+	unsigned int frameCount() const { return _index->frameCount(); }
+	double duration() const { return format().durationForFrameCount(frameCount()); }
+	unsigned int pageFrameCount() const { return _pageFrameCount; }
+	size_t budget() const { return _budget; }
+	Counters counters() const;
+
+	/**
+	 * * `unsigned int read(unsigned int offset, unsigned int count, T *dst) const`
+	 *     Read interleaved frames, as `Buffer::read` does. Return the count
+	 *     of frames read.
+	 */
+	unsigned int read(unsigned int offset, unsigned int count, float *dst) const;
+	unsigned int read(unsigned int offset, unsigned int count, int8_t *dst) const;
+	unsigned int read(unsigned int offset, unsigned int count, int16_t *dst) const;
+	/**
+	 * * `unsigned int read(unsigned int offset, unsigned int count, T **dst) const`
+	 *     Read planar frames, one destination per channel.
+	 */
+	unsigned int read(unsigned int offset, unsigned int count, float **dst) const;
+	unsigned int read(unsigned int offset, unsigned int count, int8_t **dst) const;
+	unsigned int read(unsigned int offset, unsigned int count, int16_t **dst) const;
+
+private:
+	typedef std::shared_future<std::shared_ptr<const Buffer>> Pending;
+	typedef std::list<std::pair<unsigned int, std::shared_ptr<const Buffer>>> Pages;
+
+	std::shared_ptr<const Buffer> page(unsigned int index) const;
+	std::shared_ptr<const Buffer> decodePage(unsigned int index) const;
+	void insert(unsigned int index, const std::shared_ptr<const Buffer> &) const;
+	void prefetch(unsigned int index) const;
+	template<typename T, typename DEST>
+	unsigned int readFrames(unsigned int offset, unsigned int count, DEST dst) const;
+
+private:
+	std::unique_ptr<MappedFileSource> _file;
+	std::shared_ptr<const Decoder> _decoder;
+	std::unique_ptr<Decoder::Index> _index;
+	unsigned int _pageFrameCount;
+	unsigned int _pageCount;
+	size_t _budget;
+	size_t _capacity;                       // pages kept in the cache
+	mutable std::mutex _mutex;
+	mutable std::mutex _decodeMutex;
+	mutable Pages _pages;                   // most recently used first
+	mutable std::unordered_map<unsigned int, Pages::iterator> _pageIndex;
+	mutable std::unordered_map<unsigned int, Pending> _pending;
+	mutable unsigned int _lastPage;
+	mutable Counters _counters;
+	std::unique_ptr<Executor::Group> _prefetcher; // last, waited first
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOVIRTUALBUFFER_H_ */
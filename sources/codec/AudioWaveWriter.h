@@ -0,0 +1,104 @@
+/*
+ * AudioWaveWriter.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOWAVEWRITER_H_
+#define AUDIOWAVEWRITER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../AudioExecutor.h"
+#include "../AudioFormat.h"
+#include "../AudioRequantizer.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+class Buffer;
+/**
+ * ## Class WaveWriter
+ * Write a WAV file with several tasks of the shared executor.
+ *
+ * Each `write` appends frames: the file is extended with `fallocate`, then
+ * the frames are split in ranges of `ChunkFrameCount` frames which are
+ * converted to the file format (bit depth, interleaving, requantization)
+ * and written with `pwrite` at their offset in parallel. The headers are
+ * written at construction for an empty stream, `finish` patches the RIFF
+ * and data sizes, so frames can be streamed by successive writes.
+ *
+ *     WaveWriter writer("out.wav", Format(2, 44100, 16));
+ *     writer.reserve(total_frame_count);   // optional
+ *     writer.write(buffer);
+ *     writer.finish();
+ */
+class WaveWriter {
+public:
+	static const unsigned int ChunkFrameCount = 1 << 16;
+
+public:
+	/**
+	 * * `WaveWriter(const std::string &path, Format, unsigned int threadCount, Requantizer::Dither)`
+	 *     Create (or truncate) the given file. At most `threadCount` ranges
+	 *     are written at once, as many as the executor has workers if 0
+	 *     (the default); the dither is used for float frames, none by
+	 *     default.
+	 */
+	WaveWriter(const std::string &path, Format, unsigned int threadCount = 0, Requantizer::Dither = Requantizer::Dither::None);
+	/**
+	 * * `~WaveWriter()`
+	 *     Call `finish` if needed, ignoring errors.
+	 */
+	virtual ~WaveWriter();
+
+public:
+	Format format() const { return _format; }
+	uint64_t frameCount() const { return _frameCount; }
+
+	/**
+	 * * `void reserve(uint64_t frameCount)`
+	 *     Preallocate the file for the given total frame count.
+	 */
+	void reserve(uint64_t frameCount);
+	/**
+	 * * `void write(const Buffer &)`
+	 *     Append the frames of a buffer with the same channel count, its
+	 *     bit depth is converted to the file one.
+	 */
+	void write(const Buffer &);
+	/**
+	 * * `void write(unsigned int frameCount, const float * const *channels)`
+	 * * `void write(unsigned int frameCount, const float *interleaved)`
+	 *     Append planar or interleaved float frames, requantized to the
+	 *     file bit depth.
+	 */
+	void write(unsigned int frameCount, const float * const *channels);
+	void write(unsigned int frameCount, const float *interleaved);
+	/**
+	 * * `void finish()`
+	 *     Write the final sizes in the headers and close the file.
+	 */
+	void finish();
+
+private:
+	template<typename CONVERT>
+	void writeRanges(unsigned int frameCount, CONVERT convert);
+	void patchHeaders(int fd);
+
+private:
+	Format _format;
+	Requantizer::Dither _dither;
+	int _fd;
+	uint64_t _frameCount;
+	uint64_t _chunkIndex;                   // seeds the requantizers
+	std::unique_ptr<Executor::Group> _pool;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOWAVEWRITER_H_ */
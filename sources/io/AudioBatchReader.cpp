@@ -0,0 +1,466 @@
+/*
+ * AudioBatchReader.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../AudioError.h"
+#include "../AudioExecutor.h"
+#include "../AudioTrace.h"
+#include "AudioBatchReader.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const unsigned int BatchReader::DefaultQueueDepth;
+const size_t BatchReader::DefaultHeaderSize;
+
+namespace {
+
+// Serve the head already read, then read the rest of the file with
+// positional reads.
+class HeadedFileSource : public BufferedSource {
+public:
+	HeadedFileSource(const char *header, size_t headerSize, int fd) :
+		BufferedSource(1 << 20),
+		_header(header),
+		_headerSize(headerSize),
+		_fd(fd),
+		_offset(0),
+		_size(-1) {
+		struct stat st;
+		if (fstat(_fd, &st) == 0 && S_ISREG(st.st_mode)) {
+			_size = st.st_size;
+		}
+	}
+
+	virtual int64_t size() const { return _size; }
+
+protected:
+	virtual size_t fill(char *dst, size_t size) {
+		if (_offset < _headerSize) {
+			size = std::min(size, _headerSize - _offset);
+			memcpy(dst, _header + _offset, size);
+			_offset += size;
+			return size;
+		}
+
+		ssize_t count;
+		while ((count = pread(_fd, dst, size, _offset)) < 0) {
+			if (errno != EINTR) {
+				Error::raise(Error::Status::IOError, std::string("Failed to read: ") + strerror(errno));
+			}
+		}
+		_offset += count;
+		return count;
+	}
+
+private:
+	const char *_header;
+	size_t _headerSize;
+	int _fd;
+	uint64_t _offset;
+	int64_t _size;
+};
+
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// File //////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+BatchReader::File::File(size_t headerSize) :
+	_fd(-1),
+	_error(0),
+	_header(headerSize),
+	_size(0) {
+}
+
+void BatchReader::File::reset(const std::string &path) {
+	_path = path;
+	_fd = -1;
+	_error = 0;
+	_size = 0;
+}
+
+void BatchReader::File::close() {
+	_source.reset();
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+}
+
+Source & BatchReader::File::source() {
+	if (! _source) {
+		if (complete()) {
+			_source.reset(new MemorySource(_header.data(), _size));
+		} else {
+			_source.reset(new HeadedFileSource(_header.data(), _size, _fd));
+		}
+	}
+	return *_source;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Ring //////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+// Minimal io_uring, through the raw system calls: submission and
+// completion rings shared with the kernel, the kernel consumes the
+// submission tail and produces the completion tail.
+struct BatchReader::Ring {
+	int fd;
+	unsigned int *sqTail;
+	unsigned int *sqMask;
+	unsigned int *sqArray;
+	unsigned int *cqHead;
+	unsigned int *cqTail;
+	unsigned int *cqMask;
+	struct io_uring_cqe *cqes;
+	struct io_uring_sqe *sqes;
+	void *sqMap;
+	size_t sqMapSize;
+	void *cqMap;
+	size_t cqMapSize;
+	size_t sqesSize;
+	unsigned int pending;
+
+	Ring() : fd(-1), sqes((struct io_uring_sqe *)MAP_FAILED), sqMap(MAP_FAILED), cqMap(MAP_FAILED), pending(0) {}
+
+	~Ring() {
+		if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+		if (cqMap != MAP_FAILED && cqMap != sqMap) munmap(cqMap, cqMapSize);
+		if (sqMap != MAP_FAILED) munmap(sqMap, sqMapSize);
+		if (fd >= 0) close(fd);
+	}
+
+	// Return false if the kernel lacks io_uring or the operations used.
+	bool init(unsigned int entries) {
+		struct io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		if ((fd = syscall(__NR_io_uring_setup, entries, &params)) < 0) {
+			return false;
+		}
+		if (! (params.features & IORING_FEAT_SINGLE_MMAP) || ! supported()) {
+			return false;
+		}
+
+		sqMapSize = std::max(
+			params.sq_off.array + params.sq_entries*sizeof(unsigned int),
+			params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe));
+		sqMap = cqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		cqMapSize = sqMapSize;
+		sqesSize = params.sq_entries*sizeof(struct io_uring_sqe);
+		sqes = (struct io_uring_sqe *)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqMap == MAP_FAILED || sqes == MAP_FAILED) {
+			return false;
+		}
+
+		char *sq = (char *)sqMap;
+		sqTail = (unsigned int *)(sq + params.sq_off.tail);
+		sqMask = (unsigned int *)(sq + params.sq_off.ring_mask);
+		sqArray = (unsigned int *)(sq + params.sq_off.array);
+		cqHead = (unsigned int *)(sq + params.cq_off.head);
+		cqTail = (unsigned int *)(sq + params.cq_off.tail);
+		cqMask = (unsigned int *)(sq + params.cq_off.ring_mask);
+		cqes = (struct io_uring_cqe *)(sq + params.cq_off.cqes);
+		return true;
+	}
+
+	bool supported() {
+		std::vector<char> storage(sizeof(struct io_uring_probe) + 256*sizeof(struct io_uring_probe_op));
+		struct io_uring_probe *probe = (struct io_uring_probe *)storage.data();
+
+		if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+			return false;
+		}
+		return probe->last_op >= IORING_OP_READ
+			&& (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED)
+			&& (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+	}
+
+	// The caller never has more operations in flight than ring entries.
+	struct io_uring_sqe * next(uint64_t userData) {
+		unsigned int tail = *sqTail;
+		unsigned int index = tail & *sqMask;
+		struct io_uring_sqe *sqe = &sqes[index];
+
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->user_data = userData;
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		pending++;
+		return sqe;
+	}
+
+	void submit(unsigned int waitCount) {
+		Trace::Span span("uring.enter", "io");
+		for (;;) {
+			long count = syscall(__NR_io_uring_enter, fd, pending, waitCount, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (count >= 0) {
+				pending -= count;
+				return;
+			}
+			if (errno != EINTR) {
+				Error::raise(Error::Status::IOError, std::string("io_uring_enter failed: ") + strerror(errno));
+			}
+		}
+	}
+
+	template<typename F>
+	void reap(F handler) {
+		unsigned int head = *cqHead;
+		unsigned int tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail; ++head) {
+			const struct io_uring_cqe &cqe = cqes[head & *cqMask];
+			uint64_t userData = cqe.user_data;
+			int res = cqe.res;
+			__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+			handler(userData, res);
+		}
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// BatchReader ///////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+BatchReader::BatchReader(Backend backend, unsigned int queueDepth, size_t headerSize) :
+	_backend(backend) {
+	queueDepth = std::max(queueDepth, 1u);
+	for (unsigned int i = 0; i < queueDepth; ++i) {
+		_files.push_back(std::unique_ptr<File>(new File(std::max<size_t>(headerSize, 1))));
+	}
+
+	if (_backend != Backend::ThreadPool) {
+		_ring.reset(new Ring);
+		if (_ring->init(queueDepth)) {
+			_backend = Backend::IOUring;
+		} else if (_backend == Backend::IOUring) {
+			Error::raise(Error::Status::IOError, "io_uring is not supported.");
+		} else {
+			_ring.reset();
+			_backend = Backend::ThreadPool;
+		}
+	}
+
+	if (_backend == Backend::ThreadPool) {
+		_pool.reset(new Executor::Group(std::min(queueDepth, 16u)));
+	}
+}
+
+BatchReader::~BatchReader() {
+}
+
+void BatchReader::read(const std::vector<std::string> &paths, const Callback &callback) {
+	if (_backend == Backend::IOUring) {
+		readRing(paths, callback);
+	} else {
+		readPool(paths, callback);
+	}
+}
+
+// Open stage then read stage, the user data holds the file index and the
+// stage. Files are handed to the callback as they complete; after a
+// callback error, the files in flight are only drained.
+void BatchReader::readRing(const std::vector<std::string> &paths, const Callback &callback) {
+	static const uint64_t ReadStage = 1ull << 32;
+
+	Ring &ring = *_ring;
+	std::vector<unsigned int> free_files;
+	std::exception_ptr error;
+	size_t next = 0;
+	unsigned int in_flight = 0;
+
+	for (unsigned int i = _files.size(); i > 0; --i) {
+		free_files.push_back(i - 1);
+	}
+
+	auto deliver = [&](File &file, unsigned int index) {
+		if (! error) {
+			try {
+				callback(file);
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+		file.close();
+		free_files.push_back(index);
+	};
+	// Read the rest of the header from where the previous read ended.
+	auto submit_read = [&](File &file, unsigned int index) {
+		struct io_uring_sqe *sqe = ring.next(index | ReadStage);
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = file._fd;
+		sqe->addr = (uint64_t)(uintptr_t)(file._header.data() + file._size);
+		sqe->len = file._header.size() - file._size;
+		sqe->off = file._size;
+		in_flight++;
+	};
+
+	for (;;) {
+		while (! error && next < paths.size() && ! free_files.empty()) {
+			unsigned int index = free_files.back();
+			File &file = *_files[index];
+			free_files.pop_back();
+			file.reset(paths[next++]);
+
+			struct io_uring_sqe *sqe = ring.next(index);
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = (uint64_t)(uintptr_t)file._path.c_str();
+			sqe->open_flags = O_RDONLY | O_CLOEXEC;
+			in_flight++;
+		}
+
+		if (in_flight == 0) {
+			break;
+		}
+
+		ring.submit(1);
+		ring.reap([&](uint64_t user_data, int res) {
+			unsigned int index = user_data & 0xffffffff;
+			File &file = *_files[index];
+
+			in_flight--;
+			if (res == -EINTR && (user_data & ReadStage) && ! error) {
+				submit_read(file, index);
+			} else if (res < 0) {
+				file._error = -res;
+				deliver(file, index);
+			} else if (! (user_data & ReadStage)) {
+				file._fd = res;
+				if (error) {
+					file.close();
+					free_files.push_back(index);
+					return;
+				}
+				submit_read(file, index);
+			} else {
+				// A short read is not the end of the file, as with pread:
+				// read again until the end or a full header.
+				file._size += res;
+				if (res > 0 && file._size < file._header.size() && ! error) {
+					submit_read(file, index);
+				} else {
+					deliver(file, index);
+				}
+			}
+		});
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void BatchReader::readPool(const std::vector<std::string> &paths, const Callback &callback) {
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<unsigned int> done;
+	std::vector<unsigned int> free_files;
+	std::exception_ptr error;
+	size_t next = 0;
+	unsigned int in_flight = 0;
+
+	for (unsigned int i = _files.size(); i > 0; --i) {
+		free_files.push_back(i - 1);
+	}
+
+	for (;;) {
+		while (! error && next < paths.size() && ! free_files.empty()) {
+			unsigned int index = free_files.back();
+			File &file = *_files[index];
+			free_files.pop_back();
+			file.reset(paths[next++]);
+			in_flight++;
+
+			_pool->submit([&, index]() {
+				File &file = *_files[index];
+				{
+					Trace::Span span("batch.read", "io");
+					if ((file._fd = open(file._path.data(), O_RDONLY | O_CLOEXEC)) < 0) {
+						file._error = errno;
+					}
+					while (file._fd >= 0 && file._size < file._header.size()) {
+						ssize_t count = pread(file._fd, file._header.data() + file._size, file._header.size() - file._size, file._size);
+						if (count < 0 && errno == EINTR) {
+							continue;
+						}
+						if (count < 0) {
+							file._error = errno;
+						}
+						if (count <= 0) {
+							break;
+						}
+						file._size += count;
+					}
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				done.push_back(index);
+				condition.notify_one();
+			});
+		}
+
+		if (in_flight == 0) {
+			break;
+		}
+
+		// While no read is done, run the queued ones here: the executor
+		// may be busy, or the caller one of its workers.
+		std::vector<unsigned int> completed;
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (! done.empty()) {
+					completed.swap(done);
+					break;
+				}
+			}
+			if (! _pool->runPending()) {
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&] { return ! done.empty(); });
+			}
+		}
+
+		for (unsigned int index : completed) {
+			File &file = *_files[index];
+			in_flight--;
+			if (! error) {
+				try {
+					callback(file);
+				} catch (...) {
+					error = std::current_exception();
+				}
+			}
+			file.close();
+			free_files.push_back(index);
+		}
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
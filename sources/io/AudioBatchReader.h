@@ -0,0 +1,146 @@
+/*
+ * AudioBatchReader.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOBATCHREADER_H_
+#define AUDIOBATCHREADER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../AudioExecutor.h"
+#include "AudioSource.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+
+/**
+ * ## Class BatchReader
+ * Open and read the head of many files at once, for library scans and
+ * batch transcodes.
+ *
+ * Up to `queueDepth` files are in flight: their opens, then their first
+ * `headerSize` bytes reads, are submitted together to io_uring, or run on
+ * the shared executor when io_uring is not available. Each file is handed
+ * to the callback, on the calling thread, as soon as its head is read:
+ *
+ *     BatchReader reader;
+ *     reader.read(paths, [](BatchReader::File &file) {
+ *         if (file.error() == 0) {
+ *             std::unique_ptr<Decoder> decoder(Decoder::getDecoder(file.path()));
+ *             std::unique_ptr<Buffer> buffer(decoder->decode(file.source()));
+ *         }
+ *     });
+ *
+ * Files not bigger than `headerSize` are read whole and decoded from
+ * memory, without copy; the other ones continue with positional reads of
+ * the file descriptor.
+ */
+class BatchReader {
+public:
+	static const unsigned int DefaultQueueDepth = 64;
+	static const size_t DefaultHeaderSize = 1 << 16;
+
+	/**
+	 * ### Backends
+	 * * `BatchReader::Backend::Auto`:       io_uring if the kernel supports
+	 *     it, the executor otherwise,
+	 * * `BatchReader::Backend::IOUring`:    io_uring, raise `IOError` if
+	 *     not supported,
+	 * * `BatchReader::Backend::ThreadPool`: blocking calls on the shared
+	 *     executor.
+	 */
+	enum class Backend {
+		Auto,
+		IOUring,
+		ThreadPool,
+	};
+
+	/**
+	 * ### Class BatchReader::File
+	 * A file handed to the callback, valid until the callback returns.
+	 */
+	class File {
+	public:
+		/**
+		 * * `const std::string & path() const`
+		 * * `int error() const`
+		 *     The `errno` value of the failed open or read, 0 on success.
+		 */
+		const std::string & path() const { return _path; }
+		int error() const { return _error; }
+		/**
+		 * * `const char * header() const`
+		 * * `size_t headerSize() const`
+		 *     The bytes read from the head of the file.
+		 * * `bool complete() const`
+		 *     True if the head is the whole file.
+		 */
+		const char * header() const { return _header.data(); }
+		size_t headerSize() const { return _size; }
+		bool complete() const { return _size < _header.size(); }
+		/**
+		 * * `Source & source()`
+		 *     The whole file, from its first byte.
+		 */
+		Source & source();
+
+	private:
+		friend class BatchReader;
+		File(size_t headerSize);
+		void reset(const std::string &path);
+		void close();
+
+	private:
+		std::string _path;
+		int _fd;
+		int _error;
+		std::vector<char> _header;
+		size_t _size;
+		std::unique_ptr<Source> _source;
+	};
+
+	typedef std::function<void(File &)> Callback;
+
+public:
+	BatchReader(Backend = Backend::Auto, unsigned int queueDepth = DefaultQueueDepth, size_t headerSize = DefaultHeaderSize);
+	virtual ~BatchReader();
+
+public:
+	/**
+	 * * `Backend backend() const`
+	 *     The backend in use, never `Backend::Auto`.
+	 */
+	Backend backend() const { return _backend; }
+	/**
+	 * * `void read(const std::vector<std::string> &paths, const Callback &)`
+	 *     Read the given files and call the callback once for each of them,
+	 *     in completion order. An exception thrown by the callback stops the
+	 *     batch once the files in flight are done.
+	 */
+	void read(const std::vector<std::string> &paths, const Callback &);
+
+private:
+	struct Ring;
+
+	void readRing(const std::vector<std::string> &, const Callback &);
+	void readPool(const std::vector<std::string> &, const Callback &);
+
+private:
+	Backend _backend;
+	std::vector<std::unique_ptr<File>> _files;
+	std::unique_ptr<Ring> _ring;
+	std::unique_ptr<Executor::Group> _pool;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOBATCHREADER_H_ */
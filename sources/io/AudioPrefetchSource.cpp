@@ -0,0 +1,197 @@
+/*
+ * AudioPrefetchSource.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+
+#include "../AudioTrace.h"
+#include "AudioPrefetchSource.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const size_t PrefetchSource::DefaultBlockSize;
+const unsigned int PrefetchSource::DefaultBlockCount;
+
+PrefetchSource::PrefetchSource(Source &upstream, size_t blockSize, unsigned int blockCount) :
+	_upstream(upstream),
+	_size(upstream.size()),
+	_position(0),
+	_blocks(std::max(blockCount, 1u)),
+	_head(0),
+	_filled(0),
+	_offset(0),
+	_end(false),
+	_stop(false),
+	_spillBegin(0) {
+	for (Block &block : _blocks) {
+		block.data.resize(std::max<size_t>(blockSize, 1));
+		block.size = 0;
+	}
+	start();
+}
+
+// The descriptor source buffer is kept minimal: block sized reads go
+// straight to the prefetch blocks.
+PrefetchSource::PrefetchSource(const std::string &path, size_t blockSize, unsigned int blockCount) :
+	_owned(new FileDescriptorSource(path, 1)),
+	_upstream(*_owned),
+	_size(_upstream.size()),
+	_position(0),
+	_blocks(std::max(blockCount, 1u)),
+	_head(0),
+	_filled(0),
+	_offset(0),
+	_end(false),
+	_stop(false),
+	_spillBegin(0) {
+	for (Block &block : _blocks) {
+		block.data.resize(std::max<size_t>(blockSize, 1));
+		block.size = 0;
+	}
+	start();
+}
+
+PrefetchSource::~PrefetchSource() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_condition.notify_all();
+	_thread.join();
+}
+
+void PrefetchSource::start() {
+	_thread = std::thread(&PrefetchSource::run, this);
+}
+
+// Fill the block following the filled ones until the end of the upstream
+// source. The block being filled is not visible to the reader, it is only
+// touched under lock once filled.
+void PrefetchSource::run() {
+	Trace::setThreadName("prefetch");
+
+	for (unsigned int tail = 0;; tail = (tail + 1)%_blocks.size()) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this] { return _stop || _filled < _blocks.size(); });
+			if (_stop) return;
+		}
+
+		Block &block = _blocks[tail];
+		std::exception_ptr error;
+		size_t count = 0;
+
+		try {
+			Trace::Span span("prefetch.read", "io");
+			count = _upstream.read(block.data.data(), block.data.size());
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		bool end = error || count < block.data.size();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (count > 0) {
+				block.size = count;
+				_filled++;
+			}
+			_end = end;
+			_error = error;
+		}
+		_condition.notify_all();
+
+		if (end) return;
+	}
+}
+
+PrefetchSource::Block * PrefetchSource::front() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_condition.wait(lock, [this] { return _filled > 0 || _end; });
+	if (_filled > 0) {
+		return &_blocks[_head];
+	}
+	if (_error) {
+		std::rethrow_exception(_error);
+	}
+	return nullptr;
+}
+
+void PrefetchSource::release() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_head = (_head + 1)%_blocks.size();
+		_filled--;
+		_offset = 0;
+	}
+	_condition.notify_all();
+}
+
+const char * PrefetchSource::peek(size_t &size) {
+	size_t spilled = _spill.size() - _spillBegin;
+
+	if (spilled == 0) {
+		Block *block = front();
+		if (block == nullptr) {
+			size = 0;
+			return _spill.data();
+		}
+		if (block->size - _offset >= size) {
+			return block->data.data() + _offset;
+		}
+	} else if (spilled >= size) {
+		return _spill.data() + _spillBegin;
+	}
+
+	// The peek straddles blocks: move the bytes to the spill buffer.
+	_spill.erase(_spill.begin(), _spill.begin() + _spillBegin);
+	_spillBegin = 0;
+	while (_spill.size() < size) {
+		Block *block = front();
+		if (block == nullptr) {
+			break;
+		}
+		size_t count = std::min(size - _spill.size(), block->size - _offset);
+		_spill.insert(_spill.end(), block->data.data() + _offset, block->data.data() + _offset + count);
+		_offset += count;
+		if (_offset == block->size) {
+			release();
+		}
+	}
+	size = std::min(size, _spill.size());
+	return _spill.data();
+}
+
+void PrefetchSource::consume(size_t size) {
+	size_t count = std::min(size, _spill.size() - _spillBegin);
+
+	_spillBegin += count;
+	if (_spillBegin == _spill.size()) {
+		_spill.clear();
+		_spillBegin = 0;
+	}
+	_position += count;
+	size -= count;
+
+	while (size > 0) {
+		Block *block = front();
+		if (block == nullptr) {
+			break;
+		}
+		count = std::min(size, block->size - _offset);
+		_offset += count;
+		_position += count;
+		size -= count;
+		if (_offset == block->size) {
+			release();
+		}
+	}
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
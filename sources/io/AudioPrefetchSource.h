@@ -0,0 +1,96 @@
+/*
+ * AudioPrefetchSource.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOPREFETCHSOURCE_H_
+#define AUDIOPREFETCHSOURCE_H_
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioSource.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class PrefetchSource
+ * Read ahead another source on a helper thread, so that the input I/O
+ * overlaps with decoding.
+ *
+ * The helper thread keeps up to `blockCount` blocks of `blockSize` bytes
+ * filled ahead of the reader. `peek` returns pointers in the filled blocks;
+ * only a peek straddling two blocks is copied (in a small spill buffer).
+ * Errors of the underlying source are raised by the reader call which
+ * reaches them.
+ */
+class PrefetchSource : public Source {
+public:
+	static const size_t DefaultBlockSize = 1 << 20;
+	static const unsigned int DefaultBlockCount = 4;
+
+public:
+	/**
+	 * * `PrefetchSource(Source &, size_t blockSize, unsigned int blockCount)`
+	 *     Prefetch the given source, which is not owned and must not be
+	 *     used while the prefetch source exists.
+	 */
+	PrefetchSource(Source &, size_t blockSize = DefaultBlockSize, unsigned int blockCount = DefaultBlockCount);
+	/**
+	 * * `PrefetchSource(const std::string &path, size_t blockSize, unsigned int blockCount)`
+	 *     Prefetch the given file, read sequentially from a file descriptor.
+	 */
+	PrefetchSource(const std::string &path, size_t blockSize = DefaultBlockSize, unsigned int blockCount = DefaultBlockCount);
+	virtual ~PrefetchSource();
+
+public:
+	virtual const char * peek(size_t &size);
+	virtual void consume(size_t size);
+	virtual uint64_t position() const { return _position; }
+	virtual int64_t size() const { return _size; }
+
+private:
+	struct Block {
+		std::vector<char> data;
+		size_t size;
+	};
+
+	void start();
+	void run();
+	Block * front();
+	void release();
+
+private:
+	std::unique_ptr<Source> _owned;
+	Source &_upstream;
+	int64_t _size;
+	uint64_t _position;
+
+	std::vector<Block> _blocks;
+	unsigned int _head;                     // reader block
+	unsigned int _filled;                   // filled blocks from the head
+	size_t _offset;                         // in the head block
+	bool _end;
+	bool _stop;
+	std::exception_ptr _error;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::thread _thread;
+
+	std::vector<char> _spill;
+	size_t _spillBegin;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOPREFETCHSOURCE_H_ */
@@ -0,0 +1,130 @@
+/*
+ * AudioSink.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../AudioError.h"
+#include "AudioSink.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const size_t FileDescriptorSink::DefaultBlockSize;
+
+//////////////////////////////////////////////////////////////////////////////
+// Sink //////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+void Sink::write(const struct iovec *chunks, unsigned int count) {
+	for (unsigned int i = 0; i < count; ++i) {
+		write((const char *)chunks[i].iov_base, chunks[i].iov_len);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MemorySink ////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+void MemorySink::write(const char *data, size_t size) {
+	_data.insert(_data.end(), data, data + size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// FileDescriptorSink ////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+FileDescriptorSink::FileDescriptorSink(int fd, size_t blockSize) :
+	_fd(fd),
+	_owned(false),
+	_position(0),
+	_buffer(blockSize),
+	_end(0) {
+}
+
+FileDescriptorSink::FileDescriptorSink(const std::string &path, size_t blockSize) :
+	_fd(open(path.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)),
+	_owned(true),
+	_position(0),
+	_buffer(blockSize),
+	_end(0) {
+	if (_fd < 0) {
+		Error::raise(Error::Status::IOError, "Failed to open " + path + ": " + strerror(errno));
+	}
+}
+
+FileDescriptorSink::~FileDescriptorSink() {
+	try {
+		flush();
+	} catch (Error &) {
+	}
+	if (_owned) {
+		close(_fd);
+	}
+}
+
+void FileDescriptorSink::writeAll(const char *data, size_t size) {
+	while (size > 0) {
+		ssize_t count = ::write(_fd, data, size);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			Error::raise(Error::Status::IOError, std::string("Failed to write: ") + strerror(errno));
+		}
+		data += count;
+		size -= count;
+	}
+}
+
+void FileDescriptorSink::write(const char *data, size_t size) {
+	if (_end + size > _buffer.size()) {
+		flush();
+	}
+	if (size >= _buffer.size()) {
+		writeAll(data, size);
+	} else {
+		memcpy(_buffer.data() + _end, data, size);
+		_end += size;
+	}
+	_position += size;
+}
+
+void FileDescriptorSink::flush() {
+	size_t end = _end;
+	_end = 0;
+	writeAll(_buffer.data(), end);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// StreamSink ////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+StreamSink::StreamSink(std::ostream &output) :
+	_output(output),
+	_position(0) {
+}
+
+void StreamSink::write(const char *data, size_t size) {
+	_output.write(data, size);
+	if (_output.fail()) {
+		Error::raise(Error::Status::IOError, "Failed to write the output stream.");
+	}
+	_position += size;
+}
+
+void StreamSink::flush() {
+	if (_output.flush().fail()) {
+		Error::raise(Error::Status::IOError, "Failed to write the output stream.");
+	}
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,141 @@
+/*
+ * AudioSink.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSINK_H_
+#define AUDIOSINK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class Sink
+ * A sequential byte output the coders write to. Errors are raised as
+ * `Error::Status::IOError`.
+ */
+class Sink {
+public:
+	virtual ~Sink() {}
+
+public:
+	/**
+	 * * `void write(const char *, size_t size)`
+	 *     Write the given bytes.
+	 */
+	virtual void write(const char *, size_t size) = 0;
+	/**
+	 * * `void write(const struct iovec *, unsigned int count)`
+	 *     Write the given chunks in order. The default writes them one by
+	 *     one, sinks which can gather them in a single call override it.
+	 */
+	virtual void write(const struct iovec *, unsigned int count);
+	/**
+	 * * `void flush()`
+	 *     Push the buffered bytes to the underlying output. The coders flush
+	 *     their sink at the end of an encode.
+	 */
+	virtual void flush() {}
+	/**
+	 * * `uint64_t position() const`
+	 *     Get the count of bytes written so far.
+	 */
+	virtual uint64_t position() const = 0;
+};
+
+/**
+ * ## Class MemorySink
+ * Write in a growing memory block.
+ */
+class MemorySink : public Sink {
+public:
+	MemorySink() {}
+
+public:
+	using Sink::write;
+	virtual void write(const char *, size_t size);
+	virtual uint64_t position() const { return _data.size(); }
+	const char * data() const { return _data.data(); }
+	size_t size() const { return _data.size(); }
+	/**
+	 * * `void reserve(size_t size)`
+	 *     Preallocate `size` bytes.
+	 */
+	void reserve(size_t size) { _data.reserve(size); }
+	void clear() { _data.clear(); }
+
+private:
+	std::vector<char> _data;
+};
+
+/**
+ * ## Class FileDescriptorSink
+ * Write a file descriptor (file, pipe or socket) by blocks of `blockSize`
+ * bytes; writes bigger than a block bypass the buffer. Built from a path,
+ * the sink creates (or truncates) the file and owns the descriptor.
+ */
+class FileDescriptorSink : public Sink {
+public:
+	static const size_t DefaultBlockSize = 1 << 20;
+
+public:
+	FileDescriptorSink(int fd, size_t blockSize = DefaultBlockSize);
+	FileDescriptorSink(const std::string &path, size_t blockSize = DefaultBlockSize);
+	/**
+	 * * `~FileDescriptorSink()`
+	 *     Flush the buffered bytes, ignoring errors: call `flush` to get them.
+	 */
+	virtual ~FileDescriptorSink();
+
+public:
+	using Sink::write;
+	virtual void write(const char *, size_t size);
+	virtual void flush();
+	virtual uint64_t position() const { return _position; }
+	int fd() const { return _fd; }
+
+private:
+	void writeAll(const char *, size_t size);
+
+private:
+	int _fd;
+	bool _owned;
+	uint64_t _position;
+	std::vector<char> _buffer;
+	size_t _end;
+};
+
+/**
+ * ## Class StreamSink
+ * Write a `std::ostream`. The stream is not owned.
+ */
+class StreamSink : public Sink {
+public:
+	StreamSink(std::ostream &);
+
+public:
+	using Sink::write;
+	virtual void write(const char *, size_t size);
+	virtual void flush();
+	virtual uint64_t position() const { return _position; }
+
+private:
+	std::ostream &_output;
+	uint64_t _position;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSINK_H_ */
@@ -0,0 +1,294 @@
+/*
+ * AudioSource.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../AudioError.h"
+#include "AudioSource.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const size_t FileDescriptorSource::DefaultBlockSize;
+const size_t StreamSource::DefaultBlockSize;
+
+namespace {
+
+void raise_errno(const std::string &message) {
+	Error::raise(Error::Status::IOError, message + ": " + strerror(errno));
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Source ////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+size_t Source::read(char *dst, size_t size) {
+	size_t count = 0;
+	while (count < size) {
+		size_t available = size - count;
+		const char *data = peek(available);
+		if (available == 0) {
+			break;
+		}
+		memcpy(dst + count, data, available);
+		consume(available);
+		count += available;
+	}
+	return count;
+}
+
+uint64_t Source::skip(uint64_t size) {
+	uint64_t count = 0;
+	while (count < size) {
+		size_t available = std::min<uint64_t>(size - count, 1 << 16);
+		peek(available);
+		if (available == 0) {
+			break;
+		}
+		consume(available);
+		count += available;
+	}
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MemorySource //////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+MemorySource::MemorySource(const void *data, size_t size) :
+	_data(static_cast<const char *>(data)),
+	_size(size),
+	_position(0) {
+}
+
+const char * MemorySource::peek(size_t &size) {
+	size = std::min(size, _size - _position);
+	return _data + _position;
+}
+
+void MemorySource::consume(size_t size) {
+	_position += std::min(size, _size - _position);
+}
+
+uint64_t MemorySource::skip(uint64_t size) {
+	size_t count = std::min<uint64_t>(size, _size - _position);
+	_position += count;
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// BufferedSource ////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+BufferedSource::BufferedSource(size_t blockSize) :
+	_position(0),
+	_buffer(std::max<size_t>(blockSize, 1)),
+	_begin(0),
+	_end(0) {
+}
+
+const char * BufferedSource::peek(size_t &size) {
+	if (buffered() < size) {
+		if (_begin > 0) {
+			std::copy(_buffer.begin() + _begin, _buffer.begin() + _end, _buffer.begin());
+			_end -= _begin;
+			_begin = 0;
+		}
+		if (_buffer.size() < size) {
+			_buffer.resize(size);
+		}
+		while (_end < size) {
+			size_t count = fill(_buffer.data() + _end, _buffer.size() - _end);
+			if (count == 0) {
+				break;
+			}
+			_end += count;
+		}
+	}
+	size = std::min(size, buffered());
+	return _buffer.data() + _begin;
+}
+
+void BufferedSource::consume(size_t size) {
+	size = std::min(size, buffered());
+	_begin += size;
+	_position += size;
+	if (_begin == _end) {
+		discard();
+	}
+}
+
+size_t BufferedSource::read(char *dst, size_t size) {
+	size_t count = std::min(size, buffered());
+
+	memcpy(dst, _buffer.data() + _begin, count);
+	consume(count);
+
+	// Large reads go straight to the destination.
+	while (size - count >= _buffer.size()) {
+		size_t n = fill(dst + count, size - count);
+		if (n == 0) {
+			return count;
+		}
+		count += n;
+		_position += n;
+	}
+	return count + Source::read(dst + count, size - count);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// FileDescriptorSource //////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+FileDescriptorSource::FileDescriptorSource(int fd, size_t blockSize) :
+	BufferedSource(blockSize),
+	_fd(fd),
+	_owned(false) {
+	init();
+}
+
+FileDescriptorSource::FileDescriptorSource(const std::string &path, size_t blockSize) :
+	BufferedSource(blockSize),
+	_fd(open(path.data(), O_RDONLY | O_CLOEXEC)),
+	_owned(true) {
+	if (_fd < 0) {
+		raise_errno("Failed to open " + path);
+	}
+	init();
+}
+
+FileDescriptorSource::~FileDescriptorSource() {
+	if (_owned) {
+		close(_fd);
+	}
+}
+
+// Regular files are seekable and have a known size, counted from the
+// current offset of the descriptor.
+void FileDescriptorSource::init() {
+	struct stat st;
+	off_t offset;
+
+	_seekable = false;
+	_size = -1;
+	if (fstat(_fd, &st) == 0 && S_ISREG(st.st_mode)
+			&& (offset = lseek(_fd, 0, SEEK_CUR)) >= 0) {
+		_seekable = true;
+		_size = std::max<int64_t>(st.st_size - offset, 0);
+		posix_fadvise(_fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+	}
+}
+
+size_t FileDescriptorSource::fill(char *dst, size_t size) {
+	ssize_t count;
+	while ((count = ::read(_fd, dst, size)) < 0) {
+		if (errno != EINTR) {
+			raise_errno("Failed to read");
+		}
+	}
+	return count;
+}
+
+uint64_t FileDescriptorSource::skip(uint64_t size) {
+	if (! _seekable || size <= buffered()) {
+		return Source::skip(size);
+	}
+
+	uint64_t count = std::min<uint64_t>(size, _size - _position);
+	uint64_t unbuffered = count - buffered();
+
+	discard();
+	if (lseek(_fd, unbuffered, SEEK_CUR) < 0) {
+		raise_errno("Failed to seek");
+	}
+	_position += count;
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MappedFileSource //////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+MappedFileSource::MappedFileSource(const std::string &path) :
+	_data(nullptr),
+	_size(0),
+	_position(0) {
+	int fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+	struct stat st;
+
+	if (fd < 0) {
+		raise_errno("Failed to open " + path);
+	}
+	if (fstat(fd, &st) < 0 || ! S_ISREG(st.st_mode)) {
+		close(fd);
+		Error::raise(Error::Status::IOError, path + " is not a regular file.");
+	}
+
+	_size = st.st_size;
+	if (_size > 0) {
+		void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			raise_errno("Failed to map " + path);
+		}
+		madvise(data, _size, MADV_SEQUENTIAL);
+		_data = static_cast<const char *>(data);
+	}
+	close(fd);
+}
+
+MappedFileSource::~MappedFileSource() {
+	if (_data != nullptr) {
+		munmap(const_cast<char *>(_data), _size);
+	}
+}
+
+const char * MappedFileSource::peek(size_t &size) {
+	size = std::min(size, _size - _position);
+	return _data + _position;
+}
+
+void MappedFileSource::consume(size_t size) {
+	_position += std::min(size, _size - _position);
+}
+
+uint64_t MappedFileSource::skip(uint64_t size) {
+	size_t count = std::min<uint64_t>(size, _size - _position);
+	_position += count;
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// StreamSource //////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+StreamSource::StreamSource(std::istream &input, size_t blockSize) :
+	BufferedSource(blockSize),
+	_input(input) {
+}
+
+size_t StreamSource::fill(char *dst, size_t size) {
+	_input.read(dst, size);
+	if (_input.bad()) {
+		Error::raise(Error::Status::IOError, "Failed to read the input stream.");
+	}
+	return _input.gcount();
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
@@ -0,0 +1,205 @@
+/*
+ * AudioSource.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOSOURCE_H_
+#define AUDIOSOURCE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class Source
+ * A sequential byte input the decoders read from.
+ *
+ * The primitive is `peek`/`consume`: `peek` gives a pointer on the next
+ * bytes without consuming them. Sources backed by memory (`MemorySource`,
+ * `MappedFileSource`) return a pointer in their own storage, so a decoder
+ * reading through `peek` never copies the input; the other ones fill an
+ * internal buffer by large reads.
+ */
+class Source {
+public:
+	virtual ~Source() {}
+
+public:
+	/**
+	 * * `const char * peek(size_t &size)`
+	 *     Get a pointer on the next `size` bytes of the source without
+	 *     consuming them. On return `size` is the available byte count, less
+	 *     than asked only at the end of the source (0 at the end). The
+	 *     pointer is valid until the next call on the source.
+	 */
+	virtual const char * peek(size_t &size) = 0;
+	/**
+	 * * `void consume(size_t size)`
+	 *     Consume `size` bytes, at most the byte count of the last `peek`.
+	 */
+	virtual void consume(size_t size) = 0;
+	/**
+	 * * `size_t read(char *, size_t size)`
+	 *     Copy and consume the next `size` bytes. Return the copied byte
+	 *     count, less than `size` only at the end of the source.
+	 */
+	virtual size_t read(char *, size_t size);
+	/**
+	 * * `uint64_t skip(uint64_t size)`
+	 *     Consume the next `size` bytes without reading them. Return the
+	 *     skipped byte count, less than `size` only at the end of the source.
+	 */
+	virtual uint64_t skip(uint64_t size);
+	/**
+	 * * `uint64_t position() const`
+	 *     Get the count of bytes consumed so far.
+	 */
+	virtual uint64_t position() const = 0;
+	/**
+	 * * `int64_t size() const`
+	 *     Get the total byte count of the source, -1 if unknown.
+	 */
+	virtual int64_t size() const { return -1; }
+};
+
+/**
+ * ## Class MemorySource
+ * Read a contiguous span of memory. The memory is not copied nor owned, it
+ * must outlive the source.
+ */
+class MemorySource : public Source {
+public:
+	MemorySource(const void *data, size_t size);
+
+public:
+	virtual const char * peek(size_t &size);
+	virtual void consume(size_t size);
+	virtual uint64_t skip(uint64_t size);
+	virtual uint64_t position() const { return _position; }
+	virtual int64_t size() const { return _size; }
+
+private:
+	const char *_data;
+	size_t _size;
+	size_t _position;
+};
+
+/**
+ * ## Class BufferedSource
+ * Base of the sources which copy their input in an internal buffer. Sub
+ * classes implement `fill`; reads bigger than the buffer bypass it.
+ */
+class BufferedSource : public Source {
+public:
+	BufferedSource(size_t blockSize);
+
+public:
+	virtual const char * peek(size_t &size);
+	virtual void consume(size_t size);
+	virtual size_t read(char *, size_t size);
+	virtual uint64_t position() const { return _position; }
+
+protected:
+	/**
+	 * * `size_t fill(char *, size_t size)`
+	 *     Read at most `size` bytes from the underlying input, return 0 at
+	 *     the end of it.
+	 */
+	virtual size_t fill(char *, size_t size) = 0;
+	size_t buffered() const { return _end - _begin; }
+	void discard() { _begin = _end = 0; }
+
+protected:
+	uint64_t _position;
+
+private:
+	std::vector<char> _buffer;
+	size_t _begin;
+	size_t _end;
+};
+
+/**
+ * ## Class FileDescriptorSource
+ * Read a file descriptor (file, pipe or socket) by blocks of `blockSize`
+ * bytes. Built from a path, the source opens and owns the descriptor.
+ */
+class FileDescriptorSource : public BufferedSource {
+public:
+	static const size_t DefaultBlockSize = 1 << 20;
+
+public:
+	FileDescriptorSource(int fd, size_t blockSize = DefaultBlockSize);
+	FileDescriptorSource(const std::string &path, size_t blockSize = DefaultBlockSize);
+	virtual ~FileDescriptorSource();
+
+public:
+	virtual uint64_t skip(uint64_t size);
+	virtual int64_t size() const { return _size; }
+	int fd() const { return _fd; }
+
+protected:
+	virtual size_t fill(char *, size_t size);
+
+private:
+	void init();
+
+private:
+	int _fd;
+	bool _owned;
+	bool _seekable;
+	int64_t _size;
+};
+
+/**
+ * ## Class MappedFileSource
+ * Map a whole regular file in memory and read it without copy.
+ */
+class MappedFileSource : public Source {
+public:
+	MappedFileSource(const std::string &path);
+	virtual ~MappedFileSource();
+
+public:
+	virtual const char * peek(size_t &size);
+	virtual void consume(size_t size);
+	virtual uint64_t skip(uint64_t size);
+	virtual uint64_t position() const { return _position; }
+	virtual int64_t size() const { return _size; }
+	const char * data() const { return _data; }
+
+private:
+	const char *_data;
+	size_t _size;
+	size_t _position;
+};
+
+/**
+ * ## Class StreamSource
+ * Read a `std::istream`. The stream is not owned.
+ */
+class StreamSource : public BufferedSource {
+public:
+	static const size_t DefaultBlockSize = 1 << 16;
+
+public:
+	StreamSource(std::istream &, size_t blockSize = DefaultBlockSize);
+
+protected:
+	virtual size_t fill(char *, size_t size);
+
+private:
+	std::istream &_input;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOSOURCE_H_ */
@@ -0,0 +1,211 @@
+/*
+ * AudioVectoredSink.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../AudioError.h"
+#include "../AudioTrace.h"
+#include "AudioVectoredSink.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+const size_t VectoredSink::DefaultBatchSize;
+const size_t VectoredSink::DirectAlignment;
+
+namespace {
+
+void raise_errno(const std::string &message) {
+	Error::raise(Error::Status::IOError, message + ": " + strerror(errno));
+}
+
+}
+
+VectoredSink::VectoredSink(int fd, size_t batchSize) :
+	_fd(fd),
+	_owned(false),
+	_direct(false) {
+	init(batchSize);
+}
+
+VectoredSink::VectoredSink(const std::string &path, size_t batchSize, bool direct) :
+	_fd(-1),
+	_owned(true),
+	_direct(direct) {
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	if (_direct && (_fd = open(path.data(), flags | O_DIRECT, 0666)) < 0 && errno == EINVAL) {
+		_direct = false;
+	}
+	if (! _direct) {
+		_fd = open(path.data(), flags, 0666);
+	}
+	if (_fd < 0) {
+		raise_errno("Failed to open " + path);
+	}
+	init(batchSize);
+}
+
+VectoredSink::~VectoredSink() {
+	try {
+		flush();
+	} catch (Error &) {
+	}
+	if (_owned) {
+		close(_fd);
+	}
+	free(_staging);
+}
+
+// The staging buffer is aligned and sized for O_DIRECT in any mode.
+void VectoredSink::init(size_t batchSize) {
+	void *staging;
+
+	_position = 0;
+	_staged = 0;
+	_batchSize = (std::max(batchSize, DirectAlignment) + DirectAlignment - 1) & ~(DirectAlignment - 1);
+	if (posix_memalign(&staging, DirectAlignment, _batchSize) != 0) {
+		if (_owned) close(_fd);
+		throw std::bad_alloc();
+	}
+	_staging = static_cast<char *>(staging);
+}
+
+void VectoredSink::write(const char *data, size_t size) {
+	struct iovec chunk = { const_cast<char *>(data), size };
+	write(&chunk, 1);
+}
+
+void VectoredSink::write(const struct iovec *chunks, unsigned int count) {
+	size_t size = 0;
+	for (unsigned int i = 0; i < count; ++i) {
+		size += chunks[i].iov_len;
+	}
+
+	if (_direct || _staged + size <= _batchSize) {
+		for (unsigned int i = 0; i < count; ++i) {
+			stage((const char *)chunks[i].iov_base, chunks[i].iov_len);
+		}
+	} else {
+		// Send the staged bytes and the new chunks in one call.
+		_chunks.clear();
+		if (_staged > 0) {
+			struct iovec staged = { _staging, _staged };
+			_chunks.push_back(staged);
+		}
+		_chunks.insert(_chunks.end(), chunks, chunks + count);
+		writeAll(_chunks.data(), _chunks.size());
+		_staged = 0;
+	}
+	_position += size;
+}
+
+void VectoredSink::stage(const char *data, size_t size) {
+	while (size > 0) {
+		size_t count = std::min(size, _batchSize - _staged);
+		memcpy(_staging + _staged, data, count);
+		_staged += count;
+		data += count;
+		size -= count;
+		if (_staged == _batchSize) {
+			if (_direct) {
+				writeDirect(_batchSize);
+			} else {
+				struct iovec staged = { _staging, _staged };
+				writeAll(&staged, 1);
+			}
+			_staged = 0;
+		}
+	}
+}
+
+// Empty chunks are skipped first, so that a call writing nothing fails
+// instead of looping.
+void VectoredSink::writeAll(struct iovec *chunks, unsigned int count) {
+	Trace::Span span("sink.writev", "io");
+	for (; count > 0 && chunks->iov_len == 0; ++chunks, --count);
+	while (count > 0) {
+		ssize_t written = writev(_fd, chunks, std::min<unsigned int>(count, IOV_MAX));
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			raise_errno("Failed to write");
+		}
+		if (written == 0) {
+			Error::raise(Error::Status::IOError, "Failed to write: no byte written");
+		}
+		for (; count > 0 && (size_t)written >= chunks->iov_len; ++chunks, --count) {
+			written -= chunks->iov_len;
+		}
+		if (written > 0) {
+			chunks->iov_base = (char *)chunks->iov_base + written;
+			chunks->iov_len -= written;
+		}
+	}
+}
+
+// Write the first `size` staged bytes, `size` and the file offset being
+// aligned. Fall back to buffered writes if the kernel rejects them.
+void VectoredSink::writeDirect(size_t size) {
+	Trace::Span span("sink.write_direct", "io");
+	size_t offset = 0;
+	while (offset < size) {
+		ssize_t written = ::write(_fd, _staging + offset, size - offset);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EINVAL && _direct) {
+				disableDirect();
+				continue;
+			}
+			raise_errno("Failed to write");
+		}
+		if (written == 0) {
+			Error::raise(Error::Status::IOError, "Failed to write: no byte written");
+		}
+		offset += written;
+	}
+}
+
+void VectoredSink::disableDirect() {
+	int flags = fcntl(_fd, F_GETFL);
+	if (flags < 0 || fcntl(_fd, F_SETFL, flags & ~O_DIRECT) < 0) {
+		raise_errno("Failed to disable O_DIRECT");
+	}
+	_direct = false;
+}
+
+void VectoredSink::flush() {
+	if (_direct) {
+		size_t aligned = _staged & ~(DirectAlignment - 1);
+		if (aligned > 0) {
+			writeDirect(aligned);
+			memmove(_staging, _staging + aligned, _staged - aligned);
+			_staged -= aligned;
+		}
+		if (_staged == 0) {
+			return;
+		}
+		disableDirect();
+	}
+	if (_staged > 0) {
+		struct iovec staged = { _staging, _staged };
+		_staged = 0;
+		writeAll(&staged, 1);
+	}
+}
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
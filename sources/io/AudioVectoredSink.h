@@ -0,0 +1,82 @@
+/*
+ * AudioVectoredSink.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jux
+ */
+
+#ifndef AUDIOVECTOREDSINK_H_
+#define AUDIOVECTOREDSINK_H_
+
+#include <string>
+#include <vector>
+
+#include "AudioSink.h"
+
+namespace com {
+namespace nealrame {
+namespace audio {
+
+/**
+ * ## Class VectoredSink
+ * Write a file descriptor with batched `writev` calls.
+ *
+ * Small writes (Ogg page headers and bodies, LAME chunks) are gathered in
+ * a staging buffer of `batchSize` bytes. A write which does not fit in it
+ * any more is sent in the same `writev` call as the staged bytes, without
+ * being copied.
+ *
+ * In direct mode the file is opened with `O_DIRECT` and written by aligned
+ * staging blocks, bypassing the page cache for large outputs. The last
+ * unaligned bytes are written by `flush` without `O_DIRECT`, which ends the
+ * direct mode. If the file system does not support `O_DIRECT`, the sink
+ * silently uses buffered writes.
+ */
+class VectoredSink : public Sink {
+public:
+	static const size_t DefaultBatchSize = 1 << 20;
+	static const size_t DirectAlignment = 4096;
+
+public:
+	VectoredSink(int fd, size_t batchSize = DefaultBatchSize);
+	/**
+	 * * `VectoredSink(const std::string &path, size_t batchSize, bool direct)`
+	 *     Create (or truncate) the given file, the sink owns the descriptor.
+	 */
+	VectoredSink(const std::string &path, size_t batchSize = DefaultBatchSize, bool direct = false);
+	/**
+	 * * `~VectoredSink()`
+	 *     Flush the staged bytes, ignoring errors: call `flush` to get them.
+	 */
+	virtual ~VectoredSink();
+
+public:
+	virtual void write(const char *, size_t size);
+	virtual void write(const struct iovec *, unsigned int count);
+	virtual void flush();
+	virtual uint64_t position() const { return _position; }
+	bool direct() const { return _direct; }
+	int fd() const { return _fd; }
+
+private:
+	void init(size_t batchSize);
+	void stage(const char *, size_t size);
+	void writeAll(struct iovec *, unsigned int count);
+	void writeDirect(size_t size);
+	void disableDirect();
+
+private:
+	int _fd;
+	bool _owned;
+	bool _direct;
+	uint64_t _position;
+	char *_staging;
+	size_t _batchSize;
+	size_t _staged;
+	std::vector<struct iovec> _chunks;
+};
+
+} /* namespace audio */
+} /* namespace nealrame */
+} /* namespace com */
+#endif /* AUDIOVECTOREDSINK_H_ */
@@ -0,0 +1,408 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <analysis/AudioFFT.h>
+#include <codec/AudioMP3Coder.h>
+#include <codec/AudioMP3Decoder.h>
+#include <codec/AudioOggVorbisCoder.h>
+#include <codec/AudioOggVorbisDecoder.h>
+#include <codec/AudioPCMCoder.h>
+#include <codec/AudioPCMDecoder.h>
+
+using namespace com::nealrame;
+
+// Allocation counters. malloc and friends are interposed so both operator
+// new and the Buffer storage (realloc) are accounted.
+static std::atomic<unsigned long long> allocation_count(0);
+static std::atomic<unsigned long long> allocation_bytes(0);
+
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void  __libc_free(void *);
+
+void *malloc(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(count*size, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+	__libc_free(ptr);
+}
+}
+
+struct Result {
+	std::string name;
+	unsigned long long frames;
+	double wall;
+	double cpu;
+	double realtime;
+	unsigned long long allocations;
+	unsigned long long allocatedBytes;
+	long peakRss;
+	double baselineRatio;
+};
+
+struct Case {
+	std::string name;
+	unsigned int sampleRate;
+	// Run the operation once and return the processed frame count.
+	std::function<unsigned long long ()> run;
+	// Set up the input of the case before it is measured, if not empty.
+	std::function<void ()> prepare;
+};
+
+static double cpu_time() {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// Reset the peak resident set size (Linux >= 4.0), so the high water mark
+// can be measured per case.
+static void reset_peak_rss() {
+	std::ofstream ofs("/proc/self/clear_refs");
+	ofs << "5";
+}
+
+static long peak_rss() {
+	std::ifstream ifs("/proc/self/status");
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return std::strtol(line.c_str() + 6, nullptr, 10);
+		}
+	}
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static Result measure(const Case &c, unsigned int repeat) {
+	Result best{ c.name, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+	for (unsigned int i = 0; i < repeat; ++i) {
+		reset_peak_rss();
+		unsigned long long count = allocation_count, bytes = allocation_bytes;
+		double cpu = cpu_time();
+		auto start = std::chrono::steady_clock::now();
+
+		unsigned long long frames = c.run();
+
+		std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+		if (i == 0 || wall.count() < best.wall) {
+			best.frames = frames;
+			best.wall = wall.count();
+			best.cpu = cpu_time() - cpu;
+			best.realtime = (static_cast<double>(frames)/c.sampleRate)/best.wall;
+			best.allocations = allocation_count - count;
+			best.allocatedBytes = allocation_bytes - bytes;
+			best.peakRss = peak_rss();
+		}
+	}
+	return best;
+}
+
+#define BENCH_BLOCK_FRAME_COUNT 4096
+
+template<typename T>
+static void add_buffer_cases(std::vector<Case> &cases, std::shared_ptr<audio::Buffer> source, const std::string &type) {
+	const audio::Format format = source->format();
+	const unsigned int channel_count = format.channelCount();
+	std::ostringstream prefix;
+	prefix << "buffer/" << format.bitDepth() << "bits/";
+
+	cases.push_back(Case{ prefix.str() + "read/interleaved/" + type, format.sampleRate(), [source, channel_count]() {
+		std::vector<T> dst(BENCH_BLOCK_FRAME_COUNT*channel_count);
+		unsigned long long frames = 0;
+		for (unsigned int offset = 0; offset < source->frameCount(); offset += BENCH_BLOCK_FRAME_COUNT) {
+			frames += source->read(offset, BENCH_BLOCK_FRAME_COUNT, dst.data());
+		}
+		return frames;
+	}});
+
+	cases.push_back(Case{ prefix.str() + "read/planar/" + type, format.sampleRate(), [source, channel_count]() {
+		std::vector<T> dst(BENCH_BLOCK_FRAME_COUNT*channel_count);
+		std::vector<T *> planes(channel_count);
+		for (unsigned int c = 0; c < channel_count; ++c) {
+			planes[c] = &dst[c*BENCH_BLOCK_FRAME_COUNT];
+		}
+		unsigned long long frames = 0;
+		for (unsigned int offset = 0; offset < source->frameCount(); offset += BENCH_BLOCK_FRAME_COUNT) {
+			frames += source->read(offset, BENCH_BLOCK_FRAME_COUNT, planes.data());
+		}
+		return frames;
+	}});
+
+	std::shared_ptr<std::vector<T>> interleaved = std::make_shared<std::vector<T>>(source->frameCount()*channel_count);
+	source->read(0, source->frameCount(), interleaved->data());
+
+	cases.push_back(Case{ prefix.str() + "write/interleaved/" + type, format.sampleRate(), [format, interleaved, channel_count]() {
+		audio::Buffer buffer(format);
+		const unsigned int frame_count = interleaved->size()/channel_count;
+		for (unsigned int offset = 0; offset < frame_count; offset += BENCH_BLOCK_FRAME_COUNT) {
+			buffer.write(offset, std::min(frame_count - offset, (unsigned int)BENCH_BLOCK_FRAME_COUNT), interleaved->data() + offset*channel_count);
+		}
+		return (unsigned long long)buffer.frameCount();
+	}});
+
+	std::shared_ptr<std::vector<T>> planar = std::make_shared<std::vector<T>>(source->frameCount()*channel_count);
+	std::vector<T *> planes(channel_count);
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		planes[c] = &(*planar)[c*source->frameCount()];
+	}
+	source->read(0, source->frameCount(), planes.data());
+
+	cases.push_back(Case{ prefix.str() + "write/planar/" + type, format.sampleRate(), [format, planar, channel_count]() {
+		audio::Buffer buffer(format);
+		const unsigned int frame_count = planar->size()/channel_count;
+		std::vector<const T *> planes(channel_count);
+		for (unsigned int offset = 0; offset < frame_count; offset += BENCH_BLOCK_FRAME_COUNT) {
+			for (unsigned int c = 0; c < channel_count; ++c) {
+				planes[c] = planar->data() + c*frame_count + offset;
+			}
+			buffer.write(offset, std::min(frame_count - offset, (unsigned int)BENCH_BLOCK_FRAME_COUNT), planes.data());
+		}
+		return (unsigned long long)buffer.frameCount();
+	}});
+}
+
+static void add_codec_cases(std::vector<Case> &cases, std::shared_ptr<audio::Buffer> source, const std::string &codec,
+		std::shared_ptr<audio::Coder> coder, std::shared_ptr<audio::Decoder> decoder, const std::string &directory) {
+	static const std::pair<audio::Coder::Quality, const char *> qualities[] = {
+		{ audio::Coder::Quality::Best,       "best" },
+		{ audio::Coder::Quality::Good,       "good" },
+		{ audio::Coder::Quality::Acceptable, "acceptable" },
+		{ audio::Coder::Quality::Fastest,    "fastest" },
+	};
+	const unsigned int sample_rate = source->format().sampleRate();
+
+	for (auto &quality : qualities) {
+		std::string filename = directory + "/bench-" + quality.second + "." + codec;
+		audio::Coder::Quality q = quality.first;
+
+		cases.push_back(Case{ "encode/" + codec + "/" + quality.second, sample_rate, [source, coder, q, filename]() {
+			coder->setQuality(q);
+			coder->encode(*source, filename);
+			return (unsigned long long)source->frameCount();
+		}});
+
+		// Decode cases encode their own input, to run alone.
+		std::string input = directory + "/bench-decode-" + quality.second + "." + codec;
+		cases.push_back(Case{ "decode/" + codec + "/" + quality.second, sample_rate, [decoder, input]() {
+			std::unique_ptr<audio::Buffer> buffer(decoder->decode(input));
+			return (unsigned long long)buffer->frameCount();
+		}, [source, coder, q, input]() {
+			coder->setQuality(q);
+			coder->encode(*source, input);
+		}});
+	}
+}
+
+static void add_fft_cases(std::vector<Case> &cases, unsigned int sample_rate) {
+	for (unsigned int size = 256; size <= 8192; size *= 2) {
+		std::ostringstream name;
+		name << "fft/" << size;
+		cases.push_back(Case{ name.str(), sample_rate, [size, sample_rate]() {
+			std::shared_ptr<const audio::FFT> fft = audio::FFT::plan(size);
+			std::vector<float> input(size), re(size/2 + 1), im(size/2 + 1);
+			for (unsigned int i = 0; i < size; ++i) {
+				input[i] = std::sin(0.1*i);
+			}
+			// One second of hops of size/4 frames.
+			unsigned long long frames = 0;
+			for (; frames < sample_rate; frames += size/4) {
+				fft->forward(input.data(), re.data(), im.data());
+			}
+			return frames;
+		}});
+	}
+}
+
+static void write_json(std::ostream &out, const std::vector<Result> &results, double seconds, bool compared) {
+	out << "{\n  \"version\": 1,\n  \"seconds\": " << seconds << ",\n  \"results\": [";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result &r = results[i];
+		out << (i ? ",\n" : "\n")
+			<< "    { \"name\": \"" << r.name << "\""
+			<< ", \"frames\": " << r.frames
+			<< ", \"wall\": " << r.wall
+			<< ", \"cpu\": " << r.cpu
+			<< ", \"frames_per_second\": " << r.frames/r.wall
+			<< ", \"realtime\": " << r.realtime
+			<< ", \"allocations\": " << r.allocations
+			<< ", \"allocated_bytes\": " << r.allocatedBytes
+			<< ", \"peak_rss_kb\": " << r.peakRss;
+		if (compared) {
+			out << ", \"baseline_ratio\": " << r.baselineRatio;
+		}
+		out << " }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+// Read the frames/s of each case of a report written by `write_json`.
+static std::map<std::string, double> read_baseline(const std::string &filename) {
+	std::map<std::string, double> reference;
+	std::ifstream ifs(filename.data());
+	std::string line;
+
+	if (! ifs) {
+		throw std::runtime_error("Cannot read baseline " + filename);
+	}
+	while (std::getline(ifs, line)) {
+		static const std::string name_key("\"name\": \""), fps_key("\"frames_per_second\": ");
+		size_t name = line.find(name_key);
+		size_t fps = line.find(fps_key);
+		if (name == std::string::npos || fps == std::string::npos) {
+			continue;
+		}
+		name += name_key.size();
+		reference[line.substr(name, line.find('"', name) - name)] = std::atof(line.c_str() + fps + fps_key.size());
+	}
+	return reference;
+}
+
+static void usage(const char *name) {
+	std::cerr
+		<< "usage: " << name << " [options]\n"
+		<< "  --seconds N        length of the test signal (default 30)\n"
+		<< "  --repeat N         runs per case, the fastest is kept (default 3)\n"
+		<< "  --filter STRING    only run the cases whose name contains STRING\n"
+		<< "  --output FILE      write the JSON report to FILE (default stdout)\n"
+		<< "  --baseline FILE    compare with a previous report\n"
+		<< "  --threshold RATIO  slow down flagged as a regression (default 0.05)\n"
+		<< "  --help             print this help\n";
+}
+
+int main(int argc, char **argv) {
+	double seconds = 30;
+	unsigned int repeat = 3;
+	double threshold = 0.05;
+	std::string filter, output, baseline;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg == "--help" || arg == "-h") {
+			usage(argv[0]);
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			usage(argv[0]);
+			return 1;
+		}
+		if (arg == "--seconds") {
+			seconds = std::atof(argv[++i]);
+		} else if (arg == "--repeat") {
+			repeat = std::max(1, std::atoi(argv[++i]));
+		} else if (arg == "--filter") {
+			filter = argv[++i];
+		} else if (arg == "--output") {
+			output = argv[++i];
+		} else if (arg == "--baseline") {
+			baseline = argv[++i];
+		} else if (arg == "--threshold") {
+			threshold = std::atof(argv[++i]);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path("nraudio-bench-%%%%%%%%");
+	boost::filesystem::create_directories(directory);
+
+	int status = 0;
+	try {
+		std::vector<Case> cases;
+
+		for (unsigned int bit_depth : { 8, 16 }) {
+			std::shared_ptr<audio::Buffer> source(audio::Generator(audio::Generator::Signal::PinkNoise).generate(audio::Format(2, 44100, bit_depth), seconds));
+			add_buffer_cases<float>(cases, source, "float");
+			add_buffer_cases<int8_t>(cases, source, "int8");
+			add_buffer_cases<int16_t>(cases, source, "int16");
+		}
+
+		std::shared_ptr<audio::Buffer> source(audio::Generator(audio::Generator::Signal::PinkNoise).generate(audio::Format(2, 44100, 16), seconds));
+		add_codec_cases(cases, source, "wav", std::make_shared<audio::PCMCoder>(), std::make_shared<audio::PCMDecoder>(), directory.string());
+		add_codec_cases(cases, source, "mp3", std::make_shared<audio::MP3Coder>(), std::make_shared<audio::MP3Decoder>(), directory.string());
+		add_codec_cases(cases, source, "ogg", std::make_shared<audio::OggVorbisCoder>(), std::make_shared<audio::OggVorbisDecoder>(), directory.string());
+		add_fft_cases(cases, 44100);
+
+		std::vector<Result> results;
+		for (const Case &c : cases) {
+			if (c.name.find(filter) == std::string::npos) {
+				continue;
+			}
+			std::cerr << c.name << std::endl;
+			if (c.prepare) {
+				c.prepare();
+			}
+			results.push_back(measure(c, repeat));
+		}
+
+		if (! baseline.empty()) {
+			std::map<std::string, double> reference = read_baseline(baseline);
+
+			for (Result &r : results) {
+				auto it = reference.find(r.name);
+				r.baselineRatio = it == reference.end() ? 0 : (r.frames/r.wall)/it->second;
+				if (it != reference.end() && r.baselineRatio < 1.0 - threshold) {
+					std::cerr << "regression: " << r.name << " runs at " << 100*r.baselineRatio << "% of the baseline" << std::endl;
+					status = 2;
+				}
+			}
+		}
+
+		if (output.empty()) {
+			write_json(std::cout, results, seconds, ! baseline.empty());
+		} else {
+			std::ofstream ofs(output.data());
+			write_json(ofs, results, seconds, ! baseline.empty());
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		status = 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		status = 1;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return status;
+}
@@ -0,0 +1,101 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <AudioBuffer.h>
+#include <AudioCompressedBuffer.h>
+#include <AudioError.h>
+
+using namespace com::nealrame;
+
+// Fill samples in [min, max] with one of the patterns: full range noise,
+// alternating extremes, a constant extreme, a random walk by large steps,
+// silence with extreme spikes, and a smooth sine.
+template<typename T>
+static void fill(std::vector<T> &samples, unsigned int channel_count, unsigned int pattern, std::mt19937 &random, int min, int max) {
+	std::uniform_int_distribution<int> any(min, max);
+	int walk = 0;
+
+	for (size_t i = 0; i < samples.size(); ++i) {
+		int value = 0;
+		switch (pattern) {
+		case 0: value = any(random); break;
+		case 1: value = (i/channel_count + i%channel_count) % 2 == 0 ? min : max; break;
+		case 2: value = i%channel_count % 2 == 0 ? min : max; break;
+		case 3: walk = std::max(min, std::min(max, walk + any(random)/2)); value = walk; break;
+		case 4: value = random() % 97 == 0 ? (random() % 2 == 0 ? min : max) : 0; break;
+		default: value = (int)std::lround(max*std::sin(i/channel_count*0.01*(1 + i%channel_count))); break;
+		}
+		samples[i] = (T)value;
+	}
+}
+
+// Read random ranges, from before the start to past the end, of both
+// buffers and compare them.
+template<typename T>
+static bool compare_reads(const audio::CompressedBuffer &compressed, const audio::Buffer &buffer, std::mt19937 &random) {
+	unsigned int channel_count = buffer.format().channelCount();
+	for (unsigned int i = 0; i < 20; ++i) {
+		unsigned int offset = random() % (buffer.frameCount() + 10);
+		unsigned int count = random() % (3*compressed.blockFrameCount() + 10);
+		std::vector<T> samples((size_t)count*channel_count), expected(samples.size());
+		if (compressed.read(offset, count, samples.data()) != buffer.read(offset, count, expected.data()) || samples != expected) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename T>
+static bool round_trip(audio::Format format, unsigned int frame_count, unsigned int block_frame_count, unsigned int pattern, std::mt19937 &random) {
+	int max = format.bitDepth() == 8 ? 127 : 32767;
+	std::vector<T> samples((size_t)frame_count*format.channelCount());
+	fill(samples, format.channelCount(), pattern, random, -max - 1, max);
+
+	audio::Buffer buffer(format);
+	buffer.write(0, frame_count, samples.data());
+	audio::CompressedBuffer compressed(buffer, block_frame_count);
+	std::unique_ptr<audio::Buffer> decompressed(compressed.decompress());
+	std::vector<T> decoded(samples.size());
+
+	return compressed.frameCount() == frame_count
+		&& decompressed->frameCount() == frame_count
+		&& decompressed->read(0, frame_count, decoded.data()) == frame_count
+		&& decoded == samples
+		&& compare_reads<T>(compressed, buffer, random)
+		&& compare_reads<float>(compressed, buffer, random);
+}
+
+// Compress random buffers of 1 to 6 channels, 8 and 16 bits, by blocks of
+// odd sizes, filled with patterns which reach the extreme sample values,
+// and check that they decompress and read as the original.
+int main() {
+	int failures = 0;
+
+	try {
+		std::mt19937 random(1);
+		for (unsigned int i = 0; i < 200; ++i) {
+			unsigned int channel_count = 1 + i % 6;
+			unsigned int bit_depth = i/6 % 2 == 0 ? 16 : 8;
+			unsigned int pattern = i % 7 % 6;
+			unsigned int block_frame_count = i % 5 == 0 ? 1 + i % 3 : (random() % 5000) | 1;
+			unsigned int frame_count = i % 11 == 0 ? i % 3 : random() % 20000;
+			audio::Format format(channel_count, 44100, bit_depth);
+
+			bool ok = bit_depth == 8
+				? round_trip<int8_t>(format, frame_count, block_frame_count, pattern, random)
+				: round_trip<int16_t>(format, frame_count, block_frame_count, pattern, random);
+			if (! ok) {
+				std::cerr << channel_count << " channels, " << bit_depth << " bits, " << frame_count << " frames by blocks of "
+					<< block_frame_count << ", pattern " << pattern << ": the round trip differs" << std::endl;
+				failures++;
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioChannelMixer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <analysis/AudioAnalyzer.h>
+#include <codec/AudioDecodeCache.h>
+#include <codec/AudioPCMDecoder.h>
+
+using namespace com::nealrame;
+
+struct FrameCounter : public audio::Analyzer {
+	unsigned int frames;
+	FrameCounter() : frames(0) {}
+	virtual void process(const audio::Buffer &, unsigned int, unsigned int count) { frames += count; }
+};
+
+static int failures = 0;
+
+static void check(bool condition, const std::string &what) {
+	if (! condition) {
+		std::cerr << what << std::endl;
+		failures++;
+	}
+}
+
+// Check the keys of the decode cache: decoders built per request with
+// equal mixers share an entry, other mixers do not, a hit feeds the
+// analyzers, and concurrent requests share a single decode.
+int main() {
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	boost::filesystem::create_directories(directory);
+	std::string path = (directory/"sine.wav").string();
+
+	try {
+		audio::Generator(audio::Generator::Signal::Sine).generate(audio::Format(2, 44100, 16), 1, path);
+		audio::DecodeCache cache(64 << 20);
+
+		std::shared_ptr<const audio::Buffer> first, second;
+		{
+			audio::PCMDecoder decoder;
+			decoder.setChannelMixer(std::make_shared<const audio::ChannelMixer>(audio::ChannelMixer::stereoToMono()));
+			first = cache.decode(path, decoder);
+		}
+		{
+			audio::PCMDecoder decoder;
+			FrameCounter counter;
+			decoder.setChannelMixer(std::make_shared<const audio::ChannelMixer>(audio::ChannelMixer::stereoToMono()));
+			decoder.addAnalyzer(&counter);
+			second = cache.decode(path, decoder);
+			check(counter.frames == second->frameCount(), "analyzers are not fed on a hit");
+		}
+		check(first == second, "equal mixers do not share an entry");
+		check(first->format().channelCount() == 1, "the mixer is not applied");
+
+		audio::PCMDecoder plain;
+		std::shared_ptr<const audio::Buffer> stereo = cache.decode(path, plain);
+		check(stereo != first && stereo->format().channelCount() == 2, "different mixers share an entry");
+
+		audio::DecodeCache::Counters counters = cache.counters();
+		check(counters.hits == 1 && counters.misses == 2 && counters.entries == 2, "unexpected counters");
+
+		audio::DecodeCache concurrent(64 << 20);
+		std::vector<std::shared_ptr<const audio::Buffer>> results(8);
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < results.size(); ++i) {
+			threads.push_back(std::thread([&, i]() {
+				results[i] = concurrent.decode(path, plain);
+			}));
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+		for (const std::shared_ptr<const audio::Buffer> &result : results) {
+			check(result == results[0], "concurrent requests do not share the decode");
+		}
+		check(concurrent.counters().misses == 1, "concurrent requests decode more than once");
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
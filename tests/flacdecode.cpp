@@ -0,0 +1,30 @@
+#include <iostream>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <codec/AudioFLACDecoder.h>
+#include <codec/AudioPCMCoder.h>
+
+using namespace com::nealrame;
+
+int main(int argc, char **argv) {
+	audio::PCMCoder coder;
+	audio::FLACDecoder decoder;
+
+	if (argc > 1) {
+		std::string input(argv[1]);
+		std::string output(boost::filesystem::path(input).stem().string() + ".wav");
+
+		try {
+			std::shared_ptr<audio::Buffer> buffer(decoder.decode(input));
+			coder.encode(*buffer, output);
+		} catch (const audio::Error &e) {
+			std::cerr << e.message << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <codec/AudioFLACCoder.h>
+#include <codec/AudioFLACDecoder.h>
+#include <codec/AudioPCMDecoder.h>
+
+using namespace com::nealrame;
+
+// Encode the given WAV file to FLAC, then decode it back and check that
+// the samples are unchanged.
+int main(int argc, char **argv) {
+	audio::PCMDecoder decoder;
+	audio::FLACCoder coder(audio::Coder::Quality::Best);
+	audio::FLACDecoder checker;
+
+	if (argc > 1) {
+		std::string input(argv[1]);
+		std::string output(boost::filesystem::path(input).stem().string() + ".flac");
+
+		try {
+			std::shared_ptr<audio::Buffer> buffer(decoder.decode(input));
+			coder.encode(*buffer, output);
+
+			std::shared_ptr<audio::Buffer> decoded(checker.decode(output));
+			size_t size = buffer->format().sizeForFrameCount(buffer->frameCount());
+			if (decoded->frameCount() != buffer->frameCount()
+					|| memcmp(decoded->data(), buffer->data(), size) != 0) {
+				std::cerr << output << ": decoded samples differ" << std::endl;
+				return 1;
+			}
+		} catch (const audio::Error &e) {
+			std::cerr << e.message << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioFLACDecoder.h>
+#include <io/AudioSource.h>
+
+using namespace com::nealrame;
+
+static uint8_t crc8(const std::string &data) {
+	uint8_t crc = 0;
+	for (unsigned char byte : data) {
+		crc ^= byte;
+		for (unsigned int bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+// A false frame header of 192 frames, with a valid CRC-8.
+static std::string frame_header(unsigned int assignment, unsigned int sample_size_code) {
+	std::string header;
+	header += (char)0xff;
+	header += (char)0xf8;
+	header += (char)0x10;
+	header += (char)(assignment << 4 | sample_size_code << 1);
+	header += (char)0x00;
+	header += (char)crc8(header);
+	return header;
+}
+
+static std::vector<int16_t> samples(const audio::Buffer &buffer) {
+	std::vector<int16_t> samples((size_t)buffer.frameCount()*buffer.format().channelCount());
+	buffer.read(0, buffer.frameCount(), samples.data());
+	return samples;
+}
+
+// Decode a stream followed by trailers which are not frames: tags, noise,
+// false frame headers passing their CRC-8, with a format change, bad
+// subframes or running past the end. They must be skipped, decoding the
+// same samples as the stream alone.
+int main() {
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	std::string path = (directory/"noise.flac").string();
+	int failures = 0;
+
+	boost::filesystem::create_directories(directory);
+	try {
+		audio::Generator(audio::Generator::Signal::PinkNoise).generate(audio::Format(2, 44100, 16), 1, path);
+		std::ifstream ifs(path.data(), std::ifstream::binary);
+		std::string stream((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		audio::FLACDecoder decoder;
+		audio::MemorySource source(stream.data(), stream.size());
+		std::unique_ptr<audio::Buffer> expected(decoder.decode(source));
+
+		std::mt19937 random(1);
+		std::string noise(4096, 0);
+		for (char &byte : noise) {
+			byte = random();
+		}
+		std::string tag = "TAG" + std::string(125, 'x');
+		std::string format_change = frame_header(0, 0) + noise.substr(0, 64);
+		std::string bad_subframe = frame_header(1, 0) + std::string(1, (char)0xfe) + noise.substr(0, 64);
+		std::string past_end = frame_header(1, 0) + std::string(3, 0);
+		std::string header_past_end = frame_header(1, 0).substr(0, 4);
+		std::vector<std::string> trailers = {
+			tag, noise, format_change, bad_subframe, past_end, header_past_end,
+			format_change + tag, noise + bad_subframe + past_end,
+		};
+
+		for (size_t i = 0; i < trailers.size(); ++i) {
+			std::string data = stream + trailers[i];
+			audio::MemorySource source(data.data(), data.size());
+			try {
+				std::unique_ptr<audio::Buffer> buffer(decoder.decode(source));
+				if (samples(*buffer) != samples(*expected)) {
+					std::cerr << "trailer " << i << ": " << buffer->frameCount() << " frames decoded, expected "
+						<< expected->frameCount() << std::endl;
+					failures++;
+				}
+			} catch (audio::Error &e) {
+				std::cerr << "trailer " << i << ": " << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+				failures++;
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioError.h>
+#include <AudioGenerator.h>
+
+using namespace com::nealrame;
+
+static const audio::Generator::Signal signals[] = {
+	audio::Generator::Signal::Silence,
+	audio::Generator::Signal::Sine,
+	audio::Generator::Signal::Sweep,
+	audio::Generator::Signal::WhiteNoise,
+	audio::Generator::Signal::PinkNoise,
+	audio::Generator::Signal::Impulses,
+	audio::Generator::Signal::Clipped,
+};
+
+static audio::Coder::Quality quality_from_name(const std::string &name) {
+	if (name == "best") return audio::Coder::Quality::Best;
+	if (name == "good") return audio::Coder::Quality::Good;
+	if (name == "acceptable") return audio::Coder::Quality::Acceptable;
+	if (name == "fastest") return audio::Coder::Quality::Fastest;
+	throw audio::Error(audio::Error::Status::FormatBadValue, "Unknown quality " + name + ".");
+}
+
+// Every signal at every format: WAV for all of them, Ogg Vorbis for 16
+// bits formats, MP3 for the formats LAME accepts (mono or stereo, up to
+// 48kHz).
+static void generate_corpus(const std::string &directory, double seconds, uint32_t seed, audio::Coder::Quality quality) {
+	static const unsigned int channel_counts[] = { 1, 2, 6 };
+	static const unsigned int sample_rates[] = { 8000, 16000, 22050, 44100, 48000, 96000 };
+	static const unsigned int bit_depths[] = { 8, 16 };
+
+	boost::filesystem::create_directories(directory);
+
+	for (audio::Generator::Signal signal : signals) {
+		for (unsigned int channel_count : channel_counts) {
+			for (unsigned int sample_rate : sample_rates) {
+				for (unsigned int bit_depth : bit_depths) {
+					audio::Generator generator(signal, seed);
+					audio::Format format(channel_count, sample_rate, bit_depth);
+					std::ostringstream stem;
+					stem << directory << "/" << audio::Generator::signalName(signal)
+						<< "-" << channel_count << "ch-" << sample_rate << "hz-" << bit_depth << "bits";
+
+					std::cout << stem.str() << std::endl;
+					generator.generate(format, seconds, stem.str() + ".wav", quality);
+					if (bit_depth == 16) {
+						generator.generate(format, seconds, stem.str() + ".ogg", quality);
+						if (channel_count <= 2 && sample_rate <= 48000) {
+							generator.generate(format, seconds, stem.str() + ".mp3", quality);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+static void usage(const char *name) {
+	std::cerr
+		<< "usage: " << name << " [options] OUTPUT.(wav|mp3|ogg)\n"
+		<< "       " << name << " [options] --corpus DIRECTORY\n"
+		<< "  --signal NAME      silence, sine, sweep, white, pink, impulses or clipped (default sine)\n"
+		<< "  --channels N       channel count (default 2)\n"
+		<< "  --rate N           sample rate (default 44100)\n"
+		<< "  --bits N           bit depth, 8 or 16 (default 16)\n"
+		<< "  --seconds N        duration (default 10)\n"
+		<< "  --seed N           noise seed (default 1)\n"
+		<< "  --quality NAME     best, good, acceptable or fastest (default good)\n";
+}
+
+int main(int argc, char **argv) {
+	std::string signal("sine"), output, corpus;
+	unsigned int channel_count = 2, sample_rate = 44100, bit_depth = 16;
+	double seconds = 10;
+	uint32_t seed = 1;
+	std::string quality("good");
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 2, "--") != 0) {
+			output = arg;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			usage(argv[0]);
+			return 1;
+		}
+		if (arg == "--signal") {
+			signal = argv[++i];
+		} else if (arg == "--channels") {
+			channel_count = std::atoi(argv[++i]);
+		} else if (arg == "--rate") {
+			sample_rate = std::atoi(argv[++i]);
+		} else if (arg == "--bits") {
+			bit_depth = std::atoi(argv[++i]);
+		} else if (arg == "--seconds") {
+			seconds = std::atof(argv[++i]);
+		} else if (arg == "--seed") {
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--quality") {
+			quality = argv[++i];
+		} else if (arg == "--corpus") {
+			corpus = argv[++i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (output.empty() == corpus.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	try {
+		if (! corpus.empty()) {
+			generate_corpus(corpus, seconds, seed, quality_from_name(quality));
+		} else {
+			audio::Generator generator(audio::Generator::signalFromName(signal), seed);
+			generator.generate(audio::Format(channel_count, sample_rate, bit_depth), seconds, output, quality_from_name(quality));
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		return 1;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
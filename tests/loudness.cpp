@@ -0,0 +1,55 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <analysis/AudioLoudnessMeter.h>
+
+using namespace com::nealrame;
+
+static bool close(double a, double b, double tolerance) {
+	return (std::isinf(a) && std::isinf(b) && a == b) || std::fabs(a - b) <= tolerance;
+}
+
+// Measure buffers whose lengths are not multiples of a sub-block in
+// segments, with several segment counts, and check the measure against a
+// single pass. Segments are primed on the frames before them, so the
+// filters output differs slightly at their start.
+int main() {
+	static const unsigned int frame_counts[] = { 0, 1, 4409, 4410, 8821, 10000, 44100, 132301 };
+	static const unsigned int thread_counts[] = { 1, 2, 3, 4, 7, 64 };
+	int failures = 0;
+
+	try {
+		audio::Format format(2, 44100, 16);
+		audio::Generator generator(audio::Generator::Signal::PinkNoise);
+
+		for (unsigned int frame_count : frame_counts) {
+			audio::Buffer buffer(format);
+			generator.generate(buffer, frame_count);
+
+			audio::LoudnessMeter single(format);
+			single.process(buffer, 0, buffer.frameCount());
+
+			for (unsigned int thread_count : thread_counts) {
+				audio::LoudnessMeter meter = audio::LoudnessMeter::analyze(buffer, thread_count);
+				if (! close(meter.integratedLoudness(), single.integratedLoudness(), 1e-3)
+						|| ! close(meter.momentaryLoudness(), single.momentaryLoudness(), 1e-3)
+						|| ! close(meter.shortTermLoudness(), single.shortTermLoudness(), 1e-3)
+						|| ! close(meter.loudnessRange(), single.loudnessRange(), 1e-3)
+						|| meter.samplePeak() != single.samplePeak()
+						|| ! close(meter.truePeak(), single.truePeak(), 1e-6)) {
+					std::cerr << frame_count << " frames, " << thread_count << " threads: "
+						<< meter.integratedLoudness() << " LUFS, expected " << single.integratedLoudness() << std::endl;
+					failures++;
+				}
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioOggVorbisDecoder.h>
+#include <io/AudioSource.h>
+
+using namespace com::nealrame;
+
+static std::string file_bytes(const std::string &path) {
+	std::ifstream ifs(path.data(), std::ifstream::binary);
+	return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static void file_write(const std::string &path, const std::string &data) {
+	std::ofstream(path.data(), std::ofstream::binary).write(data.data(), data.size());
+}
+
+static std::vector<int16_t> samples(const audio::Buffer &buffer) {
+	std::vector<int16_t> samples((size_t)buffer.frameCount()*buffer.format().channelCount());
+	buffer.read(0, buffer.frameCount(), samples.data());
+	return samples;
+}
+
+// Decode a stream through each kind of source.
+static std::vector<std::vector<int16_t>> decode(const audio::OggVorbisDecoder &decoder, const std::string &data, const std::string &path) {
+	std::vector<std::vector<int16_t>> decoded;
+	file_write(path, data);
+
+	audio::MemorySource memory(data.data(), data.size());
+	decoded.push_back(samples(*std::unique_ptr<audio::Buffer>(decoder.decode(memory))));
+	audio::MappedFileSource mapped(path);
+	decoded.push_back(samples(*std::unique_ptr<audio::Buffer>(decoder.decode(mapped))));
+	std::istringstream stream(data);
+	audio::StreamSource buffered(stream, 4096);
+	decoded.push_back(samples(*std::unique_ptr<audio::Buffer>(decoder.decode(buffered))));
+	return decoded;
+}
+
+// Decode a clean stream, parsed in place, and the same stream with garbage
+// before its first page, which makes the decoder fall back to ogg_sync for
+// the whole stream, or between two pages, which makes it fall back in the
+// middle of the stream. Garbage between pages is skipped, so every decode
+// must give the samples of the whole ogg_sync decode.
+int main() {
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	std::string path = (directory/"noise.ogg").string();
+	int failures = 0;
+
+	boost::filesystem::create_directories(directory);
+	try {
+		audio::Generator(audio::Generator::Signal::PinkNoise).generate(audio::Format(2, 44100, 16), 3, path);
+		std::string stream = file_bytes(path);
+		std::vector<size_t> pages;
+		for (size_t i = stream.find("OggS"); i != std::string::npos; i = stream.find("OggS", i + 1)) {
+			pages.push_back(i);
+		}
+
+		std::mt19937 random(1);
+		std::string garbage(5000, 0);
+		for (char &byte : garbage) {
+			byte = 'a' + random() % 26;
+		}
+		std::string truncated_page = stream.substr(pages[pages.size()/2], 100);
+
+		audio::OggVorbisDecoder decoder;
+		std::string baseline_path = (directory/"baseline.ogg").string();
+		std::vector<int16_t> baseline = decode(decoder, garbage + stream, baseline_path)[0];
+		if (baseline.empty()) {
+			std::cerr << "the ogg_sync decode is empty" << std::endl;
+			failures++;
+		}
+
+		struct {
+			const char *name;
+			std::string data;
+		} cases[] = {
+			{ "clean", stream },
+			{ "leading garbage", garbage + stream },
+			{ "garbage after the headers", stream.substr(0, pages[3]) + garbage + stream.substr(pages[3]) },
+			{ "mid-stream garbage", stream.substr(0, pages[pages.size()/2]) + garbage + stream.substr(pages[pages.size()/2]) },
+			{ "mid-stream truncated page", stream.substr(0, pages[pages.size()/2]) + truncated_page + stream.substr(pages[pages.size()/2]) },
+		};
+		static const char *sources[] = { "memory", "mapped file", "stream" };
+		for (auto &test : cases) {
+			std::vector<std::vector<int16_t>> decoded = decode(decoder, test.data, (directory/"test.ogg").string());
+			for (size_t i = 0; i < decoded.size(); ++i) {
+				if (decoded[i] != baseline) {
+					std::cerr << test.name << ", " << sources[i] << " source: " << decoded[i].size() << " samples decoded, "
+						<< baseline.size() << " expected" << std::endl;
+					failures++;
+				}
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <analysis/AudioPeakPyramid.h>
+
+using namespace com::nealrame;
+
+// Compute the peak of frames [start, end) straight from the samples.
+static std::vector<audio::PeakPyramid::Peak> direct(const audio::Buffer &buffer, unsigned int start, unsigned int end) {
+	unsigned int channel_count = buffer.format().channelCount();
+	std::vector<int16_t> samples((end - start)*channel_count);
+	std::vector<audio::PeakPyramid::Peak> peaks;
+
+	buffer.read(start, end - start, samples.data());
+	for (unsigned int c = 0; c < channel_count; ++c) {
+		int mn = 32767, mx = -32768;
+		double squares = 0;
+		for (unsigned int i = c; i < samples.size(); i += channel_count) {
+			mn = std::min(mn, (int)samples[i]);
+			mx = std::max(mx, (int)samples[i]);
+			squares += (double)samples[i]*samples[i];
+		}
+		peaks.push_back(audio::PeakPyramid::Peak{
+			mn/32767.0f, mx/32767.0f, (float)(std::sqrt(squares/(end - start))/32767) });
+	}
+	return peaks;
+}
+
+// Build pyramids over lengths which end in a partial bin, from chunks of
+// random sizes, and compare the peaks of ranges from the start with a
+// direct computation over the bins they cover.
+int main() {
+	static const unsigned int frame_counts[] = { 1, 255, 256, 300, 1000, 4097, 65537, 100000 };
+	int failures = 0;
+
+	try {
+		std::mt19937 random(1);
+		audio::Generator generator(audio::Generator::Signal::PinkNoise);
+
+		for (unsigned int channel_count : { 1, 2 }) {
+			for (unsigned int frame_count : frame_counts) {
+				audio::Buffer buffer(audio::Format(channel_count, 44100, 16));
+				generator.generate(buffer, frame_count);
+				// A loud start, so that an unweighted last bin shows.
+				std::vector<int16_t> loud(std::min(frame_count, 256u)*channel_count, 30000);
+				buffer.write(0, loud.size()/channel_count, loud.data());
+
+				audio::PeakPyramid pyramid;
+				for (unsigned int offset = 0; offset < frame_count;) {
+					unsigned int count = 1 + random() % 3000;
+					pyramid.process(buffer, offset, count);
+					offset += count;
+				}
+				pyramid.finish();
+
+				for (unsigned int end = frame_count; end > 0; end = end > pyramid.baseBinSize() ? (end - 1)/pyramid.baseBinSize()*pyramid.baseBinSize() : 0) {
+					// The query covers whole bins of the largest size fitting in
+					// the range.
+					unsigned int bin_size = pyramid.baseBinSize();
+					for (unsigned int level = 1; level < pyramid.levelCount() && (pyramid.baseBinSize() << level) <= end; ++level) {
+						bin_size = pyramid.baseBinSize() << level;
+					}
+					unsigned int covered = std::min((end - 1)/bin_size*bin_size + bin_size, frame_count);
+					std::vector<audio::PeakPyramid::Peak> peaks = pyramid.query(0, end, 1);
+					std::vector<audio::PeakPyramid::Peak> expected = direct(buffer, 0, covered);
+					for (unsigned int c = 0; c < channel_count; ++c) {
+						if (peaks[c].min != expected[c].min || peaks[c].max != expected[c].max
+								|| std::fabs(peaks[c].rms - expected[c].rms) > 1e-4*expected[c].rms + 1e-6) {
+							std::cerr << channel_count << " channels, " << frame_count << " frames, [0, " << covered << "): rms "
+								<< peaks[c].rms << ", expected " << expected[c].rms << std::endl;
+							failures++;
+						}
+					}
+				}
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
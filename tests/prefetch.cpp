@@ -0,0 +1,92 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioError.h>
+#include <io/AudioPrefetchSource.h>
+#include <io/AudioSource.h>
+
+using namespace com::nealrame;
+
+// Run the same random peeks, consumes, reads and skips on a prefetch
+// source and on a memory source of the same bytes. Peeks go up to three
+// blocks, so many straddle blocks and go through the spill buffer, and
+// consumes may stop in the middle of the spilled bytes.
+static bool compare(audio::Source &prefetch, const std::vector<char> &data, size_t block_size, unsigned int seed) {
+	audio::MemorySource memory(data.data(), data.size());
+	std::mt19937 random(seed);
+
+	while (memory.position() < data.size()) {
+		size_t size = random() % (3*block_size + 2), expected_size = size;
+		unsigned int operation = random() % 8;
+
+		if (operation == 0) {
+			std::vector<char> bytes(size), expected(size);
+			size = prefetch.read(bytes.data(), size);
+			if (size != memory.read(expected.data(), expected_size) || memcmp(bytes.data(), expected.data(), size) != 0) {
+				return false;
+			}
+		} else if (operation == 1) {
+			if (prefetch.skip(size) != memory.skip(size)) {
+				return false;
+			}
+		} else {
+			const char *bytes = prefetch.peek(size);
+			const char *expected = memory.peek(expected_size);
+			if (size != expected_size || memcmp(bytes, expected, size) != 0) {
+				return false;
+			}
+			size_t count = size > 0 ? random() % (size + 1) : 0;
+			prefetch.consume(count);
+			memory.consume(count);
+		}
+		if (prefetch.position() != memory.position()) {
+			return false;
+		}
+	}
+	size_t size = 16;
+	prefetch.peek(size);
+	return size == 0 && prefetch.position() == data.size();
+}
+
+int main() {
+	static const size_t block_sizes[] = { 1, 7, 1000, 4096 };
+	boost::filesystem::path path = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	std::mt19937 random(1);
+	std::vector<char> data(30000 + 17);
+	int failures = 0;
+
+	for (char &byte : data) {
+		byte = random();
+	}
+	std::ofstream(path.string(), std::ofstream::binary).write(data.data(), data.size());
+
+	try {
+		for (size_t block_size : block_sizes) {
+			for (unsigned int block_count : { 1, 2, 4 }) {
+				for (unsigned int seed = 1; seed <= 4; ++seed) {
+					audio::MemorySource upstream(data.data(), data.size());
+					audio::PrefetchSource source(upstream, block_size, block_count);
+					audio::PrefetchSource file(path.string(), block_size, block_count);
+					if (! compare(source, data, block_size, seed) || ! compare(file, data, block_size, seed)) {
+						std::cerr << block_count << " blocks of " << block_size << " bytes, seed " << seed
+							<< ": the prefetch source differs from the memory source" << std::endl;
+						failures++;
+					}
+				}
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove(path);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <codec/AudioDecoder.h>
+#include <io/AudioBatchReader.h>
+
+using namespace com::nealrame;
+
+// Decode every .wav, .mp3 and .ogg file of the given directories with a
+// BatchReader. Pass --pool to force the thread pool backend.
+int main(int argc, char **argv) {
+	audio::BatchReader::Backend backend = audio::BatchReader::Backend::Auto;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg == "--pool") {
+			backend = audio::BatchReader::Backend::ThreadPool;
+			continue;
+		}
+		for (boost::filesystem::recursive_directory_iterator it(arg), end; it != end; ++it) {
+			std::string ext = it->path().extension().string();
+			if (ext == ".wav" || ext == ".mp3" || ext == ".ogg") {
+				paths.push_back(it->path().string());
+			}
+		}
+	}
+
+	try {
+		audio::BatchReader reader(backend);
+		unsigned long long frame_count = 0;
+		unsigned int file_count = 0, error_count = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		reader.read(paths, [&](audio::BatchReader::File &file) {
+			try {
+				if (file.error() != 0) {
+					audio::Error::raise(audio::Error::Status::IOError, std::strerror(file.error()));
+				}
+				std::unique_ptr<audio::Decoder> decoder(audio::Decoder::getDecoder(file.path()));
+				std::unique_ptr<audio::Buffer> buffer(decoder->decode(file.source()));
+				frame_count += buffer->frameCount();
+				file_count++;
+			} catch (audio::Error &e) {
+				std::cerr << file.path() << ": " << e.message << std::endl;
+				error_count++;
+			}
+		});
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		std::cout
+			<< (reader.backend() == audio::BatchReader::Backend::IOUring ? "io_uring" : "thread pool")
+			<< ": " << file_count << " files (" << error_count << " errors), "
+			<< frame_count << " frames in " << elapsed.count() << "s, "
+			<< file_count/elapsed.count() << " files/s"
+			<< std::endl;
+	} catch (audio::Error &e) {
+		std::cerr << e.message << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,175 @@
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioPCMDecoder.h>
+#include <codec/AudioSharedCache.h>
+
+using namespace com::nealrame;
+
+// A decoder whose process dies in the middle of the decode, leaving the
+// slot it filled behind.
+struct DyingDecoder : public audio::PCMDecoder {
+	bool dies;
+	DyingDecoder(bool dies) : dies(dies) {}
+	using audio::PCMDecoder::decode;
+	virtual audio::Buffer * decode(audio::Source &source) const {
+		if (dies) {
+			_exit(0);
+		}
+		return audio::PCMDecoder::decode(source);
+	}
+};
+
+static bool same(const audio::Buffer &a, const audio::Buffer &b) {
+	size_t size = a.format().sizeForFrameCount(a.frameCount());
+	return a.format().channelCount() == b.format().channelCount()
+		&& a.frameCount() == b.frameCount()
+		&& memcmp(a.data(), b.data(), size) == 0;
+}
+
+// Decode the files in a child process, in its own order, and check them
+// against a plain decode.
+static bool child(const std::string &name, const std::vector<std::string> &paths, const std::vector<std::shared_ptr<audio::Buffer>> &expected, unsigned int seed) {
+	try {
+		audio::SharedCache cache(name, 64 << 20);
+		DyingDecoder decoder(false);
+		for (unsigned int round = 0; round < 16; ++round) {
+			unsigned int i = (seed + round) % paths.size();
+			std::shared_ptr<const audio::Buffer> buffer = cache.decode(paths[i], decoder);
+			if (! same(*buffer, *expected[i])) {
+				std::cerr << paths[i] << ": the shared buffer differs" << std::endl;
+				return false;
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool wait_children(std::vector<pid_t> &pids) {
+	bool succeeded = true;
+	for (pid_t pid : pids) {
+		int status;
+		succeeded = waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && succeeded;
+	}
+	pids.clear();
+	return succeeded;
+}
+
+// Decode many files in turn through a cache holding only a few of them,
+// so that entries are evicted all along and leave tombstones in the
+// index. Once every slot has been used, a miss must still visit a few
+// slots only, not the whole index.
+static bool churn(const std::string &name, const boost::filesystem::path &directory) {
+	static const unsigned int slot_count = 64;
+	std::vector<std::string> paths;
+	audio::PCMDecoder decoder;
+	for (unsigned int i = 0; i < 4*slot_count; ++i) {
+		std::string path = (directory/("churn" + std::to_string(i) + ".wav")).string();
+		audio::Generator(audio::Generator::Signal::PinkNoise, i + 1).generate(audio::Format(1, 8000, 16), 0.01, path);
+		paths.push_back(path);
+	}
+	uint64_t size = audio::Format(1, 8000, 16).sizeForFrameCount(80);
+
+	audio::SharedCache::remove(name);
+	audio::SharedCache cache(name, 4*size, slot_count);
+	bool succeeded = true;
+	for (unsigned int round = 0; round < 4; ++round) {
+		uint64_t probes = cache.counters().probes;
+		for (const std::string &path : paths) {
+			cache.decode(path, decoder);
+		}
+		probes = cache.counters().probes - probes;
+		if (round > 0 && probes > 8*paths.size()) {
+			std::cerr << "round " << round << ": " << (double)probes/paths.size() << " slots probed by miss" << std::endl;
+			succeeded = false;
+		}
+	}
+	audio::SharedCache::remove(name);
+	return succeeded;
+}
+
+// Share a few files between many processes decoding them at once, then
+// check that a file whose decoding process died is decoded again by the
+// one waiting for it, and that the index does not fill up with tombstones.
+int main() {
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	std::string name = "nraudio-test-" + std::to_string(getpid());
+	int failures = 0;
+
+	// A waiter stuck on a dead fill fails the test instead of hanging it.
+	alarm(60);
+	boost::filesystem::create_directories(directory);
+	try {
+		std::vector<std::string> paths;
+		std::vector<std::shared_ptr<audio::Buffer>> expected;
+		audio::PCMDecoder decoder;
+		for (unsigned int i = 0; i < 3; ++i) {
+			std::string path = (directory/("noise" + std::to_string(i) + ".wav")).string();
+			audio::Generator(audio::Generator::Signal::PinkNoise, i + 1).generate(audio::Format(2, 44100, 16), 1, path);
+			paths.push_back(path);
+			expected.push_back(std::shared_ptr<audio::Buffer>(decoder.decode(path)));
+		}
+
+		audio::SharedCache::remove(name);
+		audio::SharedCache cache(name, 64 << 20);
+		std::vector<pid_t> pids;
+		for (unsigned int i = 0; i < 8; ++i) {
+			pid_t pid = fork();
+			if (pid == 0) {
+				_exit(child(name, paths, expected, i) ? 0 : 1);
+			}
+			pids.push_back(pid);
+		}
+		if (! wait_children(pids)) {
+			std::cerr << "a process failed to share the files" << std::endl;
+			failures++;
+		}
+		audio::SharedCache::Counters counters = cache.counters();
+		if (counters.entries != paths.size()) {
+			std::cerr << counters.entries << " entries, expected " << paths.size() << std::endl;
+			failures++;
+		}
+
+		std::string path = (directory/"sine.wav").string();
+		audio::Generator(audio::Generator::Signal::Sine).generate(audio::Format(1, 22050, 16), 1, path);
+		pid_t pid = fork();
+		if (pid == 0) {
+			audio::SharedCache cache(name, 64 << 20);
+			cache.decode(path, DyingDecoder(true));
+			_exit(1);
+		}
+		pids.push_back(pid);
+		wait_children(pids);
+		std::shared_ptr<const audio::Buffer> buffer = cache.decode(path, DyingDecoder(false));
+		std::unique_ptr<audio::Buffer> sine(decoder.decode(path));
+		if (! same(*buffer, *sine) || cache.counters().entries != paths.size() + 1) {
+			std::cerr << "the file left by a dead process is not decoded again" << std::endl;
+			failures++;
+		}
+
+		if (! churn(name + "-churn", directory)) {
+			failures++;
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	audio::SharedCache::remove(name);
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <utime.h>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioPCMDecoder.h>
+#include <codec/AudioSidecarCache.h>
+
+using namespace com::nealrame;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string &what) {
+	if (! condition) {
+		std::cerr << what << std::endl;
+		failures++;
+	}
+}
+
+// Count the sidecars of a directory and their bytes.
+static void scan(const boost::filesystem::path &directory, uint64_t &entries, uint64_t &bytes) {
+	entries = bytes = 0;
+	for (boost::filesystem::directory_iterator it(directory), end; it != end; ++it) {
+		if (it->path().extension() == ".pcm") {
+			entries++;
+			bytes += boost::filesystem::file_size(it->path());
+		}
+	}
+}
+
+// Store sidecars until the budget is exceeded. A stale temporary file,
+// removed by directory scans only, shows when the directory is scanned:
+// at the first store and when the budget is exceeded, not in between.
+int main() {
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	boost::filesystem::path sidecars = directory/"sidecars";
+
+	boost::filesystem::create_directories(directory);
+	try {
+		audio::PCMDecoder decoder;
+		std::vector<std::string> paths;
+		std::vector<std::shared_ptr<audio::Buffer>> buffers;
+		for (unsigned int i = 0; i < 5; ++i) {
+			std::string path = (directory/("noise" + std::to_string(i) + ".wav")).string();
+			audio::Generator(audio::Generator::Signal::PinkNoise, i + 1).generate(audio::Format(2, 44100, 16), 0.1, path);
+			paths.push_back(path);
+			buffers.push_back(std::shared_ptr<audio::Buffer>(decoder.decode(path)));
+		}
+		uint64_t size = audio::SidecarCache::Alignment + buffers[0]->format().sizeForFrameCount(buffers[0]->frameCount());
+		audio::SidecarCache cache(sidecars.string(), 3*size + size/2);
+		uint64_t entries, bytes;
+
+		cache.store(paths[0], decoder, *buffers[0]);
+		check(cache.counters().entries == 1 && cache.counters().bytes == size, "the first store does not scan the directory");
+
+		boost::filesystem::path stale = sidecars/"stale.pcm.tmp1.0";
+		std::ofstream(stale.string()) << "stale";
+		struct utimbuf times = { time(nullptr) - 7200, time(nullptr) - 7200 };
+		utime(stale.string().data(), &times);
+
+		cache.store(paths[1], decoder, *buffers[1]);
+		cache.store(paths[2], decoder, *buffers[2]);
+		scan(sidecars, entries, bytes);
+		check(boost::filesystem::exists(stale), "a store within the budget scans the directory");
+		check(cache.counters().entries == entries && cache.counters().bytes == bytes, "the counted bytes differ from the directory");
+		check(cache.counters().evictions == 0, "a store within the budget evicts");
+
+		cache.store(paths[3], decoder, *buffers[3]);
+		cache.store(paths[4], decoder, *buffers[4]);
+		scan(sidecars, entries, bytes);
+		check(! boost::filesystem::exists(stale), "a store over the budget does not scan the directory");
+		check(bytes <= cache.budget() && entries == 3, "the directory does not fit in the budget");
+		check(cache.counters().entries == entries && cache.counters().bytes == bytes, "the counted bytes differ from the directory");
+		check(cache.counters().evictions == 2, "unexpected eviction count");
+
+		unsigned int loaded = 0;
+		for (unsigned int i = 0; i < paths.size(); ++i) {
+			std::unique_ptr<audio::Buffer> buffer(cache.load(paths[i], decoder));
+			loaded += buffer && buffer->frameCount() == buffers[i]->frameCount();
+		}
+		check(loaded == entries, "the sidecars left are not loaded");
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <analysis/AudioFFT.h>
+#include <analysis/AudioSpectrogram.h>
+#include <codec/AudioPCMDecoder.h>
+
+using namespace com::nealrame;
+
+// Get the largest difference between the FFT of random samples and a naive
+// DFT computed in double precision.
+static double fft_error(unsigned int size, std::mt19937 &random) {
+	std::uniform_real_distribution<float> sample(-1, 1);
+	std::shared_ptr<const audio::FFT> fft = audio::FFT::plan(size);
+	std::vector<float> input(size), re(fft->binCount()), im(fft->binCount());
+	double error = 0;
+
+	for (float &value : input) {
+		value = sample(random);
+	}
+	fft->forward(input.data(), re.data(), im.data());
+	for (unsigned int k = 0; k < fft->binCount(); ++k) {
+		double expected_re = 0, expected_im = 0;
+		for (unsigned int n = 0; n < size; ++n) {
+			double angle = -2*M_PI*(double)((uint64_t)k*n % size)/size;
+			expected_re += input[n]*std::cos(angle);
+			expected_im += input[n]*std::sin(angle);
+		}
+		error = std::max(error, std::max(std::fabs(re[k] - expected_re), std::fabs(im[k] - expected_im)));
+	}
+	return error;
+}
+
+// Check the FFT against a naive DFT for every size up to 8192, then time
+// the spectrogram of the given file if any.
+int main(int argc, char **argv) {
+	audio::PCMDecoder decoder;
+	std::mt19937 random(1);
+	int failures = 0;
+
+	for (unsigned int size = 4; size <= 8192; size *= 2) {
+		double error = fft_error(size, random);
+		std::cout << "FFT size " << size << ": " << error << " max error" << std::endl;
+		if (error > 2e-6*std::sqrt(size)) {
+			std::cerr << "FFT size " << size << ": the bins differ from a naive DFT" << std::endl;
+			failures++;
+		}
+	}
+
+	if (argc > 1) {
+		std::string input(argv[1]);
+
+		try {
+			std::shared_ptr<audio::Buffer> buffer(decoder.decode(input));
+
+			for (unsigned int frame_size = 256; frame_size <= 8192; frame_size *= 2) {
+				float sum = 0;
+				audio::Spectrogram spectrogram(frame_size, frame_size/4, audio::Spectrogram::Window::Hann,
+					[&sum](const float *magnitudes, unsigned int bin_count, unsigned int) {
+						sum += magnitudes[bin_count/2];
+					});
+
+				auto start = std::chrono::steady_clock::now();
+				spectrogram.process(*buffer, 0, buffer->frameCount());
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+				std::cout
+					<< "frame size " << frame_size
+					<< ": " << spectrogram.frameIndex() << " frames in " << elapsed.count() << "s, "
+					<< spectrogram.frameIndex()/elapsed.count() << " frames/s"
+					<< std::endl;
+			}
+		} catch (const audio::Error &e) {
+			std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+			return 1;
+		} catch (const std::exception &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
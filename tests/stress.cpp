@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioCoder.h>
+#include <codec/AudioDecoder.h>
+#include <codec/AudioOggVorbisCoder.h>
+
+using namespace com::nealrame;
+
+// A decode or an encode of the stress, and the bytes it gives when it runs
+// alone.
+struct Task {
+	std::string name;
+	std::function<std::string()> run;
+	std::string expected;
+};
+
+static std::string buffer_bytes(const audio::Buffer &buffer) {
+	std::ostringstream bytes;
+	audio::Format format = buffer.format();
+	bytes << format.channelCount() << "/" << format.sampleRate() << "/" << buffer.frameCount() << "/";
+	bytes.write((const char *)buffer.data(), format.sizeForFrameCount(buffer.frameCount()));
+	return bytes.str();
+}
+
+static void add_tasks(std::vector<Task> &tasks, const std::string &extension, const std::string &source_name, std::shared_ptr<const audio::Buffer> source) {
+	std::shared_ptr<audio::Coder> coder(audio::Coder::getCoder("stress" + extension));
+	std::shared_ptr<audio::Decoder> decoder(audio::Decoder::getDecoder("stress" + extension));
+
+	// The same file on every run.
+	if (audio::OggVorbisCoder *ogg_coder = dynamic_cast<audio::OggVorbisCoder *>(coder.get())) {
+		ogg_coder->setStreamSerial(1);
+	}
+
+	Task encode;
+	encode.name = source_name + " to " + extension;
+	encode.run = [coder, source]() {
+		std::ostringstream output;
+		coder->encode(*source, output);
+		return output.str();
+	};
+	encode.expected = encode.run();
+
+	Task decode;
+	std::string encoded(encode.expected);
+	decode.name = source_name + extension + " decode";
+	decode.run = [decoder, encoded]() {
+		std::istringstream input(encoded);
+		std::unique_ptr<audio::Buffer> buffer(decoder->decode(input));
+		return buffer_bytes(*buffer);
+	};
+	decode.expected = decode.run();
+
+	tasks.push_back(encode);
+	tasks.push_back(decode);
+}
+
+static void usage(const char *name) {
+	std::cerr
+		<< "usage: " << name << " [options]\n"
+		<< "  --threads N        thread count (default twice the hardware threads, at least 4)\n"
+		<< "  --rounds N         runs of every task by each thread (default 4)\n"
+		<< "  --format EXT       wav, flac, mp3 or ogg, may be repeated (default all)\n"
+		<< "  --help             print this help\n";
+}
+
+// Run the decodes and encodes of every format in many threads at once,
+// each thread in its own order, with one decoder and one coder per format
+// shared by all of them, and check that each run gives the same bytes as
+// the run alone.
+int main(int argc, char **argv) {
+	unsigned int thread_count = std::max(2*std::thread::hardware_concurrency(), 4u);
+	unsigned int round_count = 4;
+	std::vector<std::string> extensions;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg == "--help" || arg == "-h") {
+			usage(argv[0]);
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			usage(argv[0]);
+			return 1;
+		}
+		if (arg == "--threads") {
+			thread_count = std::max(std::atoi(argv[++i]), 1);
+		} else if (arg == "--rounds") {
+			round_count = std::max(std::atoi(argv[++i]), 1);
+		} else if (arg == "--format") {
+			extensions.push_back(std::string(".") + argv[++i]);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (extensions.empty()) {
+		extensions = { ".wav", ".flac", ".mp3", ".ogg" };
+	}
+
+	std::vector<Task> tasks;
+	try {
+		audio::Generator sine(audio::Generator::Signal::Sine);
+		audio::Generator noise(audio::Generator::Signal::PinkNoise);
+		std::shared_ptr<const audio::Buffer> stereo(sine.generate(audio::Format(2, 44100, 16), 3));
+		std::shared_ptr<const audio::Buffer> mono(noise.generate(audio::Format(1, 22050, 16), 3));
+
+		for (const std::string &extension : extensions) {
+			add_tasks(tasks, extension, "sine", stereo);
+			add_tasks(tasks, extension, "noise", mono);
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		return 1;
+	}
+
+	std::mutex failures_mutex;
+	std::vector<std::string> failures;
+	std::vector<std::thread> threads;
+
+	for (unsigned int t = 0; t < thread_count; ++t) {
+		threads.push_back(std::thread([&, t]() {
+			for (unsigned int round = 0; round < round_count; ++round) {
+				for (unsigned int i = 0; i < tasks.size(); ++i) {
+					const Task &task = tasks[(i + t + round) % tasks.size()];
+					std::string failure;
+					try {
+						if (task.run() != task.expected) {
+							failure = task.name + ": output differs from the single threaded run";
+						}
+					} catch (audio::Error &e) {
+						failure = task.name + ": " + audio::Error::statusToString(e.status) + ": " + e.message;
+					} catch (std::exception &e) {
+						failure = task.name + ": " + e.what();
+					}
+					if (! failure.empty()) {
+						std::lock_guard<std::mutex> lock(failures_mutex);
+						failures.push_back(failure);
+					}
+				}
+			}
+		}));
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	for (const std::string &failure : failures) {
+		std::cerr << failure << std::endl;
+	}
+	std::cout << thread_count << " threads, " << round_count*tasks.size() << " tasks each, "
+		<< failures.size() << " failures" << std::endl;
+	return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioError.h>
+#include <AudioTrace.h>
+#include <io/AudioVectoredSink.h>
+
+using namespace com::nealrame;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string &what) {
+	if (! condition) {
+		std::cerr << what << std::endl;
+		failures++;
+	}
+}
+
+static std::string file_bytes(const std::string &path) {
+	std::ifstream ifs(path.data(), std::ifstream::binary);
+	return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+// Count the spans of the given name recorded since the last call.
+static unsigned int spans(const std::string &name) {
+	std::ostringstream trace;
+	audio::Trace::write(trace);
+	audio::Trace::clear();
+
+	std::string json = trace.str(), quoted = "\"" + name + "\"";
+	unsigned int count = 0;
+	for (size_t i = json.find(quoted); i != std::string::npos; i = json.find(quoted, i + 1)) {
+		count++;
+	}
+	return count;
+}
+
+// Write random small chunks, vectors of chunks some of them empty, and
+// chunks larger than the batch. Each writev call but the last sends more
+// than a batch, and the staged bytes never reach the file before a batch
+// is full.
+static void check_batches(const std::string &path, const std::string &data, size_t batch_size) {
+	std::mt19937 random(1);
+	audio::VectoredSink sink(path, batch_size);
+	size_t offset = 0;
+
+	spans("sink.writev");
+	while (offset < data.size()) {
+		size_t size = std::min<size_t>(random() % 8 == 0 ? random() % (3*batch_size) : random() % 300, data.size() - offset);
+		if (random() % 2 == 0) {
+			sink.write(data.data() + offset, size);
+		} else {
+			struct iovec chunks[3] = {
+				{ const_cast<char *>(data.data()) + offset, size/2 },
+				{ nullptr, 0 },
+				{ const_cast<char *>(data.data()) + offset + size/2, size - size/2 },
+			};
+			sink.write(chunks, 3);
+		}
+		offset += size;
+		uint64_t file_size = boost::filesystem::file_size(path);
+		check(sink.position() == offset && file_size <= offset && offset - file_size <= batch_size,
+			"the staged bytes are not written by batches");
+	}
+	sink.flush();
+	check(file_bytes(path) == data, "the file differs from the written bytes");
+	check(spans("sink.writev") <= data.size()/batch_size + 1, "writev is called for less than a batch");
+}
+
+// Write unaligned chunks in direct mode: only aligned blocks reach the
+// file until the flush writes the tail, which ends the direct mode.
+static void check_direct(const std::string &path, const std::string &data, size_t batch_size) {
+	audio::VectoredSink sink(path, batch_size, true);
+	if (! sink.direct()) {
+		std::cerr << "O_DIRECT is not supported, the direct mode is not tested" << std::endl;
+	}
+	for (size_t offset = 0, size = 1; offset < data.size(); offset += size, size = size*3 + 5) {
+		size = std::min(size, data.size() - offset);
+		sink.write(data.data() + offset, size);
+		if (sink.direct()) {
+			check(boost::filesystem::file_size(path) % audio::VectoredSink::DirectAlignment == 0,
+				"an unaligned block is written in direct mode");
+		}
+	}
+	bool direct = sink.direct();
+	sink.flush();
+	check(file_bytes(path) == data, "the file differs from the written bytes in direct mode");
+	if (direct) {
+		check(sink.direct() == (data.size() % audio::VectoredSink::DirectAlignment == 0),
+			"the direct mode does not end with an unaligned tail");
+	}
+}
+
+int main() {
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	std::string path = (directory/"out").string();
+	std::mt19937 random(1);
+	std::string data(200000, 0);
+
+	for (char &byte : data) {
+		byte = random();
+	}
+	boost::filesystem::create_directories(directory);
+	audio::Trace::enable(true);
+	try {
+		for (size_t batch_size : { (size_t)audio::VectoredSink::DirectAlignment, (size_t)3*audio::VectoredSink::DirectAlignment }) {
+			check_batches(path, data, batch_size);
+			check_direct(path, data, batch_size);
+			check_direct(path, data.substr(0, 10*audio::VectoredSink::DirectAlignment), batch_size);
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioDecoder.h>
+#include <codec/AudioVirtualBuffer.h>
+
+using namespace com::nealrame;
+
+// Read random ranges of a virtual buffer, interleaved and planar, and
+// compare them with the same ranges of the whole decode.
+static unsigned int check_reads(const audio::VirtualBuffer &track, const audio::Buffer &expected, unsigned int seed) {
+	std::mt19937 random(seed);
+	unsigned int channel_count = expected.format().channelCount();
+	unsigned int failures = 0;
+
+	for (unsigned int i = 0; i < 200; ++i) {
+		unsigned int offset = random() % (expected.frameCount() + 100);
+		unsigned int count = random() % (3*track.pageFrameCount());
+		std::vector<int16_t> samples(count*channel_count), reference(count*channel_count);
+		std::vector<std::vector<float>> planes(channel_count, std::vector<float>(count)), reference_planes(planes);
+		std::vector<float *> dst, reference_dst;
+		for (unsigned int c = 0; c < channel_count; ++c) {
+			dst.push_back(planes[c].data());
+			reference_dst.push_back(reference_planes[c].data());
+		}
+
+		unsigned int n = track.read(offset, count, samples.data());
+		unsigned int m = track.read(offset, count, dst.data());
+		if (n != expected.read(offset, count, reference.data())
+				|| m != expected.read(offset, count, reference_dst.data())
+				|| samples != reference
+				|| planes != reference_planes) {
+			failures++;
+		}
+	}
+	return failures;
+}
+
+// Share one virtual buffer of each random access format between threads
+// reading random ranges, with small pages and a budget of a few pages so
+// that pages are evicted and decoded again meanwhile.
+int main() {
+	static const char *extensions[] = { ".wav", ".flac" };
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	unsigned int failures = 0;
+
+	boost::filesystem::create_directories(directory);
+	try {
+		for (const char *extension : extensions) {
+			std::string path = (directory/(std::string("noise") + extension)).string();
+			audio::Generator(audio::Generator::Signal::PinkNoise).generate(audio::Format(2, 44100, 16), 3, path);
+
+			std::unique_ptr<audio::Decoder> decoder(audio::Decoder::getDecoder(path));
+			std::unique_ptr<audio::Buffer> expected(decoder->decode(path));
+			audio::VirtualBuffer track(path, 4*expected->format().sizeForFrameCount(4096), 4096);
+			if (track.frameCount() != expected->frameCount()) {
+				std::cerr << extension << ": " << track.frameCount() << " frames, expected " << expected->frameCount() << std::endl;
+				failures++;
+				continue;
+			}
+
+			unsigned int previous_failures = failures;
+			std::mutex mutex;
+			std::vector<std::thread> threads;
+			for (unsigned int t = 0; t < 8; ++t) {
+				threads.push_back(std::thread([&, t]() {
+					unsigned int thread_failures = 0;
+					try {
+						thread_failures = check_reads(track, *expected, t + 1);
+					} catch (audio::Error &e) {
+						std::lock_guard<std::mutex> lock(mutex);
+						std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+						thread_failures++;
+					}
+					std::lock_guard<std::mutex> lock(mutex);
+					failures += thread_failures;
+				}));
+			}
+			for (std::thread &thread : threads) {
+				thread.join();
+			}
+			if (failures > previous_failures) {
+				std::cerr << extension << ": " << failures - previous_failures << " reads differ from the whole decode" << std::endl;
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
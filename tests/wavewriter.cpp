@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <AudioBuffer.h>
+#include <AudioError.h>
+#include <AudioGenerator.h>
+#include <codec/AudioPCMCoder.h>
+#include <codec/AudioWaveWriter.h>
+
+using namespace com::nealrame;
+
+static std::string file_bytes(const std::string &path) {
+	std::ifstream ifs(path.data(), std::ifstream::binary);
+	return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+// Write buffers by several writes of uneven sizes, spanning several
+// ranges written at once, as integer frames and as undithered float
+// frames, and compare the files (headers, data and size) with the
+// encoding of the whole buffer.
+int main() {
+	static const unsigned int frame_counts[] = { 0, 1, 1000, 3*audio::WaveWriter::ChunkFrameCount + 17 };
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path()/boost::filesystem::unique_path();
+	std::string path = (directory/"out.wav").string();
+	int failures = 0;
+
+	boost::filesystem::create_directories(directory);
+	try {
+		for (unsigned int channel_count : { 1, 2, 6 }) {
+			for (unsigned int bit_depth : { 8, 16 }) {
+				audio::Format format(channel_count, 44100, bit_depth);
+				for (unsigned int frame_count : frame_counts) {
+					audio::Buffer buffer(format);
+					audio::Generator(audio::Generator::Signal::PinkNoise).generate(buffer, frame_count);
+					std::ostringstream encoded;
+					audio::PCMCoder().encode(buffer, encoded);
+
+					std::vector<float> samples((size_t)frame_count*channel_count);
+					buffer.read(0, frame_count, samples.data());
+
+					for (unsigned int thread_count : { 1, 3, 8 }) {
+						for (bool floats : { false, true }) {
+							{
+								audio::WaveWriter writer(path, format, thread_count, audio::Requantizer::Dither::None);
+								if (thread_count == 3) {
+									writer.reserve(frame_count);
+								}
+								for (unsigned int offset = 0, count = 1; offset < frame_count; offset += count, count = count*5 + 3) {
+									count = std::min(count, frame_count - offset);
+									if (floats) {
+										writer.write(count, samples.data() + (size_t)offset*channel_count);
+									} else {
+										audio::Buffer part(format);
+										std::vector<int16_t> frames((size_t)count*channel_count);
+										buffer.read(offset, count, frames.data());
+										part.write(0, count, frames.data());
+										writer.write(part);
+									}
+								}
+								writer.finish();
+							}
+							if (file_bytes(path) != encoded.str()) {
+								std::cerr << channel_count << " channels, " << bit_depth << " bits, " << frame_count << " frames, "
+									<< thread_count << " threads" << (floats ? ", float frames" : "")
+									<< ": the file differs from the encoded buffer" << std::endl;
+								failures++;
+							}
+						}
+					}
+				}
+			}
+		}
+	} catch (audio::Error &e) {
+		std::cerr << audio::Error::statusToString(e.status) << ": " << e.message << std::endl;
+		failures++;
+	}
+
+	boost::filesystem::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}